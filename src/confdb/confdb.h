@@ -56,6 +56,7 @@
 #define CONFDB_SERVICE_DEBUG_TIMESTAMPS "debug_timestamps"
 #define CONFDB_SERVICE_DEBUG_MICROSECONDS "debug_microseconds"
 #define CONFDB_SERVICE_DEBUG_TO_FILES "debug_to_files"
+#define CONFDB_SERVICE_DEBUG_ASYNC "debug_async"
 #define CONFDB_SERVICE_TIMEOUT "timeout"
 #define CONFDB_SERVICE_FORCE_TIMEOUT "force_timeout"
 #define CONFDB_SERVICE_RECON_RETRIES "reconnection_retries"
@@ -85,6 +86,8 @@
 #define CONFDB_RESPONDER_GET_DOMAINS_TIMEOUT "get_domains_timeout"
 #define CONFDB_RESPONDER_CLI_IDLE_TIMEOUT "client_idle_timeout"
 #define CONFDB_RESPONDER_CLI_IDLE_DEFAULT_TIMEOUT 60
+#define CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUPS "parallel_domain_lookups"
+#define CONFDB_RESPONDER_LATENCY_STATS "latency_stats"
 
 /* NSS */
 #define CONFDB_NSS_CONF_ENTRY "config/nss"
@@ -189,6 +192,7 @@
 #define CONFDB_DOMAIN_SUBDOMAIN_HOMEDIR "subdomain_homedir"
 #define CONFDB_DOMAIN_DEFAULT_SUBDOMAIN_HOMEDIR "/home/%d/%u"
 #define CONFDB_DOMAIN_IGNORE_GROUP_MEMBERS "ignore_group_members"
+#define CONFDB_DOMAIN_LAZY_GROUP_MEMBERS "lazy_group_members"
 #define CONFDB_DOMAIN_SUBDOMAIN_REFRESH "subdomain_refresh_interval"
 
 #define CONFDB_DOMAIN_USER_CACHE_TIMEOUT "entry_cache_user_timeout"
@@ -253,6 +257,7 @@ struct sss_domain_info {
     bool fqnames;
     bool mpg;
     bool ignore_group_members;
+    bool lazy_group_members;
     uint32_t id_min;
     uint32_t id_max;
 
@@ -298,6 +303,10 @@ struct sss_domain_info {
     bool has_views;
     const char *view_name;
 
+    /* Cache generations of the object types as last read from sysdb,
+     * indexed by enum sysdb_cache_type, NULL until they are read */
+    uint64_t *cache_gen;
+
     struct sss_domain_info *prev;
     struct sss_domain_info *next;
 
@@ -303,10 +303,13 @@ class SSSDConfigTestSSSDService(unittest.TestCase):
             'debug_timestamps',
             'debug_microseconds',
             'debug_to_files',
+            'debug_async',
             'command',
             'reconnection_retries',
             'fd_limit',
             'client_idle_timeout',
+            'parallel_domain_lookups',
+            'latency_stats',
             'diag_cmd',
             'description',
             'certificate_verification']
@@ -512,6 +515,7 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'store_legacy_passwords',
             'use_fully_qualified_names',
             'ignore_group_members',
+            'lazy_group_members',
             'filter_users',
             'filter_groups',
             'entry_cache_timeout',
@@ -878,6 +882,7 @@ class SSSDConfigTestSSSDDomain(unittest.TestCase):
             'store_legacy_passwords',
             'use_fully_qualified_names',
             'ignore_group_members',
+            'lazy_group_members',
             'filter_users',
             'filter_groups',
             'entry_cache_timeout',
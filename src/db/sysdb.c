@@ -744,6 +744,36 @@ int sysdb_attrs_add_lc_name_alias_safe(struct sysdb_attrs *attrs,
                                              value);
 }
 
+const char *sysdb_msg_get_lc_name_alias(struct ldb_message *msg,
+                                        const char *name)
+{
+    struct ldb_message_element *el;
+    const char *alias;
+    unsigned int i;
+
+    if (msg == NULL || name == NULL) {
+        return NULL;
+    }
+
+    el = ldb_msg_find_element(msg, SYSDB_NAME_ALIAS);
+    if (el == NULL) {
+        return NULL;
+    }
+
+    /* The aliases of case-insensitive domains are always stored in lower
+     * case, the one that matches the name is its folded form. */
+    for (i = 0; i < el->num_values; i++) {
+        alias = (const char *) el->values[i].data;
+        if (el->values[i].length == strlen(name)
+                && sss_utf8_case_eq((const uint8_t *) alias,
+                                    (const uint8_t *) name) == EOK) {
+            return alias;
+        }
+    }
+
+    return NULL;
+}
+
 int sysdb_attrs_copy_values(struct sysdb_attrs *src,
                             struct sysdb_attrs *dst,
                             const char *name)
@@ -1724,6 +1754,212 @@ done:
     return ret;
 }
 
+static const char *sysdb_cache_gen_attr(enum sysdb_cache_type type)
+{
+    switch (type) {
+    case SYSDB_CACHE_TYPE_USER:
+        return SYSDB_USERS_CACHE_GEN;
+    case SYSDB_CACHE_TYPE_GROUP:
+        return SYSDB_GROUPS_CACHE_GEN;
+    case SYSDB_CACHE_TYPE_NETGROUP:
+        return SYSDB_NETGROUPS_CACHE_GEN;
+    case SYSDB_CACHE_TYPE_SERVICE:
+        return SYSDB_SERVICES_CACHE_GEN;
+    case SYSDB_CACHE_TYPE_AUTOFSMAP:
+        return SYSDB_AUTOFSMAPS_CACHE_GEN;
+    case SYSDB_CACHE_TYPE_SSH_HOST:
+        return SYSDB_SSH_HOSTS_CACHE_GEN;
+    case SYSDB_CACHE_TYPE_SENTINEL:
+        break;
+    }
+
+    return NULL;
+}
+
+static errno_t sysdb_load_cache_generations(struct sss_domain_info *domain)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_result *res;
+    struct ldb_dn *dn;
+    const char *attrs[SYSDB_CACHE_TYPE_SENTINEL + 1];
+    uint64_t *cache_gen;
+    errno_t ret;
+    int lret;
+    int i;
+
+    for (i = 0; i < SYSDB_CACHE_TYPE_SENTINEL; i++) {
+        attrs[i] = sysdb_cache_gen_attr(i);
+    }
+    attrs[SYSDB_CACHE_TYPE_SENTINEL] = NULL;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    dn = ldb_dn_new_fmt(tmp_ctx, domain->sysdb->ldb, SYSDB_DOM_BASE,
+                        domain->name);
+    if (dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    lret = ldb_search(domain->sysdb->ldb, tmp_ctx, &res, dn, LDB_SCOPE_BASE,
+                      attrs, NULL);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    if (res->count > 1) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Got more than one reply for base search!\n");
+        ret = EIO;
+        goto done;
+    }
+
+    /* no generation was started yet if there is no value */
+    cache_gen = talloc_zero_array(tmp_ctx, uint64_t,
+                                  SYSDB_CACHE_TYPE_SENTINEL);
+    if (cache_gen == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    if (res->count == 1) {
+        for (i = 0; i < SYSDB_CACHE_TYPE_SENTINEL; i++) {
+            cache_gen[i] = ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                       attrs[i], 0);
+        }
+    }
+
+    talloc_free(domain->cache_gen);
+    domain->cache_gen = talloc_steal(domain, cache_gen);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sysdb_get_cache_generation(struct sss_domain_info *domain,
+                                   enum sysdb_cache_type type,
+                                   uint64_t *_generation)
+{
+    errno_t ret;
+
+    if (type >= SYSDB_CACHE_TYPE_SENTINEL) {
+        return EINVAL;
+    }
+
+    if (domain->cache_gen == NULL) {
+        ret = sysdb_load_cache_generations(domain);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    *_generation = domain->cache_gen[type];
+    return EOK;
+}
+
+void sysdb_reset_cache_generations(struct sss_domain_info *domain)
+{
+    talloc_zfree(domain->cache_gen);
+}
+
+errno_t sysdb_invalidate_cache(struct sss_domain_info *domain,
+                               enum sysdb_cache_type type)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message *msg;
+    const char *attr_name;
+    time_t now;
+    errno_t ret;
+    int lret;
+
+    attr_name = sysdb_cache_gen_attr(type);
+    if (attr_name == NULL) {
+        return EINVAL;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    msg = ldb_msg_new(tmp_ctx);
+    if (msg == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    msg->dn = ldb_dn_new_fmt(msg, domain->sysdb->ldb, SYSDB_DOM_BASE,
+                             domain->name);
+    if (msg->dn == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    lret = ldb_msg_add_empty(msg, attr_name, LDB_FLAG_MOD_REPLACE, NULL);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    /* Objects stored during this second are invalidated as well. Some of
+     * them may be refreshed once more than needed, but none is missed. */
+    now = time(NULL);
+    lret = ldb_msg_add_fmt(msg, attr_name, "%llu", (unsigned long long) now);
+    if (lret != LDB_SUCCESS) {
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    lret = ldb_modify(domain->sysdb->ldb, msg);
+    if (lret != LDB_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "ldb_modify failed: [%s](%d)[%s]\n",
+              ldb_strerror(lret), lret, ldb_errstring(domain->sysdb->ldb));
+        ret = sysdb_error_to_errno(lret);
+        goto done;
+    }
+
+    if (domain->cache_gen != NULL) {
+        domain->cache_gen[type] = now;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+bool sysdb_is_invalidated(struct sss_domain_info *domain,
+                          enum sysdb_cache_type type,
+                          struct ldb_message *msg)
+{
+    uint64_t generation;
+    uint64_t last_update;
+    errno_t ret;
+
+    ret = sysdb_get_cache_generation(domain, type, &generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read the cache generation of "
+              "domain %s [%d]: %s\n", domain->name, ret, sss_strerror(ret));
+        return false;
+    }
+
+    if (generation == 0) {
+        return false;
+    }
+
+    last_update = ldb_msg_find_attr_as_uint64(msg, SYSDB_LAST_UPDATE, 0);
+
+    return last_update <= generation;
+}
+
 errno_t sysdb_attrs_primary_name(struct sysdb_ctx *sysdb,
                                  struct sysdb_attrs *attrs,
                                  const char *ldap_attr,
@@ -203,6 +203,13 @@
 
 #define SYSDB_HAS_ENUMERATED "has_enumerated"
 
+#define SYSDB_USERS_CACHE_GEN "usersCacheGeneration"
+#define SYSDB_GROUPS_CACHE_GEN "groupsCacheGeneration"
+#define SYSDB_NETGROUPS_CACHE_GEN "netgroupsCacheGeneration"
+#define SYSDB_SERVICES_CACHE_GEN "servicesCacheGeneration"
+#define SYSDB_AUTOFSMAPS_CACHE_GEN "autofsMapsCacheGeneration"
+#define SYSDB_SSH_HOSTS_CACHE_GEN "sshHostsCacheGeneration"
+
 #define SYSDB_DEFAULT_ATTRS SYSDB_LAST_UPDATE, \
                             SYSDB_CACHE_EXPIRE, \
                             SYSDB_INITGR_EXPIRE, \
@@ -218,6 +225,7 @@
                         SYSDB_OVERRIDE_DN, \
                         SYSDB_OVERRIDE_OBJECT_DN, \
                         SYSDB_DEFAULT_OVERRIDE_NAME, \
+                        SYSDB_NAME_ALIAS, \
                         NULL}
 
 #define SYSDB_GRSRC_ATTRS {SYSDB_NAME, SYSDB_GIDNUM, \
@@ -229,8 +237,18 @@
                            SYSDB_OVERRIDE_DN, \
                            SYSDB_OVERRIDE_OBJECT_DN, \
                            SYSDB_DEFAULT_OVERRIDE_NAME, \
+                           SYSDB_NAME_ALIAS, \
                            NULL}
 
+#define SYSDB_GRSRC_NO_MEMBERS_ATTRS {SYSDB_NAME, SYSDB_GIDNUM, \
+                                      SYSDB_DEFAULT_ATTRS, \
+                                      SYSDB_SID_STR, \
+                                      SYSDB_OVERRIDE_DN, \
+                                      SYSDB_OVERRIDE_OBJECT_DN, \
+                                      SYSDB_DEFAULT_OVERRIDE_NAME, \
+                                      SYSDB_NAME_ALIAS, \
+                                      NULL}
+
 #define SYSDB_NETGR_ATTRS {SYSDB_NAME, SYSDB_NETGROUP_TRIPLE, \
                            SYSDB_NETGROUP_MEMBER, \
                            SYSDB_DEFAULT_ATTRS, \
@@ -334,6 +352,11 @@ int sysdb_attrs_add_lc_name_alias(struct sysdb_attrs *attrs,
                                   const char *value);
 int sysdb_attrs_add_lc_name_alias_safe(struct sysdb_attrs *attrs,
                                        const char *value);
+
+/* Returns the lower-case name alias stored with a cached entry of a
+ * case-insensitive domain for the given name or NULL if there is none. */
+const char *sysdb_msg_get_lc_name_alias(struct ldb_message *msg,
+                                        const char *name);
 int sysdb_attrs_copy_values(struct sysdb_attrs *src,
                             struct sysdb_attrs *dst,
                             const char *name);
@@ -676,6 +699,14 @@ int sysdb_enumgrent_filter_with_views(TALLOC_CTX *mem_ctx,
                                       const char *addtl_filter,
                                       struct ldb_result **res);
 
+/* Same as sysdb_enumgrent_filter_with_views() but the member lists of the
+ * groups are neither read nor resolved. */
+int sysdb_enumgrent_filter_no_members_with_views(TALLOC_CTX *mem_ctx,
+                                                 struct sss_domain_info *domain,
+                                                 const char *name_filter,
+                                                 const char *addtl_filter,
+                                                 struct ldb_result **res);
+
 struct sysdb_netgroup_ctx {
     enum {SYSDB_NETGROUP_TRIPLE_VAL, SYSDB_NETGROUP_GROUP_VAL} type;
     union {
@@ -1095,6 +1126,41 @@ errno_t sysdb_has_enumerated(struct sss_domain_info *domain,
 errno_t sysdb_set_enumerated(struct sss_domain_info *domain,
                              bool enumerated);
 
+enum sysdb_cache_type {
+    SYSDB_CACHE_TYPE_USER,
+    SYSDB_CACHE_TYPE_GROUP,
+    SYSDB_CACHE_TYPE_NETGROUP,
+    SYSDB_CACHE_TYPE_SERVICE,
+    SYSDB_CACHE_TYPE_AUTOFSMAP,
+    SYSDB_CACHE_TYPE_SSH_HOST,
+
+    SYSDB_CACHE_TYPE_SENTINEL
+};
+
+/* Each domain keeps a cache generation per object type. The generation of
+ * a cached object is its lastUpdate timestamp, objects with a generation
+ * older than or equal to the one of the domain are expired.
+ *
+ * sysdb_invalidate_cache() starts a new generation, which expires all
+ * cached objects of the given type with a single write. */
+errno_t sysdb_invalidate_cache(struct sss_domain_info *domain,
+                               enum sysdb_cache_type type);
+
+/* The generations are read from sysdb once and kept in the domain until
+ * sysdb_reset_cache_generations() is called, e.g. when the responder is
+ * told that the cache was invalidated by another process. */
+errno_t sysdb_get_cache_generation(struct sss_domain_info *domain,
+                                   enum sysdb_cache_type type,
+                                   uint64_t *_generation);
+
+void sysdb_reset_cache_generations(struct sss_domain_info *domain);
+
+/* Returns true if msg was cached before the last sysdb_invalidate_cache()
+ * call for its type. */
+bool sysdb_is_invalidated(struct sss_domain_info *domain,
+                          enum sysdb_cache_type type,
+                          struct ldb_message *msg);
+
 errno_t sysdb_remove_attrs(struct sss_domain_info *domain,
                            const char *name,
                            enum sysdb_member_type type,
@@ -762,14 +762,14 @@ done:
     return ret;
 }
 
-int sysdb_enumgrent_filter(TALLOC_CTX *mem_ctx,
-                           struct sss_domain_info *domain,
-                           const char *name_filter,
-                           const char *addtl_filter,
-                           struct ldb_result **_res)
+static int sysdb_enumgrent_filter_attrs(TALLOC_CTX *mem_ctx,
+                                        struct sss_domain_info *domain,
+                                        const char *name_filter,
+                                        const char *addtl_filter,
+                                        const char **attrs,
+                                        struct ldb_result **_res)
 {
     TALLOC_CTX *tmp_ctx;
-    static const char *attrs[] = SYSDB_GRSRC_ATTRS;
     const char *filter = NULL;
     const char *base_filter;
     struct ldb_dn *base_dn;
@@ -821,6 +821,18 @@ done:
     return ret;
 }
 
+int sysdb_enumgrent_filter(TALLOC_CTX *mem_ctx,
+                           struct sss_domain_info *domain,
+                           const char *name_filter,
+                           const char *addtl_filter,
+                           struct ldb_result **_res)
+{
+    static const char *attrs[] = SYSDB_GRSRC_ATTRS;
+
+    return sysdb_enumgrent_filter_attrs(mem_ctx, domain, name_filter,
+                                        addtl_filter, attrs, _res);
+}
+
 int sysdb_enumgrent(TALLOC_CTX *mem_ctx,
                     struct sss_domain_info *domain,
                     struct ldb_result **_res)
@@ -828,11 +840,14 @@ int sysdb_enumgrent(TALLOC_CTX *mem_ctx,
     return sysdb_enumgrent_filter(mem_ctx, domain, NULL, 0, _res);
 }
 
-int sysdb_enumgrent_filter_with_views(TALLOC_CTX *mem_ctx,
-                                      struct sss_domain_info *domain,
-                                      const char *name_filter,
-                                      const char *addtl_filter,
-                                      struct ldb_result **_res)
+static int
+sysdb_enumgrent_filter_attrs_with_views(TALLOC_CTX *mem_ctx,
+                                        struct sss_domain_info *domain,
+                                        const char *name_filter,
+                                        const char *addtl_filter,
+                                        const char **attrs,
+                                        bool members,
+                                        struct ldb_result **_res)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_result *res;
@@ -845,7 +860,8 @@ int sysdb_enumgrent_filter_with_views(TALLOC_CTX *mem_ctx,
         return ENOMEM;
     }
 
-    ret = sysdb_enumgrent_filter(tmp_ctx, domain, name_filter, addtl_filter, &res);
+    ret = sysdb_enumgrent_filter_attrs(tmp_ctx, domain, name_filter,
+                                       addtl_filter, attrs, &res);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "sysdb_enumgrent failed.\n");
         goto done;
@@ -862,6 +878,10 @@ int sysdb_enumgrent_filter_with_views(TALLOC_CTX *mem_ctx,
                 goto done;
             }
 
+            if (!members) {
+                continue;
+            }
+
             ret = sysdb_add_group_member_overrides(domain, res->msgs[c]);
             if (ret != EOK) {
                 DEBUG(SSSDBG_OP_FAILURE,
@@ -879,6 +899,32 @@ done:
     return ret;
 }
 
+int sysdb_enumgrent_filter_with_views(TALLOC_CTX *mem_ctx,
+                                      struct sss_domain_info *domain,
+                                      const char *name_filter,
+                                      const char *addtl_filter,
+                                      struct ldb_result **_res)
+{
+    static const char *attrs[] = SYSDB_GRSRC_ATTRS;
+
+    return sysdb_enumgrent_filter_attrs_with_views(mem_ctx, domain,
+                                                   name_filter, addtl_filter,
+                                                   attrs, true, _res);
+}
+
+int sysdb_enumgrent_filter_no_members_with_views(TALLOC_CTX *mem_ctx,
+                                                 struct sss_domain_info *domain,
+                                                 const char *name_filter,
+                                                 const char *addtl_filter,
+                                                 struct ldb_result **_res)
+{
+    static const char *attrs[] = SYSDB_GRSRC_NO_MEMBERS_ATTRS;
+
+    return sysdb_enumgrent_filter_attrs_with_views(mem_ctx, domain,
+                                                   name_filter, addtl_filter,
+                                                   attrs, false, _res);
+}
+
 int sysdb_enumgrent_with_views(TALLOC_CTX *mem_ctx,
                                struct sss_domain_info *domain,
                                struct ldb_result **_res)
@@ -22,6 +22,7 @@
 
 #include <talloc.h>
 #include <time.h>
+#include <sys/time.h>
 
 #include "db/sysdb.h"
 #include "db/sysdb_private.h"
@@ -429,9 +430,9 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t value)
+static errno_t sysdb_sudo_set_value(struct sss_domain_info *domain,
+                                    const char *attr_name,
+                                    uint64_t value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -487,7 +488,7 @@ static errno_t sysdb_sudo_set_refresh_time(struct sss_domain_info *domain,
         }
     }
 
-    lret = ldb_msg_add_fmt(msg, attr_name, "%lld", (long long)value);
+    lret = ldb_msg_add_fmt(msg, attr_name, "%llu", (unsigned long long)value);
     if (lret != LDB_SUCCESS) {
         ret = sysdb_error_to_errno(lret);
         goto done;
@@ -511,9 +512,9 @@ done:
     return ret;
 }
 
-static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
-                                           const char *attr_name,
-                                           time_t *value)
+static errno_t sysdb_sudo_get_value(struct sss_domain_info *domain,
+                                    const char *attr_name,
+                                    uint64_t *value)
 {
     TALLOC_CTX *tmp_ctx;
     struct ldb_dn *dn;
@@ -557,7 +558,7 @@ static errno_t sysdb_sudo_get_refresh_time(struct sss_domain_info *domain,
         goto done;
     }
 
-    *value = ldb_msg_find_attr_as_int(res->msgs[0], attr_name, 0);
+    *value = ldb_msg_find_attr_as_uint64(res->msgs[0], attr_name, 0);
 
     ret = EOK;
 
@@ -569,15 +570,65 @@ done:
 errno_t sysdb_sudo_set_last_full_refresh(struct sss_domain_info *domain,
                                          time_t value)
 {
-    return sysdb_sudo_set_refresh_time(domain,
-                                       SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
+    return sysdb_sudo_set_value(domain, SYSDB_SUDO_AT_LAST_FULL_REFRESH,
+                                value);
 }
 
 errno_t sysdb_sudo_get_last_full_refresh(struct sss_domain_info *domain,
                                          time_t *value)
 {
-    return sysdb_sudo_get_refresh_time(domain,
-                                       SYSDB_SUDO_AT_LAST_FULL_REFRESH, value);
+    uint64_t val;
+    errno_t ret;
+
+    ret = sysdb_sudo_get_value(domain, SYSDB_SUDO_AT_LAST_FULL_REFRESH, &val);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *value = val;
+    return EOK;
+}
+
+/* The generation changes whenever the cached rules are modified so that the
+ * sudo responder knows when to reload them. A timestamp in microseconds is
+ * used instead of a counter because the whole rules subtree, including the
+ * attribute, is removed when all rules are purged. */
+static errno_t sysdb_sudo_bump_generation(struct sss_domain_info *domain,
+                                          const char *attr_name)
+{
+    struct timeval tv;
+    uint64_t generation;
+
+    gettimeofday(&tv, NULL);
+    generation = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    return sysdb_sudo_set_value(domain, attr_name, generation);
+}
+
+static errno_t sysdb_sudo_bump_rules_generation(struct sss_domain_info *domain)
+{
+    return sysdb_sudo_bump_generation(domain, SYSDB_SUDO_AT_RULES_GENERATION);
+}
+
+/* Changes when unchanged rules were stored again with a new expiration. */
+static errno_t sysdb_sudo_bump_expire_generation(struct sss_domain_info *domain)
+{
+    return sysdb_sudo_bump_generation(domain,
+                                      SYSDB_SUDO_AT_EXPIRE_GENERATION);
+}
+
+errno_t sysdb_sudo_get_rules_generation(struct sss_domain_info *domain,
+                                        uint64_t *_generation)
+{
+    return sysdb_sudo_get_value(domain, SYSDB_SUDO_AT_RULES_GENERATION,
+                                _generation);
+}
+
+errno_t sysdb_sudo_get_expire_generation(struct sss_domain_info *domain,
+                                         uint64_t *_generation)
+{
+    return sysdb_sudo_get_value(domain, SYSDB_SUDO_AT_EXPIRE_GENERATION,
+                                _generation);
 }
 
 /* ====================  Purge functions ==================== */
@@ -636,10 +687,72 @@ sysdb_sudo_purge_byname(struct sss_domain_info *domain,
     return sysdb_delete_custom(domain, name, SUDORULE_SUBDIR);
 }
 
+/* Names of the rules that are stored right after the purge. They are kept
+ * in the cache and replaced by sysdb_sudo_store() only if they changed, so
+ * that a refresh of unchanged rules does not invalidate the responder's
+ * index of the rules. */
+static errno_t
+sysdb_sudo_rule_names(TALLOC_CTX *mem_ctx,
+                      struct sysdb_attrs **rules,
+                      size_t num_rules,
+                      hash_table_t **_names)
+{
+    hash_table_t *names;
+    hash_key_t key;
+    hash_value_t value;
+    const char *name;
+    errno_t ret;
+    size_t i;
+    int hret;
+
+    ret = sss_hash_create(mem_ctx, num_rules, &names);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    value.type = HASH_VALUE_UNDEF;
+    key.type = HASH_KEY_STRING;
+    for (i = 0; i < num_rules; i++) {
+        name = sysdb_sudo_get_rule_name(rules[i]);
+        if (name == NULL) {
+            continue;
+        }
+
+        key.str = discard_const(name);
+        hret = hash_enter(names, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to remember rule %s [%d]: %s\n",
+                  name, hret, hash_error_string(hret));
+            talloc_free(names);
+            return EIO;
+        }
+    }
+
+    *_names = names;
+    return EOK;
+}
+
+static bool
+sysdb_sudo_rule_is_kept(hash_table_t *keep, const char *name)
+{
+    hash_key_t key;
+
+    if (keep == NULL) {
+        return false;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+
+    return hash_has_key(keep, &key);
+}
+
 static errno_t
 sysdb_sudo_purge_byrules(struct sss_domain_info *dom,
                          struct sysdb_attrs **rules,
-                         size_t num_rules)
+                         size_t num_rules,
+                         hash_table_t *keep,
+                         bool *_deleted)
 {
     const char *name;
     errno_t ret;
@@ -657,12 +770,18 @@ sysdb_sudo_purge_byrules(struct sss_domain_info *dom,
             continue;
         }
 
+        if (sysdb_sudo_rule_is_kept(keep, name)) {
+            continue;
+        }
+
         ret = sysdb_sudo_purge_byname(dom, name);
         if (ret != EOK) {
             DEBUG(SSSDBG_MINOR_FAILURE, "Failed to delete rule "
                   "%s [%d]: %s\n", name, ret, sss_strerror(ret));
             continue;
         }
+
+        *_deleted = true;
     }
 
     return EOK;
@@ -670,7 +789,9 @@ sysdb_sudo_purge_byrules(struct sss_domain_info *dom,
 
 static errno_t
 sysdb_sudo_purge_byfilter(struct sss_domain_info *domain,
-                          const char *filter)
+                          const char *filter,
+                          hash_table_t *keep,
+                          bool *_deleted)
 {
     TALLOC_CTX *tmp_ctx;
     struct sysdb_attrs **rules;
@@ -683,7 +804,13 @@ sysdb_sudo_purge_byfilter(struct sss_domain_info *domain,
                             NULL };
 
     if (filter == NULL || strcmp(filter, SUDO_ALL_FILTER) == 0) {
-        return sysdb_sudo_purge_all(domain);
+        if (keep == NULL || hash_count(keep) == 0) {
+            *_deleted = true;
+            return sysdb_sudo_purge_all(domain);
+        }
+
+        /* only the rules that are not stored again are removed */
+        filter = SUDO_ALL_FILTER;
     }
 
     tmp_ctx = talloc_new(NULL);
@@ -711,7 +838,7 @@ sysdb_sudo_purge_byfilter(struct sss_domain_info *domain,
         goto done;
     }
 
-    ret = sysdb_sudo_purge_byrules(domain, rules, count);
+    ret = sysdb_sudo_purge_byrules(domain, rules, count, keep, _deleted);
 
 done:
     talloc_free(tmp_ctx);
@@ -723,27 +850,49 @@ errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
                          struct sysdb_attrs **rules,
                          size_t num_rules)
 {
+    TALLOC_CTX *tmp_ctx;
+    hash_table_t *keep;
     bool in_transaction = false;
+    bool deleted = false;
     errno_t sret;
     errno_t ret;
 
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_sudo_rule_names(tmp_ctx, rules, num_rules, &keep);
+    if (ret != EOK) {
+        goto done;
+    }
+
     ret = sysdb_transaction_start(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
-        return ret;
+        goto done;
     }
     in_transaction = true;
 
     if (delete_filter) {
-        ret = sysdb_sudo_purge_byfilter(domain, delete_filter);
+        ret = sysdb_sudo_purge_byfilter(domain, delete_filter, keep,
+                                        &deleted);
     } else {
-        ret = sysdb_sudo_purge_byrules(domain, rules, num_rules);
+        ret = sysdb_sudo_purge_byrules(domain, rules, num_rules, keep,
+                                       &deleted);
     }
 
     if (ret != EOK) {
         goto done;
     }
 
+    if (deleted) {
+        ret = sysdb_sudo_bump_rules_generation(domain);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
     ret = sysdb_transaction_commit(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
@@ -764,6 +913,7 @@ done:
               ret, sss_strerror(ret));
     }
 
+    talloc_free(tmp_ctx);
     return ret;
 }
 
@@ -801,13 +951,99 @@ sysdb_sudo_add_sss_attrs(struct sysdb_attrs *rule,
     return EOK;
 }
 
+/* attributes added by sysdb_sudo_add_sss_attrs() */
+static bool
+sysdb_sudo_is_sss_attr(const char *name)
+{
+    return strcasecmp(name, SYSDB_OBJECTCLASS) == 0
+           || strcasecmp(name, SYSDB_NAME) == 0
+           || strcasecmp(name, SYSDB_CACHE_EXPIRE) == 0;
+}
+
+/* Compares the rule with its cached version, the attributes maintained by
+ * SSSD are not compared. */
+static errno_t
+sysdb_sudo_rule_cmp_cached(struct sss_domain_info *domain,
+                           const char *name,
+                           struct sysdb_attrs *rule,
+                           bool *_cached,
+                           bool *_changed)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *attrs[] = { "*", NULL };
+    struct ldb_message **msgs;
+    struct ldb_message_element *el;
+    struct ldb_message_element *cached_el;
+    size_t count;
+    unsigned int num_cached = 0;
+    unsigned int num_rule = 0;
+    unsigned int i;
+    unsigned int j;
+    int k;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sysdb_search_custom_by_name(tmp_ctx, domain, name, SUDORULE_SUBDIR,
+                                      attrs, &count, &msgs);
+    if (ret == ENOENT) {
+        *_cached = false;
+        *_changed = true;
+        ret = EOK;
+        goto done;
+    } else if (ret != EOK) {
+        goto done;
+    }
+
+    *_cached = true;
+    *_changed = true;
+
+    for (i = 0; i < msgs[0]->num_elements; i++) {
+        if (!sysdb_sudo_is_sss_attr(msgs[0]->elements[i].name)) {
+            num_cached++;
+        }
+    }
+
+    for (k = 0; k < rule->num; k++) {
+        el = &rule->a[k];
+        if (sysdb_sudo_is_sss_attr(el->name)) {
+            continue;
+        }
+        num_rule++;
+
+        cached_el = ldb_msg_find_element(msgs[0], el->name);
+        if (cached_el == NULL || cached_el->num_values != el->num_values) {
+            goto done;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            if (ldb_msg_find_val(cached_el, &el->values[j]) == NULL) {
+                goto done;
+            }
+        }
+    }
+
+    /* an attribute was removed on the server */
+    *_changed = num_rule != num_cached;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 static errno_t
 sysdb_sudo_store_rule(struct sss_domain_info *domain,
                       struct sysdb_attrs *rule,
                       int cache_timeout,
-                      time_t now)
+                      time_t now,
+                      bool *_changed)
 {
     const char *name;
+    bool cached;
+    bool changed;
     errno_t ret;
 
     name = sysdb_sudo_get_rule_name(rule);
@@ -817,6 +1053,27 @@ sysdb_sudo_store_rule(struct sss_domain_info *domain,
 
     DEBUG(SSSDBG_TRACE_FUNC, "Adding sudo rule %s\n", name);
 
+    ret = sysdb_sudo_rule_cmp_cached(domain, name, rule, &cached, &changed);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to compare rule %s [%d]: %s\n",
+              name, ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (cached && changed) {
+        /* attributes removed on the server must not stay in the cache */
+        ret = sysdb_sudo_purge_byname(domain, name);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to replace rule %s [%d]: %s\n",
+                  name, ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+
+    if (changed) {
+        *_changed = true;
+    }
+
     ret = sysdb_sudo_add_sss_attrs(rule, name, cache_timeout, now);
     if (ret != EOK) {
         return ret;
@@ -838,6 +1095,7 @@ sysdb_sudo_store(struct sss_domain_info *domain,
                  size_t num_rules)
 {
     bool in_transaction = false;
+    bool changed = false;
     errno_t sret;
     errno_t ret;
     time_t now;
@@ -857,7 +1115,7 @@ sysdb_sudo_store(struct sss_domain_info *domain,
     now = time(NULL);
     for (i = 0; i < num_rules; i++) {
         ret = sysdb_sudo_store_rule(domain, rules[i],
-                                    domain->sudo_timeout, now);
+                                    domain->sudo_timeout, now, &changed);
         if (ret == EINVAL) {
             /* Multiple CNs are error on server side, we can just ignore this
              * rule and save the others. Loud debug message is in logs. */
@@ -867,6 +1125,16 @@ sysdb_sudo_store(struct sss_domain_info *domain,
         }
     }
 
+    if (changed) {
+        ret = sysdb_sudo_bump_rules_generation(domain);
+    } else {
+        /* only the expiration of the rules was refreshed */
+        ret = sysdb_sudo_bump_expire_generation(domain);
+    }
+    if (ret != EOK) {
+        goto done;
+    }
+
     ret = sysdb_transaction_commit(domain->sysdb);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
@@ -31,6 +31,8 @@
  * should be true if we have downloaded all rules atleast once */
 #define SYSDB_SUDO_AT_REFRESHED      "refreshed"
 #define SYSDB_SUDO_AT_LAST_FULL_REFRESH "sudoLastFullRefreshTime"
+#define SYSDB_SUDO_AT_RULES_GENERATION "sudoRulesGeneration"
+#define SYSDB_SUDO_AT_EXPIRE_GENERATION "sudoExpireGeneration"
 
 /* sysdb attributes */
 #define SYSDB_SUDO_CACHE_OC            "sudoRule"
@@ -112,6 +114,12 @@ errno_t sysdb_sudo_set_last_full_refresh(struct sss_domain_info *domain,
 errno_t sysdb_sudo_get_last_full_refresh(struct sss_domain_info *domain,
                                          time_t *value);
 
+errno_t sysdb_sudo_get_rules_generation(struct sss_domain_info *domain,
+                                        uint64_t *_generation);
+
+errno_t sysdb_sudo_get_expire_generation(struct sss_domain_info *domain,
+                                         uint64_t *_generation);
+
 errno_t sysdb_sudo_purge(struct sss_domain_info *domain,
                          const char *delete_filter,
                          struct sysdb_attrs **rules,
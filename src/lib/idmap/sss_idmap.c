@@ -58,8 +58,27 @@ struct idmap_domain_info {
 
     idmap_store_cb cb;
     void *pvt;
+
+    /* lookup index data, see idmap_index_add() */
+    uint64_t seq;
+    bool sid_indexed;
+    uint32_t sid_key[3];
+    struct idmap_domain_info *hash_next;
 };
 
+/* Entry of the table of primary ranges used for unix->SID lookups. max_upto
+ * is the highest max_id of this and all preceding entries which allows to
+ * stop the backward scan early even if ranges overlap. */
+struct idmap_range_entry {
+    uint32_t min_id;
+    uint32_t max_id;
+    uint32_t max_upto;
+    struct idmap_domain_info *dom;
+};
+
+#define IDMAP_INDEX_MIN_BUCKETS 16
+#define IDMAP_INDEX_MIN_RANGES 16
+
 static void *default_alloc(size_t size, void *pvt)
 {
     return malloc(size);
@@ -319,6 +338,8 @@ enum idmap_error_code sss_idmap_free(struct sss_idmap_ctx *ctx)
         sss_idmap_free_domain(ctx, dom);
     }
 
+    ctx->free_func(ctx->sid_buckets, ctx->alloc_pvt);
+    ctx->free_func(ctx->ranges, ctx->alloc_pvt);
     ctx->free_func(ctx, ctx->alloc_pvt);
 
     return IDMAP_SUCCESS;
@@ -698,6 +719,260 @@ fail:
     return err;
 }
 
+/* Parse the three sub-authorities following DOM_SID_PREFIX. Only the
+ * canonical representation (decimal numbers without leading zeros) is
+ * accepted so that equal keys always mean equal SID strings. The length of
+ * the parsed domain part is returned in _len. */
+static bool parse_sid_key(const char *sid, uint32_t key[3], size_t *_len)
+{
+    const char *p;
+    uint64_t val;
+    size_t c;
+
+    if (sid == NULL || strncmp(sid, DOM_SID_PREFIX, DOM_SID_PREFIX_LEN) != 0) {
+        return false;
+    }
+
+    p = sid + DOM_SID_PREFIX_LEN;
+    for (c = 0; c < 3; c++) {
+        if (c > 0) {
+            if (*p != '-') {
+                return false;
+            }
+            p++;
+        }
+
+        if (*p < '0' || *p > '9' || (*p == '0' && p[1] >= '0' && p[1] <= '9')) {
+            return false;
+        }
+
+        val = 0;
+        while (*p >= '0' && *p <= '9') {
+            val = val * 10 + (*p - '0');
+            if (val > UINT32_MAX) {
+                return false;
+            }
+            p++;
+        }
+
+        key[c] = val;
+    }
+
+    *_len = p - sid;
+    return true;
+}
+
+static size_t sid_key_bucket(const uint32_t key[3], size_t bucket_count)
+{
+    /* bucket_count is always a power of 2 */
+    return murmurhash3((const char *) key, 3 * sizeof(uint32_t), 0xdeadbeef)
+               & (bucket_count - 1);
+}
+
+static bool sid_key_eq(const uint32_t a[3], const uint32_t b[3])
+{
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+/* Make sure there is room for one more domain in both indexes. Nothing is
+ * changed in the indexes themselves so a failure here leaves them intact. */
+static enum idmap_error_code idmap_index_reserve(struct sss_idmap_ctx *ctx,
+                                                 bool add_sid)
+{
+    struct idmap_domain_info **buckets;
+    struct idmap_domain_info *dom;
+    struct idmap_domain_info *prev;
+    struct idmap_domain_info *next;
+    struct idmap_range_entry *ranges;
+    size_t count;
+    size_t b;
+
+    if (ctx->range_count == ctx->range_size) {
+        count = ctx->range_size == 0 ? IDMAP_INDEX_MIN_RANGES
+                                     : 2 * ctx->range_size;
+        ranges = ctx->alloc_func(count * sizeof(struct idmap_range_entry),
+                                 ctx->alloc_pvt);
+        if (ranges == NULL) {
+            return IDMAP_OUT_OF_MEMORY;
+        }
+
+        if (ctx->range_count > 0) {
+            memcpy(ranges, ctx->ranges,
+                   ctx->range_count * sizeof(struct idmap_range_entry));
+        }
+        ctx->free_func(ctx->ranges, ctx->alloc_pvt);
+        ctx->ranges = ranges;
+        ctx->range_size = count;
+    }
+
+    if (!add_sid || ctx->sid_indexed < ctx->sid_bucket_count) {
+        return IDMAP_SUCCESS;
+    }
+
+    count = ctx->sid_bucket_count == 0 ? IDMAP_INDEX_MIN_BUCKETS
+                                       : 2 * ctx->sid_bucket_count;
+    buckets = ctx->alloc_func(count * sizeof(struct idmap_domain_info *),
+                              ctx->alloc_pvt);
+    if (buckets == NULL) {
+        return IDMAP_OUT_OF_MEMORY;
+    }
+    memset(buckets, 0, count * sizeof(struct idmap_domain_info *));
+
+    /* Rehash from the domain list and reverse the chains afterwards, this
+     * way every chain keeps the order of the domain list, i.e. the most
+     * recently added domain first. */
+    for (dom = ctx->idmap_domain_info; dom != NULL; dom = dom->next) {
+        if (dom->sid_indexed) {
+            b = sid_key_bucket(dom->sid_key, count);
+            dom->hash_next = buckets[b];
+            buckets[b] = dom;
+        }
+    }
+
+    for (b = 0; b < count; b++) {
+        prev = NULL;
+        for (dom = buckets[b]; dom != NULL; dom = next) {
+            next = dom->hash_next;
+            dom->hash_next = prev;
+            prev = dom;
+        }
+        buckets[b] = prev;
+    }
+
+    ctx->free_func(ctx->sid_buckets, ctx->alloc_pvt);
+    ctx->sid_buckets = buckets;
+    ctx->sid_bucket_count = count;
+
+    return IDMAP_SUCCESS;
+}
+
+/* Add a new domain to the indexes, idmap_index_reserve() must have been
+ * called before and the domain must be the new head of the domain list. */
+static void idmap_index_add(struct sss_idmap_ctx *ctx,
+                            struct idmap_domain_info *dom)
+{
+    struct idmap_range_entry *entry;
+    size_t pos;
+    size_t lo;
+    size_t hi;
+    size_t b;
+
+    dom->seq = ++ctx->dom_seq;
+
+    if (dom->sid_indexed) {
+        b = sid_key_bucket(dom->sid_key, ctx->sid_bucket_count);
+        dom->hash_next = ctx->sid_buckets[b];
+        ctx->sid_buckets[b] = dom;
+        ctx->sid_indexed++;
+    } else if (dom->sid != NULL) {
+        ctx->sid_unindexed++;
+    }
+
+    /* insert after all entries with a lower or equal min_id */
+    lo = 0;
+    hi = ctx->range_count;
+    while (lo < hi) {
+        pos = lo + (hi - lo) / 2;
+        if (ctx->ranges[pos].min_id <= dom->range_params.min_id) {
+            lo = pos + 1;
+        } else {
+            hi = pos;
+        }
+    }
+
+    memmove(&ctx->ranges[lo + 1], &ctx->ranges[lo],
+            (ctx->range_count - lo) * sizeof(struct idmap_range_entry));
+    ctx->range_count++;
+
+    entry = &ctx->ranges[lo];
+    entry->min_id = dom->range_params.min_id;
+    entry->max_id = dom->range_params.max_id;
+    entry->dom = dom;
+
+    for (pos = lo; pos < ctx->range_count; pos++) {
+        entry = &ctx->ranges[pos];
+        entry->max_upto = entry->max_id;
+        if (pos > 0 && ctx->ranges[pos - 1].max_upto > entry->max_upto) {
+            entry->max_upto = ctx->ranges[pos - 1].max_upto;
+        }
+    }
+}
+
+/* Return the first domain in list order whose SID matches the given key. The
+ * domains with the same key can be iterated with idmap_index_next_sid(). */
+static struct idmap_domain_info *
+idmap_index_first_sid(struct sss_idmap_ctx *ctx, const uint32_t key[3])
+{
+    struct idmap_domain_info *dom;
+
+    if (ctx->sid_bucket_count == 0) {
+        return NULL;
+    }
+
+    dom = ctx->sid_buckets[sid_key_bucket(key, ctx->sid_bucket_count)];
+    while (dom != NULL && !sid_key_eq(dom->sid_key, key)) {
+        dom = dom->hash_next;
+    }
+
+    return dom;
+}
+
+static struct idmap_domain_info *
+idmap_index_next_sid(struct idmap_domain_info *dom)
+{
+    struct idmap_domain_info *next;
+
+    for (next = dom->hash_next; next != NULL; next = next->hash_next) {
+        if (sid_key_eq(next->sid_key, dom->sid_key)) {
+            return next;
+        }
+    }
+
+    return NULL;
+}
+
+/* Return the most recently added domain whose primary range contains id,
+ * this is the domain a linear search of the domain list would find first. */
+static struct idmap_domain_info *
+idmap_index_find_id(struct sss_idmap_ctx *ctx, uint32_t id)
+{
+    struct idmap_domain_info *found = NULL;
+    struct idmap_range_entry *entry;
+    size_t lo;
+    size_t hi;
+    size_t mid;
+
+    if (id == 0) {
+        return NULL;
+    }
+
+    lo = 0;
+    hi = ctx->range_count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (ctx->ranges[mid].min_id <= id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    /* all entries before lo start at or below id */
+    while (lo > 0) {
+        entry = &ctx->ranges[--lo];
+        if (entry->max_upto < id) {
+            break;
+        }
+
+        if (entry->max_id >= id
+                && (found == NULL || entry->dom->seq > found->seq)) {
+            found = entry->dom;
+        }
+    }
+
+    return found;
+}
+
 enum idmap_error_code sss_idmap_add_domain_ex(struct sss_idmap_ctx *ctx,
                                               const char *domain_name,
                                               const char *domain_sid,
@@ -708,6 +983,7 @@ enum idmap_error_code sss_idmap_add_domain_ex(struct sss_idmap_ctx *ctx,
 {
     struct idmap_domain_info *dom = NULL;
     enum idmap_error_code err;
+    size_t sid_len;
 
     CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
 
@@ -767,8 +1043,18 @@ enum idmap_error_code sss_idmap_add_domain_ex(struct sss_idmap_ctx *ctx,
         goto fail;
     }
 
+    if (dom->sid != NULL && parse_sid_key(dom->sid, dom->sid_key, &sid_len)) {
+        dom->sid_indexed = (dom->sid[sid_len] == '\0');
+    }
+
+    err = idmap_index_reserve(ctx, dom->sid_indexed);
+    if (err != IDMAP_SUCCESS) {
+        goto fail;
+    }
+
     dom->next = ctx->idmap_domain_info;
     ctx->idmap_domain_info = dom;
+    idmap_index_add(ctx, dom);
 
     return IDMAP_SUCCESS;
 
@@ -1052,12 +1338,25 @@ done:
     return err;
 }
 
+/* Check if the domains matching the given SID can be found with the SID
+ * index. This is not possible if the SID is not in canonical form or if
+ * there are domains with a SID which was not indexed. */
+static bool use_sid_index(struct sss_idmap_ctx *ctx, const char *sid,
+                          uint32_t key[3], size_t *_dom_len)
+{
+    return ctx->sid_unindexed == 0
+               && parse_sid_key(sid, key, _dom_len)
+               && sid[*_dom_len] == '-';
+}
+
 enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
                                             const char *sid,
                                             uint32_t *_id)
 {
     struct idmap_domain_info *idmap_domain_info;
     struct idmap_domain_info *matched_dom = NULL;
+    uint32_t key[3];
+    bool indexed;
     size_t dom_len;
     long long rid;
 
@@ -1067,16 +1366,19 @@ enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
 
     CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
 
-    idmap_domain_info = ctx->idmap_domain_info;
-
     if (sss_idmap_sid_is_builtin(sid)) {
         return IDMAP_BUILTIN_SID;
     }
 
+    indexed = use_sid_index(ctx, sid, key, &dom_len);
+    idmap_domain_info = indexed ? idmap_index_first_sid(ctx, key)
+                                : ctx->idmap_domain_info;
+
     /* Try primary slices */
     while (idmap_domain_info != NULL) {
 
-        if (is_sid_from_dom(idmap_domain_info->sid, sid, &dom_len)) {
+        if (indexed
+                || is_sid_from_dom(idmap_domain_info->sid, sid, &dom_len)) {
 
             if (idmap_domain_info->external_mapping == true) {
                 return IDMAP_EXTERNAL;
@@ -1093,7 +1395,8 @@ enum idmap_error_code sss_idmap_sid_to_unix(struct sss_idmap_ctx *ctx,
             matched_dom = idmap_domain_info;
         }
 
-        idmap_domain_info = idmap_domain_info->next;
+        idmap_domain_info = indexed ? idmap_index_next_sid(idmap_domain_info)
+                                    : idmap_domain_info->next;
     }
 
     if (matched_dom != NULL && matched_dom->auto_add_ranges) {
@@ -1108,6 +1411,7 @@ enum idmap_error_code sss_idmap_check_sid_unix(struct sss_idmap_ctx *ctx,
                                                uint32_t id)
 {
     struct idmap_domain_info *idmap_domain_info;
+    uint32_t key[3];
     size_t dom_len;
     bool no_range = false;
 
@@ -1127,6 +1431,22 @@ enum idmap_error_code sss_idmap_check_sid_unix(struct sss_idmap_ctx *ctx,
         return IDMAP_BUILTIN_SID;
     }
 
+    if (use_sid_index(ctx, sid, key, &dom_len)) {
+        for (idmap_domain_info = idmap_index_first_sid(ctx, key);
+             idmap_domain_info != NULL;
+             idmap_domain_info = idmap_index_next_sid(idmap_domain_info)) {
+
+            if (id >= idmap_domain_info->range_params.min_id
+                && id <= idmap_domain_info->range_params.max_id) {
+                return IDMAP_SUCCESS;
+            }
+
+            no_range = true;
+        }
+
+        return no_range ? IDMAP_NO_RANGE : IDMAP_SID_UNKNOWN;
+    }
+
     while (idmap_domain_info != NULL) {
         if (idmap_domain_info->sid != NULL) {
             dom_len = strlen(idmap_domain_info->sid);
@@ -1187,20 +1507,16 @@ enum idmap_error_code sss_idmap_unix_to_sid(struct sss_idmap_ctx *ctx,
 
     CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
 
-    idmap_domain_info = ctx->idmap_domain_info;
-
-    while (idmap_domain_info != NULL) {
-        if (id_is_in_range(id, &idmap_domain_info->range_params, &rid)) {
-
-            if (idmap_domain_info->external_mapping == true
-                    || idmap_domain_info->sid == NULL) {
-                return IDMAP_EXTERNAL;
-            }
+    idmap_domain_info = idmap_index_find_id(ctx, id);
+    if (idmap_domain_info != NULL
+            && id_is_in_range(id, &idmap_domain_info->range_params, &rid)) {
 
-            return generate_sid(ctx, idmap_domain_info->sid, rid, _sid);
+        if (idmap_domain_info->external_mapping == true
+                || idmap_domain_info->sid == NULL) {
+            return IDMAP_EXTERNAL;
         }
 
-        idmap_domain_info = idmap_domain_info->next;
+        return generate_sid(ctx, idmap_domain_info->sid, rid, _sid);
     }
 
     /* Check secondary ranges. */
@@ -1266,7 +1582,7 @@ enum idmap_error_code sss_idmap_bin_sid_to_unix(struct sss_idmap_ctx *ctx,
                                                 uint32_t *id)
 {
     enum idmap_error_code err;
-    char *sid;
+    char *sid = NULL;
 
     CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
 
@@ -1283,6 +1599,122 @@ done:
     return err;
 }
 
+/* Extract the lookup key and the RID from a binary SID of the form
+ * S-1-5-21-a-b-c-rid without converting it to a string. Other SIDs have to
+ * take the generic path. */
+static bool bin_sid_key(const uint8_t *bin_sid, size_t length,
+                        uint32_t key[3], uint32_t *_rid)
+{
+    static const uint8_t nt_authority[] = { 0, 0, 0, 0, 0, 5 };
+    uint32_t sub_auths[5];
+    const uint8_t *p;
+    size_t c;
+
+    if (bin_sid == NULL || length != 8 + sizeof(sub_auths)
+            || bin_sid[0] != 1 || bin_sid[1] != 5
+            || memcmp(bin_sid + 2, nt_authority, sizeof(nt_authority)) != 0) {
+        return false;
+    }
+
+    /* sub-authorities are stored little-endian */
+    for (c = 0; c < 5; c++) {
+        p = bin_sid + 8 + 4 * c;
+        sub_auths[c] = (uint32_t) p[0]
+                           | ((uint32_t) p[1] << 8)
+                           | ((uint32_t) p[2] << 16)
+                           | ((uint32_t) p[3] << 24);
+    }
+
+    if (sub_auths[0] != 21) {
+        return false;
+    }
+
+    key[0] = sub_auths[1];
+    key[1] = sub_auths[2];
+    key[2] = sub_auths[3];
+    *_rid = sub_auths[4];
+
+    return true;
+}
+
+/* Same as the primary slice lookup in sss_idmap_sid_to_unix() but with an
+ * already parsed SID. IDMAP_NO_RANGE with a domain which can get new
+ * secondary slices is returned as IDMAP_SID_UNKNOWN to tell the caller to
+ * use the generic path. */
+static enum idmap_error_code bin_sid_to_unix_indexed(struct sss_idmap_ctx *ctx,
+                                                     const uint32_t key[3],
+                                                     uint32_t rid,
+                                                     uint32_t *_id)
+{
+    struct idmap_domain_info *dom;
+    struct idmap_domain_info *matched_dom = NULL;
+
+    for (dom = idmap_index_first_sid(ctx, key);
+         dom != NULL;
+         dom = idmap_index_next_sid(dom)) {
+
+        if (dom->external_mapping == true) {
+            return IDMAP_EXTERNAL;
+        }
+
+        if (comp_id(&dom->range_params, rid, _id)) {
+            return IDMAP_SUCCESS;
+        }
+
+        matched_dom = dom;
+    }
+
+    if (matched_dom != NULL && matched_dom->auto_add_ranges) {
+        return IDMAP_SID_UNKNOWN;
+    }
+
+    return matched_dom ? IDMAP_NO_RANGE : IDMAP_NO_DOMAIN;
+}
+
+enum idmap_error_code sss_idmap_bin_sids_to_unix(struct sss_idmap_ctx *ctx,
+                                                 size_t num_sids,
+                                                 uint8_t **bin_sids,
+                                                 size_t *lengths,
+                                                 uint32_t *ids,
+                                                 enum idmap_error_code *errs)
+{
+    enum idmap_error_code err;
+    uint32_t key[3];
+    uint32_t rid;
+    size_t c;
+
+    CHECK_IDMAP_CTX(ctx, IDMAP_CONTEXT_INVALID);
+
+    if (num_sids > 0
+            && (bin_sids == NULL || lengths == NULL
+                || ids == NULL || errs == NULL)) {
+        return IDMAP_ERROR;
+    }
+
+    for (c = 0; c < num_sids; c++) {
+        if (ctx->sid_unindexed == 0
+                && bin_sid_key(bin_sids[c], lengths[c], key, &rid)) {
+            err = bin_sid_to_unix_indexed(ctx, key, rid, &ids[c]);
+            if (err != IDMAP_SID_UNKNOWN) {
+                errs[c] = err;
+                continue;
+            }
+        }
+
+        if (bin_sids[c] == NULL) {
+            errs[c] = IDMAP_SID_INVALID;
+            continue;
+        }
+
+        /* a new secondary slice might be needed or the SID cannot be
+         * looked up in the index */
+        errs[c] = sss_idmap_bin_sid_to_unix(ctx, bin_sids[c], lengths[c],
+                                            &ids[c]);
+    }
+
+    return IDMAP_SUCCESS;
+}
+
 enum idmap_error_code sss_idmap_smb_sid_to_unix(struct sss_idmap_ctx *ctx,
                                                 struct dom_sid *smb_sid,
                                                 uint32_t *id)
@@ -475,6 +475,37 @@ enum idmap_error_code sss_idmap_bin_sid_to_unix(struct sss_idmap_ctx *ctx,
                                                 size_t length,
                                                 uint32_t *id);
 
+/**
+ * @brief Translate a list of binary SIDs to unix UIDs or GIDs
+ *
+ * This is the same as calling sss_idmap_bin_sid_to_unix() for every SID
+ * but SIDs of the form S-1-5-21-a-b-c-rid are mapped without converting
+ * them to the string representation first.
+ *
+ * @param[in] ctx      Idmap context
+ * @param[in] num_sids Number of SIDs in the list
+ * @param[in] bin_sids Array of binary SIDs
+ * @param[in] lengths  Array with the sizes of the binary SIDs
+ * @param[out] ids     Array of num_sids elements for the returned unix UIDs
+ *                     or GIDs, only valid if the related element of errs is
+ *                     #IDMAP_SUCCESS
+ * @param[out] errs    Array of num_sids elements for the result of each
+ *                     mapping, see sss_idmap_bin_sid_to_unix() for the
+ *                     possible values
+ *
+ * @return
+ *  - #IDMAP_SUCCESS:         all SIDs were processed, check errs for the
+ *                            individual results
+ *  - #IDMAP_CONTEXT_INVALID: Provided context is invalid
+ *  - #IDMAP_ERROR:           Invalid parameters
+ */
+enum idmap_error_code sss_idmap_bin_sids_to_unix(struct sss_idmap_ctx *ctx,
+                                                 size_t num_sids,
+                                                 uint8_t **bin_sids,
+                                                 size_t *lengths,
+                                                 uint32_t *ids,
+                                                 enum idmap_error_code *errs);
+
 /**
  * @brief Translate a Samba dom_sid stucture to a unix UID or GID
  *
@@ -54,12 +54,30 @@ struct sss_idmap_opts {
     int extra_slice_init;
 };
 
+struct idmap_range_entry;
+
 struct sss_idmap_ctx {
     idmap_alloc_func *alloc_func;
     void *alloc_pvt;
     idmap_free_func *free_func;
     struct sss_idmap_opts idmap_opts;
     struct idmap_domain_info *idmap_domain_info;
+
+    /* number of domains added so far, used to order the index entries */
+    uint64_t dom_seq;
+
+    /* hash table of domains keyed by the sub-authorities of the domain SID */
+    struct idmap_domain_info **sid_buckets;
+    size_t sid_bucket_count;
+    size_t sid_indexed;
+    /* domains with a SID which cannot be indexed, if there are any the
+     * lookup falls back to a linear search */
+    size_t sid_unindexed;
+
+    /* primary ranges of all domains sorted by the lower bound */
+    struct idmap_range_entry *ranges;
+    size_t range_count;
+    size_t range_size;
 };
 
 /* This is a copy of the definition in the samba gen_ndr/security.h header
@@ -1640,11 +1640,14 @@ static void monitor_hup(struct tevent_context *ev,
     DEBUG(SSSDBG_CRIT_FAILURE, "Received SIGHUP.\n");
 
     /* Send D-Bus message to other services to rotate their logs.
-     * NSS service receives also message to clear memory caches. */
+     * Responders receive also message to clear memory caches. */
     for(cur_svc = ctx->svc_list; cur_svc; cur_svc = cur_svc->next) {
         service_signal_rotate(cur_svc);
-        if (!strcmp(NSS_SBUS_SERVICE_NAME, cur_svc->name)) {
+        if (cur_svc->type == MT_SVC_SERVICE) {
             service_signal_clear_memcache(cur_svc);
+        }
+
+        if (!strcmp(NSS_SBUS_SERVICE_NAME, cur_svc->name)) {
             service_signal_clear_enum_cache(cur_svc);
         }
 
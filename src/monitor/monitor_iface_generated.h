@@ -27,6 +27,7 @@
 #define MON_CLI_IFACE_CLEARMEMCACHE "clearMemcache"
 #define MON_CLI_IFACE_CLEARENUMCACHE "clearEnumCache"
 #define MON_CLI_IFACE_SYSBUSRECONNECT "sysbusReconnect"
+#define MON_CLI_IFACE_GETLATENCYSTATS "getLatencyStats"
 
 /* ------------------------------------------------------------------------
  * DBus handlers
@@ -65,6 +66,7 @@ struct mon_cli_iface {
     sbus_msg_handler_fn clearMemcache;
     sbus_msg_handler_fn clearEnumCache;
     sbus_msg_handler_fn sysbusReconnect;
+    sbus_msg_handler_fn getLatencyStats;
 };
 
 /* ------------------------------------------------------------------------
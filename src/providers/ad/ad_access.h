@@ -23,6 +23,8 @@
 #ifndef AD_ACCESS_H_
 #define AD_ACCESS_H_
 
+#include "providers/dp_access_cache.h"
+
 struct ad_access_ctx {
     struct dp_option *ad_options;
     struct sdap_access_ctx *sdap_access_ctx;
@@ -47,6 +49,10 @@ struct ad_access_ctx {
     } gpo_map_type;
     hash_table_t *gpo_map_options_table;
     enum gpo_map_type gpo_default_right;
+    /* results of previous GPO evaluations */
+    struct be_access_cache *gpo_decision_cache;
+    /* GPOs applying to this host, from the previous evaluation */
+    struct ad_gpo_chain *gpo_chain;
 };
 
 void
@@ -64,6 +64,7 @@ enum ad_basic_opt {
     AD_KRB5_CONFD_PATH,
     AD_MAXIMUM_MACHINE_ACCOUNT_PASSWORD_AGE,
     AD_MACHINE_ACCOUNT_PASSWORD_RENEWAL_OPTS,
+    AD_GPO_DECISION_CACHE_TIMEOUT,
 
     AD_OPTS_BASIC /* opts counter */
 };
@@ -28,7 +28,9 @@
  * are used by the public functions):
  *   ad_gpo_process_som_send/recv: populate list of gp_som objects
  *   ad_gpo_process_gpo_send/recv: populate list of gp_gpo objects
- *   ad_gpo_process_cse_send/recv: retrieve policy file data
+ *
+ * The policy files are retrieved by ad_gpo_process_cse_send/recv, which are
+ * implemented in ad_gpo_cse.c.
  */
 
 #include <security/pam_modules.h>
@@ -44,6 +46,7 @@
 #include "providers/ad/ad_common.h"
 #include "providers/ad/ad_domain_info.h"
 #include "providers/ad/ad_gpo.h"
+#include "providers/ad/ad_gpo_cse.h"
 #include "providers/ldap/sdap_access.h"
 #include "providers/ldap/sdap_async.h"
 #include "providers/ldap/sdap.h"
@@ -65,6 +68,7 @@
 #define AD_AT_MACHINE_EXT_NAMES "gPCMachineExtensionNames"
 #define AD_AT_FUNC_VERSION "gPCFunctionalityVersion"
 #define AD_AT_FLAGS "flags"
+#define AD_AT_VERSION_NUMBER "versionNumber"
 
 #define UAC_WORKSTATION_TRUST_ACCOUNT 0x00001000
 #define UAC_SERVER_TRUST_ACCOUNT 0x00002000
@@ -91,14 +95,8 @@
 #define GP_EXT_GUID_SECURITY "{827D319E-6EAC-11D2-A4EA-00C04F79F83A}"
 #define GP_EXT_GUID_SECURITY_SUFFIX "/Machine/Microsoft/Windows NT/SecEdit/GptTmpl.inf"
 
-#ifndef SSSD_LIBEXEC_PATH
-#error "SSSD_LIBEXEC_PATH not defined"
-#else
-#define GPO_CHILD SSSD_LIBEXEC_PATH"/gpo_child"
-#endif
-
-/* fd used by the gpo_child process for logging */
-int gpo_child_debug_fd = -1;
+/* gpo_child processes downloading policy files at the same time */
+#define AD_GPO_CSE_MAX_PARALLEL 8
 
 /* == common data structures and declarations ============================= */
 
@@ -124,7 +122,10 @@ struct gp_gpo {
     int num_gpo_cse_guids;
     int gpo_func_version;
     int gpo_flags;
+    /* version of the GPO's LDAP part, -1 if unknown */
+    int gpc_version;
     bool send_to_child;
+    int cached_gpt_version;
     const char *policy_filename;
 };
 
@@ -162,20 +163,6 @@ int ad_gpo_process_gpo_recv(struct tevent_req *req,
                             struct gp_gpo ***candidate_gpos,
                             int *num_candidate_gpos);
 
-struct tevent_req *ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
-                                           struct tevent_context *ev,
-                                           bool send_to_child,
-                                           struct sss_domain_info *domain,
-                                           const char *gpo_guid,
-                                           const char *smb_server,
-                                           const char *smb_share,
-                                           const char *smb_path,
-                                           const char *smb_cse_suffix,
-                                           int cached_gpt_version,
-                                           int gpo_timeout_option);
-
-int ad_gpo_process_cse_recv(struct tevent_req *req);
-
 /* == ad_gpo_parse_map_options and helpers ==================================*/
 
 #define GPO_LOGIN "login"
@@ -1347,13 +1334,6 @@ ad_gpo_access_check(TALLOC_CTX *mem_ctx,
     return ret;
 }
 
-#define GPO_CHILD_LOG_FILE "gpo_child"
-
-static errno_t gpo_child_init(void)
-{
-    return child_debug_init(GPO_CHILD_LOG_FILE, &gpo_child_debug_fd);
-}
-
 /*
  * This function retrieves the raw policy_setting_value for the input key from
  * the GPO_Result object in the sysdb cache. It then parses the raw value and
@@ -1507,6 +1487,11 @@ struct ad_gpo_access_state {
     struct gp_gpo **cse_filtered_gpos;
     int num_cse_filtered_gpos;
     int cse_gpo_index;
+    int cse_pending;
+    /* the first failed download, reported once no download is pending */
+    errno_t cse_error;
+    char *decision_user;
+    bool store_decision;
 };
 
 static void ad_gpo_connect_done(struct tevent_req *subreq);
@@ -1517,6 +1502,182 @@ static void ad_gpo_process_gpo_done(struct tevent_req *subreq);
 static errno_t ad_gpo_cse_step(struct tevent_req *req);
 static void ad_gpo_cse_done(struct tevent_req *subreq);
 
+/*
+ * The outcome of the evaluation depends on the user, the logon right the
+ * PAM service is mapped to and the host (whose GPOs are evaluated), so these
+ * form the key of the decision cache. The set of applicable GPOs and their
+ * GPT versions form the version of the rule set; a change of either drops
+ * all cached decisions.
+ */
+static errno_t
+ad_gpo_decision_lookup(struct ad_gpo_access_state *state, int *_decision)
+{
+    return be_access_cache_lookup(state->access_ctx->gpo_decision_cache,
+                                  state->decision_user,
+                                  gpo_map_type_string(state->gpo_map_type),
+                                  state->ad_hostname,
+                                  _decision);
+}
+
+static void
+ad_gpo_decision_store(struct ad_gpo_access_state *state, int decision)
+{
+    errno_t ret;
+
+    ret = be_access_cache_store(state->access_ctx->gpo_decision_cache,
+                                state->decision_user,
+                                gpo_map_type_string(state->gpo_map_type),
+                                state->ad_hostname,
+                                decision);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to cache GPO decision: [%d](%s)\n",
+              ret, sss_strerror(ret));
+    }
+}
+
+/* The candidates are in the order of their precedence, which is part of
+ * the digest together with the version of every GPO's LDAP part */
+static uint64_t
+ad_gpo_candidates_digest(struct gp_gpo **candidate_gpos,
+                         int num_candidate_gpos)
+{
+    struct be_access_digest digest;
+    int i;
+
+    be_access_digest_init(&digest);
+    be_access_digest_add_int(&digest, num_candidate_gpos);
+
+    for (i = 0; i < num_candidate_gpos; i++) {
+        be_access_digest_add_string(&digest, candidate_gpos[i]->gpo_guid);
+        be_access_digest_add_int(&digest, candidate_gpos[i]->gpc_version);
+    }
+
+    return be_access_digest_value(&digest);
+}
+
+/*
+ * Collecting the GPOs that apply to the host takes several LDAP round trips
+ * (target DN, SOM list, attributes and security descriptor of each GPO),
+ * while the result rarely changes. The list is kept for ad_gpo_cache_timeout
+ * seconds, the same time the downloaded policy files are trusted; the policy
+ * files themselves are still revalidated by their version.
+ */
+struct ad_gpo_chain {
+    time_t expire;
+    struct gp_gpo **gpos;
+    int num_gpos;
+};
+
+static errno_t
+ad_gpo_chain_store(struct ad_access_ctx *access_ctx,
+                   struct gp_gpo **gpos,
+                   int num_gpos)
+{
+    struct ad_gpo_chain *chain;
+
+    chain = talloc_zero(access_ctx, struct ad_gpo_chain);
+    if (chain == NULL) {
+        return ENOMEM;
+    }
+
+    chain->expire = time(NULL) + access_ctx->gpo_cache_timeout;
+    chain->gpos = talloc_steal(chain, gpos);
+    chain->num_gpos = num_gpos;
+
+    talloc_free(access_ctx->gpo_chain);
+    access_ctx->gpo_chain = chain;
+
+    return EOK;
+}
+
+static struct ad_gpo_chain *
+ad_gpo_chain_lookup(struct ad_access_ctx *access_ctx)
+{
+    struct ad_gpo_chain *chain = access_ctx->gpo_chain;
+
+    if (chain == NULL || chain->expire <= time(NULL)) {
+        return NULL;
+    }
+
+    return chain;
+}
+
+/*
+ * The filtering steps take the GPOs over and the CSE processing records its
+ * progress in them, so each evaluation works on its own copy. The chain may
+ * be replaced while the evaluation waits for gpo_child, therefore the copy
+ * owns everything that is used by then. The security descriptor is shared;
+ * it is only looked at by the DACL filter, which runs before the first
+ * asynchronous step, and ad_gpo_evaluate_chain() drops it afterwards.
+ */
+static struct gp_gpo *
+ad_gpo_copy_gpo(TALLOC_CTX *mem_ctx, struct gp_gpo *orig)
+{
+    struct gp_gpo *gpo;
+    int i;
+
+    gpo = talloc_memdup(mem_ctx, orig, sizeof(struct gp_gpo));
+    if (gpo == NULL) {
+        return NULL;
+    }
+
+    gpo->gpo_dn = talloc_strdup(gpo, orig->gpo_dn);
+    gpo->gpo_guid = talloc_strdup(gpo, orig->gpo_guid);
+    gpo->smb_server = talloc_strdup(gpo, orig->smb_server);
+    gpo->smb_share = talloc_strdup(gpo, orig->smb_share);
+    gpo->smb_path = talloc_strdup(gpo, orig->smb_path);
+    gpo->gpo_cse_guids = talloc_zero_array(gpo, const char *,
+                                           orig->num_gpo_cse_guids + 1);
+    if (gpo->gpo_dn == NULL || gpo->gpo_guid == NULL
+            || gpo->smb_server == NULL || gpo->smb_share == NULL
+            || gpo->smb_path == NULL || gpo->gpo_cse_guids == NULL) {
+        goto fail;
+    }
+
+    for (i = 0; i < orig->num_gpo_cse_guids; i++) {
+        gpo->gpo_cse_guids[i] = talloc_strdup(gpo->gpo_cse_guids,
+                                              orig->gpo_cse_guids[i]);
+        if (gpo->gpo_cse_guids[i] == NULL) {
+            goto fail;
+        }
+    }
+
+    return gpo;
+
+fail:
+    talloc_free(gpo);
+    return NULL;
+}
+
+static errno_t
+ad_gpo_chain_copy(TALLOC_CTX *mem_ctx,
+                  struct ad_gpo_chain *chain,
+                  struct gp_gpo ***_gpos)
+{
+    struct gp_gpo **gpos;
+    int i;
+
+    gpos = talloc_zero_array(mem_ctx, struct gp_gpo *, chain->num_gpos + 1);
+    if (gpos == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < chain->num_gpos; i++) {
+        gpos[i] = ad_gpo_copy_gpo(gpos, chain->gpos[i]);
+        if (gpos[i] == NULL) {
+            talloc_free(gpos);
+            return ENOMEM;
+        }
+    }
+
+    *_gpos = gpos;
+    return EOK;
+}
+
+static errno_t ad_gpo_evaluate_chain(struct tevent_req *req,
+                                     struct ad_gpo_chain *chain);
+
 struct tevent_req *
 ad_gpo_access_send(TALLOC_CTX *mem_ctx,
                    struct tevent_context *ev,
@@ -1533,6 +1694,8 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     hash_key_t key;
     hash_value_t val;
     enum gpo_map_type gpo_map_type;
+    int decision;
+    struct ad_gpo_chain *chain;
 
     /* setup logging for gpo child */
     gpo_child_init();
@@ -1611,6 +1774,36 @@ ad_gpo_access_send(TALLOC_CTX *mem_ctx,
     state->access_ctx = ctx;
     state->opts = ctx->sdap_access_ctx->id_ctx->opts;
     state->timeout = dp_opt_get_int(state->opts->basic, SDAP_SEARCH_TIMEOUT);
+
+    state->decision_user = talloc_asprintf(state, "%s@%s",
+                                           user, domain->name);
+    if (state->decision_user == NULL) {
+        ret = ENOMEM;
+        goto immediately;
+    }
+
+    ret = ad_gpo_decision_lookup(state, &decision);
+    if (ret == EOK) {
+        ret = decision;
+        goto immediately;
+    } else if (ret != ENOENT) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to look up cached GPO decision: [%d](%s)\n",
+              ret, sss_strerror(ret));
+    }
+    state->store_decision = true;
+
+    /* When offline the stored policy settings are used instead */
+    chain = ad_gpo_chain_lookup(ctx);
+    if (chain != NULL && !be_is_offline(ctx->ad_id_ctx->sdap_id_ctx->be)) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Using the cached list of GPOs\n");
+        ret = ad_gpo_evaluate_chain(req, chain);
+        if (ret == EAGAIN) {
+            return req;
+        }
+        goto immediately;
+    }
+
     state->conn = ad_get_dom_ldap_conn(ctx->ad_id_ctx, state->host_domain);
     state->sdap_op = sdap_id_op_create(state, state->conn->conn_cache);
     if (state->sdap_op == NULL) {
@@ -1968,18 +2161,6 @@ ad_gpo_process_som_done(struct tevent_req *subreq)
     }
 }
 
-/*
- * This function retrieves a list of candidate_gpos and potentially reduces it
- * to a list of dacl_filtered_gpos, based on each GPO's DACL.
- *
- * This function then takes the list of dacl_filtered_gpos and potentially
- * reduces it to a list of cse_filtered_gpos, based on whether each GPO's list
- * of cse_guids includes the "SecuritySettings" CSE GUID (used for HBAC).
- *
- * Ultimately, this function then sends each cse_filtered_gpo to the gpo_child,
- * which retrieves the GPT.INI and policy files (as needed). Once all files
- * have been downloaded, the ad_gpo_cse_done function performs HBAC processing.
- */
 static void
 ad_gpo_process_gpo_done(struct tevent_req *subreq)
 {
@@ -1989,8 +2170,6 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
     int dp_error;
     struct gp_gpo **candidate_gpos = NULL;
     int num_candidate_gpos = 0;
-    int i = 0;
-    const char **cse_filtered_gpo_guids;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct ad_gpo_access_state);
@@ -2007,8 +2186,59 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
               ret, sss_strerror(ret));
         goto done;
     } else if (ret == ENOENT) {
+        candidate_gpos = NULL;
+        num_candidate_gpos = 0;
+    }
+
+    ret = ad_gpo_chain_store(state->access_ctx,
+                             candidate_gpos, num_candidate_gpos);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Unable to cache GPO list: [%d](%s)\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = ad_gpo_evaluate_chain(req, state->access_ctx->gpo_chain);
+
+ done:
+
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+    }
+}
+
+/*
+ * This function takes the list of candidate_gpos of the host and potentially
+ * reduces it to a list of dacl_filtered_gpos, based on each GPO's DACL.
+ *
+ * This function then takes the list of dacl_filtered_gpos and potentially
+ * reduces it to a list of cse_filtered_gpos, based on whether each GPO's list
+ * of cse_guids includes the "SecuritySettings" CSE GUID (used for HBAC).
+ *
+ * Ultimately, this function then sends the cse_filtered_gpos to the
+ * gpo_child, which retrieves the GPT.INI and policy files (as needed). Once
+ * all files have been downloaded, ad_gpo_cse_step performs HBAC processing.
+ *
+ * Returns EAGAIN if the evaluation continues asynchronously.
+ */
+static errno_t
+ad_gpo_evaluate_chain(struct tevent_req *req, struct ad_gpo_chain *chain)
+{
+    struct ad_gpo_access_state *state;
+    struct gp_gpo **candidate_gpos = NULL;
+    int i = 0;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct ad_gpo_access_state);
+
+    if (chain->num_gpos == 0) {
         DEBUG(SSSDBG_TRACE_FUNC,
               "No GPOs found that apply to this system.\n");
+        be_access_cache_set_version(state->access_ctx->gpo_decision_cache, 0);
+
         /*
          * Delete the result object list, since there are no
          * GPOs to include in it.
@@ -2023,24 +2253,37 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
                 DEBUG(SSSDBG_FATAL_FAILURE,
                       "Could not delete GPO Result from cache: [%s]\n",
                       sss_strerror(ret));
-                goto done;
+                return ret;
             }
         }
 
-        ret = EOK;
-        goto done;
+        return EOK;
     }
 
+    ret = ad_gpo_chain_copy(state, chain, &candidate_gpos);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    be_access_cache_set_version(state->access_ctx->gpo_decision_cache,
+                                ad_gpo_candidates_digest(candidate_gpos,
+                                                         chain->num_gpos));
+
     ret = ad_gpo_filter_gpos_by_dacl(state, state->user, state->user_domain,
                                      state->opts->idmap_ctx->map,
-                                     candidate_gpos, num_candidate_gpos,
+                                     candidate_gpos, chain->num_gpos,
                                      &state->dacl_filtered_gpos,
                                      &state->num_dacl_filtered_gpos);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE,
               "Unable to filter GPO list by DACKL: [%d](%s)\n",
               ret, sss_strerror(ret));
-        goto done;
+        return ret;
+    }
+
+    /* the security descriptor belongs to the chain, see ad_gpo_chain_copy() */
+    for (i = 0; i < state->num_dacl_filtered_gpos; i++) {
+        state->dacl_filtered_gpos[i]->gpo_sd = NULL;
     }
 
     if (state->dacl_filtered_gpos[0] == NULL) {
@@ -2062,12 +2305,11 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
                 DEBUG(SSSDBG_FATAL_FAILURE,
                       "Could not delete GPO Result from cache: [%s]\n",
                       sss_strerror(ret));
-                goto done;
+                return ret;
             }
         }
 
-        ret = EOK;
-        goto done;
+        return EOK;
     }
 
     for (i = 0; i < state->num_dacl_filtered_gpos; i++) {
@@ -2086,34 +2328,19 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
         DEBUG(SSSDBG_OP_FAILURE,
               "Unable to filter GPO list by CSE_GUID: [%d](%s)\n",
                ret, sss_strerror(ret));
-        goto done;
+        return ret;
     }
 
     if (state->cse_filtered_gpos[0] == NULL) {
         /* no gpos contain "SecuritySettings" cse_guid, nothing to enforce */
         DEBUG(SSSDBG_TRACE_FUNC,
               "no applicable gpos found after cse_guid filtering\n");
-        ret = EOK;
-        goto done;
-    }
-
-    /* we create and populate an array of applicable gpo-guids */
-    cse_filtered_gpo_guids =
-        talloc_array(state, const char *, state->num_cse_filtered_gpos);
-    if (cse_filtered_gpo_guids == NULL) {
-        ret = ENOMEM;
-        goto done;
+        return EOK;
     }
 
     for (i = 0; i < state->num_cse_filtered_gpos; i++) {
         DEBUG(SSSDBG_TRACE_FUNC, "cse_filtered_gpos[%d]->gpo_guid is %s\n", i,
                                   state->cse_filtered_gpos[i]->gpo_guid);
-        cse_filtered_gpo_guids[i] = talloc_steal(cse_filtered_gpo_guids,
-                                                 state->cse_filtered_gpos[i]->gpo_guid);
-        if (cse_filtered_gpo_guids[i] == NULL) {
-            ret = ENOMEM;
-            goto done;
-        }
     }
 
     DEBUG(SSSDBG_TRACE_FUNC, "num_cse_filtered_gpos: %d\n",
@@ -2135,26 +2362,28 @@ ad_gpo_process_gpo_done(struct tevent_req *subreq)
             DEBUG(SSSDBG_FATAL_FAILURE,
                   "Could not delete GPO Result from cache: [%s]\n",
                   sss_strerror(ret));
-            goto done;
+            return ret;
         }
     }
 
-    ret = ad_gpo_cse_step(req);
-
- done:
-
-    if (ret == EOK) {
-        tevent_req_done(req);
-    } else if (ret != EAGAIN) {
-        tevent_req_error(req, ret);
-    }
+    return ad_gpo_cse_step(req);
 }
 
+struct ad_gpo_cse_fetch {
+    struct tevent_req *req;
+    struct gp_gpo *gpo;
+};
+
+/*
+ * This function checks whether the policy files of a single GPO in the
+ * GPO CACHE are current and starts the gpo_child to download them if not.
+ */
 static errno_t
-ad_gpo_cse_step(struct tevent_req *req)
+ad_gpo_cse_start(struct tevent_req *req, struct gp_gpo *cse_filtered_gpo)
 {
     struct tevent_req *subreq;
     struct ad_gpo_access_state *state;
+    struct ad_gpo_cse_fetch *fetch;
     int i = 0;
     struct ldb_result *res;
     errno_t ret;
@@ -2164,18 +2393,12 @@ ad_gpo_cse_step(struct tevent_req *req)
 
     state = tevent_req_data(req, struct ad_gpo_access_state);
 
-    struct gp_gpo *cse_filtered_gpo =
-        state->cse_filtered_gpos[state->cse_gpo_index];
-
-    /* cse_filtered_gpo is NULL after all GPO policy files have been downloaded */
-    if (cse_filtered_gpo == NULL) return EOK;
-
-    DEBUG(SSSDBG_TRACE_FUNC, "cse filtered_gpos[%d]->gpo_guid is %s\n",
-          state->cse_gpo_index, cse_filtered_gpo->gpo_guid);
+    DEBUG(SSSDBG_TRACE_FUNC, "cse filtered_gpo->gpo_guid is %s\n",
+          cse_filtered_gpo->gpo_guid);
     for (i = 0; i < cse_filtered_gpo->num_gpo_cse_guids; i++) {
         DEBUG(SSSDBG_TRACE_ALL,
-              "cse_filtered_gpos[%d]->gpo_cse_guids[%d]->gpo_guid is %s\n",
-              state->cse_gpo_index, i, cse_filtered_gpo->gpo_cse_guids[i]);
+              "cse_filtered_gpo->gpo_cse_guids[%d]->gpo_guid is %s\n",
+              i, cse_filtered_gpo->gpo_cse_guids[i]);
     }
 
     DEBUG(SSSDBG_TRACE_FUNC, "smb_server: %s\n", cse_filtered_gpo->smb_server);
@@ -2217,9 +2440,15 @@ ad_gpo_cse_step(struct tevent_req *req)
 
         policy_file_timeout = ldb_msg_find_attr_as_uint64
             (res->msgs[0], SYSDB_GPO_TIMEOUT_ATTR, 0);
+        talloc_free(res);
 
         if (policy_file_timeout >= time(NULL)) {
             send_to_child = false;
+        } else if (cse_filtered_gpo->gpc_version >= 0
+                   && cse_filtered_gpo->gpc_version == cached_gpt_version) {
+            /* The version of the GPO in LDAP is the version of the files
+             * we already have, there is nothing new to download. */
+            send_to_child = false;
         }
     } else if (ret == ENOENT) {
         DEBUG(SSSDBG_TRACE_FUNC, "ENOENT\n");
@@ -2234,6 +2463,7 @@ ad_gpo_cse_step(struct tevent_req *req)
     DEBUG(SSSDBG_TRACE_FUNC, "cached_gpt_version: %d\n", cached_gpt_version);
 
     cse_filtered_gpo->send_to_child = send_to_child;
+    cse_filtered_gpo->cached_gpt_version = cached_gpt_version;
 
     subreq = ad_gpo_process_cse_send(state,
                                      state->ev,
@@ -2246,80 +2476,146 @@ ad_gpo_cse_step(struct tevent_req *req)
                                      GP_EXT_GUID_SECURITY_SUFFIX,
                                      cached_gpt_version,
                                      state->gpo_timeout_option);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
 
-    tevent_req_set_callback(subreq, ad_gpo_cse_done, req);
-    return EAGAIN;
+    fetch = talloc(subreq, struct ad_gpo_cse_fetch);
+    if (fetch == NULL) {
+        talloc_free(subreq);
+        return ENOMEM;
+    }
+    fetch->req = req;
+    fetch->gpo = cse_filtered_gpo;
+
+    tevent_req_set_callback(subreq, ad_gpo_cse_done, fetch);
+    return EOK;
 }
 
 /*
- * This cse-specific function (GP_EXT_GUID_SECURITY) increments the
- * cse_gpo_index until the policy settings for all applicable GPOs have been
- * stored as part of the GPO Result object in the sysdb cache. Once all
- * GPOs have been processed, this functions performs HBAC processing by
- * comparing the resultant policy setting values in the GPO Result object
- * with the user_sid/group_sids of interest.
+ * This cse-specific function (GP_EXT_GUID_SECURITY) keeps up to
+ * AD_GPO_CSE_MAX_PARALLEL gpo_child processes downloading policy files of
+ * the cse_filtered_gpos. Once all files are in the GPO CACHE, it stores the
+ * supported keys present in each file (as part of the GPO Result object in
+ * the sysdb cache) and performs HBAC processing by comparing the resultant
+ * policy setting values in the GPO Result object with the
+ * user_sid/group_sids of interest.
+ *
+ * Returns EAGAIN while downloads are in progress.
  */
+static errno_t
+ad_gpo_cse_step(struct tevent_req *req)
+{
+    struct ad_gpo_access_state *state;
+    int i;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct ad_gpo_access_state);
+
+    while (state->cse_error == EOK
+            && state->cse_pending < AD_GPO_CSE_MAX_PARALLEL
+            && state->cse_filtered_gpos[state->cse_gpo_index] != NULL) {
+        ret = ad_gpo_cse_start(req,
+                               state->cse_filtered_gpos[state->cse_gpo_index]);
+        if (ret != EOK) {
+            state->cse_error = ret;
+            break;
+        }
+
+        state->cse_gpo_index++;
+        state->cse_pending++;
+    }
+
+    /* After a failure no further download is started, but the ones in
+     * progress must finish before the request does; their callbacks refer
+     * to it. */
+    if (state->cse_pending > 0) {
+        return EAGAIN;
+    }
+
+    if (state->cse_error != EOK) {
+        return state->cse_error;
+    }
+
+    /* The files are processed in the order of the GPOs, not in the order
+     * the downloads finished, so that later GPOs trump earlier ones. */
+    for (i = 0; state->cse_filtered_gpos[i] != NULL; i++) {
+        ret = ad_gpo_store_policy_settings(state->host_domain,
+                                   state->cse_filtered_gpos[i]->policy_filename);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "ad_gpo_store_policy_settings failed: [%d](%s)\n",
+                  ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+
+    ret = ad_gpo_perform_hbac_processing(state,
+                                         state->gpo_mode,
+                                         state->gpo_map_type,
+                                         state->user,
+                                         state->user_domain,
+                                         state->host_domain);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "HBAC processing failed: [%d](%s}\n",
+              ret, sss_strerror(ret));
+        return ret;
+    }
+
+    return EOK;
+}
+
 static void
 ad_gpo_cse_done(struct tevent_req *subreq)
 {
+    struct ad_gpo_cse_fetch *fetch;
     struct tevent_req *req;
     struct ad_gpo_access_state *state;
+    struct gp_gpo *cse_filtered_gpo;
+    struct ldb_result *res;
+    int gpt_version;
     int ret;
 
-    req = tevent_req_callback_data(subreq, struct tevent_req);
+    fetch = tevent_req_callback_data(subreq, struct ad_gpo_cse_fetch);
+    req = fetch->req;
+    cse_filtered_gpo = fetch->gpo;
     state = tevent_req_data(req, struct ad_gpo_access_state);
 
-    struct gp_gpo *cse_filtered_gpo =
-        state->cse_filtered_gpos[state->cse_gpo_index];
-
-    const char *gpo_guid = cse_filtered_gpo->gpo_guid;
-
-    DEBUG(SSSDBG_TRACE_FUNC, "gpo_guid: %s\n", gpo_guid);
+    DEBUG(SSSDBG_TRACE_FUNC, "gpo_guid: %s\n", cse_filtered_gpo->gpo_guid);
 
     ret = ad_gpo_process_cse_recv(subreq);
 
+    /* fetch is freed together with subreq */
     talloc_zfree(subreq);
+    state->cse_pending--;
 
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "Unable to retrieve policy data: [%d](%s}\n",
               ret, sss_strerror(ret));
-        goto done;
-    }
-
-    /*
-     * now that the policy file for this gpo have been downloaded to the
-     * GPO CACHE, we store all of the supported keys present in the file
-     * (as part of the GPO Result object in the sysdb cache).
-     */
-    ret = ad_gpo_store_policy_settings(state->host_domain,
-                                       cse_filtered_gpo->policy_filename);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE,
-              "ad_gpo_store_policy_settings failed: [%d](%s)\n",
-              ret, sss_strerror(ret));
-        goto done;
-    }
-
-    state->cse_gpo_index++;
-    ret = ad_gpo_cse_step(req);
-
-    if (ret == EOK) {
-        /* ret is EOK only after all GPO policy files have been downloaded */
-        ret = ad_gpo_perform_hbac_processing(state,
-                                             state->gpo_mode,
-                                             state->gpo_map_type,
-                                             state->user,
-                                             state->user_domain,
-                                             state->host_domain);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_OP_FAILURE, "HBAC processing failed: [%d](%s}\n",
-                  ret, sss_strerror(ret));
-            goto done;
+        if (state->cse_error == EOK) {
+            state->cse_error = ret;
+        }
+    } else if (cse_filtered_gpo->send_to_child) {
+        /* the gpo_child may have downloaded a new version of the policy */
+        ret = sysdb_gpo_get_gpo_by_guid(state, state->host_domain,
+                                        cse_filtered_gpo->gpo_guid, &res);
+        if (ret == EOK) {
+            gpt_version = ldb_msg_find_attr_as_int(res->msgs[0],
+                                                   SYSDB_GPO_VERSION_ATTR,
+                                                   0);
+            talloc_free(res);
+        } else {
+            gpt_version = -1;
         }
 
+        if (gpt_version != cse_filtered_gpo->cached_gpt_version) {
+            DEBUG(SSSDBG_TRACE_FUNC, "GPT version of [%s] changed\n",
+                  cse_filtered_gpo->gpo_guid);
+            be_access_cache_invalidate(state->access_ctx->gpo_decision_cache);
+        }
     }
 
- done:
+    ret = ad_gpo_cse_step(req);
 
     if (ret == EOK) {
         tevent_req_done(req);
@@ -2331,9 +2627,25 @@ ad_gpo_cse_done(struct tevent_req *subreq)
 errno_t
 ad_gpo_access_recv(struct tevent_req *req)
 {
-    TEVENT_REQ_RETURN_ON_ERROR(req);
+    struct ad_gpo_access_state *state;
+    enum tevent_req_state tstate;
+    uint64_t err;
+    errno_t ret;
 
-    return EOK;
+    state = tevent_req_data(req, struct ad_gpo_access_state);
+
+    if (tevent_req_is_error(req, &tstate, &err)) {
+        ret = tstate == TEVENT_REQ_USER_ERROR ? (errno_t)err : ERR_INTERNAL;
+    } else {
+        ret = EOK;
+    }
+
+    /* only definite answers are remembered, never transient failures */
+    if (state->store_decision && (ret == EOK || ret == ERR_ACCESS_DENIED)) {
+        ad_gpo_decision_store(state, ret);
+    }
+
+    return ret;
 }
 
 /* == ad_gpo_process_som_send/recv helpers ================================= */
@@ -3791,6 +4103,20 @@ ad_gpo_sd_process_attrs(struct tevent_req *req,
 
     DEBUG(SSSDBG_TRACE_ALL, "gpo_flags: %d\n", gp_gpo->gpo_flags);
 
+    /* retrieve AD_AT_VERSION_NUMBER, it is only an optimization */
+    ret = sysdb_attrs_get_int32_t(result, AD_AT_VERSION_NUMBER,
+                                  &gp_gpo->gpc_version);
+    if (ret == ENOENT) {
+        gp_gpo->gpc_version = -1;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "sysdb_attrs_get_int32_t failed: [%d](%s)\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_ALL, "gpc_version: %d\n", gp_gpo->gpc_version);
+
     /* retrieve AD_AT_NT_SEC_DESC */
     ret = sysdb_attrs_get_el(result, AD_AT_NT_SEC_DESC, &el);
     if (ret != EOK && ret != ENOENT) {
@@ -3865,361 +4191,6 @@ ad_gpo_process_gpo_recv(struct tevent_req *req,
     return EOK;
 }
 
-/* == ad_gpo_process_cse_send/recv helpers ================================= */
-static errno_t
-create_cse_send_buffer(TALLOC_CTX *mem_ctx,
-                       const char *smb_server,
-                       const char *smb_share,
-                       const char *smb_path,
-                       const char *smb_cse_suffix,
-                       int cached_gpt_version,
-                       struct io_buffer **io_buf)
-{
-    struct io_buffer *buf;
-    size_t rp;
-    int smb_server_length;
-    int smb_share_length;
-    int smb_path_length;
-    int smb_cse_suffix_length;
-
-    smb_server_length = strlen(smb_server);
-    smb_share_length = strlen(smb_share);
-    smb_path_length = strlen(smb_path);
-    smb_cse_suffix_length = strlen(smb_cse_suffix);
-
-    buf = talloc(mem_ctx, struct io_buffer);
-    if (buf == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
-        return ENOMEM;
-    }
-
-    buf->size = 5 * sizeof(uint32_t);
-    buf->size += smb_server_length + smb_share_length + smb_path_length +
-        smb_cse_suffix_length;
-
-    DEBUG(SSSDBG_TRACE_ALL, "buffer size: %zu\n", buf->size);
-
-    buf->data = talloc_size(buf, buf->size);
-    if (buf->data == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc_size failed.\n");
-        talloc_free(buf);
-        return ENOMEM;
-    }
-
-    rp = 0;
-    /* cached_gpt_version */
-    SAFEALIGN_SET_UINT32(&buf->data[rp], cached_gpt_version, &rp);
-
-    /* smb_server */
-    SAFEALIGN_SET_UINT32(&buf->data[rp], smb_server_length, &rp);
-    safealign_memcpy(&buf->data[rp], smb_server, smb_server_length, &rp);
-
-    /* smb_share */
-    SAFEALIGN_SET_UINT32(&buf->data[rp], smb_share_length, &rp);
-    safealign_memcpy(&buf->data[rp], smb_share, smb_share_length, &rp);
-
-    /* smb_path */
-    SAFEALIGN_SET_UINT32(&buf->data[rp], smb_path_length, &rp);
-    safealign_memcpy(&buf->data[rp], smb_path, smb_path_length, &rp);
-
-    /* smb_cse_suffix */
-    SAFEALIGN_SET_UINT32(&buf->data[rp], smb_cse_suffix_length, &rp);
-    safealign_memcpy(&buf->data[rp], smb_cse_suffix, smb_cse_suffix_length, &rp);
-
-    *io_buf = buf;
-    return EOK;
-}
-
-static errno_t
-ad_gpo_parse_gpo_child_response(uint8_t *buf,
-                                ssize_t size,
-                                uint32_t *_sysvol_gpt_version,
-                                uint32_t *_result)
-{
-
-    int ret;
-    size_t p = 0;
-    uint32_t sysvol_gpt_version;
-    uint32_t result;
-
-    /* sysvol_gpt_version */
-    SAFEALIGN_COPY_UINT32_CHECK(&sysvol_gpt_version, buf + p, size, &p);
-
-    /* operation result code */
-    SAFEALIGN_COPY_UINT32_CHECK(&result, buf + p, size, &p);
-
-    *_sysvol_gpt_version = sysvol_gpt_version;
-    *_result = result;
-
-    ret = EOK;
-    return ret;
-}
-
-/* == ad_gpo_process_cse_send/recv implementation ========================== */
-
-struct ad_gpo_process_cse_state {
-    struct tevent_context *ev;
-    struct sss_domain_info *domain;
-    int gpo_timeout_option;
-    const char *gpo_guid;
-    const char *smb_path;
-    const char *smb_cse_suffix;
-    pid_t child_pid;
-    uint8_t *buf;
-    ssize_t len;
-    struct child_io_fds *io;
-};
-
-static errno_t gpo_fork_child(struct tevent_req *req);
-static void gpo_cse_step(struct tevent_req *subreq);
-static void gpo_cse_done(struct tevent_req *subreq);
-
-/*
- * This cse-specific function (GP_EXT_GUID_SECURITY) sends the input smb uri
- * components and cached_gpt_version to the gpo child, which, in turn,
- * will download the GPT.INI file and policy files (as needed) and store
- * them in the GPO_CACHE directory. Note that if the send_to_child input is
- * false, this function simply completes the request.
- */
-struct tevent_req *
-ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
-                        struct tevent_context *ev,
-                        bool send_to_child,
-                        struct sss_domain_info *domain,
-                        const char *gpo_guid,
-                        const char *smb_server,
-                        const char *smb_share,
-                        const char *smb_path,
-                        const char *smb_cse_suffix,
-                        int cached_gpt_version,
-                        int gpo_timeout_option)
-{
-    struct tevent_req *req;
-    struct tevent_req *subreq;
-    struct ad_gpo_process_cse_state *state;
-    struct io_buffer *buf = NULL;
-    errno_t ret;
-
-    req = tevent_req_create(mem_ctx, &state, struct ad_gpo_process_cse_state);
-    if (req == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "tevent_req_create() failed\n");
-        return NULL;
-    }
-
-    if (!send_to_child) {
-        /*
-         * if we don't need to talk to child (b/c cache timeout is still valid),
-         * we simply complete the request
-         */
-        ret = EOK;
-        goto immediately;
-    }
-
-    state->ev = ev;
-    state->buf = NULL;
-    state->len = 0;
-    state->domain = domain;
-    state->gpo_timeout_option = gpo_timeout_option;
-    state->gpo_guid = gpo_guid;
-    state->smb_path = smb_path;
-    state->smb_cse_suffix = smb_cse_suffix;
-    state->io = talloc(state, struct child_io_fds);
-    if (state->io == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
-        ret = ENOMEM;
-        goto immediately;
-    }
-
-    state->io->write_to_child_fd = -1;
-    state->io->read_from_child_fd = -1;
-    talloc_set_destructor((void *) state->io, child_io_destructor);
-
-    /* prepare the data to pass to child */
-    ret = create_cse_send_buffer(state, smb_server, smb_share, smb_path,
-                                 smb_cse_suffix, cached_gpt_version, &buf);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "create_cse_send_buffer failed.\n");
-        goto immediately;
-    }
-
-    ret = gpo_fork_child(req);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "gpo_fork_child failed.\n");
-        goto immediately;
-    }
-
-    subreq = write_pipe_send(state, ev, buf->data, buf->size,
-                             state->io->write_to_child_fd);
-    if (subreq == NULL) {
-        ret = ENOMEM;
-        goto immediately;
-    }
-    tevent_req_set_callback(subreq, gpo_cse_step, req);
-
-    return req;
-
-immediately:
-
-    if (ret == EOK) {
-        tevent_req_done(req);
-        tevent_req_post(req, ev);
-    } else {
-        tevent_req_error(req, ret);
-        tevent_req_post(req, ev);
-    }
-
-    return req;
-}
-
-static void gpo_cse_step(struct tevent_req *subreq)
-{
-    struct tevent_req *req;
-    struct ad_gpo_process_cse_state *state;
-    int ret;
-
-    req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct ad_gpo_process_cse_state);
-
-    ret = write_pipe_recv(subreq);
-    talloc_zfree(subreq);
-    if (ret != EOK) {
-        tevent_req_error(req, ret);
-        return;
-    }
-
-    close(state->io->write_to_child_fd);
-    state->io->write_to_child_fd = -1;
-
-    subreq = read_pipe_send(state, state->ev, state->io->read_from_child_fd);
-
-    if (subreq == NULL) {
-        tevent_req_error(req, ENOMEM);
-        return;
-    }
-    tevent_req_set_callback(subreq, gpo_cse_done, req);
-}
-
-static void gpo_cse_done(struct tevent_req *subreq)
-{
-    struct tevent_req *req;
-    struct ad_gpo_process_cse_state *state;
-    uint32_t sysvol_gpt_version = -1;
-    uint32_t child_result;
-    time_t now;
-
-    req = tevent_req_callback_data(subreq, struct tevent_req);
-    state = tevent_req_data(req, struct ad_gpo_process_cse_state);
-    int ret;
-
-    ret = read_pipe_recv(subreq, state, &state->buf, &state->len);
-    talloc_zfree(subreq);
-    if (ret != EOK) {
-        tevent_req_error(req, ret);
-        return;
-    }
-
-    close(state->io->read_from_child_fd);
-    state->io->read_from_child_fd = -1;
-
-    ret = ad_gpo_parse_gpo_child_response(state->buf, state->len,
-                                          &sysvol_gpt_version, &child_result);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "ad_gpo_parse_gpo_child_response failed: [%d][%s]\n",
-              ret, sss_strerror(ret));
-        tevent_req_error(req, ret);
-        return;
-    } else if (child_result != 0){
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "Error in gpo_child: [%d][%s]\n",
-              child_result, strerror(child_result));
-        tevent_req_error(req, child_result);
-        return;
-    }
-
-    now = time(NULL);
-    DEBUG(SSSDBG_TRACE_FUNC, "sysvol_gpt_version: %d\n", sysvol_gpt_version);
-    ret = sysdb_gpo_store_gpo(state->domain, state->gpo_guid, sysvol_gpt_version,
-                              state->gpo_timeout_option, now);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "Unable to store gpo cache entry: [%d](%s}\n",
-              ret, sss_strerror(ret));
-        tevent_req_error(req, ret);
-        return;
-    }
-
-    tevent_req_done(req);
-    return;
-}
-
-int ad_gpo_process_cse_recv(struct tevent_req *req)
-{
-    TEVENT_REQ_RETURN_ON_ERROR(req);
-    return EOK;
-}
-
-static errno_t
-gpo_fork_child(struct tevent_req *req)
-{
-    int pipefd_to_child[2];
-    int pipefd_from_child[2];
-    pid_t pid;
-    int ret;
-    errno_t err;
-    struct ad_gpo_process_cse_state *state;
-
-    state = tevent_req_data(req, struct ad_gpo_process_cse_state);
-
-    ret = pipe(pipefd_from_child);
-    if (ret == -1) {
-        err = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, strerror(errno));
-        return err;
-    }
-    ret = pipe(pipefd_to_child);
-    if (ret == -1) {
-        err = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "pipe failed [%d][%s].\n", errno, strerror(errno));
-        return err;
-    }
-
-    pid = fork();
-
-    if (pid == 0) { /* child */
-        err = exec_child_ex(state,
-                            pipefd_to_child, pipefd_from_child,
-                            GPO_CHILD, gpo_child_debug_fd, NULL, false,
-                            STDIN_FILENO, AD_GPO_CHILD_OUT_FILENO);
-        DEBUG(SSSDBG_CRIT_FAILURE, "Could not exec gpo_child: [%d][%s].\n",
-              err, strerror(err));
-        return err;
-    } else if (pid > 0) { /* parent */
-        state->child_pid = pid;
-        state->io->read_from_child_fd = pipefd_from_child[0];
-        close(pipefd_from_child[1]);
-        state->io->write_to_child_fd = pipefd_to_child[1];
-        close(pipefd_to_child[0]);
-        sss_fd_nonblocking(state->io->read_from_child_fd);
-        sss_fd_nonblocking(state->io->write_to_child_fd);
-
-        ret = child_handler_setup(state->ev, pid, NULL, NULL, NULL);
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "Could not set up child signal handler\n");
-            return ret;
-        }
-    } else { /* error */
-        err = errno;
-        DEBUG(SSSDBG_CRIT_FAILURE,
-              "fork failed [%d][%s].\n", errno, strerror(errno));
-        return err;
-    }
-
-    return EOK;
-}
-
 struct ad_gpo_get_sd_referral_state {
     struct tevent_context *ev;
     struct ad_access_ctx *access_ctx;
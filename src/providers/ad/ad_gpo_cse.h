@@ -0,0 +1,45 @@
+/*
+    SSSD
+
+    GPO policy file retrieval by the gpo_child
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AD_GPO_CSE_H_
+#define AD_GPO_CSE_H_
+
+#include "util/util.h"
+
+/* Sets up the log file of the gpo_child processes */
+errno_t gpo_child_init(void);
+
+/* Retrieves the policy files of a single GPO into the GPO_CACHE */
+struct tevent_req *ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
+                                           struct tevent_context *ev,
+                                           bool send_to_child,
+                                           struct sss_domain_info *domain,
+                                           const char *gpo_guid,
+                                           const char *smb_server,
+                                           const char *smb_share,
+                                           const char *smb_path,
+                                           const char *smb_cse_suffix,
+                                           int cached_gpt_version,
+                                           int gpo_timeout_option);
+
+int ad_gpo_process_cse_recv(struct tevent_req *req);
+
+#endif /* AD_GPO_CSE_H_ */
@@ -498,6 +498,17 @@ sssm_ad_access_init(struct be_ctx *bectx,
         dp_opt_get_int(access_ctx->ad_options, AD_GPO_CACHE_TIMEOUT);
     access_ctx->gpo_cache_timeout = gpo_cache_timeout;
 
+    ret = be_access_cache_init(access_ctx,
+                               dp_opt_get_int(access_ctx->ad_options,
+                                              AD_GPO_DECISION_CACHE_TIMEOUT),
+                               &access_ctx->gpo_decision_cache);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Could not create GPO decision cache: [%s]\n",
+              strerror(ret));
+        goto fail;
+    }
+
     /* GPO logon maps */
 
     ret = sss_hash_create(access_ctx, 10, &access_ctx->gpo_map_options_table);
@@ -71,6 +71,7 @@ struct mon_cli_iface monitor_be_methods = {
     .clearMemcache = NULL,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getLatencyStats = NULL,
 };
 
 static int client_registration(struct sbus_request *dbus_req, void *data);
@@ -177,10 +178,30 @@ struct be_req {
     /* Just for nicer debugging */
     const char *req_name;
 
+    /* NULL if the request is not traced */
+    struct be_req_trace *trace;
+
     struct be_req *prev;
     struct be_req *next;
 };
 
+/* requests slower than this are logged with a lower debug level */
+#define BE_TRACE_SLOW_USEC (1000 * 1000)
+
+struct be_req_trace {
+    const char *id;
+    const char *desc;
+    struct timeval points[BE_TRACE_SENTINEL];
+};
+
+static const char *be_trace_phase_names[BE_TRACE_SENTINEL] = {
+    NULL,       /* nothing happens before the request is received */
+    "queue",
+    "connect",
+    "lookup",
+    "reply",
+};
+
 static int be_req_destructor(struct be_req *be_req)
 {
     DLIST_REMOVE(be_req->be_ctx->active_requests, be_req);
@@ -253,6 +274,89 @@ void be_req_terminate(struct be_req *be_req,
     be_req->fn(be_req, dp_err_type, errnum, errstr);
 }
 
+static struct be_req_trace *be_req_trace_create(struct be_req *be_req,
+                                                const char *id,
+                                                const char *desc)
+{
+    struct be_req_trace *trace;
+
+    trace = talloc_zero(be_req, struct be_req_trace);
+    if (trace == NULL) {
+        return NULL;
+    }
+
+    trace->id = talloc_strdup(trace, id);
+    trace->desc = talloc_strdup(trace, desc);
+    if (trace->id == NULL || trace->desc == NULL) {
+        talloc_free(trace);
+        return NULL;
+    }
+
+    be_req_trace_mark(trace, BE_TRACE_RECEIVED);
+    be_req->trace = trace;
+
+    return trace;
+}
+
+void be_req_trace_mark(struct be_req_trace *trace, enum be_trace_point point)
+{
+    if (trace == NULL || point >= BE_TRACE_SENTINEL) {
+        return;
+    }
+
+    trace->points[point] = tevent_timeval_current();
+}
+
+static long be_req_trace_usec(struct timeval *from, struct timeval *to)
+{
+    struct timeval diff;
+
+    diff = tevent_timeval_until(from, to);
+    return diff.tv_sec * 1000000 + diff.tv_usec;
+}
+
+static void be_req_trace_log(struct be_req_trace *trace,
+                             int dp_err_type, int errnum)
+{
+    struct timeval *prev;
+    char *phases;
+    long usec;
+    long total;
+    int level;
+    int i;
+
+    if (trace == NULL) {
+        return;
+    }
+
+    phases = talloc_strdup(trace, "");
+    prev = &trace->points[BE_TRACE_RECEIVED];
+    for (i = BE_TRACE_RECEIVED + 1; i < BE_TRACE_SENTINEL; i++) {
+        if (tevent_timeval_is_zero(&trace->points[i])) {
+            /* the provider does not report this point */
+            continue;
+        }
+
+        usec = be_req_trace_usec(prev, &trace->points[i]);
+        if (phases != NULL) {
+            phases = talloc_asprintf_append(phases, " %s=%ldus",
+                                            be_trace_phase_names[i], usec);
+        }
+        prev = &trace->points[i];
+    }
+
+    total = be_req_trace_usec(&trace->points[BE_TRACE_RECEIVED], prev);
+
+    level = total >= BE_TRACE_SLOW_USEC ? SSSDBG_MINOR_FAILURE
+                                        : SSSDBG_TRACE_FUNC;
+
+    DEBUG(level, "Trace [%s] %s:%s total=%ldus result=%d,%d\n",
+          trace->id, trace->desc, phases ? phases : "", total,
+          dp_err_type, errnum);
+
+    talloc_free(phases);
+}
+
 static errno_t be_sbus_reply(struct sbus_request *sbus_req,
                              dbus_uint16_t err_maj,
                              dbus_uint32_t err_min,
@@ -321,6 +425,10 @@ static void be_req_default_callback(struct be_req *be_req,
     dbus_req = (struct sbus_request *) be_req->pvt;
 
     be_sbus_req_reply(dbus_req, dp_err_type, errnum, errstr);
+
+    be_req_trace_mark(be_req->trace, BE_TRACE_REPLIED);
+    be_req_trace_log(be_req->trace, dp_err_type, errnum);
+
     talloc_free(be_req);
 }
 
@@ -416,6 +524,7 @@ static void be_async_req_handler(struct tevent_context *ev,
 
     async_req = talloc_get_type(pvt, struct be_async_req);
 
+    be_req_trace_mark(async_req->req->trace, BE_TRACE_DISPATCHED);
     async_req->fn(async_req->req);
 }
 
@@ -1199,7 +1308,9 @@ static int be_get_account_info(struct sbus_request *dbus_req, void *user_data)
     uint32_t type;
     char *filter;
     char *domain;
+    char *trace_id;
     uint32_t attr_type;
+    char *desc;
     int ret;
     struct be_sbus_reply_data req_reply = BE_SBUS_REPLY_DATA_INIT;
 
@@ -1213,12 +1324,13 @@ static int be_get_account_info(struct sbus_request *dbus_req, void *user_data)
                                       DBUS_TYPE_UINT32, &attr_type,
                                       DBUS_TYPE_STRING, &filter,
                                       DBUS_TYPE_STRING, &domain,
+                                      DBUS_TYPE_STRING, &trace_id,
                                       DBUS_TYPE_INVALID))
         return EOK; /* handled */
 
     DEBUG(SSSDBG_FUNC_DATA,
-          "Got request for [%#x][%s][%d][%s]\n", type, be_req2str(type),
-          attr_type, filter);
+          "Got request [%s] for [%#x][%s][%d][%s]\n", trace_id, type,
+          be_req2str(type), attr_type, filter);
 
     /* If we are offline and fast reply was requested
      * return offline immediately
@@ -1245,6 +1357,18 @@ static int be_get_account_info(struct sbus_request *dbus_req, void *user_data)
         goto done;
     }
 
+    if (trace_id[0] != '\0') {
+        desc = talloc_asprintf(be_req, "%s %s@%s", be_req2str(type),
+                               filter, domain);
+        if (desc == NULL
+                || be_req_trace_create(be_req, trace_id, desc) == NULL) {
+            /* the request is just not traced */
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to trace request [%s]\n",
+                  trace_id);
+        }
+        talloc_free(desc);
+    }
+
     ret = be_req_set_domain(be_req, domain);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to set request domain [%d]: %s\n",
@@ -1262,6 +1386,7 @@ static int be_get_account_info(struct sbus_request *dbus_req, void *user_data)
     }
     req->entry_type = type;
     req->attr_type = (int)attr_type;
+    req->trace = be_req->trace;
     req->domain = talloc_strdup(req, domain);
     if (!req->domain) {
         be_sbus_reply_data_set(&req_reply, DP_ERR_FATAL, ENOMEM,
@@ -39,6 +39,8 @@
 #define BE_REQ_BY_CERT        0x0014
 #define BE_REQ_TYPE_MASK      0x00FF
 #define BE_REQ_FAST           0x1000
+/* For BE_REQ_GROUP: store the group without resolving its members */
+#define BE_REQ_NO_MEMBERS     0x2000
 
 /**
  * @brief Convert request type to string for logging purpose.
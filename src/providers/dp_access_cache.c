@@ -0,0 +1,426 @@
+/*
+    SSSD
+
+    Access control decision cache
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <time.h>
+
+#include "util/util.h"
+#include "util/murmurhash3.h"
+#include "db/sysdb.h"
+#include "providers/dp_access_cache.h"
+
+#define BE_ACCESS_CACHE_INIT_SIZE 64
+
+struct be_access_cache {
+    time_t ttl;
+    uint64_t version;
+    bool version_set;
+    hash_table_t *table;
+};
+
+struct be_access_cache_entry {
+    int decision;
+    time_t expire;
+};
+
+static errno_t be_access_cache_create_table(struct be_access_cache *cache)
+{
+    return sss_hash_create(cache, BE_ACCESS_CACHE_INIT_SIZE, &cache->table);
+}
+
+errno_t be_access_cache_init(TALLOC_CTX *mem_ctx,
+                             time_t ttl,
+                             struct be_access_cache **_cache)
+{
+    struct be_access_cache *cache;
+    errno_t ret;
+
+    if (ttl < 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid TTL [%ld]\n", (long)ttl);
+        return EINVAL;
+    }
+
+    cache = talloc_zero(mem_ctx, struct be_access_cache);
+    if (cache == NULL) {
+        return ENOMEM;
+    }
+
+    cache->ttl = ttl;
+
+    if (ttl > 0) {
+        ret = be_access_cache_create_table(cache);
+        if (ret != EOK) {
+            talloc_free(cache);
+            return ret;
+        }
+    }
+
+    *_cache = cache;
+    return EOK;
+}
+
+static char *be_access_cache_key(TALLOC_CTX *mem_ctx,
+                                 const char *user,
+                                 const char *service,
+                                 const char *host)
+{
+    /* newline cannot appear in any of the components */
+    return talloc_asprintf(mem_ctx, "%s\n%s\n%s",
+                           user,
+                           service == NULL ? "" : service,
+                           host == NULL ? "" : host);
+}
+
+errno_t be_access_cache_lookup(struct be_access_cache *cache,
+                               const char *user,
+                               const char *service,
+                               const char *host,
+                               int *_decision)
+{
+    struct be_access_cache_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (cache == NULL || cache->table == NULL || user == NULL) {
+        return ENOENT;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = be_access_cache_key(NULL, user, service, host);
+    if (key.str == NULL) {
+        return ENOMEM;
+    }
+
+    hret = hash_lookup(cache->table, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        ret = ENOENT;
+        goto done;
+    } else if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up decision [%d]: %s\n",
+              hret, hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    entry = talloc_get_type(value.ptr, struct be_access_cache_entry);
+    if (entry->expire < time(NULL)) {
+        DEBUG(SSSDBG_TRACE_INTERNAL, "Cached decision has expired\n");
+        hret = hash_delete(cache->table, &key);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Unable to remove expired decision [%d]: %s\n",
+                  hret, hash_error_string(hret));
+        }
+        talloc_free(entry);
+        ret = ENOENT;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Using cached decision [%d] for user [%s], "
+          "service [%s]\n", entry->decision, user,
+          service == NULL ? "-" : service);
+
+    *_decision = entry->decision;
+    ret = EOK;
+
+done:
+    talloc_free(key.str);
+    return ret;
+}
+
+errno_t be_access_cache_store(struct be_access_cache *cache,
+                              const char *user,
+                              const char *service,
+                              const char *host,
+                              int decision)
+{
+    struct be_access_cache_entry *entry;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (cache == NULL || cache->table == NULL || user == NULL) {
+        return EOK;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = be_access_cache_key(NULL, user, service, host);
+    if (key.str == NULL) {
+        return ENOMEM;
+    }
+
+    hret = hash_lookup(cache->table, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        /* update the entry in place */
+        entry = talloc_get_type(value.ptr, struct be_access_cache_entry);
+    } else if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        entry = talloc_zero(cache->table, struct be_access_cache_entry);
+        if (entry == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        value.type = HASH_VALUE_PTR;
+        value.ptr = entry;
+
+        hret = hash_enter(cache->table, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to store decision [%d]: %s\n",
+                  hret, hash_error_string(hret));
+            talloc_free(entry);
+            ret = EIO;
+            goto done;
+        }
+    } else {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up decision [%d]: %s\n",
+              hret, hash_error_string(hret));
+        ret = EIO;
+        goto done;
+    }
+
+    entry->decision = decision;
+    entry->expire = time(NULL) + cache->ttl;
+
+    ret = EOK;
+
+done:
+    talloc_free(key.str);
+    return ret;
+}
+
+void be_access_cache_invalidate(struct be_access_cache *cache)
+{
+    errno_t ret;
+
+    if (cache == NULL || cache->ttl == 0) {
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Dropping all cached access decisions\n");
+
+    /* entries are allocated on the table and released together with it */
+    talloc_zfree(cache->table);
+
+    ret = be_access_cache_create_table(cache);
+    if (ret != EOK) {
+        /* the cache is simply disabled until the next invalidation */
+        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to recreate decision cache "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        cache->table = NULL;
+    }
+}
+
+void be_access_cache_set_version(struct be_access_cache *cache,
+                                 uint64_t version)
+{
+    if (cache == NULL || cache->ttl == 0) {
+        return;
+    }
+
+    if (cache->version_set && cache->version == version) {
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Rule set version changed to [%"PRIu64"]\n",
+          version);
+
+    cache->version = version;
+    cache->version_set = true;
+    be_access_cache_invalidate(cache);
+}
+
+/* Two independently seeded lanes give a 64 bit digest */
+#define BE_ACCESS_DIGEST_SEED1 0xdeadbeef
+#define BE_ACCESS_DIGEST_SEED2 0x5ca1ab1e
+
+/* length marker of a NULL string */
+#define BE_ACCESS_DIGEST_NULL UINT32_MAX
+
+static void be_access_digest_mix(struct be_access_digest *digest,
+                                 const void *data,
+                                 size_t len)
+{
+    digest->h1 = murmurhash3(data, len, digest->h1);
+    digest->h2 = murmurhash3(data, len, digest->h2);
+}
+
+void be_access_digest_init(struct be_access_digest *digest)
+{
+    digest->h1 = BE_ACCESS_DIGEST_SEED1;
+    digest->h2 = BE_ACCESS_DIGEST_SEED2;
+}
+
+void be_access_digest_add(struct be_access_digest *digest,
+                          const void *data,
+                          size_t len)
+{
+    uint32_t len32 = len;
+
+    be_access_digest_mix(digest, &len32, sizeof(len32));
+    be_access_digest_mix(digest, data, len);
+}
+
+void be_access_digest_add_string(struct be_access_digest *digest,
+                                 const char *str)
+{
+    uint32_t len32 = BE_ACCESS_DIGEST_NULL;
+
+    if (str == NULL) {
+        be_access_digest_mix(digest, &len32, sizeof(len32));
+        return;
+    }
+
+    be_access_digest_add(digest, str, strlen(str));
+}
+
+void be_access_digest_add_int(struct be_access_digest *digest, int64_t num)
+{
+    be_access_digest_add(digest, &num, sizeof(num));
+}
+
+uint64_t be_access_digest_value(struct be_access_digest *digest)
+{
+    return ((uint64_t) digest->h1 << 32) | digest->h2;
+}
+
+static int be_access_digest_el_cmp(const void *a, const void *b)
+{
+    const struct ldb_message_element *el1;
+    const struct ldb_message_element *el2;
+
+    el1 = *(struct ldb_message_element * const *) a;
+    el2 = *(struct ldb_message_element * const *) b;
+
+    return strcasecmp(el1->name, el2->name);
+}
+
+static int be_access_digest_val_cmp(const void *a, const void *b)
+{
+    const struct ldb_val *val1 = *(struct ldb_val * const *) a;
+    const struct ldb_val *val2 = *(struct ldb_val * const *) b;
+    size_t len;
+    int ret;
+
+    len = val1->length < val2->length ? val1->length : val2->length;
+    ret = memcmp(val1->data, val2->data, len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    return val1->length < val2->length ? -1 : val1->length > val2->length;
+}
+
+static int be_access_digest_u64_cmp(const void *a, const void *b)
+{
+    uint64_t u1 = *(const uint64_t *) a;
+    uint64_t u2 = *(const uint64_t *) b;
+
+    return u1 < u2 ? -1 : u1 > u2;
+}
+
+/* The digest of a single entry, its attributes are added sorted by name
+ * and the values of every attribute sorted as well */
+static errno_t be_access_digest_entry(TALLOC_CTX *mem_ctx,
+                                      struct sysdb_attrs *attrs,
+                                      uint64_t *_value)
+{
+    struct be_access_digest digest;
+    struct ldb_message_element **els;
+    struct ldb_val **vals;
+    int i;
+    unsigned int j;
+
+    els = talloc_array(mem_ctx, struct ldb_message_element *, attrs->num);
+    if (els == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < attrs->num; i++) {
+        els[i] = &attrs->a[i];
+    }
+    qsort(els, attrs->num, sizeof(els[0]), be_access_digest_el_cmp);
+
+    be_access_digest_init(&digest);
+    for (i = 0; i < attrs->num; i++) {
+        vals = talloc_array(els, struct ldb_val *, els[i]->num_values);
+        if (vals == NULL) {
+            talloc_free(els);
+            return ENOMEM;
+        }
+
+        for (j = 0; j < els[i]->num_values; j++) {
+            vals[j] = &els[i]->values[j];
+        }
+        qsort(vals, els[i]->num_values, sizeof(vals[0]),
+              be_access_digest_val_cmp);
+
+        be_access_digest_add_string(&digest, els[i]->name);
+        be_access_digest_add_int(&digest, els[i]->num_values);
+        for (j = 0; j < els[i]->num_values; j++) {
+            be_access_digest_add(&digest, vals[j]->data, vals[j]->length);
+        }
+
+        talloc_free(vals);
+    }
+
+    talloc_free(els);
+
+    *_value = be_access_digest_value(&digest);
+    return EOK;
+}
+
+errno_t be_access_digest_add_attrs(struct be_access_digest *digest,
+                                   size_t count,
+                                   struct sysdb_attrs **attrs)
+{
+    uint64_t *entries;
+    size_t i;
+    errno_t ret;
+
+    entries = talloc_array(NULL, uint64_t, count);
+    if (entries == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < count; i++) {
+        ret = be_access_digest_entry(entries, attrs[i], &entries[i]);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    /* the order in which the server returned the entries does not matter */
+    qsort(entries, count, sizeof(entries[0]), be_access_digest_u64_cmp);
+
+    be_access_digest_add_int(digest, count);
+    for (i = 0; i < count; i++) {
+        be_access_digest_add(digest, &entries[i], sizeof(entries[i]));
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(entries);
+    return ret;
+}
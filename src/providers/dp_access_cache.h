@@ -0,0 +1,123 @@
+/*
+    SSSD
+
+    Access control decision cache
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _DP_ACCESS_CACHE_H_
+#define _DP_ACCESS_CACHE_H_
+
+#include <talloc.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "util/util_errors.h"
+
+/**
+ * The access cache remembers the outcome of an access control evaluation
+ * (e.g. IPA HBAC or AD GPO) for a (user, service, host) tuple so that
+ * repeated checks do not need to rebuild and evaluate the whole rule set.
+ *
+ * Every cached decision is bound to the version of the rule set it was
+ * computed from. When the provider refreshes its rules it reports the new
+ * version with be_access_cache_set_version() and all decisions computed
+ * from a different version are dropped.
+ */
+struct be_access_cache;
+
+/**
+ * Create a new decision cache. Decisions are kept for at most @ttl seconds,
+ * a @ttl of 0 disables the cache completely.
+ */
+errno_t be_access_cache_init(TALLOC_CTX *mem_ctx,
+                             time_t ttl,
+                             struct be_access_cache **_cache);
+
+/**
+ * Look up a cached decision.
+ *
+ * @return EOK and the decision in @_decision if a valid entry was found,
+ *         ENOENT if there is no valid entry or the cache is disabled.
+ */
+errno_t be_access_cache_lookup(struct be_access_cache *cache,
+                               const char *user,
+                               const char *service,
+                               const char *host,
+                               int *_decision);
+
+/**
+ * Remember the decision for the given tuple. The meaning of @decision is
+ * entirely up to the caller (PAM status, errno code, ...).
+ */
+errno_t be_access_cache_store(struct be_access_cache *cache,
+                              const char *user,
+                              const char *service,
+                              const char *host,
+                              int decision);
+
+/**
+ * Report the version of the rule set the provider currently evaluates.
+ * If it differs from the previously reported one, all cached decisions
+ * are dropped.
+ */
+void be_access_cache_set_version(struct be_access_cache *cache,
+                                 uint64_t version);
+
+/**
+ * Drop all cached decisions unconditionally.
+ */
+void be_access_cache_invalidate(struct be_access_cache *cache);
+
+/**
+ * A digest of an ordered sequence of data, used as the version of a rule
+ * set. Every piece of data is added together with its length, so moving
+ * data between two pieces or reordering them changes the digest.
+ */
+struct be_access_digest {
+    uint32_t h1;
+    uint32_t h2;
+};
+
+struct sysdb_attrs;
+
+void be_access_digest_init(struct be_access_digest *digest);
+
+void be_access_digest_add(struct be_access_digest *digest,
+                          const void *data,
+                          size_t len);
+
+/**
+ * Add a string, NULL is distinguished from an empty string.
+ */
+void be_access_digest_add_string(struct be_access_digest *digest,
+                                 const char *str);
+
+void be_access_digest_add_int(struct be_access_digest *digest, int64_t num);
+
+/**
+ * Add a set of entries, e.g. as downloaded from the server. The order of
+ * the entries, of their attributes and of the attribute values does not
+ * matter, but every value stays bound to its attribute and its entry.
+ */
+errno_t be_access_digest_add_attrs(struct be_access_digest *digest,
+                                   size_t count,
+                                   struct sysdb_attrs **attrs);
+
+uint64_t be_access_digest_value(struct be_access_digest *digest);
+
+#endif /* _DP_ACCESS_CACHE_H_ */
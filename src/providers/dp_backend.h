@@ -156,6 +156,8 @@ struct bet_ops {
     be_req_fn_t finalize;
 };
 
+struct be_req_trace;
+
 struct be_acct_req {
     int entry_type;
     int attr_type;
@@ -163,6 +165,9 @@ struct be_acct_req {
     char *filter_value;
     char *extra_value;
     char *domain;
+
+    /* NULL if the request is not traced */
+    struct be_req_trace *trace;
 };
 
 struct be_sudo_req {
@@ -311,6 +316,22 @@ void *be_req_get_data(struct be_req *be_req);
 void be_req_terminate(struct be_req *be_req,
                       int dp_err_type, int errnum, const char *errstr);
 
+/* Points in the life of a traced request. The time spent in a phase is
+ * the difference to the previous point that was reached. */
+enum be_trace_point {
+    BE_TRACE_RECEIVED,      /* the request arrived over sbus */
+    BE_TRACE_DISPATCHED,    /* the provider handler was started */
+    BE_TRACE_CONNECTED,     /* the connection to the server is ready */
+    BE_TRACE_LOOKED_UP,     /* the server was searched and the cache updated */
+    BE_TRACE_REPLIED,       /* the reply was sent */
+
+    BE_TRACE_SENTINEL
+};
+
+/* Records that the request reached the point now. Does nothing if trace is
+ * NULL, so providers can mark the points unconditionally. */
+void be_req_trace_mark(struct be_req_trace *trace, enum be_trace_point point);
+
 void be_terminate_domain_requests(struct be_ctx *be_ctx,
                                   const char *domain);
 
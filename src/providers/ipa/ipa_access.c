@@ -72,6 +72,113 @@ void hbac_debug_messages(const char *file, int line,
     }
 }
 
+/* The HBAC result depends on the user, the service and, if source host
+ * checking is enabled, the remote host. The target host is always
+ * the configured ipa_hostname. */
+static const char *hbac_decision_rhost(struct dp_option *ipa_options,
+                                       struct pam_data *pd)
+{
+    if (dp_opt_get_bool(ipa_options, IPA_HBAC_SUPPORT_SRCHOST)) {
+        return pd->rhost;
+    }
+
+    return NULL;
+}
+
+static char *hbac_decision_user(TALLOC_CTX *mem_ctx, struct pam_data *pd)
+{
+    return talloc_asprintf(mem_ctx, "%s@%s", pd->user, pd->domain);
+}
+
+static void hbac_decision_store(struct ipa_access_ctx *access_ctx,
+                                struct pam_data *pd,
+                                int pam_status)
+{
+    char *user;
+    errno_t ret;
+
+    user = hbac_decision_user(NULL, pd);
+    if (user == NULL) {
+        return;
+    }
+
+    ret = be_access_cache_store(access_ctx->decision_cache, user,
+                                pd->service,
+                                hbac_decision_rhost(access_ctx->ipa_options,
+                                                    pd),
+                                pam_status);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to cache HBAC decision "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+
+    talloc_free(user);
+}
+
+static errno_t hbac_decision_lookup(struct ipa_access_ctx *access_ctx,
+                                    struct pam_data *pd,
+                                    int *_pam_status)
+{
+    char *user;
+    errno_t ret;
+
+    user = hbac_decision_user(NULL, pd);
+    if (user == NULL) {
+        return ENOMEM;
+    }
+
+    ret = be_access_cache_lookup(access_ctx->decision_cache, user,
+                                 pd->service,
+                                 hbac_decision_rhost(access_ctx->ipa_options,
+                                                     pd),
+                                 _pam_status);
+    talloc_free(user);
+    return ret;
+}
+
+/* Compute a digest of the downloaded HBAC data. It does not depend on the
+ * order in which the server returned the entries and their values. */
+static errno_t hbac_ctx_digest(struct hbac_ctx *hbac_ctx, uint64_t *_digest)
+{
+    struct be_access_digest digest;
+    errno_t ret;
+
+    be_access_digest_init(&digest);
+
+    ret = be_access_digest_add_attrs(&digest, hbac_ctx->host_count,
+                                     hbac_ctx->hosts);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = be_access_digest_add_attrs(&digest, hbac_ctx->hostgroup_count,
+                                     hbac_ctx->hostgroups);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = be_access_digest_add_attrs(&digest, hbac_ctx->service_count,
+                                     hbac_ctx->services);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = be_access_digest_add_attrs(&digest, hbac_ctx->servicegroup_count,
+                                     hbac_ctx->servicegroups);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = be_access_digest_add_attrs(&digest, hbac_ctx->rule_count,
+                                     hbac_ctx->rules);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    *_digest = be_access_digest_value(&digest);
+    return EOK;
+}
+
 static void ipa_access_reply(struct hbac_ctx *hbac_ctx, int pam_status)
 {
     struct be_req *be_req = hbac_ctx->be_req;
@@ -79,6 +186,10 @@ static void ipa_access_reply(struct hbac_ctx *hbac_ctx, int pam_status)
     pd = talloc_get_type(be_req_get_data(be_req), struct pam_data);
     pd->pam_status = pam_status;
 
+    if (pam_status == PAM_SUCCESS || pam_status == PAM_PERM_DENIED) {
+        hbac_decision_store(hbac_ctx->access_ctx, pd, pam_status);
+    }
+
     /* destroy HBAC context now to release all used resources and LDAP connection */
     talloc_zfree(hbac_ctx);
 
@@ -152,6 +263,7 @@ static void ipa_hbac_check(struct tevent_req *req)
     struct pam_data *pd;
     struct hbac_ctx *hbac_ctx = NULL;
     struct ipa_access_ctx *ipa_access_ctx;
+    int pam_status;
     int ret;
 
     be_req = tevent_req_callback_data(req, struct be_req);
@@ -186,6 +298,19 @@ static void ipa_hbac_check(struct tevent_req *req)
         return;
     }
 
+    ipa_access_ctx = talloc_get_type(be_ctx->bet_info[BET_ACCESS].pvt_bet_data,
+                                     struct ipa_access_ctx);
+
+    ret = hbac_decision_lookup(ipa_access_ctx, pd, &pam_status);
+    if (ret == EOK) {
+        pd->pam_status = pam_status;
+        be_req_terminate(be_req, DP_ERR_OK, pd->pam_status, NULL);
+        return;
+    } else if (ret != ENOENT) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to look up cached HBAC decision "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+    }
+
     hbac_ctx = talloc_zero(be_req, struct hbac_ctx);
     if (hbac_ctx == NULL) {
         DEBUG(SSSDBG_CRIT_FAILURE, "talloc failed.\n");
@@ -195,8 +320,6 @@ static void ipa_hbac_check(struct tevent_req *req)
 
     hbac_ctx->be_req = be_req;
     hbac_ctx->pd = pd;
-    ipa_access_ctx = talloc_get_type(be_ctx->bet_info[BET_ACCESS].pvt_bet_data,
-                                     struct ipa_access_ctx);
     hbac_ctx->access_ctx = ipa_access_ctx;
     hbac_ctx->sdap_ctx = ipa_access_ctx->sdap_ctx;
     hbac_ctx->ipa_options = ipa_access_ctx->ipa_options;
@@ -525,6 +648,7 @@ static void hbac_sysdb_save(struct tevent_req *req)
             talloc_get_type(be_ctx->bet_info[BET_ACCESS].pvt_bet_data,
                             struct ipa_access_ctx);
     TALLOC_CTX *tmp_ctx;
+    uint64_t digest;
 
     ret = ipa_hbac_rule_info_recv(req, hbac_ctx,
                                   &hbac_ctx->rule_count,
@@ -558,6 +682,8 @@ static void hbac_sysdb_save(struct tevent_req *req)
             return;
         }
 
+        be_access_cache_set_version(access_ctx->decision_cache, 0);
+
         /* If no rules are found, we default to DENY */
         ipa_access_reply(hbac_ctx, PAM_PERM_DENIED);
         return;
@@ -618,6 +744,16 @@ static void hbac_sysdb_save(struct tevent_req *req)
     }
     in_transaction = false;
 
+    /* Drop the cached decisions if the rules changed */
+    ret = hbac_ctx_digest(hbac_ctx, &digest);
+    if (ret == EOK) {
+        be_access_cache_set_version(access_ctx->decision_cache, digest);
+    } else {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to compute HBAC digest "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        be_access_cache_invalidate(access_ctx->decision_cache);
+    }
+
     /* We don't need the rule data any longer,
      * the rest of the processing relies on
      * sysdb lookups.
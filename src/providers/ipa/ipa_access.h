@@ -26,6 +26,7 @@
 #define _IPA_ACCESS_H_
 
 #include "providers/ldap/ldap_common.h"
+#include "providers/dp_access_cache.h"
 
 enum ipa_access_mode {
     IPA_ACCESS_DENY = 0,
@@ -38,6 +39,7 @@ struct ipa_access_ctx {
     struct time_rules_ctx *tr_ctx;
     time_t last_update;
     struct sdap_access_ctx *sdap_access_ctx;
+    struct be_access_cache *decision_cache;
 
     struct sdap_attr_map *host_map;
     struct sdap_attr_map *hostgroup_map;
@@ -54,6 +54,8 @@ enum ipa_basic_opt {
     IPA_SERVER_MODE,
     IPA_VIEWS_SEARCH_BASE,
     IPA_KRB5_CONFD_PATH,
+    IPA_HBAC_DECISION_CACHE_TIMEOUT,
+    IPA_EXTDOM_MAX_OUTSTANDING,
 
     IPA_OPTS_BASIC /* opts counter */
 };
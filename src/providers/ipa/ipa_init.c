@@ -626,6 +626,15 @@ int sssm_ipa_access_init(struct be_ctx *bectx,
     ipa_access_ctx->sdap_access_ctx->access_rule[0] = LDAP_ACCESS_EXPIRE;
     ipa_access_ctx->sdap_access_ctx->access_rule[1] = LDAP_ACCESS_EMPTY;
 
+    ret = be_access_cache_init(ipa_access_ctx,
+                               dp_opt_get_int(ipa_access_ctx->ipa_options,
+                                              IPA_HBAC_DECISION_CACHE_TIMEOUT),
+                               &ipa_access_ctx->decision_cache);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "be_access_cache_init failed.\n");
+        goto done;
+    }
+
     *ops = &ipa_access_ops;
     *pvt_data = ipa_access_ctx;
 
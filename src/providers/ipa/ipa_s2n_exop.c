@@ -888,26 +888,43 @@ done:
     return ret;
 }
 
+struct ipa_s2n_list_item {
+    struct tevent_req *req;
+    struct req_input req_input;
+    struct sss_domain_info *obj_domain;
+    struct resp_attrs *attrs;
+    struct sysdb_attrs *override_attrs;
+};
+
 struct ipa_s2n_get_list_state {
     struct tevent_context *ev;
     struct ipa_id_ctx *ipa_ctx;
     struct sss_domain_info *dom;
     struct sdap_handle *sh;
-    struct req_input req_input;
     char **list;
-    size_t list_idx;
     int exop_timeout;
     int entry_type;
     enum request_types request_type;
-    struct resp_attrs *attrs;
-    struct sss_domain_info *obj_domain;
-    struct sysdb_attrs *override_attrs;
+    enum req_input_type list_type;
+
+    /* one item per list entry, the replies are kept until all requests
+     * are finished and then saved together */
+    struct ipa_s2n_list_item *items;
+    size_t num_items;
+    size_t next_idx;
+    size_t num_done;
+    size_t outstanding;
+    size_t max_outstanding;
 };
 
-static errno_t ipa_s2n_get_list_step(struct tevent_req *req);
+static errno_t ipa_s2n_get_list_fill(struct tevent_req *req);
+static errno_t ipa_s2n_get_list_step(struct tevent_req *req,
+                                     struct ipa_s2n_list_item *item,
+                                     const char *list_entry);
 static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq);
 static void ipa_s2n_get_list_next(struct tevent_req *subreq);
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req);
+static errno_t ipa_s2n_get_list_item_done(struct tevent_req *req);
+static errno_t ipa_s2n_get_list_save(struct tevent_req *req);
 
 static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
                                                 struct tevent_context *ev,
@@ -923,6 +940,8 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
     int ret;
     struct ipa_s2n_get_list_state *state;
     struct tevent_req *req;
+    int max_outstanding;
+    size_t c;
 
     req = tevent_req_create(mem_ctx, &state, struct ipa_s2n_get_list_state);
     if (req == NULL) {
@@ -942,31 +961,81 @@ static struct tevent_req *ipa_s2n_get_list_send(TALLOC_CTX *mem_ctx,
     state->dom = dom;
     state->sh = sh;
     state->list = list;
-    state->list_idx = 0;
-    state->req_input.type = list_type;
-    state->req_input.inp.name = NULL;
     state->exop_timeout = exop_timeout;
     state->entry_type = entry_type;
     state->request_type = request_type;
-    state->attrs = NULL;
-    state->override_attrs = NULL;
+    state->list_type = list_type;
+
+    for (c = 0; list[c] != NULL; c++);
+    if (c == 0) {
+        ret = EOK;
+        goto done;
+    }
+
+    state->num_items = c;
+    state->items = talloc_zero_array(state, struct ipa_s2n_list_item, c);
+    if (state->items == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
 
-    ret = ipa_s2n_get_list_step(req);
+    max_outstanding = dp_opt_get_int(ipa_ctx->ipa_options->basic,
+                                     IPA_EXTDOM_MAX_OUTSTANDING);
+    state->max_outstanding = max_outstanding > 1 ? max_outstanding : 1;
+
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Resolving %zu objects with up to %zu parallel requests.\n",
+          state->num_items, state->max_outstanding);
+
+    ret = ipa_s2n_get_list_fill(req);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
+        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_fill failed.\n");
         goto done;
     }
 
+    return req;
+
 done:
     if (ret != EOK) {
         tevent_req_error(req, ret);
-        tevent_req_post(req, ev);
+    } else {
+        tevent_req_done(req);
     }
+    tevent_req_post(req, ev);
 
     return req;
 }
 
-static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
+/* Send requests for the following list entries until the window of
+ * outstanding requests is full. */
+static errno_t ipa_s2n_get_list_fill(struct tevent_req *req)
+{
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_list_item *item;
+    errno_t ret;
+
+    while (state->outstanding < state->max_outstanding
+            && state->next_idx < state->num_items) {
+        item = &state->items[state->next_idx];
+        item->req = req;
+
+        ret = ipa_s2n_get_list_step(req, item, state->list[state->next_idx]);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
+            return ret;
+        }
+
+        state->next_idx++;
+        state->outstanding++;
+    }
+
+    return EOK;
+}
+
+static errno_t ipa_s2n_get_list_step(struct tevent_req *req,
+                                     struct ipa_s2n_list_item *item,
+                                     const char *list_entry)
 {
     int ret;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
@@ -980,67 +1049,66 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
     char *endptr;
     bool need_v1 = false;
 
+    item->req_input.type = state->list_type;
+
     parent_domain = get_domains_head(state->dom);
-    switch (state->req_input.type) {
+    switch (item->req_input.type) {
     case REQ_INP_NAME:
 
-        ret = sss_parse_name(state, parent_domain->names,
-                             state->list[state->list_idx],
+        ret = sss_parse_name(state->items, parent_domain->names, list_entry,
                              &domain_name, &short_name);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Unable to parse name '%s' [%d]: %s\n",
-                                        state->list[state->list_idx],
-                                        ret, sss_strerror(ret));
+                                        list_entry, ret, sss_strerror(ret));
             return ret;
         }
 
         if (domain_name) {
-            state->obj_domain = find_domain_by_name(parent_domain,
-                                                    domain_name, true);
-            if (state->obj_domain == NULL) {
+            item->obj_domain = find_domain_by_name(parent_domain,
+                                                   domain_name, true);
+            if (item->obj_domain == NULL) {
                 DEBUG(SSSDBG_OP_FAILURE, "find_domain_by_name failed.\n");
                 return ENOMEM;
             }
         } else {
-            state->obj_domain = parent_domain;
+            item->obj_domain = parent_domain;
         }
 
-        state->req_input.inp.name = short_name;
+        item->req_input.inp.name = short_name;
 
         break;
     case REQ_INP_ID:
         errno = 0;
-        id = strtouint32(state->list[state->list_idx], &endptr, 10);
-        if (errno != 0 || *endptr != '\0'
-                || (state->list[state->list_idx] == endptr)) {
+        id = strtouint32(list_entry, &endptr, 10);
+        if (errno != 0 || *endptr != '\0' || (list_entry == endptr)) {
             DEBUG(SSSDBG_OP_FAILURE, "strtouint32 failed.\n");
             return EINVAL;
         }
-        state->req_input.inp.id = id;
-        state->obj_domain = state->dom;
+        item->req_input.inp.id = id;
+        item->obj_domain = state->dom;
 
         break;
     case REQ_INP_SECID:
-        state->req_input.inp.secid = state->list[state->list_idx];
-        state->obj_domain = find_domain_by_sid(parent_domain,
-                                               state->req_input.inp.secid);
-        if (state->obj_domain == NULL) {
+        item->req_input.inp.secid = list_entry;
+        item->obj_domain = find_domain_by_sid(parent_domain,
+                                              item->req_input.inp.secid);
+        if (item->obj_domain == NULL) {
             DEBUG(SSSDBG_OP_FAILURE,
                   "find_domain_by_sid failed for SID [%s].\n",
-                  state->req_input.inp.secid);
+                  item->req_input.inp.secid);
             return EINVAL;
         }
 
         break;
     default:
         DEBUG(SSSDBG_OP_FAILURE, "Unexpected inoput type [%d].\n",
-                                 state->req_input.type);
+                                 item->req_input.type);
         return EINVAL;
     }
 
-    ret = s2n_encode_request(state, state->obj_domain->name, state->entry_type,
-                             state->request_type,
-                             &state->req_input, &bv_req);
+    ret = s2n_encode_request(state->items, item->obj_domain->name,
+                             state->entry_type, state->request_type,
+                             &item->req_input, &bv_req);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_encode_request failed.\n");
         return ret;
@@ -1056,7 +1124,7 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
         DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_exop_send failed.\n");
         return ENOMEM;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_next, item);
 
     return EOK;
 }
@@ -1064,8 +1132,9 @@ static errno_t ipa_s2n_get_list_step(struct tevent_req *req)
 static void ipa_s2n_get_list_next(struct tevent_req *subreq)
 {
     int ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
+    struct ipa_s2n_list_item *item = tevent_req_callback_data(subreq,
+                                                     struct ipa_s2n_list_item);
+    struct tevent_req *req = item->req;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
     char *retoid = NULL;
@@ -1080,33 +1149,34 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
         goto fail;
     }
 
-    talloc_zfree(state->attrs);
-    ret = s2n_response_to_attrs(state, retoid, retdata, &state->attrs);
+    ret = s2n_response_to_attrs(state->items, retoid, retdata, &item->attrs);
+    talloc_free(retoid);
+    talloc_free(retdata);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "s2n_response_to_attrs failed.\n");
         goto fail;
     }
 
     if (is_default_view(state->ipa_ctx->view_name)) {
-        ret = ipa_s2n_get_list_save_step(req);
+        ret = ipa_s2n_get_list_item_done(req);
         if (ret == EOK) {
             tevent_req_done(req);
         } else if (ret != EAGAIN) {
-            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_item_done failed.\n");
             goto fail;
         }
 
         return;
     }
 
-    ret = sysdb_attrs_get_string(state->attrs->sysdb_attrs, SYSDB_SID_STR,
+    ret = sysdb_attrs_get_string(item->attrs->sysdb_attrs, SYSDB_SID_STR,
                                  &sid_str);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "sysdb_attrs_get_string failed.\n");
         goto fail;
     }
 
-    ret = get_be_acct_req_for_sid(state, sid_str, state->obj_domain->name, &ar);
+    ret = get_be_acct_req_for_sid(state, sid_str, item->obj_domain->name, &ar);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "get_be_acct_req_for_sid failed.\n");
         goto fail;
@@ -1124,7 +1194,7 @@ static void ipa_s2n_get_list_next(struct tevent_req *subreq)
         ret = ENOMEM;
         goto fail;
     }
-    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, req);
+    tevent_req_set_callback(subreq, ipa_s2n_get_list_get_override_done, item);
 
     return;
 
@@ -1136,23 +1206,25 @@ fail:
 static void ipa_s2n_get_list_get_override_done(struct tevent_req *subreq)
 {
     int ret;
-    struct tevent_req *req = tevent_req_callback_data(subreq,
-                                                      struct tevent_req);
+    struct ipa_s2n_list_item *item = tevent_req_callback_data(subreq,
+                                                     struct ipa_s2n_list_item);
+    struct tevent_req *req = item->req;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
 
-    ret = ipa_get_ad_override_recv(subreq, NULL, state, &state->override_attrs);
+    ret = ipa_get_ad_override_recv(subreq, NULL, state->items,
+                                   &item->override_attrs);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE, "IPA override lookup failed: %d\n", ret);
         goto fail;
     }
 
-    ret = ipa_s2n_get_list_save_step(req);
+    ret = ipa_s2n_get_list_item_done(req);
     if (ret == EOK) {
         tevent_req_done(req);
     } else if (ret != EAGAIN) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_save_step failed.\n");
+        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_item_done failed.\n");
         goto fail;
     }
 
@@ -1163,32 +1235,75 @@ fail:
     return;
 }
 
-static errno_t ipa_s2n_get_list_save_step(struct tevent_req *req)
+/* Returns EAGAIN as long as there are requests which did not finish yet
+ * and EOK once all objects are saved. */
+static errno_t ipa_s2n_get_list_item_done(struct tevent_req *req)
 {
     int ret;
     struct ipa_s2n_get_list_state *state = tevent_req_data(req,
                                                struct ipa_s2n_get_list_state);
 
-    ret = ipa_s2n_save_objects(state->dom, &state->req_input, state->attrs,
-                               NULL, state->ipa_ctx->view_name,
-                               state->override_attrs, false);
+    state->outstanding--;
+    state->num_done++;
+
+    if (state->num_done == state->num_items) {
+        return ipa_s2n_get_list_save(req);
+    }
+
+    ret = ipa_s2n_get_list_fill(req);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_save_objects failed.\n");
+        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_fill failed.\n");
         return ret;
     }
 
-    state->list_idx++;
-    if (state->list[state->list_idx] == NULL) {
-        return EOK;
+    return EAGAIN;
+}
+
+static errno_t ipa_s2n_get_list_save(struct tevent_req *req)
+{
+    int ret;
+    int tret;
+    struct ipa_s2n_get_list_state *state = tevent_req_data(req,
+                                               struct ipa_s2n_get_list_state);
+    struct ipa_s2n_list_item *item;
+    bool in_transaction = false;
+    size_t c;
+
+    ret = sysdb_transaction_start(state->dom->sysdb);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
+        goto done;
     }
+    in_transaction = true;
 
-    ret = ipa_s2n_get_list_step(req);
+    for (c = 0; c < state->num_items; c++) {
+        item = &state->items[c];
+
+        ret = ipa_s2n_save_objects(state->dom, &item->req_input, item->attrs,
+                                   NULL, state->ipa_ctx->view_name,
+                                   item->override_attrs, false);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_save_objects failed.\n");
+            goto done;
+        }
+    }
+
+    ret = sysdb_transaction_commit(state->dom->sysdb);
     if (ret != EOK) {
-        DEBUG(SSSDBG_OP_FAILURE, "ipa_s2n_get_list_step failed.\n");
-        return ret;
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+        goto done;
     }
+    in_transaction = false;
 
-    return EAGAIN;
+done:
+    if (in_transaction) {
+        tret = sysdb_transaction_cancel(state->dom->sysdb);
+        if (tret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to cancel transaction\n");
+        }
+    }
+
+    return ret;
 }
 
 static int ipa_s2n_get_list_recv(struct tevent_req *req)
@@ -102,6 +102,9 @@ struct ipa_selinux_op_ctx {
 
     struct sysdb_attrs *user;
     struct sysdb_attrs *host;
+
+    /* the login mapping selinux_child is setting */
+    struct selinux_child_input *sci;
 };
 
 void ipa_selinux_handler(struct be_req *be_req)
@@ -312,6 +315,113 @@ static errno_t selinux_child_recv(struct tevent_req *req);
 
 static void ipa_selinux_child_done(struct tevent_req *child_req);
 
+static char *ipa_selinux_mapping_str(TALLOC_CTX *mem_ctx,
+                                     struct selinux_child_input *sci)
+{
+    return talloc_asprintf(mem_ctx, "%s:%s:%s",
+                           sci->username, sci->seuser, sci->mls_range);
+}
+
+/* Every PAM session would otherwise fork selinux_child which opens a
+ * libsemanage transaction only to find out the login mapping is already
+ * in place. The last mapping set by the child is kept in the user entry
+ * and the child is skipped if the newly evaluated one is the same. */
+static bool ipa_selinux_mapping_unchanged(struct sss_domain_info *domain,
+                                          const char *user,
+                                          struct selinux_child_input *sci)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct ldb_message *msg;
+    const char *attrs[] = { SYSDB_SELINUX_LOGIN_MAPPING, NULL };
+    const char *applied;
+    char *mapping;
+    bool unchanged = false;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return false;
+    }
+
+    ret = sysdb_search_user_by_name(tmp_ctx, domain, user, attrs, &msg);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    applied = ldb_msg_find_attr_as_string(msg, SYSDB_SELINUX_LOGIN_MAPPING,
+                                          NULL);
+    if (applied == NULL) {
+        goto done;
+    }
+
+    mapping = ipa_selinux_mapping_str(tmp_ctx, sci);
+    if (mapping == NULL) {
+        goto done;
+    }
+
+    unchanged = (strcmp(applied, mapping) == 0);
+
+done:
+    talloc_free(tmp_ctx);
+    return unchanged;
+}
+
+static errno_t ipa_selinux_mapping_save(struct sss_domain_info *domain,
+                                        const char *user,
+                                        struct selinux_child_input *sci)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs *attrs;
+    char *mapping;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    mapping = ipa_selinux_mapping_str(tmp_ctx, sci);
+    if (mapping == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    attrs = sysdb_new_attrs(tmp_ctx);
+    if (attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SELINUX_LOGIN_MAPPING, mapping);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sysdb_set_user_attr(domain, user, attrs, SYSDB_MOD_REP);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static void ipa_selinux_finish(struct ipa_selinux_op_ctx *op_ctx)
+{
+    struct be_req *breq = op_ctx->be_req;
+    struct pam_data *pd;
+    struct be_ctx *be_ctx;
+
+    pd = talloc_get_type(be_req_get_data(breq), struct pam_data);
+    be_ctx = be_req_get_be_ctx(breq);
+
+    /* If we got here in online mode, set last_update to current time */
+    if (!be_is_offline(be_ctx)) {
+        op_ctx->selinux_ctx->last_update = time(NULL);
+    }
+
+    pd->pam_status = PAM_SUCCESS;
+    be_req_terminate(breq, DP_ERR_OK, EOK, "Success");
+}
+
 static void ipa_selinux_handler_done(struct tevent_req *req)
 {
     struct ipa_selinux_op_ctx *op_ctx = tevent_req_callback_data(req, struct ipa_selinux_op_ctx);
@@ -402,6 +512,14 @@ static void ipa_selinux_handler_done(struct tevent_req *req)
         goto fail;
     }
 
+    if (ipa_selinux_mapping_unchanged(op_ctx->user_domain, pd->user, sci)) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "SELinux login mapping of [%s] is unchanged, "
+              "not running selinux_child\n", sci->username);
+        ipa_selinux_finish(op_ctx);
+        return;
+    }
+
     /* Update the SELinux context in a privileged child as the back end is
      * running unprivileged
      */
@@ -411,6 +529,7 @@ static void ipa_selinux_handler_done(struct tevent_req *req)
         ret = ENOMEM;
         goto fail;
     }
+    op_ctx->sci = sci;
     tevent_req_set_callback(child_req, ipa_selinux_child_done, op_ctx);
     return;
 
@@ -434,12 +553,9 @@ static void ipa_selinux_child_done(struct tevent_req *child_req)
     struct ipa_selinux_op_ctx *op_ctx;
     struct be_req *breq;
     struct pam_data *pd;
-    struct be_ctx *be_ctx;
 
     op_ctx = tevent_req_callback_data(child_req, struct ipa_selinux_op_ctx);
     breq = op_ctx->be_req;
-    pd = talloc_get_type(be_req_get_data(breq), struct pam_data);
-    be_ctx = be_req_get_be_ctx(breq);
 
     ret = selinux_child_recv(child_req);
     talloc_free(child_req);
@@ -448,13 +564,17 @@ static void ipa_selinux_child_done(struct tevent_req *child_req)
         return;
     }
 
-    /* If we got here in online mode, set last_update to current time */
-    if (!be_is_offline(be_ctx)) {
-        op_ctx->selinux_ctx->last_update = time(NULL);
+    pd = talloc_get_type(be_req_get_data(breq), struct pam_data);
+
+    ret = ipa_selinux_mapping_save(op_ctx->user_domain, pd->user, op_ctx->sci);
+    if (ret != EOK) {
+        /* not fatal, the child will be run again next time */
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Cannot store the applied SELinux login mapping [%d]: %s\n",
+              ret, sss_strerror(ret));
     }
 
-    pd->pam_status = PAM_SUCCESS;
-    be_req_terminate(breq, DP_ERR_OK, EOK, "Success");
+    ipa_selinux_finish(op_ctx);
 }
 
 static errno_t
@@ -32,6 +32,7 @@
 #include "providers/krb5/krb5_auth.h"
 #include "util/util.h"
 #include "util/find_uid.h"
+#include "util/uid_tracker.h"
 
 #define INITIAL_USER_TABLE_SIZE 10
 
@@ -153,7 +154,7 @@ static errno_t authenticate_stored_users(
     struct auth_data *auth_data;
     struct tevent_timer *te;
 
-    ret = get_uid_table(deferred_auth_ctx, &uid_table);
+    ret = uid_tracker_get_uid_table(deferred_auth_ctx, &uid_table);
     if (ret != HASH_SUCCESS) {
         DEBUG(SSSDBG_CRIT_FAILURE, "get_uid_table failed.\n");
         return ret;
@@ -372,6 +373,11 @@ errno_t init_delayed_online_authentication(struct krb5_ctx *krb5_ctx,
         goto fail;
     }
 
+    ret = uid_tracker_start(be_ctx, ev);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Active users will be read from /proc\n");
+    }
+
     /* TODO: add destructor */
 
     return EOK;
@@ -57,8 +57,19 @@ struct users_get_state {
     int dp_error;
     int sdap_ret;
     bool noexist_delete;
+
+    struct be_req_trace *trace;
 };
 
+static void users_get_set_trace(struct tevent_req *req,
+                                struct be_req_trace *trace)
+{
+    struct users_get_state *state = tevent_req_data(req,
+                                                    struct users_get_state);
+
+    state->trace = trace;
+}
+
 static int users_get_retry(struct tevent_req *req);
 static void users_get_connect_done(struct tevent_req *subreq);
 static void users_get_posix_check_done(struct tevent_req *subreq);
@@ -327,6 +338,8 @@ static void users_get_connect_done(struct tevent_req *subreq)
         return;
     }
 
+    be_req_trace_mark(state->trace, BE_TRACE_CONNECTED);
+
     /* If POSIX attributes have been requested with an AD server and we
      * have no idea about POSIX attributes support, run a one-time check
      */
@@ -433,6 +446,9 @@ static void users_get_done(struct tevent_req *subreq)
 
     ret = sdap_get_users_recv(subreq, NULL, NULL);
     talloc_zfree(subreq);
+    if (ret == EOK) {
+        be_req_trace_mark(state->trace, BE_TRACE_LOOKED_UP);
+    }
 
     ret = sdap_id_op_done(state->op, ret, &dp_error);
     if (dp_error == DP_ERR_OK && ret != EOK) {
@@ -590,8 +606,19 @@ struct groups_get_state {
     int sdap_ret;
     bool noexist_delete;
     bool no_members;
+
+    struct be_req_trace *trace;
 };
 
+static void groups_get_set_trace(struct tevent_req *req,
+                                 struct be_req_trace *trace)
+{
+    struct groups_get_state *state = tevent_req_data(req,
+                                                     struct groups_get_state);
+
+    state->trace = trace;
+}
+
 static int groups_get_retry(struct tevent_req *req);
 static void groups_get_connect_done(struct tevent_req *subreq);
 static void groups_get_posix_check_done(struct tevent_req *subreq);
@@ -842,6 +869,8 @@ static void groups_get_connect_done(struct tevent_req *subreq)
         return;
     }
 
+    be_req_trace_mark(state->trace, BE_TRACE_CONNECTED);
+
     /* If POSIX attributes have been requested with an AD server and we
      * have no idea about POSIX attributes support, run a one-time check
      */
@@ -947,6 +976,9 @@ static void groups_get_done(struct tevent_req *subreq)
 
     ret = sdap_get_groups_recv(subreq, NULL, NULL);
     talloc_zfree(subreq);
+    if (ret == EOK) {
+        be_req_trace_mark(state->trace, BE_TRACE_LOOKED_UP);
+    }
     ret = sdap_id_op_done(state->op, ret, &dp_error);
 
     if (dp_error == DP_ERR_OK && ret != EOK) {
@@ -1518,6 +1550,9 @@ sdap_handle_acct_req_send(TALLOC_CTX *mem_ctx,
                                 ar->extra_value,
                                 ar->attr_type,
                                 noexist_delete);
+        if (subreq != NULL) {
+            users_get_set_trace(subreq, ar->trace);
+        }
         break;
 
     case BE_REQ_GROUP: /* group */
@@ -1526,7 +1561,11 @@ sdap_handle_acct_req_send(TALLOC_CTX *mem_ctx,
                                  ar->filter_value,
                                  ar->filter_type,
                                  ar->attr_type,
-                                 noexist_delete, false);
+                                 noexist_delete,
+                                 (ar->entry_type & BE_REQ_NO_MEMBERS) != 0);
+        if (subreq != NULL) {
+            groups_get_set_trace(subreq, ar->trace);
+        }
         break;
 
     case BE_REQ_INITGROUPS: /* init groups for user */
@@ -1634,6 +1673,9 @@ sdap_handle_acct_req_send(TALLOC_CTX *mem_ctx,
                                 ar->extra_value,
                                 ar->attr_type,
                                 noexist_delete);
+        if (subreq != NULL) {
+            users_get_set_trace(subreq, ar->trace);
+        }
         break;
 
     default: /*fail*/
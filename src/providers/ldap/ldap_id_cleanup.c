@@ -28,6 +28,7 @@
 
 #include "util/util.h"
 #include "util/find_uid.h"
+#include "util/uid_tracker.h"
 #include "db/sysdb.h"
 #include "providers/ldap/ldap_common.h"
 #include "providers/ldap/sdap_async.h"
@@ -97,6 +98,13 @@ errno_t ldap_setup_cleanup(struct sdap_id_ctx *id_ctx,
     }
 
     talloc_steal(sdom->cleanup_task, cleanup_ctx);
+
+    /* users who are logged in are not removed by the cleanup */
+    ret = uid_tracker_start(id_ctx->be, id_ctx->be->ev);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_TRACE_FUNC, "Active users will be read from /proc\n");
+    }
+
     ret = EOK;
 
 done:
@@ -233,7 +241,7 @@ static int cleanup_users(struct sdap_options *opts,
         goto done;
     }
 
-    ret = get_uid_table(tmpctx, &uid_table);
+    ret = uid_tracker_get_uid_table(tmpctx, &uid_table);
     /* get_uid_table returns ENOSYS on non-Linux platforms. We proceed with
      * the cleanup in that case
      */
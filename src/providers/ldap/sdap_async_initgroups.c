@@ -2186,6 +2186,23 @@ error:
     return ret;
 }
 
+/* The parent groups are expanded breadth-first: all groups of one nesting
+ * level are searched before the next level is started and every group is
+ * searched only once per request, the group_hash is the set of groups that
+ * were already visited. The searches of one level do not depend on each
+ * other, up to RFC2307BIS_NESTED_MAX_OUTSTANDING of them are sent to the
+ * server without waiting for the replies.
+ *
+ * If the server supports the matched values control (RFC 3876), the parents
+ * of up to RFC2307BIS_NESTED_BATCH_SIZE groups are searched with one OR
+ * filter. The control limits the member attribute of the returned parents to
+ * the members that were searched for, so every parent can be mapped back to
+ * its children without downloading the whole member list. Without the
+ * control every group is searched separately and the member attribute is
+ * not requested at all. */
+#define RFC2307BIS_NESTED_MAX_OUTSTANDING 8
+#define RFC2307BIS_NESTED_BATCH_SIZE 32
+
 struct sdap_rfc2307bis_nested_ctx {
     struct tevent_context *ev;
     struct sdap_options *opts;
@@ -2193,28 +2210,53 @@ struct sdap_rfc2307bis_nested_ctx {
     struct sss_domain_info *dom;
     struct sdap_handle *sh;
     int timeout;
-    const char *base_filter;
-    char *filter;
-    const char *orig_dn;
     const char **attrs;
-    struct sysdb_attrs **groups;
-    size_t num_groups;
+    char *oc_list;
 
-    size_t nesting_level;
+    /* the matched values control is used */
+    bool batch;
+    size_t batch_size;
 
-    size_t group_iter;
-    struct sdap_nested_group **processed_groups;
+    size_t nesting_level;
+    size_t max_nesting_level;
 
     hash_table_t *group_hash;
-    const char *primary_name;
-
-    struct sysdb_handle *handle;
 
-    size_t base_iter;
     struct sdap_search_base **search_bases;
+    size_t num_bases;
+
+    /* the groups of the current nesting level, a search is sent for each
+     * combination of a batch of groups and a search base */
+    TALLOC_CTX *level_ctx;
+    struct sdap_nested_group **level_groups;
+    size_t num_level_groups;
+    size_t num_batches;
+    size_t next_search;
+    size_t outstanding;
+
+    /* the groups of the current nesting level by their case-folded DN,
+     * only used with batches */
+    hash_table_t *level_dns;
+
+    /* the parents found in the current level, they form the next one */
+    struct sysdb_attrs **next_groups;
+    size_t num_next_groups;
+};
+
+struct sdap_rfc2307bis_nested_search {
+    struct tevent_req *req;
+    /* the groups of the batch in level_groups */
+    size_t first;
+    size_t count;
+    LDAPControl **ctrls;
 };
 
-static errno_t rfc2307bis_nested_groups_step(struct tevent_req *req);
+static errno_t rfc2307bis_nested_groups_level(struct tevent_req *req,
+                                              struct sysdb_attrs **groups,
+                                              size_t num_groups);
+static errno_t rfc2307bis_nested_groups_fill(struct tevent_req *req);
+static void rfc2307bis_nested_groups_process(struct tevent_req *subreq);
+
 struct tevent_req *rfc2307bis_nested_groups_send(
         TALLOC_CTX *mem_ctx, struct tevent_context *ev,
         struct sdap_options *opts, struct sysdb_ctx *sysdb,
@@ -2226,38 +2268,25 @@ struct tevent_req *rfc2307bis_nested_groups_send(
     errno_t ret;
     struct tevent_req *req;
     struct sdap_rfc2307bis_nested_ctx *state;
-
-    DEBUG(SSSDBG_TRACE_INTERNAL,
-          "About to process %zu groups in nesting level %zu\n",
-           num_groups, nesting);
+    const char *attr_filter[2];
 
     req = tevent_req_create(mem_ctx, &state,
                             struct sdap_rfc2307bis_nested_ctx);
     if (!req) return NULL;
 
-    if ((num_groups == 0) ||
-        (nesting > dp_opt_get_int(opts->basic, SDAP_NESTING_LEVEL))) {
-        /* No parent groups to process or too deep*/
-        ret = EOK;
-        goto done;
-    }
-
     state->ev = ev;
     state->opts = opts;
     state->sysdb = sysdb;
     state->dom = dom;
     state->sh = sh;
-    state->groups = groups;
-    state->num_groups = num_groups;
-    state->group_iter = 0;
-    state->nesting_level = nesting;
     state->group_hash = group_hash;
-    state->filter = NULL;
+    state->nesting_level = nesting;
+    state->max_nesting_level = dp_opt_get_int(opts->basic,
+                                              SDAP_NESTING_LEVEL);
     state->timeout = dp_opt_get_int(state->opts->basic,
                                     SDAP_SEARCH_TIMEOUT);
-    state->base_iter = 0;
     state->search_bases = search_bases;
-    if (!state->search_bases) {
+    if (!state->search_bases || !state->search_bases[0]) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Initgroups nested lookup request "
                "without a group search base\n");
@@ -2265,32 +2294,44 @@ struct tevent_req *rfc2307bis_nested_groups_send(
         goto done;
     }
 
-    state->processed_groups = talloc_array(state,
-                                           struct sdap_nested_group *,
-                                           state->num_groups);
-    if (state->processed_groups == NULL) {
-        ret = ENOMEM;
+    for (state->num_bases = 0;
+         state->search_bases[state->num_bases] != NULL;
+         state->num_bases++);
+
+    state->batch = sdap_is_control_supported(sh,
+                                             LDAP_CONTROL_VALUESRETURNFILTER);
+    if (state->batch) {
+        state->batch_size = RFC2307BIS_NESTED_BATCH_SIZE;
+
+        /* only the matching member values are returned */
+        ret = build_attrs_from_map(state, state->opts->group_map,
+                                   SDAP_OPTS_GROUP, NULL, &state->attrs, NULL);
+    } else {
+        state->batch_size = 1;
+
+        attr_filter[0] = state->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+        attr_filter[1] = NULL;
+
+        ret = build_attrs_from_map(state, state->opts->group_map,
+                                   SDAP_OPTS_GROUP, attr_filter,
+                                   &state->attrs, NULL);
+    }
+    if (ret != EOK) {
         goto done;
     }
 
-    while (state->group_iter < state->num_groups) {
-        ret = rfc2307bis_nested_groups_step(req);
-        if (ret == EOK) {
-            /* This group had already been looked up. Continue to
-             * another group in the same level
-             */
-            state->group_iter++;
-            continue;
-        } else {
-            goto done;
-        }
+    state->oc_list = sdap_make_oc_list(state, state->opts->group_map);
+    if (state->oc_list == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to create objectClass list.\n");
+        ret = ENOMEM;
+        goto done;
     }
 
-    ret = EOK;
+    ret = rfc2307bis_nested_groups_level(req, groups, num_groups);
 
 done:
     if (ret == EOK) {
-        /* All parent groups were already processed */
+        /* No parent groups to process or too deep */
         tevent_req_done(req);
         tevent_req_post(req, ev);
     } else if (ret != EAGAIN) {
@@ -2302,308 +2343,524 @@ done:
     return req;
 }
 
-static errno_t rfc2307bis_nested_groups_next_base(struct tevent_req *req);
-static void rfc2307bis_nested_groups_process(struct tevent_req *subreq);
-static errno_t rfc2307bis_nested_groups_step(struct tevent_req *req)
+/* Returns the case-folded form of the DN, so that the DN of a group and a
+ * member value referring to it can be compared. */
+static const char *rfc2307bis_nested_casefold_dn(TALLOC_CTX *mem_ctx,
+                                                 struct sysdb_ctx *sysdb,
+                                                 const char *dn_str)
+{
+    struct ldb_dn *dn;
+
+    dn = ldb_dn_new(mem_ctx, sysdb_ctx_get_ldb(sysdb), dn_str);
+    if (dn == NULL || !ldb_dn_validate(dn)) {
+        return NULL;
+    }
+
+    return ldb_dn_get_casefold(dn);
+}
+
+/* Start the searches for the parents of the given groups. Returns EAGAIN if
+ * searches were sent and EOK if there is nothing to search for. */
+static errno_t rfc2307bis_nested_groups_level(struct tevent_req *req,
+                                              struct sysdb_attrs **groups,
+                                              size_t num_groups)
 {
-    errno_t ret;
-    TALLOC_CTX *tmp_ctx = NULL;
-    const char **attr_filter;
-    char *clean_orig_dn;
-    hash_key_t key;
-    hash_value_t value;
     struct sdap_rfc2307bis_nested_ctx *state =
             tevent_req_data(req, struct sdap_rfc2307bis_nested_ctx);
-    char *oc_list;
+    struct sdap_nested_group *ngr;
+    TALLOC_CTX *level_ctx;
+    hash_table_t *level_dns = NULL;
+    const char *primary_name;
+    const char *orig_dn;
+    hash_key_t key;
+    hash_value_t value;
+    size_t i;
+    int hret;
+    errno_t ret;
 
-    tmp_ctx = talloc_new(state);
-    if (!tmp_ctx) {
-        ret = ENOMEM;
-        goto done;
+    if (num_groups == 0 || state->nesting_level > state->max_nesting_level) {
+        return EOK;
     }
 
-    ret = sdap_get_group_primary_name(state, state->opts,
-                                      state->groups[state->group_iter],
-                                      state->dom, &state->primary_name);
-    if (ret != EOK) {
-        goto done;
+    DEBUG(SSSDBG_TRACE_INTERNAL,
+          "About to process %zu groups in nesting level %zu\n",
+           num_groups, state->nesting_level);
+
+    /* groups is allocated on the context of the previous level */
+    level_ctx = talloc_new(state);
+    if (level_ctx == NULL) {
+        return ENOMEM;
     }
 
-    key.type = HASH_KEY_STRING;
-    key.str = talloc_strdup(state, state->primary_name);
-    if (!key.str) {
+    state->level_groups = talloc_array(level_ctx, struct sdap_nested_group *,
+                                       num_groups);
+    if (state->level_groups == NULL) {
         ret = ENOMEM;
         goto done;
     }
+    state->num_level_groups = 0;
 
-    DEBUG(SSSDBG_TRACE_LIBS, "Processing group [%s]\n", state->primary_name);
-
-    ret = hash_lookup(state->group_hash, &key, &value);
-    if (ret == HASH_SUCCESS) {
-        DEBUG(SSSDBG_TRACE_INTERNAL, "Group [%s] was already processed, "
-              "taking a shortcut\n", state->primary_name);
-        state->processed_groups[state->group_iter] =
-            talloc_get_type(value.ptr, struct sdap_nested_group);
-        talloc_free(key.str);
-        ret = EOK;
-        goto done;
+    if (state->batch) {
+        ret = sss_hash_create(level_ctx, num_groups, &level_dns);
+        if (ret != EOK) {
+            goto done;
+        }
     }
 
-    /* Need to try to find parent groups for this group. */
-    state->processed_groups[state->group_iter] =
-            talloc_zero(state->processed_groups, struct sdap_nested_group);
-    if (!state->processed_groups[state->group_iter]) {
-        ret = ENOMEM;
-        goto done;
-    }
+    for (i = 0; i < num_groups; i++) {
+        ret = sdap_get_group_primary_name(level_ctx, state->opts, groups[i],
+                                          state->dom, &primary_name);
+        if (ret != EOK) {
+            goto done;
+        }
 
-    /* this steal doesn't change much now, but will be helpful later on
-     * if we steal the whole processed_group on the hash table */
-    state->processed_groups[state->group_iter]->group =
-        talloc_steal(state->processed_groups[state->group_iter],
-                     state->groups[state->group_iter]);
+        key.type = HASH_KEY_STRING;
+        key.str = discard_const(primary_name);
 
-    /* Get any parent groups for this group */
-    ret = sysdb_attrs_get_string(state->groups[state->group_iter],
-                                 SYSDB_ORIG_DN,
-                                 &state->orig_dn);
-    if (ret != EOK) {
-        goto done;
-    }
+        hret = hash_lookup(state->group_hash, &key, &value);
+        if (hret == HASH_SUCCESS) {
+            DEBUG(SSSDBG_TRACE_INTERNAL, "Group [%s] was already processed, "
+                  "taking a shortcut\n", primary_name);
+            continue;
+        }
 
-    attr_filter = talloc_array(state, const char *, 2);
-    if (!attr_filter) {
-        ret = ENOMEM;
-        goto done;
-    }
+        DEBUG(SSSDBG_TRACE_LIBS, "Processing group [%s]\n", primary_name);
 
-    attr_filter[0] = state->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
-    attr_filter[1] = NULL;
+        /* The nested group entry lives on the group_hash context so it can
+         * outlive this request */
+        ngr = talloc_zero(state->group_hash, struct sdap_nested_group);
+        if (ngr == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        ngr->group = talloc_steal(ngr, groups[i]);
 
-    ret = build_attrs_from_map(state, state->opts->group_map, SDAP_OPTS_GROUP,
-                               attr_filter, &state->attrs, NULL);
-    if (ret != EOK) {
-        goto done;
-    }
+        value.type = HASH_VALUE_PTR;
+        value.ptr = ngr;
 
-    ret = sss_filter_sanitize(tmp_ctx, state->orig_dn, &clean_orig_dn);
-    if (ret != EOK) {
-        goto done;
+        hret = hash_enter(state->group_hash, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            talloc_free(ngr);
+            ret = EIO;
+            goto done;
+        }
+
+        if (level_dns != NULL) {
+            ret = sysdb_attrs_get_string(ngr->group, SYSDB_ORIG_DN, &orig_dn);
+            if (ret != EOK) {
+                goto done;
+            }
+
+            key.str = discard_const(rfc2307bis_nested_casefold_dn(level_ctx,
+                                                                  state->sysdb,
+                                                                  orig_dn));
+            if (key.str == NULL) {
+                DEBUG(SSSDBG_OP_FAILURE, "Invalid DN [%s]\n", orig_dn);
+                ret = EINVAL;
+                goto done;
+            }
+
+            hret = hash_enter(level_dns, &key, &value);
+            if (hret != HASH_SUCCESS) {
+                ret = EIO;
+                goto done;
+            }
+        }
+
+        state->level_groups[state->num_level_groups] = ngr;
+        state->num_level_groups++;
     }
 
-    oc_list = sdap_make_oc_list(state, state->opts->group_map);
-    if (oc_list == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to create objectClass list.\n");
-        ret = ENOMEM;
+    talloc_free(state->level_ctx);
+    state->level_ctx = level_ctx;
+    state->level_dns = level_dns;
+    level_ctx = NULL;
+
+    state->next_groups = NULL;
+    state->num_next_groups = 0;
+    state->num_batches = (state->num_level_groups + state->batch_size - 1)
+                             / state->batch_size;
+    state->next_search = 0;
+    state->outstanding = 0;
+
+    if (state->num_level_groups == 0) {
+        ret = EOK;
         goto done;
     }
 
-    state->base_filter = talloc_asprintf(
-            state, "(&(%s=%s)(%s)(%s=*))",
-            state->opts->group_map[SDAP_AT_GROUP_MEMBER].name,
-            clean_orig_dn, oc_list,
-            state->opts->group_map[SDAP_AT_GROUP_NAME].name);
-    if (!state->base_filter) {
-        ret = ENOMEM;
+    ret = rfc2307bis_nested_groups_fill(req);
+    if (ret != EOK) {
         goto done;
     }
 
-    ret = rfc2307bis_nested_groups_next_base(req);
-    if (ret != EOK) goto done;
-
     /* Still processing parent groups */
     ret = EAGAIN;
 
 done:
-    talloc_free(tmp_ctx);
+    talloc_free(level_ctx);
     return ret;
 }
 
-static errno_t rfc2307bis_nested_groups_next_base(struct tevent_req *req)
+static int rfc2307bis_nested_ctrls_destructor(void *ptr)
 {
-    struct tevent_req *subreq;
-    struct sdap_rfc2307bis_nested_ctx *state;
+    LDAPControl **ctrls = talloc_get_type(ptr, LDAPControl *);
 
-    state = tevent_req_data(req, struct sdap_rfc2307bis_nested_ctx);
+    if (ctrls && ctrls[0]) {
+        ldap_control_free(ctrls[0]);
+    }
 
-    talloc_zfree(state->filter);
-    state->filter = sdap_combine_filters(state, state->base_filter,
-                        state->search_bases[state->base_iter]->filter);
-    if (!state->filter) {
+    return 0;
+}
+
+static errno_t rfc2307bis_nested_vrf_control(TALLOC_CTX *mem_ctx,
+                                             struct sdap_handle *sh,
+                                             const char *vr_filter,
+                                             LDAPControl ***_ctrls)
+{
+    LDAPControl **ctrls;
+    BerElement *ber;
+    struct berval *bv = NULL;
+    int ret;
+
+    ctrls = talloc_zero_array(mem_ctx, LDAPControl *, 2);
+    if (ctrls == NULL) {
         return ENOMEM;
     }
+    talloc_set_destructor((TALLOC_CTX *) ctrls,
+                          rfc2307bis_nested_ctrls_destructor);
 
-    DEBUG(SSSDBG_TRACE_FUNC,
-          "Searching for parent groups of group [%s] with base [%s]\n",
-           state->orig_dn,
-           state->search_bases[state->base_iter]->basedn);
+    ber = ber_alloc_t(LBER_USE_DER);
+    if (ber == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "ber_alloc_t failed.\n");
+        talloc_free(ctrls);
+        return ENOMEM;
+    }
 
-    subreq = sdap_get_generic_send(
-            state, state->ev, state->opts, state->sh,
-            state->search_bases[state->base_iter]->basedn,
-            state->search_bases[state->base_iter]->scope,
-            state->filter, state->attrs,
-            state->opts->group_map, SDAP_OPTS_GROUP,
-            state->timeout,
-            true);
-    if (!subreq) {
+    ret = ldap_put_vrFilter(ber, vr_filter);
+    if (ret == -1) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Invalid matched values filter [%s]\n", vr_filter);
+        ber_free(ber, 1);
+        talloc_free(ctrls);
+        return EINVAL;
+    }
+
+    ret = ber_flatten(ber, &bv);
+    ber_free(ber, 1);
+    if (ret == -1) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "ber_flatten failed.\n");
+        talloc_free(ctrls);
         return ENOMEM;
     }
-    tevent_req_set_callback(subreq,
-                            rfc2307bis_nested_groups_process,
-                            req);
 
+    /* Not critical, a server that ignores the control returns the whole
+     * member attribute which is mapped the same way */
+    ret = sdap_control_create(sh, LDAP_CONTROL_VALUESRETURNFILTER,
+                              0, bv, 1, &ctrls[0]);
+    ber_bvfree(bv);
+    if (ret != LDAP_SUCCESS) {
+        talloc_free(ctrls);
+        return EIO;
+    }
+
+    *_ctrls = ctrls;
     return EOK;
 }
 
-static void
-rfc2307bis_nested_groups_iterate(struct tevent_req *req,
-                                 struct sdap_rfc2307bis_nested_ctx *state)
+/* Send searches for the groups of the current level until the window of
+ * outstanding searches is full. */
+static errno_t rfc2307bis_nested_groups_fill(struct tevent_req *req)
 {
+    struct sdap_rfc2307bis_nested_ctx *state =
+            tevent_req_data(req, struct sdap_rfc2307bis_nested_ctx);
+    const char *member_attr =
+            state->opts->group_map[SDAP_AT_GROUP_MEMBER].name;
+    struct sdap_rfc2307bis_nested_search *search;
+    struct sdap_search_base *base;
+    struct tevent_req *subreq;
+    const char *orig_dn;
+    char *clean_orig_dn;
+    char *members;
+    char *vr_filter;
+    char *base_filter;
+    char *filter;
+    size_t i;
     errno_t ret;
 
-    state->group_iter++;
-    while (state->group_iter < state->num_groups) {
-        ret = rfc2307bis_nested_groups_step(req);
-        if (ret == EAGAIN) {
-            /* Looking up parent groups.. */
-            return;
-        } else if (ret != EOK) {
-            tevent_req_error(req, ret);
-            return;
+    while (state->outstanding < RFC2307BIS_NESTED_MAX_OUTSTANDING
+            && state->next_search < state->num_batches * state->num_bases) {
+        search = talloc_zero(state->level_ctx,
+                             struct sdap_rfc2307bis_nested_search);
+        if (search == NULL) {
+            return ENOMEM;
+        }
+        search->req = req;
+        search->first = (state->next_search / state->num_bases)
+                            * state->batch_size;
+        search->count = state->num_level_groups - search->first;
+        if (search->count > state->batch_size) {
+            search->count = state->batch_size;
+        }
+        base = state->search_bases[state->next_search % state->num_bases];
+
+        members = talloc_strdup(search, "");
+        if (members == NULL) {
+            return ENOMEM;
+        }
+
+        for (i = search->first; i < search->first + search->count; i++) {
+            ret = sysdb_attrs_get_string(state->level_groups[i]->group,
+                                         SYSDB_ORIG_DN, &orig_dn);
+            if (ret != EOK) {
+                return ret;
+            }
+
+            ret = sss_filter_sanitize(search, orig_dn, &clean_orig_dn);
+            if (ret != EOK) {
+                return ret;
+            }
+
+            members = talloc_asprintf_append_buffer(members, "(%s=%s)",
+                                                    member_attr,
+                                                    clean_orig_dn);
+            if (members == NULL) {
+                return ENOMEM;
+            }
+            talloc_free(clean_orig_dn);
+        }
+
+        if (state->batch) {
+            vr_filter = talloc_asprintf(search, "(%s)", members);
+            if (vr_filter == NULL) {
+                return ENOMEM;
+            }
+
+            ret = rfc2307bis_nested_vrf_control(search, state->sh, vr_filter,
+                                                &search->ctrls);
+            if (ret != EOK) {
+                return ret;
+            }
+        }
+
+        base_filter = talloc_asprintf(search, "(&(|%s)(%s)(%s=*))",
+                            members, state->oc_list,
+                            state->opts->group_map[SDAP_AT_GROUP_NAME].name);
+        if (base_filter == NULL) {
+            return ENOMEM;
+        }
+
+        filter = sdap_combine_filters(search, base_filter, base->filter);
+        if (filter == NULL) {
+            return ENOMEM;
         }
 
-        /* EOK means this group has already been processed
-         * in another nesting level */
-        state->group_iter++;
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Searching for parent groups of %zu groups with base [%s]\n",
+               search->count, base->basedn);
+
+        subreq = sdap_get_and_parse_generic_send(state, state->ev,
+                                                 state->opts, state->sh,
+                                                 base->basedn, base->scope,
+                                                 filter, state->attrs,
+                                                 state->opts->group_map,
+                                                 SDAP_OPTS_GROUP,
+                                                 0, search->ctrls, NULL, 0,
+                                                 state->timeout,
+                                                 true);
+        if (subreq == NULL) {
+            return ENOMEM;
+        }
+        tevent_req_set_callback(subreq, rfc2307bis_nested_groups_process,
+                                search);
+
+        state->next_search++;
+        state->outstanding++;
     }
 
-    if (state->group_iter == state->num_groups) {
-        /* All groups processed. Done. */
-        tevent_req_done(req);
+    return EOK;
+}
+
+/* Returns the groups of the batch the parent was returned for. */
+static errno_t
+rfc2307bis_nested_groups_children(TALLOC_CTX *mem_ctx,
+                                  struct sdap_rfc2307bis_nested_ctx *state,
+                                  struct sdap_rfc2307bis_nested_search *search,
+                                  struct sysdb_attrs *parent,
+                                  struct sdap_nested_group ***_children,
+                                  size_t *_num_children)
+{
+    struct sdap_nested_group **children;
+    struct sdap_nested_group *ngr;
+    struct ldb_message_element *el;
+    size_t num_children = 0;
+    hash_key_t key;
+    hash_value_t value;
+    size_t i;
+    size_t j;
+    int hret;
+    errno_t ret;
+
+    if (!state->batch) {
+        *_children = &state->level_groups[search->first];
+        *_num_children = 1;
+        return EOK;
+    }
+
+    ret = sysdb_attrs_get_el_ext(parent,
+                        state->opts->group_map[SDAP_AT_GROUP_MEMBER].sys_name,
+                        false, &el);
+    if (ret == ENOENT) {
+        *_children = NULL;
+        *_num_children = 0;
+        return EOK;
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    children = talloc_array(mem_ctx, struct sdap_nested_group *,
+                            el->num_values);
+    if (children == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        key.type = HASH_KEY_STRING;
+        key.str = discard_const(rfc2307bis_nested_casefold_dn(children,
+                                        state->sysdb,
+                                        (const char *) el->values[i].data));
+        if (key.str == NULL) {
+            continue;
+        }
+
+        hret = hash_lookup(state->level_dns, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            continue;
+        }
+
+        ngr = talloc_get_type(value.ptr, struct sdap_nested_group);
+        for (j = 0; j < num_children; j++) {
+            if (children[j] == ngr) {
+                break;
+            }
+        }
+        if (ngr != NULL && j == num_children) {
+            children[num_children] = ngr;
+            num_children++;
+        }
     }
+
+    /* Only some of the member values were returned, they must not be
+     * mistaken for the members of the group */
+    el->num_values = 0;
+
+    *_children = children;
+    *_num_children = num_children;
+    return EOK;
 }
 
-static void rfc2307bis_nested_groups_done(struct tevent_req *subreq);
 static void rfc2307bis_nested_groups_process(struct tevent_req *subreq)
 {
     errno_t ret;
-    struct tevent_req *req =
-            tevent_req_callback_data(subreq, struct tevent_req);
+    struct sdap_rfc2307bis_nested_search *search =
+            tevent_req_callback_data(subreq,
+                                     struct sdap_rfc2307bis_nested_search);
+    struct tevent_req *req = search->req;
     struct sdap_rfc2307bis_nested_ctx *state =
             tevent_req_data(req, struct sdap_rfc2307bis_nested_ctx);
+    struct sdap_nested_group **children;
+    struct sdap_nested_group *ngr;
+    size_t num_children;
     size_t count;
     size_t i;
+    size_t j;
     struct sysdb_attrs **ldap_groups;
-    struct sdap_nested_group *ngr;
-    hash_value_t value;
-    hash_key_t key;
-    int hret;
 
-    ret = sdap_get_generic_recv(subreq, state,
-                                &count,
-                                &ldap_groups);
+    ret = sdap_get_and_parse_generic_recv(subreq, state,
+                                          &count,
+                                          &ldap_groups);
     talloc_zfree(subreq);
     if (ret) {
         tevent_req_error(req, ret);
         return;
     }
+    state->outstanding--;
 
     DEBUG(SSSDBG_TRACE_LIBS,
-          "Found %zu parent groups of [%s]\n", count, state->orig_dn);
-    ngr = state->processed_groups[state->group_iter];
+          "Found %zu parent groups of %zu groups\n", count, search->count);
 
-    /* Add this batch of groups to the list */
     if (count > 0) {
-        ngr->ldap_parents =
-                talloc_realloc(ngr,
-                               ngr->ldap_parents,
-                               struct sysdb_attrs *,
-                               ngr->parents_count + count + 1);
-        if (!ngr->ldap_parents) {
+        state->next_groups = talloc_realloc(state->level_ctx,
+                                            state->next_groups,
+                                            struct sysdb_attrs *,
+                                            state->num_next_groups + count);
+        if (state->next_groups == NULL) {
             tevent_req_error(req, ENOMEM);
             return;
         }
-
-        /* Copy the new groups into the list.
-         * They're allocated on 'state' so we need to move them
-         * onto ldap_parents so that the data won't disappear when
-         * we finish this nesting level.
-         */
-        for (i = 0; i < count; i++) {
-            ngr->ldap_parents[ngr->parents_count + i] =
-                talloc_steal(ngr->ldap_parents, ldap_groups[i]);
-        }
-
-        ngr->parents_count += count;
-
-        ngr->ldap_parents[ngr->parents_count] = NULL;
-        DEBUG(SSSDBG_TRACE_INTERNAL,
-              "Total of %zu direct parents after this iteration\n",
-               ngr->parents_count);
     }
 
-    state->base_iter++;
-
-    /* Check for additional search bases, and iterate
-     * through again.
-     */
-    if (state->search_bases[state->base_iter] != NULL) {
-        ret = rfc2307bis_nested_groups_next_base(req);
+    for (i = 0; i < count; i++) {
+        ret = rfc2307bis_nested_groups_children(search, state, search,
+                                                ldap_groups[i], &children,
+                                                &num_children);
         if (ret != EOK) {
             tevent_req_error(req, ret);
+            return;
         }
-        return;
-    }
 
-    /* Reset the base iterator for future lookups */
-    state->base_iter = 0;
+        if (num_children == 0) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Parent group does not list any of the searched groups, "
+                  "skipping\n");
+            continue;
+        }
 
-    /* Save the group into the hash table */
-    key.type = HASH_KEY_STRING;
-    key.str = talloc_strdup(state, state->primary_name);
-    if (!key.str) {
-        tevent_req_error(req, ENOMEM);
-        return;
-    }
+        /* The parent is shared by all its children and is moved to its
+         * own nested group entry in the next level, keep it as long as
+         * the entries. */
+        talloc_steal(state->group_hash, ldap_groups[i]);
 
-    /* Steal the nested group entry on the group_hash context so it can
-     * outlive this request */
-    talloc_steal(state->group_hash, ngr);
+        for (j = 0; j < num_children; j++) {
+            ngr = children[j];
+            ngr->ldap_parents = talloc_realloc(ngr, ngr->ldap_parents,
+                                               struct sysdb_attrs *,
+                                               ngr->parents_count + 2);
+            if (ngr->ldap_parents == NULL) {
+                tevent_req_error(req, ENOMEM);
+                return;
+            }
 
-    value.type = HASH_VALUE_PTR;
-    value.ptr = ngr;
+            ngr->ldap_parents[ngr->parents_count] = ldap_groups[i];
+            ngr->parents_count++;
+            ngr->ldap_parents[ngr->parents_count] = NULL;
+        }
 
-    hret = hash_enter(state->group_hash, &key, &value);
-    if (hret != HASH_SUCCESS) {
-        talloc_free(key.str);
-        tevent_req_error(req, EIO);
-        return;
+        state->next_groups[state->num_next_groups] = ldap_groups[i];
+        state->num_next_groups++;
     }
-    talloc_free(key.str);
+    talloc_free(ldap_groups);
+    talloc_free(search);
 
-    if (ngr->parents_count == 0) {
-        /* No parent groups for this group in LDAP
-         * Move on to the next group
-         */
-        rfc2307bis_nested_groups_iterate(req, state);
+    ret = rfc2307bis_nested_groups_fill(req);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
         return;
     }
 
-    /* Otherwise, recurse into the groups */
-    subreq = rfc2307bis_nested_groups_send(
-            state, state->ev, state->opts, state->sysdb,
-            state->dom, state->sh,
-            state->search_bases,
-            ngr->ldap_parents,
-            ngr->parents_count,
-            state->group_hash,
-            state->nesting_level+1);
-    if (!subreq) {
-        tevent_req_error(req, EIO);
+    if (state->outstanding > 0) {
+        /* Other searches of this level are still running */
         return;
     }
-    tevent_req_set_callback(subreq, rfc2307bis_nested_groups_done, req);
+
+    /* All groups of this level processed, continue with their parents */
+    state->nesting_level++;
+    ret = rfc2307bis_nested_groups_level(req, state->next_groups,
+                                         state->num_next_groups);
+    if (ret == EOK) {
+        tevent_req_done(req);
+    } else if (ret != EAGAIN) {
+        tevent_req_error(req, ret);
+    }
 }
 
 static errno_t rfc2307bis_nested_groups_recv(struct tevent_req *req)
@@ -2612,26 +2869,6 @@ static errno_t rfc2307bis_nested_groups_recv(struct tevent_req *req)
     return EOK;
 }
 
-static void rfc2307bis_nested_groups_done(struct tevent_req *subreq)
-{
-    errno_t ret;
-    struct tevent_req *req =
-            tevent_req_callback_data(subreq, struct tevent_req);
-    struct sdap_rfc2307bis_nested_ctx *state =
-            tevent_req_data(req, struct sdap_rfc2307bis_nested_ctx);
-
-    ret = rfc2307bis_nested_groups_recv(subreq);
-    talloc_zfree(subreq);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_TRACE_FUNC, "rfc2307bis_nested failed [%d][%s]\n",
-                  ret, strerror(ret));
-        tevent_req_error(req, ret);
-        return;
-    }
-
-    rfc2307bis_nested_groups_iterate(req, state);
-}
-
 /* ==Initgr-call-(groups-a-user-is-member-of)============================= */
 
 struct sdap_get_initgr_state {
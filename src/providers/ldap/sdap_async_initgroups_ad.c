@@ -312,6 +312,7 @@ struct sdap_get_ad_tokengroups_state {
     const char *username;
 
     char **sids;
+    struct ldb_val *bin_sids;
     size_t num_sids;
 };
 
@@ -419,12 +420,14 @@ static void sdap_get_ad_tokengroups_done(struct tevent_req *subreq)
 
     state->num_sids = 0;
     state->sids = talloc_zero_array(state, char*, el->num_values);
-    if (state->sids == NULL) {
+    state->bin_sids = talloc_zero_array(state, struct ldb_val, el->num_values);
+    if (state->sids == NULL || state->bin_sids == NULL) {
         ret = ENOMEM;
         goto done;
     }
 
-    /* convert binary sid to string */
+    /* convert binary sid to string, the binary form is kept as well so that
+     * the SIDs can be mapped in one batch */
     for (i = 0; i < el->num_values; i++) {
         err = sss_idmap_bin_sid_to_sid(state->idmap_ctx, el->values[i].data,
                                        el->values[i].length, &sid_str);
@@ -435,13 +438,25 @@ static void sdap_get_ad_tokengroups_done(struct tevent_req *subreq)
             continue;
         }
 
-        state->sids[i] = talloc_move(state->sids, &sid_str);
+        state->bin_sids[state->num_sids].data = talloc_memdup(state->bin_sids,
+                                                         el->values[i].data,
+                                                         el->values[i].length);
+        if (state->bin_sids[state->num_sids].data == NULL) {
+            talloc_free(sid_str);
+            ret = ENOMEM;
+            goto done;
+        }
+        state->bin_sids[state->num_sids].length = el->values[i].length;
+
+        state->sids[state->num_sids] = talloc_move(state->sids, &sid_str);
         state->num_sids++;
     }
 
-    /* shrink array to final number of elements */
+    /* shrink arrays to final number of elements */
     state->sids = talloc_realloc(state, state->sids, char*, state->num_sids);
-    if (state->sids == NULL) {
+    state->bin_sids = talloc_realloc(state, state->bin_sids, struct ldb_val,
+                                     state->num_sids);
+    if (state->sids == NULL || state->bin_sids == NULL) {
         ret = ENOMEM;
         goto done;
     }
@@ -462,7 +477,8 @@ done:
 static errno_t sdap_get_ad_tokengroups_recv(TALLOC_CTX *mem_ctx,
                                             struct tevent_req *req,
                                             size_t *_num_sids,
-                                            char ***_sids)
+                                            char ***_sids,
+                                            struct ldb_val **_bin_sids)
 {
     struct sdap_get_ad_tokengroups_state *state = NULL;
     state = tevent_req_data(req, struct sdap_get_ad_tokengroups_state);
@@ -477,6 +493,10 @@ static errno_t sdap_get_ad_tokengroups_recv(TALLOC_CTX *mem_ctx,
         *_sids = talloc_steal(mem_ctx, state->sids);
     }
 
+    if (_bin_sids != NULL) {
+        *_bin_sids = talloc_steal(mem_ctx, state->bin_sids);
+    }
+
     return EOK;
 }
 
@@ -838,11 +858,13 @@ sdap_ad_tokengroups_initgr_mapping_connect_done(struct tevent_req *subreq)
     return;
 }
 
-errno_t sdap_ad_save_group_membership_with_idmapping(const char *username,
-                                               struct sss_domain_info *user_dom,
-                                               struct sdap_idmap_ctx *idmap_ctx,
-                                               size_t num_sids,
-                                               char **sids)
+static errno_t
+sdap_ad_save_group_membership_with_gids(const char *username,
+                                        struct sss_domain_info *user_dom,
+                                        size_t num_sids,
+                                        char **sids,
+                                        id_t *gids,
+                                        errno_t *gid_rets)
 {
     TALLOC_CTX *tmp_ctx = NULL;
     struct sss_domain_info *domain = NULL;
@@ -883,7 +905,8 @@ errno_t sdap_ad_save_group_membership_with_idmapping(const char *username,
         sid = sids[i];
         DEBUG(SSSDBG_TRACE_LIBS, "Processing membership SID [%s]\n", sid);
 
-        ret = sdap_idmap_sid_to_unix(idmap_ctx, sid, &gid);
+        ret = gid_rets[i];
+        gid = gids[i];
         if (ret == ENOTSUP) {
             DEBUG(SSSDBG_TRACE_FUNC, "Skipping built-in object.\n");
             continue;
@@ -970,18 +993,60 @@ done:
     return ret;
 }
 
+errno_t sdap_ad_save_group_membership_with_idmapping(const char *username,
+                                               struct sss_domain_info *user_dom,
+                                               struct sdap_idmap_ctx *idmap_ctx,
+                                               size_t num_sids,
+                                               char **sids)
+{
+    TALLOC_CTX *tmp_ctx = NULL;
+    id_t *gids;
+    errno_t *gid_rets;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_OP_FAILURE, "talloc_new failed.\n");
+        return ENOMEM;
+    }
+
+    gids = talloc_array(tmp_ctx, id_t, num_sids);
+    gid_rets = talloc_array(tmp_ctx, errno_t, num_sids);
+    if (gids == NULL || gid_rets == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_sids; i++) {
+        gid_rets[i] = sdap_idmap_sid_to_unix(idmap_ctx, sids[i], &gids[i]);
+    }
+
+    ret = sdap_ad_save_group_membership_with_gids(username, user_dom,
+                                                  num_sids, sids,
+                                                  gids, gid_rets);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 static void sdap_ad_tokengroups_initgr_mapping_done(struct tevent_req *subreq)
 {
     struct sdap_ad_tokengroups_initgr_mapping_state *state = NULL;
     struct tevent_req *req = NULL;
     char **sids = NULL;
+    struct ldb_val *bin_sids = NULL;
+    id_t *gids = NULL;
+    errno_t *gid_rets = NULL;
     size_t num_sids = 0;
     errno_t ret;
 
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct sdap_ad_tokengroups_initgr_mapping_state);
 
-    ret = sdap_get_ad_tokengroups_recv(state, subreq, &num_sids, &sids);
+    ret = sdap_get_ad_tokengroups_recv(state, subreq, &num_sids, &sids,
+                                       &bin_sids);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to acquire tokengroups [%d]: %s\n",
@@ -989,14 +1054,22 @@ static void sdap_ad_tokengroups_initgr_mapping_done(struct tevent_req *subreq)
         goto done;
     }
 
-    ret = sdap_ad_save_group_membership_with_idmapping(state->username,
-                                                       state->domain,
-                                                       state->idmap_ctx,
-                                                       num_sids,
-                                                       sids);
+    /* map all tokenGroups in one go from their binary form */
+    ret = sdap_idmap_bin_sids_to_unix(state, state->idmap_ctx, num_sids,
+                                      bin_sids, &gids, &gid_rets);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to map tokengroups [%d]: %s\n",
+                                  ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = sdap_ad_save_group_membership_with_gids(state->username,
+                                                  state->domain,
+                                                  num_sids, sids,
+                                                  gids, gid_rets);
     if (ret != EOK) {
         DEBUG(SSSDBG_OP_FAILURE,
-              "sdap_ad_save_group_membership_with_idmapping failed.\n");
+              "sdap_ad_save_group_membership_with_gids failed.\n");
         goto done;
     }
 
@@ -1296,7 +1369,8 @@ sdap_ad_tokengroups_initgr_posix_tg_done(struct tevent_req *subreq)
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct sdap_ad_tokengroups_initgr_posix_state);
 
-    ret = sdap_get_ad_tokengroups_recv(state, subreq, &num_sids, &sids);
+    ret = sdap_get_ad_tokengroups_recv(state, subreq, &num_sids, &sids,
+                                       NULL);
     talloc_zfree(subreq);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE, "Unable to acquire tokengroups [%d]: %s\n",
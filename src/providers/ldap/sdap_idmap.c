@@ -531,6 +531,89 @@ done:
     return ret;
 }
 
+errno_t
+sdap_idmap_bin_sids_to_unix(TALLOC_CTX *mem_ctx,
+                            struct sdap_idmap_ctx *idmap_ctx,
+                            size_t num_sids,
+                            struct ldb_val *bin_sids,
+                            id_t **_ids,
+                            errno_t **_rets)
+{
+    TALLOC_CTX *tmp_ctx;
+    enum idmap_error_code err;
+    enum idmap_error_code *errs;
+    uint8_t **sids;
+    size_t *lengths;
+    uint32_t *uids;
+    id_t *ids;
+    errno_t *rets;
+    char *sid_str;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    sids = talloc_array(tmp_ctx, uint8_t *, num_sids);
+    lengths = talloc_array(tmp_ctx, size_t, num_sids);
+    uids = talloc_array(tmp_ctx, uint32_t, num_sids);
+    errs = talloc_array(tmp_ctx, enum idmap_error_code, num_sids);
+    ids = talloc_array(tmp_ctx, id_t, num_sids);
+    rets = talloc_array(tmp_ctx, errno_t, num_sids);
+    if (sids == NULL || lengths == NULL || uids == NULL || errs == NULL
+            || ids == NULL || rets == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_sids; i++) {
+        sids[i] = bin_sids[i].data;
+        lengths[i] = bin_sids[i].length;
+    }
+
+    err = sss_idmap_bin_sids_to_unix(idmap_ctx->map, num_sids, sids, lengths,
+                                     uids, errs);
+    if (err != IDMAP_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Could not map SIDs: [%s]\n",
+              idmap_error_string(err));
+        ret = EIO;
+        goto done;
+    }
+
+    for (i = 0; i < num_sids; i++) {
+        if (errs[i] == IDMAP_SUCCESS) {
+            ids[i] = uids[i];
+            rets[i] = EOK;
+            continue;
+        }
+
+        /* Unknown domains must be added first, the string based call takes
+         * care of this and of reporting all other errors. */
+        err = sss_idmap_bin_sid_to_sid(idmap_ctx->map, bin_sids[i].data,
+                                       bin_sids[i].length, &sid_str);
+        if (err != IDMAP_SUCCESS) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Could not convert binary SID to string: [%s]\n",
+                  idmap_error_string(err));
+            rets[i] = EINVAL;
+            continue;
+        }
+
+        rets[i] = sdap_idmap_sid_to_unix(idmap_ctx, sid_str, &ids[i]);
+        sss_idmap_free_sid(idmap_ctx->map, sid_str);
+    }
+
+    *_ids = talloc_steal(mem_ctx, ids);
+    *_rets = talloc_steal(mem_ctx, rets);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 bool sdap_idmap_domain_has_algorithmic_mapping(struct sdap_idmap_ctx *ctx,
                                                const char *dom_name,
                                                const char *dom_sid)
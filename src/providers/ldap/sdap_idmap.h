@@ -56,6 +56,17 @@ sdap_idmap_sid_to_unix(struct sdap_idmap_ctx *idmap_ctx,
                        const char *sid_str,
                        id_t *id);
 
+/* Map a list of binary SIDs at once. The result of each mapping is returned
+ * in _rets, with the same meaning as the return value of
+ * sdap_idmap_sid_to_unix(). */
+errno_t
+sdap_idmap_bin_sids_to_unix(TALLOC_CTX *mem_ctx,
+                            struct sdap_idmap_ctx *idmap_ctx,
+                            size_t num_sids,
+                            struct ldb_val *bin_sids,
+                            id_t **_ids,
+                            errno_t **_rets);
+
 bool sdap_idmap_domain_has_algorithmic_mapping(struct sdap_idmap_ctx *ctx,
                                                const char *name,
                                                const char *dom_sid);
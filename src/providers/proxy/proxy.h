@@ -99,6 +99,7 @@ struct proxy_id_ctx {
     bool fast_alias;
     struct proxy_nss_ops ops;
     void *handle;
+    char *libname;
 };
 
 struct proxy_auth_ctx {
@@ -24,8 +24,12 @@
 
 #include "config.h"
 
+#include <signal.h>
+
 #include "util/sss_format.h"
 #include "util/strtonum.h"
+#include "util/atomic_io.h"
+#include "util/child_common.h"
 #include "providers/proxy/proxy.h"
 
 /* =Getpwnam-wrapper======================================================*/
@@ -362,152 +366,6 @@ done:
     return ret;
 }
 
-/* =Getpwent-wrapper======================================================*/
-
-static int enum_users(TALLOC_CTX *mem_ctx,
-                      struct proxy_id_ctx *ctx,
-                      struct sysdb_ctx *sysdb,
-                      struct sss_domain_info *dom)
-{
-    TALLOC_CTX *tmpctx;
-    bool in_transaction = false;
-    struct passwd *pwd;
-    enum nss_status status;
-    size_t buflen;
-    char *buffer;
-    char *newbuf;
-    int ret;
-    errno_t sret;
-    bool again;
-
-    DEBUG(SSSDBG_TRACE_LIBS, "Enumerating users\n");
-
-    tmpctx = talloc_new(mem_ctx);
-    if (!tmpctx) {
-        return ENOMEM;
-    }
-
-    pwd = talloc_zero(tmpctx, struct passwd);
-    if (!pwd) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    buflen = DEFAULT_BUFSIZE;
-    buffer = talloc_size(tmpctx, buflen);
-    if (!buffer) {
-        ret = ENOMEM;
-        goto done;
-    }
-
-    ret = sysdb_transaction_start(sysdb);
-    if (ret) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
-        goto done;
-    }
-    in_transaction = true;
-
-    status = ctx->ops.setpwent();
-    if (status != NSS_STATUS_SUCCESS) {
-        ret = EIO;
-        goto done;
-    }
-
-    do {
-        again = false;
-
-        /* always zero out the pwd structure */
-        memset(pwd, 0, sizeof(struct passwd));
-
-        /* get entry */
-        status = ctx->ops.getpwent_r(pwd, buffer, buflen, &ret);
-
-        switch (status) {
-            case NSS_STATUS_TRYAGAIN:
-                /* buffer too small ? */
-                if (buflen < MAX_BUF_SIZE) {
-                    buflen *= 2;
-                }
-                if (buflen > MAX_BUF_SIZE) {
-                    buflen = MAX_BUF_SIZE;
-                }
-                newbuf = talloc_realloc_size(tmpctx, buffer, buflen);
-                if (!newbuf) {
-                    ret = ENOMEM;
-                    goto done;
-                }
-                buffer = newbuf;
-                again = true;
-                break;
-
-            case NSS_STATUS_NOTFOUND:
-
-                /* we are done here */
-                DEBUG(SSSDBG_TRACE_LIBS, "Enumeration completed.\n");
-
-                ret = sysdb_transaction_commit(sysdb);
-                if (ret != EOK) {
-                    DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
-                    goto done;
-                }
-                in_transaction = false;
-                break;
-
-            case NSS_STATUS_SUCCESS:
-
-                DEBUG(SSSDBG_TRACE_LIBS,
-                      "User found (%s, %"SPRIuid", %"SPRIgid")\n",
-                       pwd->pw_name, pwd->pw_uid, pwd->pw_gid);
-
-                /* uid=0 or gid=0 are invalid values */
-                /* also check that the id is in the valid range for this domain
-                 */
-                if (OUT_OF_ID_RANGE(pwd->pw_uid, dom->id_min, dom->id_max) ||
-                    OUT_OF_ID_RANGE(pwd->pw_gid, dom->id_min, dom->id_max)) {
-
-                    DEBUG(SSSDBG_OP_FAILURE, "User [%s] filtered out! (id out"
-                        " of range)\n", pwd->pw_name);
-
-                    again = true;
-                    break;
-                }
-
-                ret = save_user(dom, !dom->case_sensitive, pwd,
-                        pwd->pw_name, NULL, dom->user_timeout);
-                if (ret) {
-                    /* Do not fail completely on errors.
-                     * Just report the failure to save and go on */
-                    DEBUG(SSSDBG_OP_FAILURE, "Failed to store user %s."
-                                " Ignoring.\n", pwd->pw_name);
-                }
-                again = true;
-                break;
-
-            case NSS_STATUS_UNAVAIL:
-                /* "remote" backend unavailable. Enter offline mode */
-                ret = ENXIO;
-                break;
-
-            default:
-                ret = EIO;
-                DEBUG(SSSDBG_OP_FAILURE, "proxy -> getpwent_r failed (%d)[%s]"
-                            "\n", ret, strerror(ret));
-                break;
-        }
-    } while (again);
-
-done:
-    talloc_zfree(tmpctx);
-    if (in_transaction) {
-        sret = sysdb_transaction_cancel(sysdb);
-        if (sret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to cancel transaction\n");
-        }
-    }
-    ctx->ops.endpwent();
-    return ret;
-}
-
 /* =Save-group-utilities=================================================*/
 #define DEBUG_GR_MEM(level, grp) \
     do { \
@@ -983,150 +841,814 @@ done:
     return ret;
 }
 
-/* =Getgrent-wrapper======================================================*/
+/* =Enumeration-helper====================================================*/
+
+/* getpwent_r() and getgrent_r() of the wrapped module block and walking a
+ * large map can take long. The enumeration is therefore run in a child
+ * process which streams the entries back through a pipe. The back end
+ * reads them asynchronously and saves the entries of every chunk it reads
+ * in a transaction of their own, so the event loop keeps running during
+ * the enumeration and between the transactions.
+ *
+ * Each record is the record type, the length of the payload and the
+ * payload. A user is uid, gid and the name, password, gecos, home
+ * directory and shell strings, a group is gid, the number of members and
+ * the name, password and member strings. The last record carries the
+ * result of the enumeration. */
+
+#define PROXY_ENUM_REC_ENTRY 1
+#define PROXY_ENUM_REC_END 2
+
+#define PROXY_ENUM_REC_HDR_SIZE (2 * sizeof(uint32_t))
+
+/* the child writes and the back end reads in chunks of this size */
+#define PROXY_ENUM_CHUNK_SIZE (64 * 1024)
+
+enum proxy_enum_type {
+    PROXY_ENUM_USERS,
+    PROXY_ENUM_GROUPS
+};
+
+struct proxy_enum_wbuf {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+};
+
+static errno_t proxy_enum_wbuf_reserve(struct proxy_enum_wbuf *wbuf,
+                                       size_t len)
+{
+    uint8_t *data;
+    size_t size;
 
-static int enum_groups(TALLOC_CTX *mem_ctx,
-                       struct proxy_id_ctx *ctx,
-                       struct sysdb_ctx *sysdb,
-                       struct sss_domain_info *dom)
+    if (wbuf->len + len <= wbuf->size) {
+        return EOK;
+    }
+
+    size = wbuf->size * 2;
+    if (size < wbuf->len + len) {
+        size = wbuf->len + len;
+    }
+    data = talloc_realloc(NULL, wbuf->data, uint8_t, size);
+    if (data == NULL) {
+        return ENOMEM;
+    }
+
+    wbuf->data = data;
+    wbuf->size = size;
+    return EOK;
+}
+
+static errno_t proxy_enum_wbuf_add_str(struct proxy_enum_wbuf *wbuf,
+                                       const char *str)
+{
+    size_t len;
+    errno_t ret;
+
+    if (str == NULL) {
+        str = "";
+    }
+
+    len = strlen(str) + 1;
+    ret = proxy_enum_wbuf_reserve(wbuf, len);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    memcpy(wbuf->data + wbuf->len, str, len);
+    wbuf->len += len;
+    return EOK;
+}
+
+static errno_t proxy_enum_wbuf_add_uint32(struct proxy_enum_wbuf *wbuf,
+                                          uint32_t value)
+{
+    errno_t ret;
+
+    ret = proxy_enum_wbuf_reserve(wbuf, sizeof(uint32_t));
+    if (ret != EOK) {
+        return ret;
+    }
+
+    SAFEALIGN_SET_UINT32(wbuf->data + wbuf->len, value, &wbuf->len);
+    return EOK;
+}
+
+/* Starts a new record, the length is filled by proxy_enum_wbuf_end(). */
+static errno_t proxy_enum_wbuf_begin(struct proxy_enum_wbuf *wbuf,
+                                     uint32_t type, size_t *_start)
+{
+    errno_t ret;
+
+    *_start = wbuf->len;
+
+    ret = proxy_enum_wbuf_add_uint32(wbuf, type);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return proxy_enum_wbuf_add_uint32(wbuf, 0);
+}
+
+static void proxy_enum_wbuf_end(struct proxy_enum_wbuf *wbuf, size_t start)
+{
+    size_t pos = start + sizeof(uint32_t);
+
+    SAFEALIGN_SET_UINT32(wbuf->data + pos,
+                         wbuf->len - start - PROXY_ENUM_REC_HDR_SIZE, &pos);
+}
+
+static errno_t proxy_enum_wbuf_flush(struct proxy_enum_wbuf *wbuf, int fd)
+{
+    ssize_t written;
+
+    if (wbuf->len == 0) {
+        return EOK;
+    }
+
+    written = sss_atomic_write_s(fd, wbuf->data, wbuf->len);
+    if (written == -1) {
+        return errno;
+    } else if ((size_t) written != wbuf->len) {
+        return EIO;
+    }
+
+    wbuf->len = 0;
+    return EOK;
+}
+
+static errno_t proxy_enum_wbuf_add_user(struct proxy_enum_wbuf *wbuf,
+                                        struct passwd *pwd)
+{
+    size_t start;
+    errno_t ret;
+
+    ret = proxy_enum_wbuf_begin(wbuf, PROXY_ENUM_REC_ENTRY, &start);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_uint32(wbuf, pwd->pw_uid);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_uint32(wbuf, pwd->pw_gid);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, pwd->pw_name);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, pwd->pw_passwd);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, pwd->pw_gecos);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, pwd->pw_dir);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, pwd->pw_shell);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    proxy_enum_wbuf_end(wbuf, start);
+    return EOK;
+}
+
+static errno_t proxy_enum_wbuf_add_group(struct proxy_enum_wbuf *wbuf,
+                                         struct group *grp)
+{
+    uint32_t num_mem;
+    size_t start;
+    errno_t ret;
+    uint32_t i;
+
+    for (num_mem = 0; grp->gr_mem != NULL && grp->gr_mem[num_mem] != NULL;
+         num_mem++);
+
+    ret = proxy_enum_wbuf_begin(wbuf, PROXY_ENUM_REC_ENTRY, &start);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_uint32(wbuf, grp->gr_gid);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_uint32(wbuf, num_mem);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, grp->gr_name);
+    if (ret == EOK) ret = proxy_enum_wbuf_add_str(wbuf, grp->gr_passwd);
+    for (i = 0; ret == EOK && i < num_mem; i++) {
+        ret = proxy_enum_wbuf_add_str(wbuf, grp->gr_mem[i]);
+    }
+    if (ret != EOK) {
+        return ret;
+    }
+
+    proxy_enum_wbuf_end(wbuf, start);
+    return EOK;
+}
+
+/* The child must not share the state of the NSS module, e.g. its open
+ * connections, with the back end. A fresh copy of the module is loaded into
+ * a new namespace and used instead of the inherited one, which is left
+ * untouched. */
+static errno_t proxy_enum_child_reinit(struct proxy_id_ctx *ctx,
+                                       enum proxy_enum_type type)
+{
+    const char *names[3];
+    void *funcs[3];
+    char *libpath;
+    char *funcname;
+    void *handle;
+    errno_t ret;
+    int i;
+
+    if (type == PROXY_ENUM_USERS) {
+        names[0] = "_nss_%s_setpwent";
+        names[1] = "_nss_%s_getpwent_r";
+        names[2] = "_nss_%s_endpwent";
+    } else {
+        names[0] = "_nss_%s_setgrent";
+        names[1] = "_nss_%s_getgrent_r";
+        names[2] = "_nss_%s_endgrent";
+    }
+
+    libpath = talloc_asprintf(NULL, "libnss_%s.so.2", ctx->libname);
+    if (libpath == NULL) {
+        return ENOMEM;
+    }
+
+    handle = dlmopen(LM_ID_NEWLM, libpath, RTLD_NOW);
+    if (handle == NULL) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to load a new copy of %s: %s\n",
+              libpath, dlerror());
+        ret = ELIBACC;
+        goto done;
+    }
+
+    for (i = 0; i < 3; i++) {
+        funcname = talloc_asprintf(libpath, names[i], ctx->libname);
+        if (funcname == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        funcs[i] = dlsym(handle, funcname);
+        if (funcs[i] == NULL) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to find %s in the new copy "
+                  "of %s\n", funcname, libpath);
+            ret = ELIBBAD;
+            goto done;
+        }
+    }
+
+    if (type == PROXY_ENUM_USERS) {
+        ctx->ops.setpwent = funcs[0];
+        ctx->ops.getpwent_r = funcs[1];
+        ctx->ops.endpwent = funcs[2];
+    } else {
+        ctx->ops.setgrent = funcs[0];
+        ctx->ops.getgrent_r = funcs[1];
+        ctx->ops.endgrent = funcs[2];
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(libpath);
+    return ret;
+}
+
+/* Runs in the child, returns the result of the enumeration. */
+static errno_t proxy_enum_child_run(struct proxy_id_ctx *ctx,
+                                    enum proxy_enum_type type,
+                                    struct proxy_enum_wbuf *wbuf,
+                                    int fd)
 {
-    TALLOC_CTX *tmpctx;
-    bool in_transaction = false;
-    struct group *grp;
     enum nss_status status;
+    struct passwd pwd;
+    struct group grp;
     size_t buflen;
     char *buffer;
     char *newbuf;
-    int ret;
-    errno_t sret;
-    bool again;
-
-    DEBUG(SSSDBG_TRACE_LIBS, "Enumerating groups\n");
+    errno_t ret;
 
-    tmpctx = talloc_new(mem_ctx);
-    if (!tmpctx) {
+    buflen = DEFAULT_BUFSIZE;
+    buffer = talloc_size(NULL, buflen);
+    if (buffer == NULL) {
         return ENOMEM;
     }
 
-    grp = talloc(tmpctx, struct group);
-    if (!grp) {
+    if (type == PROXY_ENUM_USERS) {
+        status = ctx->ops.setpwent();
+    } else {
+        status = ctx->ops.setgrent();
+    }
+    if (status != NSS_STATUS_SUCCESS) {
+        return EIO;
+    }
+
+    for (;;) {
+        /* always zero out the entry */
+        if (type == PROXY_ENUM_USERS) {
+            memset(&pwd, 0, sizeof(struct passwd));
+            status = ctx->ops.getpwent_r(&pwd, buffer, buflen, &ret);
+        } else {
+            memset(&grp, 0, sizeof(struct group));
+            status = ctx->ops.getgrent_r(&grp, buffer, buflen, &ret);
+        }
+
+        switch (status) {
+        case NSS_STATUS_TRYAGAIN:
+            /* buffer too small ? */
+            if (buflen < MAX_BUF_SIZE) {
+                buflen *= 2;
+            }
+            if (buflen > MAX_BUF_SIZE) {
+                buflen = MAX_BUF_SIZE;
+            }
+            newbuf = talloc_realloc_size(NULL, buffer, buflen);
+            if (newbuf == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+            buffer = newbuf;
+            continue;
+
+        case NSS_STATUS_NOTFOUND:
+            /* we are done here */
+            ret = EOK;
+            goto done;
+
+        case NSS_STATUS_SUCCESS:
+            if (type == PROXY_ENUM_USERS) {
+                ret = proxy_enum_wbuf_add_user(wbuf, &pwd);
+            } else {
+                ret = proxy_enum_wbuf_add_group(wbuf, &grp);
+            }
+            if (ret != EOK) {
+                goto done;
+            }
+
+            if (wbuf->len >= PROXY_ENUM_CHUNK_SIZE) {
+                ret = proxy_enum_wbuf_flush(wbuf, fd);
+                if (ret != EOK) {
+                    goto done;
+                }
+            }
+            continue;
+
+        case NSS_STATUS_UNAVAIL:
+            /* "remote" backend unavailable. Enter offline mode */
+            ret = ENXIO;
+            goto done;
+
+        default:
+            DEBUG(SSSDBG_OP_FAILURE, "proxy -> get%sent_r failed (%d)[%s]\n",
+                  type == PROXY_ENUM_USERS ? "pw" : "gr", ret, strerror(ret));
+            ret = EIO;
+            goto done;
+        }
+    }
+
+done:
+    if (type == PROXY_ENUM_USERS) {
+        ctx->ops.endpwent();
+    } else {
+        ctx->ops.endgrent();
+    }
+    talloc_free(buffer);
+    return ret;
+}
+
+static void proxy_enum_child(struct proxy_id_ctx *ctx,
+                             enum proxy_enum_type type,
+                             int fd)
+{
+    struct proxy_enum_wbuf wbuf = { NULL, 0, 0 };
+    size_t start;
+    errno_t ret;
+
+    ret = proxy_enum_child_reinit(ctx, type);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Using the NSS module inherited from the back end\n");
+    }
+
+    ret = proxy_enum_child_run(ctx, type, &wbuf, fd);
+
+    if (proxy_enum_wbuf_begin(&wbuf, PROXY_ENUM_REC_END, &start) != EOK
+            || proxy_enum_wbuf_add_uint32(&wbuf, ret) != EOK) {
+        _exit(1);
+    }
+    proxy_enum_wbuf_end(&wbuf, start);
+
+    if (proxy_enum_wbuf_flush(&wbuf, fd) != EOK) {
+        _exit(1);
+    }
+
+    _exit(0);
+}
+
+struct proxy_enum_state {
+    struct proxy_id_ctx *ctx;
+    struct sss_domain_info *dom;
+    enum proxy_enum_type type;
+
+    pid_t pid;
+    int fd;
+    struct tevent_fd *fde;
+
+    /* records received but not processed yet, the last one may be
+     * incomplete */
+    uint8_t *buf;
+    size_t len;
+    size_t size;
+    size_t num_saved;
+
+    bool finished;
+    errno_t result;
+};
+
+static int proxy_enum_state_destructor(struct proxy_enum_state *state)
+{
+    if (state->fd != -1) {
+        close(state->fd);
+    }
+
+    if (state->pid > 0 && !state->finished) {
+        /* the request was cancelled, the child is reaped by the sigchld
+         * handler */
+        kill(state->pid, SIGKILL);
+    }
+
+    return 0;
+}
+
+static void proxy_enum_readable(struct tevent_context *ev,
+                                struct tevent_fd *fde,
+                                uint16_t flags, void *pvt);
+
+static struct tevent_req *proxy_enum_send(TALLOC_CTX *mem_ctx,
+                                          struct tevent_context *ev,
+                                          struct proxy_id_ctx *ctx,
+                                          struct sss_domain_info *dom,
+                                          enum proxy_enum_type type)
+{
+    struct proxy_enum_state *state;
+    struct tevent_req *req;
+    int pipefd[2];
+    errno_t ret;
+    pid_t pid;
+
+    req = tevent_req_create(mem_ctx, &state, struct proxy_enum_state);
+    if (req == NULL) {
+        return NULL;
+    }
+
+    state->ctx = ctx;
+    state->dom = dom;
+    state->type = type;
+    state->fd = -1;
+    talloc_set_destructor(state, proxy_enum_state_destructor);
+
+    DEBUG(SSSDBG_TRACE_LIBS, "Enumerating %s\n",
+          type == PROXY_ENUM_USERS ? "users" : "groups");
+
+    state->size = PROXY_ENUM_CHUNK_SIZE;
+    state->buf = talloc_size(state, state->size);
+    if (state->buf == NULL) {
         ret = ENOMEM;
-        goto done;
+        goto immediately;
     }
 
-    buflen = DEFAULT_BUFSIZE;
-    buffer = talloc_size(tmpctx, buflen);
-    if (!buffer) {
+    ret = pipe(pipefd);
+    if (ret == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "pipe failed [%d][%s].\n", ret, strerror(ret));
+        goto immediately;
+    }
+
+    pid = fork();
+    if (pid == 0) { /* child */
+        close(pipefd[0]);
+        proxy_enum_child(ctx, type, pipefd[1]);
+        /* not reached */
+    } else if (pid < 0) { /* error */
+        ret = errno;
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "fork failed [%d][%s].\n", ret, strerror(ret));
+        close(pipefd[0]);
+        close(pipefd[1]);
+        goto immediately;
+    }
+
+    /* parent */
+    state->pid = pid;
+    state->fd = pipefd[0];
+    close(pipefd[1]);
+    sss_fd_nonblocking(state->fd);
+
+    ret = child_handler_setup(ev, pid, NULL, NULL, NULL);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Could not set up child signal handler\n");
+        goto immediately;
+    }
+
+    state->fde = tevent_add_fd(ev, state, state->fd, TEVENT_FD_READ,
+                               proxy_enum_readable, req);
+    if (state->fde == NULL) {
         ret = ENOMEM;
-        goto done;
+        goto immediately;
     }
 
-    ret = sysdb_transaction_start(sysdb);
-    if (ret) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Failed to start transaction\n");
-        goto done;
+    return req;
+
+immediately:
+    tevent_req_error(req, ret);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+static errno_t proxy_enum_parse_str(const uint8_t *body, size_t len,
+                                    size_t *_pos, char **_str)
+{
+    const uint8_t *end;
+
+    if (*_pos >= len) {
+        return EINVAL;
     }
-    in_transaction = true;
 
-    status = ctx->ops.setgrent();
-    if (status != NSS_STATUS_SUCCESS) {
-        ret = EIO;
+    end = memchr(body + *_pos, '\0', len - *_pos);
+    if (end == NULL) {
+        return EINVAL;
+    }
+
+    *_str = discard_const(body + *_pos);
+    *_pos = end - body + 1;
+    return EOK;
+}
+
+static errno_t proxy_enum_save_user(struct proxy_enum_state *state,
+                                    const uint8_t *body, size_t len)
+{
+    struct sss_domain_info *dom = state->dom;
+    struct passwd pwd;
+    uint32_t id;
+    size_t pos = 0;
+    errno_t ret;
+
+    memset(&pwd, 0, sizeof(struct passwd));
+
+    SAFEALIGN_COPY_UINT32_CHECK(&id, body + pos, len, &pos);
+    pwd.pw_uid = id;
+    SAFEALIGN_COPY_UINT32_CHECK(&id, body + pos, len, &pos);
+    pwd.pw_gid = id;
+
+    ret = proxy_enum_parse_str(body, len, &pos, &pwd.pw_name);
+    if (ret == EOK) ret = proxy_enum_parse_str(body, len, &pos, &pwd.pw_passwd);
+    if (ret == EOK) ret = proxy_enum_parse_str(body, len, &pos, &pwd.pw_gecos);
+    if (ret == EOK) ret = proxy_enum_parse_str(body, len, &pos, &pwd.pw_dir);
+    if (ret == EOK) ret = proxy_enum_parse_str(body, len, &pos, &pwd.pw_shell);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    DEBUG(SSSDBG_TRACE_LIBS, "User found (%s, %"SPRIuid", %"SPRIgid")\n",
+          pwd.pw_name, pwd.pw_uid, pwd.pw_gid);
+
+    /* uid=0 or gid=0 are invalid values */
+    /* also check that the id is in the valid range for this domain */
+    if (OUT_OF_ID_RANGE(pwd.pw_uid, dom->id_min, dom->id_max) ||
+        OUT_OF_ID_RANGE(pwd.pw_gid, dom->id_min, dom->id_max)) {
+        DEBUG(SSSDBG_OP_FAILURE, "User [%s] filtered out! (id out"
+              " of range)\n", pwd.pw_name);
+        return EOK;
+    }
+
+    ret = save_user(dom, !dom->case_sensitive, &pwd, pwd.pw_name, NULL,
+                    dom->user_timeout);
+    if (ret != EOK) {
+        /* Do not fail completely on errors.
+         * Just report the failure to save and go on */
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to store user %s. Ignoring.\n",
+              pwd.pw_name);
+    }
+
+    return EOK;
+}
+
+static errno_t proxy_enum_save_group(struct proxy_enum_state *state,
+                                     const uint8_t *body, size_t len)
+{
+    struct sss_domain_info *dom = state->dom;
+    struct group grp;
+    uint32_t num_mem;
+    uint32_t id;
+    size_t pos = 0;
+    uint32_t i;
+    errno_t ret;
+
+    memset(&grp, 0, sizeof(struct group));
+
+    SAFEALIGN_COPY_UINT32_CHECK(&id, body + pos, len, &pos);
+    grp.gr_gid = id;
+    SAFEALIGN_COPY_UINT32_CHECK(&num_mem, body + pos, len, &pos);
+
+    /* every member takes at least one byte */
+    if (num_mem > len) {
+        return EINVAL;
+    }
+
+    grp.gr_mem = talloc_zero_array(state, char *, num_mem + 1);
+    if (grp.gr_mem == NULL) {
+        return ENOMEM;
+    }
+
+    ret = proxy_enum_parse_str(body, len, &pos, &grp.gr_name);
+    if (ret == EOK) ret = proxy_enum_parse_str(body, len, &pos, &grp.gr_passwd);
+    for (i = 0; ret == EOK && i < num_mem; i++) {
+        ret = proxy_enum_parse_str(body, len, &pos, &grp.gr_mem[i]);
+    }
+    if (ret != EOK) {
         goto done;
     }
 
-    do {
-        again = false;
+    DEBUG(SSSDBG_TRACE_LIBS, "Group found (%s, %"SPRIgid")\n",
+          grp.gr_name, grp.gr_gid);
 
-        /* always zero out the grp structure */
-        memset(grp, 0, sizeof(struct group));
+    /* gid=0 is an invalid value */
+    /* also check that the id is in the valid range for this domain */
+    if (OUT_OF_ID_RANGE(grp.gr_gid, dom->id_min, dom->id_max)) {
+        DEBUG(SSSDBG_OP_FAILURE, "Group [%s] filtered out! (id"
+              "out of range)\n", grp.gr_name);
+        ret = EOK;
+        goto done;
+    }
 
-        /* get entry */
-        status = ctx->ops.getgrent_r(grp, buffer, buflen, &ret);
+    ret = save_group(dom->sysdb, dom, &grp, grp.gr_name, NULL,
+                     dom->group_timeout);
+    if (ret != EOK) {
+        /* Do not fail completely on errors.
+         * Just report the failure to save and go on */
+        DEBUG(SSSDBG_OP_FAILURE, "Failed to store group. Ignoring\n");
+    }
+    ret = EOK;
 
-        switch (status) {
-            case NSS_STATUS_TRYAGAIN:
-                /* buffer too small ? */
-                if (buflen < MAX_BUF_SIZE) {
-                    buflen *= 2;
-                }
-                if (buflen > MAX_BUF_SIZE) {
-                    buflen = MAX_BUF_SIZE;
-                }
-                newbuf = talloc_realloc_size(tmpctx, buffer, buflen);
-                if (!newbuf) {
-                    ret = ENOMEM;
-                    goto done;
-                }
-                buffer = newbuf;
-                again = true;
-                break;
+done:
+    talloc_free(grp.gr_mem);
+    return ret;
+}
+
+/* Saves all complete entry records in the buffer in a single transaction
+ * and drops them from the buffer. Returns EOK once the final record was
+ * received and EAGAIN if more data is needed. */
+static errno_t proxy_enum_process(struct proxy_enum_state *state)
+{
+    struct sysdb_ctx *sysdb = state->dom->sysdb;
+    bool in_transaction = false;
+    bool finished = false;
+    uint32_t type;
+    uint32_t len;
+    size_t pos = 0;
+    size_t hdr;
+    errno_t ret;
+    errno_t sret;
 
-            case NSS_STATUS_NOTFOUND:
+    while (!finished && state->len - pos >= PROXY_ENUM_REC_HDR_SIZE) {
+        hdr = pos;
+        SAFEALIGN_COPY_UINT32(&type, state->buf + hdr, &hdr);
+        SAFEALIGN_COPY_UINT32(&len, state->buf + hdr, &hdr);
 
-                /* we are done here */
-                DEBUG(SSSDBG_TRACE_LIBS, "Enumeration completed.\n");
+        if (state->len - hdr < len) {
+            /* incomplete record, wait for the rest */
+            break;
+        }
 
-                ret = sysdb_transaction_commit(sysdb);
+        switch (type) {
+        case PROXY_ENUM_REC_ENTRY:
+            if (!in_transaction) {
+                ret = sysdb_transaction_start(sysdb);
                 if (ret != EOK) {
-                    DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+                    DEBUG(SSSDBG_CRIT_FAILURE,
+                          "Failed to start transaction\n");
                     goto done;
                 }
-                in_transaction = false;
-                break;
-
-            case NSS_STATUS_SUCCESS:
+                in_transaction = true;
+            }
 
-                DEBUG(SSSDBG_OP_FAILURE, "Group found (%s, %"SPRIgid")\n",
-                            grp->gr_name, grp->gr_gid);
+            if (state->type == PROXY_ENUM_USERS) {
+                ret = proxy_enum_save_user(state, state->buf + hdr, len);
+            } else {
+                ret = proxy_enum_save_group(state, state->buf + hdr, len);
+            }
+            if (ret != EOK) {
+                DEBUG(SSSDBG_CRIT_FAILURE, "Malformed record from the "
+                      "enumeration child\n");
+                goto done;
+            }
+            state->num_saved++;
+            break;
 
-                /* gid=0 is an invalid value */
-                /* also check that the id is in the valid range for this domain
-                 */
-                if (OUT_OF_ID_RANGE(grp->gr_gid, dom->id_min, dom->id_max)) {
+        case PROXY_ENUM_REC_END:
+            if (len != sizeof(uint32_t) || state->len != hdr + len) {
+                DEBUG(SSSDBG_CRIT_FAILURE, "Malformed final record from the "
+                      "enumeration child\n");
+                ret = EINVAL;
+                goto done;
+            }
+            SAFEALIGN_COPY_UINT32(&state->result, state->buf + hdr, NULL);
+            finished = true;
+            break;
 
-                    DEBUG(SSSDBG_OP_FAILURE, "Group [%s] filtered out! (id"
-                        "out of range)\n", grp->gr_name);
+        default:
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unknown record type %"PRIu32" from "
+                  "the enumeration child\n", type);
+            ret = EINVAL;
+            goto done;
+        }
 
-                    again = true;
-                    break;
-                }
+        pos = hdr + len;
+    }
 
-                ret = save_group(sysdb, dom, grp, grp->gr_name,
-                        NULL, dom->group_timeout);
-                if (ret) {
-                    /* Do not fail completely on errors.
-                     * Just report the failure to save and go on */
-                    DEBUG(SSSDBG_OP_FAILURE, "Failed to store group."
-                                "Ignoring\n");
-                }
-                again = true;
-                break;
-
-            case NSS_STATUS_UNAVAIL:
-                /* "remote" backend unavailable. Enter offline mode */
-                ret = ENXIO;
-                break;
-
-            default:
-                ret = EIO;
-                DEBUG(SSSDBG_OP_FAILURE, "proxy -> getgrent_r failed (%d)[%s]"
-                            "\n", ret, strerror(ret));
-                break;
+    if (in_transaction) {
+        ret = sysdb_transaction_commit(sysdb);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Failed to commit transaction\n");
+            goto done;
         }
-    } while (again);
+        in_transaction = false;
+    }
+
+    /* keep the incomplete record */
+    memmove(state->buf, state->buf + pos, state->len - pos);
+    state->len -= pos;
+
+    ret = finished ? EOK : EAGAIN;
 
 done:
-    talloc_zfree(tmpctx);
     if (in_transaction) {
         sret = sysdb_transaction_cancel(sysdb);
         if (sret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Failed to cancel transaction\n");
         }
     }
-    ctx->ops.endgrent();
     return ret;
 }
 
+static void proxy_enum_readable(struct tevent_context *ev,
+                                struct tevent_fd *fde,
+                                uint16_t flags, void *pvt)
+{
+    struct tevent_req *req = talloc_get_type(pvt, struct tevent_req);
+    struct proxy_enum_state *state;
+    uint8_t *buf;
+    size_t size;
+    ssize_t n;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct proxy_enum_state);
+
+    if (state->size - state->len < PROXY_ENUM_CHUNK_SIZE) {
+        size = MAX(state->size * 2, state->len + PROXY_ENUM_CHUNK_SIZE);
+        buf = talloc_realloc(state, state->buf, uint8_t, size);
+        if (buf == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        state->buf = buf;
+        state->size = size;
+    }
+
+    n = read(state->fd, state->buf + state->len, state->size - state->len);
+    if (n == -1) {
+        ret = errno;
+        if (ret == EAGAIN || ret == EINTR) {
+            return;
+        }
+        DEBUG(SSSDBG_CRIT_FAILURE, "read failed [%d][%s].\n",
+              ret, strerror(ret));
+        goto done;
+    } else if (n == 0) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "The enumeration child exited "
+              "unexpectedly after %zu entries\n", state->num_saved);
+        ret = EIO;
+        goto done;
+    }
+    state->len += n;
+
+    /* one transaction per chunk, the next one is read in a later
+     * iteration of the event loop */
+    ret = proxy_enum_process(state);
+    if (ret == EAGAIN) {
+        /* wait for more */
+        return;
+    } else if (ret != EOK) {
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_LIBS, "Enumeration completed, %zu entries "
+          "saved [%d]: %s\n", state->num_saved,
+          state->result, sss_strerror(state->result));
+    ret = state->result;
+
+done:
+    talloc_zfree(state->fde);
+    state->finished = true;
+
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    tevent_req_done(req);
+}
+
+static errno_t proxy_enum_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    return EOK;
+}
 
 /* =Initgroups-wrapper====================================================*/
 
@@ -1362,6 +1884,47 @@ static int get_initgr_groups_process(TALLOC_CTX *memctx,
 
 /* =Proxy_Id-Functions====================================================*/
 
+static void proxy_account_info_enum_done(struct tevent_req *subreq);
+
+static errno_t proxy_account_info_enum(struct be_req *breq,
+                                       struct proxy_id_ctx *ctx,
+                                       struct sss_domain_info *domain,
+                                       enum proxy_enum_type type)
+{
+    struct be_ctx *be_ctx = be_req_get_be_ctx(breq);
+    struct tevent_req *subreq;
+
+    subreq = proxy_enum_send(breq, be_ctx->ev, ctx, domain, type);
+    if (subreq == NULL) {
+        return ENOMEM;
+    }
+
+    tevent_req_set_callback(subreq, proxy_account_info_enum_done, breq);
+    return EOK;
+}
+
+static void proxy_account_info_enum_done(struct tevent_req *subreq)
+{
+    struct be_req *breq = tevent_req_callback_data(subreq, struct be_req);
+    struct be_ctx *be_ctx = be_req_get_be_ctx(breq);
+    errno_t ret;
+
+    ret = proxy_enum_recv(subreq);
+    talloc_zfree(subreq);
+    if (ret != EOK) {
+        if (ret == ENXIO) {
+            DEBUG(SSSDBG_OP_FAILURE,
+                  "proxy returned UNAVAIL error, going offline!\n");
+            be_mark_offline(be_ctx);
+        }
+        be_req_terminate(breq, DP_ERR_FATAL, ret, NULL);
+        return;
+    }
+
+    be_req_terminate(breq, DP_ERR_OK, EOK, NULL);
+}
+
+
 void proxy_get_account_info(struct be_req *breq)
 {
     struct be_ctx *be_ctx = be_req_get_be_ctx(breq);
@@ -1399,7 +1962,12 @@ void proxy_get_account_info(struct be_req *breq)
     case BE_REQ_USER: /* user */
         switch (ar->filter_type) {
         case BE_FILTER_ENUM:
-            ret = enum_users(breq, ctx, sysdb, domain);
+            ret = proxy_account_info_enum(breq, ctx, domain,
+                                          PROXY_ENUM_USERS);
+            if (ret == EOK) {
+                /* terminated when the enumeration finishes */
+                return;
+            }
             break;
 
         case BE_FILTER_NAME:
@@ -1423,7 +1991,12 @@ void proxy_get_account_info(struct be_req *breq)
     case BE_REQ_GROUP: /* group */
         switch (ar->filter_type) {
         case BE_FILTER_ENUM:
-            ret = enum_groups(breq, ctx, sysdb, domain);
+            ret = proxy_account_info_enum(breq, ctx, domain,
+                                          PROXY_ENUM_GROUPS);
+            if (ret == EOK) {
+                /* terminated when the enumeration finishes */
+                return;
+            }
             break;
         case BE_FILTER_NAME:
             ret = get_gr_name(ctx, sysdb, domain, ar->filter_value);
@@ -120,6 +120,8 @@ int sssm_proxy_id_init(struct be_ctx *bectx,
         goto done;
     }
 
+    ctx->libname = libname;
+
     ctx->handle = dlopen(libpath, RTLD_NOW);
     if (!ctx->handle) {
         DEBUG(SSSDBG_FATAL_FAILURE,
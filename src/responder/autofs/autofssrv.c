@@ -39,9 +39,10 @@ struct mon_cli_iface monitor_autofs_methods = {
     .goOffline = NULL,
     .resetOffline = NULL,
     .rotateLogs = responder_logrotate,
-    .clearMemcache = NULL,
+    .clearMemcache = responder_clear_memcache,
     .clearEnumCache = autofs_clean_hash_table,
     .sysbusReconnect = NULL,
+    .getLatencyStats = responder_get_latency_stats,
 };
 
 static struct data_provider_iface autofs_dp_methods = {
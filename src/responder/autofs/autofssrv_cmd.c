@@ -768,6 +768,10 @@ lookup_automntmap_update_cache(struct setautomntent_lookup_ctx *lookup_ctx)
         if (strcmp(lookup_ctx->mapname, "auto.master") != 0) {
             cache_expire = ldb_msg_find_attr_as_uint64(dctx->map,
                                                        SYSDB_CACHE_EXPIRE, 0);
+            if (sysdb_is_invalidated(dctx->domain, SYSDB_CACHE_TYPE_AUTOFSMAP,
+                                     dctx->map)) {
+                cache_expire = 0;
+            }
         }
 
         /* if we have any reply let's check cache validity */
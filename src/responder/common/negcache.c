@@ -23,6 +23,7 @@
 #include "confdb/confdb.h"
 #include "responder/common/responder.h"
 #include "responder/common/negcache.h"
+#include "util/murmurhash3.h"
 #include <fcntl.h>
 #include <time.h>
 #include "tdb.h"
@@ -39,6 +40,10 @@
 
 struct sss_nc_ctx {
     struct tdb_context *tdb;
+    /* users watched with sss_ncache_watch_user() and their use count */
+    hash_table_t *watched;
+    /* incremented whenever a watched user is added */
+    uint64_t user_gen;
 };
 
 typedef int (*ncache_set_byname_fn_t)(struct sss_nc_ctx *, bool,
@@ -515,11 +520,134 @@ static int sss_ncache_set_ent(struct sss_nc_ctx *ctx, bool permanent,
     return ret;
 }
 
+static errno_t sss_ncache_user_watch_key(struct sss_nc_ctx *ctx,
+                                         struct sss_domain_info *dom,
+                                         const char *name,
+                                         unsigned long *_key)
+{
+    char *lower = NULL;
+    char *str;
+    size_t len;
+    uint64_t h1;
+    uint64_t h2;
+
+    if (!name || !*name) return EINVAL;
+
+    /* the same name the negative cache entry is stored under */
+    if (dom->case_sensitive == false) {
+        lower = sss_tc_utf8_str_tolower(ctx, name);
+        if (!lower) return ENOMEM;
+        name = lower;
+    }
+
+    str = talloc_asprintf(ctx, "%s/%s/%s", NC_USER_PREFIX, dom->name, name);
+    talloc_free(lower);
+    if (!str) return ENOMEM;
+
+    len = strlen(str);
+    h1 = murmurhash3(str, len, 0);
+    h2 = murmurhash3(str, len, 0xdeadbeef);
+    talloc_free(str);
+
+    *_key = (unsigned long) ((h1 << 32) | h2);
+    return EOK;
+}
 
 int sss_ncache_set_user(struct sss_nc_ctx *ctx, bool permanent,
                         struct sss_domain_info *dom, const char *name)
 {
-    return sss_ncache_set_ent(ctx, permanent, dom, name, sss_ncache_set_user_int);
+    hash_key_t key;
+    errno_t ret;
+
+    ret = sss_ncache_set_ent(ctx, permanent, dom, name,
+                             sss_ncache_set_user_int);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (ctx->watched == NULL || hash_count(ctx->watched) == 0) {
+        return EOK;
+    }
+
+    key.type = HASH_KEY_ULONG;
+    if (sss_ncache_user_watch_key(ctx, dom, name, &key.ul) != EOK
+            || hash_has_key(ctx->watched, &key)) {
+        ctx->user_gen++;
+    }
+
+    return EOK;
+}
+
+uint64_t sss_ncache_user_generation(struct sss_nc_ctx *ctx)
+{
+    return ctx->user_gen;
+}
+
+errno_t sss_ncache_watch_user(struct sss_nc_ctx *ctx,
+                              struct sss_domain_info *dom, const char *name,
+                              unsigned long *_key)
+{
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    if (ctx->watched == NULL) {
+        ret = sss_hash_create(ctx, 0, &ctx->watched);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    key.type = HASH_KEY_ULONG;
+    ret = sss_ncache_user_watch_key(ctx, dom, name, &key.ul);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    hret = hash_lookup(ctx->watched, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        value.type = HASH_VALUE_ULONG;
+        value.ul = 0;
+    } else if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    value.ul++;
+    hret = hash_enter(ctx->watched, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    *_key = key.ul;
+    return EOK;
+}
+
+void sss_ncache_unwatch_user(struct sss_nc_ctx *ctx, unsigned long key)
+{
+    hash_key_t hkey;
+    hash_value_t value;
+    int hret;
+
+    if (ctx->watched == NULL) {
+        return;
+    }
+
+    hkey.type = HASH_KEY_ULONG;
+    hkey.ul = key;
+
+    hret = hash_lookup(ctx->watched, &hkey, &value);
+    if (hret != HASH_SUCCESS) {
+        return;
+    }
+
+    if (value.ul <= 1) {
+        hash_delete(ctx->watched, &hkey);
+        return;
+    }
+
+    value.ul--;
+    hash_enter(ctx->watched, &hkey, &value);
 }
 
 int sss_ncache_set_group(struct sss_nc_ctx *ctx, bool permanent,
@@ -76,6 +76,20 @@ int sss_ncache_set_service_port(struct sss_nc_ctx *ctx, bool permanent,
 
 int sss_ncache_reset_permanent(struct sss_nc_ctx *ctx);
 
+/* Changes every time a watched user is added to the negative cache, so that
+ * results which were filtered with the negative cache can tell they are
+ * outdated */
+uint64_t sss_ncache_user_generation(struct sss_nc_ctx *ctx);
+
+/* Starts watching the user, every call must be paired with a call of
+ * sss_ncache_unwatch_user() with the returned key. Users are watched by a
+ * hash of their name; a collision can only change the generation when it
+ * is not necessary. */
+errno_t sss_ncache_watch_user(struct sss_nc_ctx *ctx,
+                              struct sss_domain_info *dom, const char *name,
+                              unsigned long *_key);
+void sss_ncache_unwatch_user(struct sss_nc_ctx *ctx, unsigned long key);
+
 struct resp_ctx;
 
 /* Set up the negative cache with values from filter_users and
@@ -51,6 +51,20 @@ extern hash_table_t *dp_requests;
 #define NEED_CHECK_PROVIDER(provider) \
     (provider != NULL && strcmp(provider, "local") != 0)
 
+/* How a request was answered, for the latency statistics. The values are
+ * ordered by cost, a request keeps the most expensive one it was given.
+ * Only the NSS responder sets the outcome, requests of the other responders
+ * are accounted as SSS_CMD_OUTCOME_OTHER. */
+enum sss_cmd_outcome {
+    SSS_CMD_OUTCOME_OTHER = 0,
+    SSS_CMD_OUTCOME_NEGCACHE,
+    SSS_CMD_OUTCOME_CACHE_HIT,
+    SSS_CMD_OUTCOME_CACHE_MIDPOINT,
+    SSS_CMD_OUTCOME_DP,
+
+    SSS_CMD_OUTCOME_SENTINEL
+};
+
 /* needed until nsssrv.h is updated */
 struct cli_request {
 
@@ -59,6 +73,11 @@ struct cli_request {
 
     /* reply data */
     struct sss_packet *out;
+
+    /* latency statistics */
+    struct timeval start;
+    int cmd_idx;
+    enum sss_cmd_outcome outcome;
 };
 
 struct cli_protocol_version {
@@ -68,6 +87,7 @@ struct cli_protocol_version {
 };
 
 struct resp_ctx;
+struct rsp_latency;
 
 struct be_conn {
     struct be_conn *next;
@@ -98,6 +118,7 @@ struct resp_ctx {
     struct sss_domain_info *domains;
     int domains_timeout;
     int client_idle_timeout;
+    bool parallel_domain_lookups;
 
     struct sss_cmd_table *sss_cmds;
     const char *sss_pipe_name;
@@ -115,6 +136,8 @@ struct resp_ctx {
 
     uint32_t cache_req_num;
 
+    struct rsp_latency *latency;
+
     void *pvt_ctx;
 
     bool shutting_down;
@@ -203,6 +226,22 @@ int sss_cmd_execute(struct cli_ctx *cctx,
                     struct sss_cmd_table *sss_cmds);
 struct cli_protocol_version *register_cli_protocol_version(void);
 
+/* responder_latency.c */
+errno_t rsp_latency_init(struct resp_ctx *rctx, bool enabled);
+void rsp_latency_start(struct cli_ctx *cctx);
+void rsp_latency_set_outcome(struct cli_ctx *cctx,
+                             enum sss_cmd_outcome outcome);
+void rsp_latency_done(struct cli_ctx *cctx);
+/* Returns the count, mean, percentiles and maximum per command and outcome
+ * as a text table or ENOTSUP if the statistics are not collected. */
+errno_t rsp_latency_get_stats(TALLOC_CTX *mem_ctx,
+                              struct resp_ctx *rctx,
+                              char **_stats);
+
+/* exported for the tests */
+size_t rsp_latency_bucket(uint64_t usec);
+uint64_t rsp_latency_bucket_max(size_t bucket);
+
 struct setent_req_list;
 
 /* A facility for notifying setent requests */
@@ -234,6 +273,14 @@ void handle_requests_after_reconnect(struct resp_ctx *rctx);
 
 int responder_logrotate(struct sbus_request *dbus_req, void *data);
 
+/* Forgets the cache generations read from sysdb, so that the next cache
+ * lookups see the invalidations done by sss_cache. */
+void responder_reset_cache_generations(struct resp_ctx *rctx);
+
+int responder_clear_memcache(struct sbus_request *dbus_req, void *data);
+
+int responder_get_latency_stats(struct sbus_request *dbus_req, void *data);
+
 /* Each responder-specific request must create a constructor
  * function that creates a DBus Message that would be sent to
  * the back end
@@ -292,6 +339,7 @@ enum sss_dp_acct_type {
     SSS_DP_CERT,
     SSS_DP_WILDCARD_USER,
     SSS_DP_WILDCARD_GROUP,
+    SSS_DP_GROUP_NO_MEMBERS,
 };
 
 struct tevent_req *
@@ -355,6 +355,35 @@ cache_req_create(TALLOC_CTX *mem_ctx,
     return cr;
 }
 
+/* Create a copy of @cr that can be bound to a different domain. The input
+ * data are shared with @cr, which must outlive the copy. */
+static struct cache_req *
+cache_req_copy(TALLOC_CTX *mem_ctx, struct cache_req *cr)
+{
+    struct cache_req *copy;
+
+    copy = talloc_zero(mem_ctx, struct cache_req);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    copy->data = talloc_zero(copy, struct cache_req_data);
+    if (copy->data == NULL) {
+        talloc_free(copy);
+        return NULL;
+    }
+
+    *copy->data = *cr->data;
+    copy->data->name.lookup = NULL;
+
+    copy->dp_type = cr->dp_type;
+    copy->reqid = cr->reqid;
+    copy->reqname = cr->reqname;
+    copy->req_start = cr->req_start;
+
+    return copy;
+}
+
 static errno_t
 cache_req_set_name(struct cache_req *cr, const char *name)
 {
@@ -772,6 +801,27 @@ static bool cache_req_bypass_cache(struct cache_req *cr)
     return false;
 }
 
+static enum sysdb_cache_type cache_req_cache_type(struct cache_req *cr,
+                                                  struct ldb_message *msg)
+{
+    const char *oc;
+
+    switch (cr->data->type) {
+    case CACHE_REQ_GROUP_BY_NAME:
+    case CACHE_REQ_GROUP_BY_ID:
+    case CACHE_REQ_GROUP_BY_FILTER:
+        return SYSDB_CACHE_TYPE_GROUP;
+    case CACHE_REQ_OBJECT_BY_SID:
+        oc = ldb_msg_find_attr_as_string(msg, SYSDB_OBJECTCLASS, NULL);
+        if (oc != NULL && strcasecmp(oc, SYSDB_GROUP_CLASS) == 0) {
+            return SYSDB_CACHE_TYPE_GROUP;
+        }
+        return SYSDB_CACHE_TYPE_USER;
+    default:
+        return SYSDB_CACHE_TYPE_USER;
+    }
+}
+
 static errno_t cache_req_expiration_status(struct cache_req *cr,
                                            struct ldb_result *result,
                                            time_t cache_refresh_percent)
@@ -782,6 +832,12 @@ static errno_t cache_req_expiration_status(struct cache_req *cr,
         return ENOENT;
     }
 
+    if (sysdb_is_invalidated(cr->domain,
+                             cache_req_cache_type(cr, result->msgs[0]),
+                             result->msgs[0])) {
+        return ENOENT;
+    }
+
     if (cr->data->type == CACHE_REQ_INITGROUPS) {
         expire = ldb_msg_find_attr_as_uint64(result->msgs[0],
                                              SYSDB_INITGR_EXPIRE, 0);
@@ -1125,6 +1181,15 @@ static errno_t cache_req_cache_recv(TALLOC_CTX *mem_ctx,
 }
 
 
+struct cache_req_domain_lookup {
+    struct tevent_req *req;
+    struct tevent_req *subreq;
+    struct cache_req *cr;
+    struct ldb_result *result;
+    bool done;
+    bool found;
+};
+
 struct cache_req_state {
     /* input data */
     struct tevent_context *ev;
@@ -1139,6 +1204,10 @@ struct cache_req_state {
     struct sss_domain_info *domain;
     struct sss_domain_info *selected_domain;
     bool check_next;
+
+    /* parallel multi-domain search, ordered by domain precedence */
+    struct cache_req_domain_lookup *lookups;
+    size_t num_lookups;
 };
 
 static void cache_req_input_parsed(struct tevent_req *subreq);
@@ -1148,6 +1217,8 @@ static errno_t cache_req_select_domains(struct tevent_req *req,
 
 static errno_t cache_req_next_domain(struct tevent_req *req);
 
+static errno_t cache_req_parallel_domains(struct tevent_req *req);
+
 static void cache_req_done(struct tevent_req *subreq);
 
 struct tevent_req *cache_req_send(TALLOC_CTX *mem_ctx,
@@ -1288,11 +1359,36 @@ static errno_t cache_req_select_domains(struct tevent_req *req,
 
         state->domain = state->rctx->domains;
         state->check_next = true;
+
+        if (state->rctx->parallel_domain_lookups) {
+            return cache_req_parallel_domains(req);
+        }
     }
 
     return cache_req_next_domain(req);
 }
 
+static bool cache_req_skip_domain(struct cache_req *cr,
+                                  struct sss_domain_info *domain)
+{
+    /* If it is a domainless search, skip domains that require fully
+     * qualified names instead. */
+    return domain->fqnames
+           && cr->data->type != CACHE_REQ_USER_BY_CERT
+           && !cache_req_is_upn(cr);
+}
+
+static struct sss_domain_info *
+cache_req_get_next_domain(struct cache_req *cr,
+                          struct sss_domain_info *domain)
+{
+    if (cache_req_is_upn(cr) || cr->data->type == CACHE_REQ_USER_BY_CERT) {
+        return get_next_domain(domain, SSS_GND_DESCEND);
+    }
+
+    return get_next_domain(domain, 0);
+}
+
 static errno_t cache_req_next_domain(struct tevent_req *req)
 {
     struct cache_req_state *state = NULL;
@@ -1302,12 +1398,8 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
     state = tevent_req_data(req, struct cache_req_state);
 
     while (state->domain != NULL) {
-       /* If it is a domainless search, skip domains that require fully
-        * qualified names instead. */
         while (state->domain != NULL && state->check_next
-                && state->domain->fqnames
-                && state->cr->data->type != CACHE_REQ_USER_BY_CERT
-                && !cache_req_is_upn(state->cr)) {
+                && cache_req_skip_domain(state->cr, state->domain)) {
             state->domain = get_next_domain(state->domain, 0);
         }
 
@@ -1335,12 +1427,8 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
 
         /* we will continue with the following domain the next time */
         if (state->check_next) {
-            if (cache_req_is_upn(state->cr)
-                    || state->cr->data->type == CACHE_REQ_USER_BY_CERT ) {
-                state->domain = get_next_domain(state->domain, SSS_GND_DESCEND);
-            } else {
-                state->domain = get_next_domain(state->domain, 0);
-            }
+            state->domain = cache_req_get_next_domain(state->cr,
+                                                      state->domain);
         }
 
         return EAGAIN;
@@ -1355,6 +1443,161 @@ static errno_t cache_req_next_domain(struct tevent_req *req)
     return ENOENT;
 }
 
+static void cache_req_parallel_done(struct tevent_req *subreq);
+
+/* All domain caches are searched at once and the data provider is
+ * contacted concurrently for every domain that may still contain the
+ * object. Domains that follow the first one with a valid cache entry
+ * are not searched at all since they can never win. */
+static errno_t cache_req_parallel_domains(struct tevent_req *req)
+{
+    struct cache_req_state *state = NULL;
+    struct cache_req_domain_lookup *lookup;
+    struct sss_domain_info *domain;
+    enum tevent_req_state req_state;
+    uint64_t err;
+    size_t count;
+    errno_t ret;
+
+    state = tevent_req_data(req, struct cache_req_state);
+
+    CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr,
+                    "Searching all domains in parallel\n");
+
+    talloc_zfree(state->lookups);
+    state->num_lookups = 0;
+
+    count = 0;
+    for (domain = state->domain; domain != NULL;
+            domain = cache_req_get_next_domain(state->cr, domain)) {
+        count++;
+    }
+
+    if (count == 0) {
+        cache_req_add_to_ncache_global(state->cr, state->ncache);
+        return ENOENT;
+    }
+
+    state->lookups = talloc_zero_array(state, struct cache_req_domain_lookup,
+                                       count);
+    if (state->lookups == NULL) {
+        return ENOMEM;
+    }
+
+    for (domain = state->domain; domain != NULL;
+            domain = cache_req_get_next_domain(state->cr, domain)) {
+        if (cache_req_skip_domain(state->cr, domain)) {
+            continue;
+        }
+
+        lookup = &state->lookups[state->num_lookups];
+        lookup->req = req;
+
+        lookup->cr = cache_req_copy(state->lookups, state->cr);
+        if (lookup->cr == NULL) {
+            ret = ENOMEM;
+            goto fail;
+        }
+
+        ret = cache_req_set_domain(lookup->cr, domain, state->rctx);
+        if (ret != EOK) {
+            goto fail;
+        }
+
+        lookup->subreq = cache_req_cache_send(state->lookups, state->ev,
+                                              state->rctx, state->ncache,
+                                              state->neg_timeout,
+                                              state->cache_refresh_percent,
+                                              lookup->cr);
+        if (lookup->subreq == NULL) {
+            ret = ENOMEM;
+            goto fail;
+        }
+
+        tevent_req_set_callback(lookup->subreq, cache_req_parallel_done,
+                                lookup);
+        state->num_lookups++;
+
+        if (!tevent_req_is_error(lookup->subreq, &req_state, &err)) {
+            /* valid entry found in the cache */
+            break;
+        }
+    }
+
+    if (state->num_lookups == 0) {
+        talloc_zfree(state->lookups);
+        cache_req_add_to_ncache_global(state->cr, state->ncache);
+        return ENOENT;
+    }
+
+    return EAGAIN;
+
+fail:
+    /* releases also the requests that were already sent */
+    talloc_zfree(state->lookups);
+    state->num_lookups = 0;
+    return ret;
+}
+
+static void cache_req_parallel_done(struct tevent_req *subreq)
+{
+    struct cache_req_domain_lookup *lookup;
+    struct cache_req_state *state = NULL;
+    struct tevent_req *req = NULL;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    lookup = tevent_req_callback_data(subreq, struct cache_req_domain_lookup);
+    req = lookup->req;
+    state = tevent_req_data(req, struct cache_req_state);
+
+    ret = cache_req_cache_recv(state->lookups, subreq, &lookup->result);
+    talloc_zfree(subreq);
+    lookup->subreq = NULL;
+    lookup->done = true;
+    lookup->found = (ret == EOK);
+
+    /* The first domain in order that contains the object wins. */
+    for (i = 0; i < state->num_lookups; i++) {
+        lookup = &state->lookups[i];
+
+        if (!lookup->done) {
+            /* a domain with a higher priority is still being searched */
+            return;
+        }
+
+        if (lookup->found) {
+            break;
+        }
+    }
+
+    if (i == state->num_lookups) {
+        cache_req_add_to_ncache_global(state->cr, state->ncache);
+
+        CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Not found\n");
+        tevent_req_error(req, ENOENT);
+        return;
+    }
+
+    /* Domains with a lower priority do not matter anymore. */
+    for (j = i + 1; j < state->num_lookups; j++) {
+        talloc_zfree(state->lookups[j].subreq);
+    }
+
+    ret = cache_req_set_domain(state->cr, lookup->cr->domain, state->rctx);
+    if (ret != EOK) {
+        tevent_req_error(req, ret);
+        return;
+    }
+
+    state->selected_domain = lookup->cr->domain;
+    state->result = talloc_steal(state, lookup->result);
+
+    CACHE_REQ_DEBUG(SSSDBG_TRACE_FUNC, state->cr, "Finished: Success\n");
+    tevent_req_done(req);
+}
+
 static void cache_req_done(struct tevent_req *subreq)
 {
     struct cache_req_state *state = NULL;
@@ -258,6 +258,7 @@ static void client_send(struct cli_ctx *cctx)
     }
 
     /* ok all sent */
+    rsp_latency_done(cctx);
     TEVENT_FD_NOT_WRITEABLE(cctx->cfde);
     TEVENT_FD_READABLE(cctx->cfde);
     talloc_free(cctx->creq);
@@ -303,6 +304,7 @@ static void client_recv(struct cli_ctx *cctx)
     case EOK:
         /* do not read anymore */
         TEVENT_FD_NOT_READABLE(cctx->cfde);
+        rsp_latency_start(cctx);
         /* execute command */
         ret = client_cmd_execute(cctx, cctx->rctx->sss_cmds);
         if (ret != EOK) {
@@ -774,6 +776,7 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
 {
     struct resp_ctx *rctx;
     struct sss_domain_info *dom;
+    bool latency_stats;
     int ret;
     char *tmp = NULL;
 
@@ -810,6 +813,34 @@ int sss_process_init(TALLOC_CTX *mem_ctx,
         rctx->client_idle_timeout = 10;
     }
 
+    ret = confdb_get_bool(rctx->cdb, rctx->confdb_service_path,
+                          CONFDB_RESPONDER_PARALLEL_DOMAIN_LOOKUPS, false,
+                          &rctx->parallel_domain_lookups);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the parallel domain lookups option [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
+    ret = confdb_get_bool(rctx->cdb, rctx->confdb_service_path,
+                          CONFDB_RESPONDER_LATENCY_STATS, false,
+                          &latency_stats);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot get the latency statistics option [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
+    ret = rsp_latency_init(rctx, latency_stats);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE,
+              "Cannot set up the latency statistics [%d]: %s\n",
+               ret, strerror(ret));
+        goto fail;
+    }
+
     ret = confdb_get_int(rctx->cdb, rctx->confdb_service_path,
                          CONFDB_RESPONDER_GET_DOMAINS_TIMEOUT,
                          GET_DOMAINS_DEFAULT_TIMEOUT, &rctx->domains_timeout);
@@ -1030,6 +1061,47 @@ int responder_logrotate(struct sbus_request *dbus_req, void *data)
     return sbus_request_return_and_finish(dbus_req, DBUS_TYPE_INVALID);
 }
 
+void responder_reset_cache_generations(struct resp_ctx *rctx)
+{
+    struct sss_domain_info *dom;
+
+    for (dom = rctx->domains;
+         dom != NULL;
+         dom = get_next_domain(dom, SSS_GND_DESCEND)) {
+        sysdb_reset_cache_generations(dom);
+    }
+}
+
+int responder_clear_memcache(struct sbus_request *dbus_req, void *data)
+{
+    struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
+
+    responder_reset_cache_generations(rctx);
+
+    return sbus_request_return_and_finish(dbus_req, DBUS_TYPE_INVALID);
+}
+
+int responder_get_latency_stats(struct sbus_request *dbus_req, void *data)
+{
+    struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
+    DBusError *error;
+    char *stats;
+    errno_t ret;
+
+    ret = rsp_latency_get_stats(dbus_req, rctx, &stats);
+    if (ret == ENOTSUP) {
+        error = sbus_error_new(dbus_req, DBUS_ERROR_NOT_SUPPORTED,
+                               "Latency statistics are not enabled");
+        return sbus_request_fail_and_finish(dbus_req, error);
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    return sbus_request_return_and_finish(dbus_req,
+                                          DBUS_TYPE_STRING, &stats,
+                                          DBUS_TYPE_INVALID);
+}
+
 void responder_set_fd_limit(rlim_t fd_limit)
 {
     struct rlimit current_limit, new_limit;
@@ -44,12 +44,15 @@ struct sss_dp_req {
     DBusPendingCall *pending_reply;
 
     hash_key_t *key;
+    char *trace_id;
 
     struct sss_dp_callback *cb_list;
 
     dbus_uint16_t dp_err;
     dbus_uint32_t dp_ret;
     char *err_msg;
+
+    struct timeval issued;
 };
 
 static int sss_dp_callback_destructor(void *ptr)
@@ -517,12 +520,14 @@ error:
 static DBusMessage *
 sss_dp_get_account_msg(void *pvt)
 {
+    static uint32_t trace_counter = 0;
     DBusMessage *msg;
     dbus_bool_t dbret;
     struct sss_dp_account_info *info;
     uint32_t be_type;
     uint32_t attrs = BE_ATTR_CORE;
     char *filter;
+    char *trace_id;
 
     info = talloc_get_type(pvt, struct sss_dp_account_info);
 
@@ -535,6 +540,9 @@ sss_dp_get_account_msg(void *pvt)
         case SSS_DP_WILDCARD_GROUP:
             be_type = BE_REQ_GROUP;
             break;
+        case SSS_DP_GROUP_NO_MEMBERS:
+            be_type = BE_REQ_GROUP | BE_REQ_NO_MEMBERS;
+            break;
         case SSS_DP_INITGROUPS:
             be_type = BE_REQ_INITGROUPS;
             break;
@@ -608,6 +616,16 @@ sss_dp_get_account_msg(void *pvt)
         return NULL;
     }
 
+    /* The back end logs the phases of the request under this ID so that
+     * the lines can be matched with the ones of the responder. */
+    trace_id = talloc_asprintf(filter, "%d.%"PRIu32,
+                               (int) getpid(), ++trace_counter);
+    if (!trace_id) {
+        talloc_free(filter);
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory?!\n");
+        return NULL;
+    }
+
     msg = dbus_message_new_method_call(NULL,
                                        DP_PATH,
                                        DATA_PROVIDER_IFACE,
@@ -620,14 +638,16 @@ sss_dp_get_account_msg(void *pvt)
 
     /* create the message */
     DEBUG(SSSDBG_TRACE_FUNC,
-          "Creating request for [%s][%#x][%s][%d][%s]\n",
-           info->dom->name, be_type, be_req2str(be_type), attrs, filter);
+          "Creating request [%s] for [%s][%#x][%s][%d][%s]\n",
+           trace_id, info->dom->name, be_type, be_req2str(be_type), attrs,
+           filter);
 
     dbret = dbus_message_append_args(msg,
                                      DBUS_TYPE_UINT32, &be_type,
                                      DBUS_TYPE_UINT32, &attrs,
                                      DBUS_TYPE_STRING, &filter,
                                      DBUS_TYPE_STRING, &info->dom->name,
+                                     DBUS_TYPE_STRING, &trace_id,
                                      DBUS_TYPE_INVALID);
     talloc_free(filter);
     if (!dbret) {
@@ -659,6 +679,40 @@ struct dp_internal_get_state {
 
 static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr);
 
+/* Returns a copy of the trace ID carried by a getAccountInfo message or
+ * NULL if the message has none. */
+static char *
+sss_dp_msg_trace_id(TALLOC_CTX *mem_ctx, DBusMessage *msg)
+{
+    DBusError dbus_error;
+    dbus_uint32_t be_type;
+    dbus_uint32_t attrs;
+    const char *filter;
+    const char *domain;
+    const char *trace_id;
+    dbus_bool_t dbret;
+
+    if (!dbus_message_is_method_call(msg, DATA_PROVIDER_IFACE,
+                                     DATA_PROVIDER_IFACE_GETACCOUNTINFO)) {
+        return NULL;
+    }
+
+    dbus_error_init(&dbus_error);
+    dbret = dbus_message_get_args(msg, &dbus_error,
+                                  DBUS_TYPE_UINT32, &be_type,
+                                  DBUS_TYPE_UINT32, &attrs,
+                                  DBUS_TYPE_STRING, &filter,
+                                  DBUS_TYPE_STRING, &domain,
+                                  DBUS_TYPE_STRING, &trace_id,
+                                  DBUS_TYPE_INVALID);
+    if (!dbret) {
+        dbus_error_free(&dbus_error);
+        return NULL;
+    }
+
+    return talloc_strdup(mem_ctx, trace_id);
+}
+
 static struct tevent_req *
 sss_dp_internal_get_send(struct resp_ctx *rctx,
                          hash_key_t *key,
@@ -692,6 +746,7 @@ sss_dp_internal_get_send(struct resp_ctx *rctx,
     }
     state->sdp_req->rctx = rctx;
     state->sdp_req->ev = rctx->ev;
+    state->sdp_req->issued = tevent_timeval_current();
 
     /* Copy the key to use when calling the destructor
      * It needs to be a copy because the original request
@@ -699,6 +754,10 @@ sss_dp_internal_get_send(struct resp_ctx *rctx,
      */
     state->sdp_req->key = talloc_steal(state->sdp_req, key);
 
+    /* The message is released once it is sent, keep the trace ID so that
+     * the reply can be matched with the back end log. */
+    state->sdp_req->trace_id = sss_dp_msg_trace_id(state->sdp_req, msg);
+
     /* double check dp_ctx has actually been initialized.
      * in some pathological cases it may happen that nss starts up before
      * dp connection code is actually able to establish a connection.
@@ -760,6 +819,8 @@ static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
     struct sss_dp_callback *cb;
     struct dp_internal_get_state *state;
     struct sss_dp_req_state *cb_state;
+    struct timeval elapsed;
+    struct timeval now;
 
     req = talloc_get_type(ptr, struct tevent_req);
     state = tevent_req_data(req, struct dp_internal_get_state);
@@ -768,6 +829,13 @@ static void sss_dp_internal_get_done(DBusPendingCall *pending, void *ptr)
     /* prevent trying to cancel a reply that we already received */
     sdp_req->pending_reply = NULL;
 
+    now = tevent_timeval_current();
+    elapsed = tevent_timeval_until(&sdp_req->issued, &now);
+    DEBUG(SSSDBG_TRACE_FUNC,
+          "Data Provider request [%s] for [%s] took %ld.%06lds\n",
+          sdp_req->trace_id ? sdp_req->trace_id : "-", sdp_req->key->str,
+          (long) elapsed.tv_sec, (long) elapsed.tv_usec);
+
     ret = sss_dp_get_reply(pending,
                            &sdp_req->dp_err,
                            &sdp_req->dp_ret,
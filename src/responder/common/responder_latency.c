@@ -0,0 +1,291 @@
+/*
+    SSSD
+
+    Responder request latency statistics
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The time between reading a request from the client and sending the last
+ * byte of the reply is recorded per command and per outcome in log-linear
+ * histograms: the values below RSP_LATENCY_SUB_BUCKETS microseconds have a
+ * bucket each, every larger power of two is split into
+ * RSP_LATENCY_SUB_BUCKETS equal buckets. The relative error of a reported
+ * percentile is therefore at most 1 / RSP_LATENCY_SUB_BUCKETS.
+ *
+ * The responders reply with a summary of the histograms to the
+ * getLatencyStats method of their monitor interface.
+ */
+
+#include <time.h>
+#include <talloc.h>
+#include <tevent.h>
+
+#include "util/util.h"
+#include "util/sss_cli_cmd.h"
+#include "responder/common/responder.h"
+#include "responder/common/responder_packet.h"
+
+#define RSP_LATENCY_SUB_BITS 3
+#define RSP_LATENCY_SUB_BUCKETS (1 << RSP_LATENCY_SUB_BITS)
+/* latencies of more than 2^RSP_LATENCY_MAX_EXP us end in the last bucket */
+#define RSP_LATENCY_MAX_EXP 31
+#define RSP_LATENCY_BUCKETS \
+    ((RSP_LATENCY_MAX_EXP - RSP_LATENCY_SUB_BITS + 2) * RSP_LATENCY_SUB_BUCKETS)
+
+struct rsp_latency_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[RSP_LATENCY_BUCKETS];
+};
+
+struct rsp_latency {
+    struct resp_ctx *rctx;
+    time_t since;
+
+    /* indexed by the position of the command in rctx->sss_cmds */
+    size_t num_cmds;
+    struct rsp_latency_hist *(*hists)[SSS_CMD_OUTCOME_SENTINEL];
+};
+
+static const char *rsp_latency_outcome_names[SSS_CMD_OUTCOME_SENTINEL] = {
+    "other",
+    "negcache",
+    "cache_hit",
+    "midpoint",
+    "dp",
+};
+
+size_t rsp_latency_bucket(uint64_t usec)
+{
+    unsigned int exp;
+
+    if (usec < RSP_LATENCY_SUB_BUCKETS) {
+        return usec;
+    }
+
+    for (exp = RSP_LATENCY_SUB_BITS; exp < RSP_LATENCY_MAX_EXP
+            && (usec >> (exp + 1)) != 0; exp++);
+
+    if ((usec >> (exp + 1)) != 0) {
+        return RSP_LATENCY_BUCKETS - 1;
+    }
+
+    return (exp - RSP_LATENCY_SUB_BITS + 1) * RSP_LATENCY_SUB_BUCKETS
+           + ((usec >> (exp - RSP_LATENCY_SUB_BITS))
+              & (RSP_LATENCY_SUB_BUCKETS - 1));
+}
+
+uint64_t rsp_latency_bucket_max(size_t bucket)
+{
+    unsigned int exp;
+    uint64_t sub;
+
+    if (bucket < RSP_LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    exp = bucket / RSP_LATENCY_SUB_BUCKETS + RSP_LATENCY_SUB_BITS - 1;
+    sub = bucket % RSP_LATENCY_SUB_BUCKETS;
+
+    return ((RSP_LATENCY_SUB_BUCKETS + sub + 1)
+            << (exp - RSP_LATENCY_SUB_BITS)) - 1;
+}
+
+static uint64_t rsp_latency_percentile(struct rsp_latency_hist *hist,
+                                       unsigned int percent)
+{
+    uint64_t wanted;
+    uint64_t seen = 0;
+    size_t i;
+
+    wanted = (hist->count * percent + 99) / 100;
+    if (wanted == 0) {
+        wanted = 1;
+    }
+
+    for (i = 0; i < RSP_LATENCY_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+
+    /* the bucket bound may be above the largest value seen */
+    return MIN(rsp_latency_bucket_max(i), hist->max);
+}
+
+static int rsp_latency_cmd_idx(struct rsp_latency *lat,
+                               enum sss_cli_command cmd)
+{
+    size_t i;
+
+    for (i = 0; i < lat->num_cmds; i++) {
+        if (lat->rctx->sss_cmds[i].cmd == cmd) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+errno_t rsp_latency_init(struct resp_ctx *rctx, bool enabled)
+{
+    struct rsp_latency *lat;
+
+    if (!enabled) {
+        rctx->latency = NULL;
+        return EOK;
+    }
+
+    lat = talloc_zero(rctx, struct rsp_latency);
+    if (lat == NULL) {
+        return ENOMEM;
+    }
+
+    lat->rctx = rctx;
+    lat->since = time(NULL);
+
+    for (lat->num_cmds = 0;
+         rctx->sss_cmds[lat->num_cmds].cmd != SSS_CLI_NULL;
+         lat->num_cmds++);
+
+    lat->hists = talloc_zero_size(lat, lat->num_cmds
+                                       * sizeof(*lat->hists));
+    if (lat->hists == NULL && lat->num_cmds > 0) {
+        talloc_free(lat);
+        return ENOMEM;
+    }
+
+    DEBUG(SSSDBG_CONF_SETTINGS, "Collecting request latency statistics\n");
+
+    rctx->latency = lat;
+    return EOK;
+}
+
+errno_t rsp_latency_get_stats(TALLOC_CTX *mem_ctx,
+                              struct resp_ctx *rctx,
+                              char **_stats)
+{
+    struct rsp_latency *lat = rctx->latency;
+    struct rsp_latency_hist *hist;
+    char *stats;
+    size_t i;
+    int o;
+
+    if (lat == NULL) {
+        return ENOTSUP;
+    }
+
+    stats = talloc_asprintf(mem_ctx,
+                            "# Request latency in microseconds since %ld\n"
+                            "# %-30s %-10s %10s %10s %10s %10s %10s %10s\n",
+                            (long) lat->since, "command", "outcome",
+                            "count", "mean", "p50", "p90", "p99", "max");
+    if (stats == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < lat->num_cmds; i++) {
+        for (o = 0; o < SSS_CMD_OUTCOME_SENTINEL; o++) {
+            hist = lat->hists[i][o];
+            if (hist == NULL || hist->count == 0) {
+                continue;
+            }
+
+            stats = talloc_asprintf_append(stats,
+                    "%-32s %-10s %10"PRIu64" %10"PRIu64" %10"PRIu64
+                    " %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+                    sss_cmd2str(lat->rctx->sss_cmds[i].cmd),
+                    rsp_latency_outcome_names[o],
+                    hist->count, hist->sum / hist->count,
+                    rsp_latency_percentile(hist, 50),
+                    rsp_latency_percentile(hist, 90),
+                    rsp_latency_percentile(hist, 99),
+                    hist->max);
+            if (stats == NULL) {
+                return ENOMEM;
+            }
+        }
+    }
+
+    *_stats = stats;
+    return EOK;
+}
+
+void rsp_latency_start(struct cli_ctx *cctx)
+{
+    struct rsp_latency *lat = cctx->rctx->latency;
+    struct cli_request *creq = cctx->creq;
+
+    if (lat == NULL) {
+        return;
+    }
+
+    creq->start = tevent_timeval_current();
+    creq->cmd_idx = rsp_latency_cmd_idx(lat, sss_packet_get_cmd(creq->in));
+    creq->outcome = SSS_CMD_OUTCOME_OTHER;
+}
+
+void rsp_latency_set_outcome(struct cli_ctx *cctx,
+                             enum sss_cmd_outcome outcome)
+{
+    if (cctx->creq == NULL) {
+        return;
+    }
+
+    /* a request that visits several domains is accounted to the slowest
+     * path it took */
+    if (outcome > cctx->creq->outcome) {
+        cctx->creq->outcome = outcome;
+    }
+}
+
+void rsp_latency_done(struct cli_ctx *cctx)
+{
+    struct rsp_latency *lat = cctx->rctx->latency;
+    struct cli_request *creq = cctx->creq;
+    struct rsp_latency_hist *hist;
+    struct timeval elapsed;
+    struct timeval now;
+    uint64_t usec;
+
+    if (lat == NULL || creq == NULL || creq->cmd_idx < 0) {
+        return;
+    }
+
+    hist = lat->hists[creq->cmd_idx][creq->outcome];
+    if (hist == NULL) {
+        hist = talloc_zero(lat, struct rsp_latency_hist);
+        if (hist == NULL) {
+            return;
+        }
+        lat->hists[creq->cmd_idx][creq->outcome] = hist;
+    }
+
+    now = tevent_timeval_current();
+    elapsed = tevent_timeval_until(&creq->start, &now);
+    usec = elapsed.tv_sec * 1000000ULL + elapsed.tv_usec;
+
+    hist->count++;
+    hist->sum += usec;
+    if (usec > hist->max) {
+        hist->max = usec;
+    }
+    hist->buckets[rsp_latency_bucket(usec)]++;
+}
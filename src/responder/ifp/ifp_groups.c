@@ -413,6 +413,35 @@ done:
     return;
 }
 
+/* There is no configurable whitelist for groups. */
+static const char *ifp_groups_fetch_attrs[] = { SYSDB_NAME, SYSDB_GIDNUM,
+                                                NULL };
+
+int ifp_groups_fetch_by_name(struct sbus_request *sbus_req, void *data)
+{
+    struct ifp_ctx *ctx;
+
+    ctx = talloc_get_type(data, struct ifp_ctx);
+    if (ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid pointer!\n");
+        return ERR_INTERNAL;
+    }
+
+    return ifp_fetch_by_name(sbus_req, ctx,
+                             sysdb_enumgrent_filter_no_members_with_views,
+                             ifp_groups_fetch_attrs);
+}
+
+/* The group object looked up once per D-Bus request and shared by all
+ * property getters invoked for it, e.g. by GetAll. */
+struct ifp_groups_group_obj {
+    struct sss_domain_info *domain;
+    gid_t gid;
+    bool looked_up;
+    errno_t lookup_ret;
+    struct ldb_message *msg;
+};
+
 static errno_t
 ifp_groups_group_get(struct sbus_request *sbus_req,
                      void *data,
@@ -420,48 +449,70 @@ ifp_groups_group_get(struct sbus_request *sbus_req,
                      struct sss_domain_info **_domain,
                      struct ldb_message **_group)
 {
+    struct ifp_groups_group_obj *obj;
     struct ifp_ctx *ctx;
     struct sss_domain_info *domain;
     struct ldb_result *res;
     uid_t gid;
     errno_t ret;
 
-    ctx = talloc_get_type(data, struct ifp_ctx);
-    if (ctx == NULL) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid pointer!\n");
-        return ERR_INTERNAL;
-    }
+    obj = sbus_request_get_object_data(sbus_req, struct ifp_groups_group_obj);
+    if (obj == NULL) {
+        ctx = talloc_get_type(data, struct ifp_ctx);
+        if (ctx == NULL) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Invalid pointer!\n");
+            return ERR_INTERNAL;
+        }
 
-    ret = ifp_groups_decompose_path(ctx->rctx->domains, sbus_req->path,
-                                    &domain, &gid);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to decompose object path"
-              "[%s] [%d]: %s\n", sbus_req->path, ret, sss_strerror(ret));
-        return ret;
+        ret = ifp_groups_decompose_path(ctx->rctx->domains, sbus_req->path,
+                                        &domain, &gid);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to decompose object path"
+                  "[%s] [%d]: %s\n", sbus_req->path, ret, sss_strerror(ret));
+            return ret;
+        }
+
+        obj = talloc_zero(sbus_req, struct ifp_groups_group_obj);
+        if (obj == NULL) {
+            return ENOMEM;
+        }
+
+        obj->domain = domain;
+        obj->gid = gid;
+        sbus_request_set_object_data(sbus_req, obj);
     }
 
+    ret = EOK;
     if (_group != NULL) {
-        ret = sysdb_getgrgid_with_views(sbus_req, domain, gid, &res);
-        if (ret == EOK && res->count == 0) {
-            *_group = NULL;
-            ret = ENOENT;
-        }
+        if (!obj->looked_up) {
+            ret = sysdb_getgrgid_with_views(obj, obj->domain, obj->gid, &res);
+            if (ret == EOK && res->count == 0) {
+                ret = ENOENT;
+            }
 
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to lookup group %u@%s [%d]: %s\n",
-                  gid, domain->name, ret, sss_strerror(ret));
-        } else {
-            *_group = res->msgs[0];
+            if (ret != EOK) {
+                DEBUG(SSSDBG_CRIT_FAILURE, "Unable to lookup group %u@%s "
+                      "[%d]: %s\n", obj->gid, obj->domain->name,
+                      ret, sss_strerror(ret));
+            } else {
+                obj->msg = res->msgs[0];
+            }
+
+            obj->lookup_ret = ret;
+            obj->looked_up = true;
         }
+
+        ret = obj->lookup_ret;
+        *_group = ret == EOK ? obj->msg : NULL;
     }
 
     if (ret == EOK || ret == ENOENT) {
         if (_gid != NULL) {
-            *_gid = gid;
+            *_gid = obj->gid;
         }
 
         if (_domain != NULL) {
-            *_domain = domain;
+            *_domain = obj->domain;
         }
     }
 
@@ -561,6 +612,10 @@ static void resolv_ghosts_group_done(struct tevent_req *subreq)
     req = tevent_req_callback_data(subreq, struct tevent_req);
     state = tevent_req_data(req, struct resolv_ghosts_state);
 
+    /* the group was refreshed, do not use the object cached for this
+     * request */
+    sbus_request_set_object_data(state->sbus_req, NULL);
+
     ret = ifp_groups_group_get(state->sbus_req, state->data, NULL,
                                &state->domain, &group);
     if (ret != EOK) {
@@ -84,7 +84,8 @@ struct iface_ifp_users iface_ifp_users = {
     .FindByID = ifp_users_find_by_id,
     .FindByCertificate = ifp_users_find_by_cert,
     .ListByName = ifp_users_list_by_name,
-    .ListByDomainAndName = ifp_users_list_by_domain_and_name
+    .ListByDomainAndName = ifp_users_list_by_domain_and_name,
+    .FetchByName = ifp_users_fetch_by_name
 };
 
 struct iface_ifp_users_user iface_ifp_users_user = {
@@ -105,7 +106,8 @@ struct iface_ifp_groups iface_ifp_groups = {
     .FindByName = ifp_groups_find_by_name,
     .FindByID = ifp_groups_find_by_id,
     .ListByName = ifp_groups_list_by_name,
-    .ListByDomainAndName = ifp_groups_list_by_domain_and_name
+    .ListByDomainAndName = ifp_groups_list_by_domain_and_name,
+    .FetchByName = ifp_groups_fetch_by_name
 };
 
 struct iface_ifp_groups_group iface_ifp_groups_group = {
@@ -745,6 +745,24 @@ int iface_ifp_users_ListByDomainAndName_finish(struct sbus_request *req, const c
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.infopipe.Users.FetchByName */
+const struct sbus_arg_meta iface_ifp_users_FetchByName__in[] = {
+    { "name_filter", "s" },
+    { "attrs", "as" },
+    { "cookie_domain", "s" },
+    { "cookie_name", "s" },
+    { "limit", "u" },
+    { NULL, }
+};
+
+/* arguments for org.freedesktop.sssd.infopipe.Users.FetchByName */
+const struct sbus_arg_meta iface_ifp_users_FetchByName__out[] = {
+    { "result", "aa{sv}" },
+    { "next_domain", "s" },
+    { "next_name", "s" },
+    { NULL, }
+};
+
 /* methods for org.freedesktop.sssd.infopipe.Users */
 const struct sbus_method_meta iface_ifp_users__methods[] = {
     {
@@ -782,6 +800,13 @@ const struct sbus_method_meta iface_ifp_users__methods[] = {
         offsetof(struct iface_ifp_users, ListByDomainAndName),
         invoke_ssu_method,
     },
+    {
+        "FetchByName", /* name */
+        iface_ifp_users_FetchByName__in,
+        iface_ifp_users_FetchByName__out,
+        offsetof(struct iface_ifp_users, FetchByName),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -977,6 +1002,24 @@ int iface_ifp_groups_ListByDomainAndName_finish(struct sbus_request *req, const
                                          DBUS_TYPE_INVALID);
 }
 
+/* arguments for org.freedesktop.sssd.infopipe.Groups.FetchByName */
+const struct sbus_arg_meta iface_ifp_groups_FetchByName__in[] = {
+    { "name_filter", "s" },
+    { "attrs", "as" },
+    { "cookie_domain", "s" },
+    { "cookie_name", "s" },
+    { "limit", "u" },
+    { NULL, }
+};
+
+/* arguments for org.freedesktop.sssd.infopipe.Groups.FetchByName */
+const struct sbus_arg_meta iface_ifp_groups_FetchByName__out[] = {
+    { "result", "aa{sv}" },
+    { "next_domain", "s" },
+    { "next_name", "s" },
+    { NULL, }
+};
+
 /* methods for org.freedesktop.sssd.infopipe.Groups */
 const struct sbus_method_meta iface_ifp_groups__methods[] = {
     {
@@ -1007,6 +1050,13 @@ const struct sbus_method_meta iface_ifp_groups__methods[] = {
         offsetof(struct iface_ifp_groups, ListByDomainAndName),
         invoke_ssu_method,
     },
+    {
+        "FetchByName", /* name */
+        iface_ifp_groups_FetchByName__in,
+        iface_ifp_groups_FetchByName__out,
+        offsetof(struct iface_ifp_groups, FetchByName),
+        NULL, /* no invoker */
+    },
     { NULL, }
 };
 
@@ -71,6 +71,7 @@
 #define IFACE_IFP_USERS_FINDBYCERTIFICATE "FindByCertificate"
 #define IFACE_IFP_USERS_LISTBYNAME "ListByName"
 #define IFACE_IFP_USERS_LISTBYDOMAINANDNAME "ListByDomainAndName"
+#define IFACE_IFP_USERS_FETCHBYNAME "FetchByName"
 
 /* constants for org.freedesktop.sssd.infopipe.Users.User */
 #define IFACE_IFP_USERS_USER "org.freedesktop.sssd.infopipe.Users.User"
@@ -90,6 +91,7 @@
 #define IFACE_IFP_GROUPS_FINDBYID "FindByID"
 #define IFACE_IFP_GROUPS_LISTBYNAME "ListByName"
 #define IFACE_IFP_GROUPS_LISTBYDOMAINANDNAME "ListByDomainAndName"
+#define IFACE_IFP_GROUPS_FETCHBYNAME "FetchByName"
 
 /* constants for org.freedesktop.sssd.infopipe.Groups.Group */
 #define IFACE_IFP_GROUPS_GROUP "org.freedesktop.sssd.infopipe.Groups.Group"
@@ -239,6 +241,7 @@ struct iface_ifp_users {
     int (*FindByCertificate)(struct sbus_request *req, void *data, const char *arg_pem_cert);
     int (*ListByName)(struct sbus_request *req, void *data, const char *arg_name_filter, uint32_t arg_limit);
     int (*ListByDomainAndName)(struct sbus_request *req, void *data, const char *arg_domain_name, const char *arg_name_filter, uint32_t arg_limit);
+    sbus_msg_handler_fn FetchByName;
 };
 
 /* finish function for FindByName */
@@ -280,6 +283,7 @@ struct iface_ifp_groups {
     int (*FindByID)(struct sbus_request *req, void *data, uint32_t arg_id);
     int (*ListByName)(struct sbus_request *req, void *data, const char *arg_name_filter, uint32_t arg_limit);
     int (*ListByDomainAndName)(struct sbus_request *req, void *data, const char *arg_domain_name, const char *arg_name_filter, uint32_t arg_limit);
+    sbus_msg_handler_fn FetchByName;
 };
 
 /* finish function for FindByName */
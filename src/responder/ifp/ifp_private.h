@@ -106,4 +106,20 @@ struct ifp_list_ctx *ifp_list_ctx_new(struct sbus_request *sbus_req,
 size_t ifp_list_ctx_remaining_capacity(struct ifp_list_ctx *list_ctx,
                                        size_t entries);
 
+uint32_t ifp_list_limit(struct ifp_ctx *ctx, uint32_t limit);
+
+/* Used for fetch calls, e.g. sysdb_enumpwent_filter_with_views() */
+typedef int (*ifp_fetch_search_fn)(TALLOC_CTX *mem_ctx,
+                                   struct sss_domain_info *domain,
+                                   const char *name_filter,
+                                   const char *addtl_filter,
+                                   struct ldb_result **res);
+
+/* Handles the FetchByName methods: replies with the attributes listed in
+ * the request and allowed by whitelist of one page of cached objects. */
+int ifp_fetch_by_name(struct sbus_request *sbus_req,
+                      struct ifp_ctx *ctx,
+                      ifp_fetch_search_fn search_fn,
+                      const char **whitelist);
+
 #endif /* _IFPSRV_PRIVATE_H_ */
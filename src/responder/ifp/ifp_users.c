@@ -510,6 +510,30 @@ done:
     return;
 }
 
+int ifp_users_fetch_by_name(struct sbus_request *sbus_req, void *data)
+{
+    struct ifp_ctx *ctx;
+
+    ctx = talloc_get_type(data, struct ifp_ctx);
+    if (ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Invalid pointer!\n");
+        return ERR_INTERNAL;
+    }
+
+    return ifp_fetch_by_name(sbus_req, ctx, sysdb_enumpwent_filter_with_views,
+                             ctx->user_whitelist);
+}
+
+/* The user object looked up once per D-Bus request and shared by all
+ * property getters invoked for it, e.g. by GetAll. */
+struct ifp_users_user_obj {
+    struct sss_domain_info *domain;
+    uid_t uid;
+    bool looked_up;
+    errno_t lookup_ret;
+    struct ldb_message *msg;
+};
+
 static errno_t
 ifp_users_user_get(struct sbus_request *sbus_req,
                    struct ifp_ctx *ifp_ctx,
@@ -517,41 +541,63 @@ ifp_users_user_get(struct sbus_request *sbus_req,
                    struct sss_domain_info **_domain,
                    struct ldb_message **_user)
 {
+    struct ifp_users_user_obj *obj;
     struct sss_domain_info *domain;
     struct ldb_result *res;
     uid_t uid;
     errno_t ret;
 
-    ret = ifp_users_decompose_path(ifp_ctx->rctx->domains, sbus_req->path,
-                                   &domain, &uid);
-    if (ret != EOK) {
-        DEBUG(SSSDBG_CRIT_FAILURE, "Unable to decompose object path"
-              "[%s] [%d]: %s\n", sbus_req->path, ret, sss_strerror(ret));
-        return ret;
+    obj = sbus_request_get_object_data(sbus_req, struct ifp_users_user_obj);
+    if (obj == NULL) {
+        ret = ifp_users_decompose_path(ifp_ctx->rctx->domains, sbus_req->path,
+                                       &domain, &uid);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to decompose object path"
+                  "[%s] [%d]: %s\n", sbus_req->path, ret, sss_strerror(ret));
+            return ret;
+        }
+
+        obj = talloc_zero(sbus_req, struct ifp_users_user_obj);
+        if (obj == NULL) {
+            return ENOMEM;
+        }
+
+        obj->domain = domain;
+        obj->uid = uid;
+        sbus_request_set_object_data(sbus_req, obj);
     }
 
+    ret = EOK;
     if (_user != NULL) {
-        ret = sysdb_getpwuid_with_views(sbus_req, domain, uid, &res);
-        if (ret == EOK && res->count == 0) {
-            *_user = NULL;
-            ret = ENOENT;
+        if (!obj->looked_up) {
+            ret = sysdb_getpwuid_with_views(obj, obj->domain, obj->uid, &res);
+            if (ret == EOK && res->count == 0) {
+                ret = ENOENT;
+            }
+
+            if (ret != EOK) {
+                DEBUG(SSSDBG_CRIT_FAILURE, "Unable to lookup user %u@%s "
+                      "[%d]: %s\n", obj->uid, obj->domain->name,
+                      ret, sss_strerror(ret));
+            } else {
+                obj->msg = res->msgs[0];
+            }
+
+            obj->lookup_ret = ret;
+            obj->looked_up = true;
         }
 
-        if (ret != EOK) {
-            DEBUG(SSSDBG_CRIT_FAILURE, "Unable to lookup user %u@%s [%d]: %s\n",
-                  uid, domain->name, ret, sss_strerror(ret));
-        } else {
-            *_user = res->msgs[0];
-        }
+        ret = obj->lookup_ret;
+        *_user = ret == EOK ? obj->msg : NULL;
     }
 
     if (ret == EOK || ret == ENOENT) {
         if (_uid != NULL) {
-            *_uid = uid;
+            *_uid = obj->uid;
         }
 
         if (_domain != NULL) {
-            *_domain = domain;
+            *_domain = obj->domain;
         }
     }
 
@@ -55,7 +55,9 @@ struct mon_cli_iface monitor_ifp_methods = {
     .goOffline = NULL,
     .resetOffline = NULL,
     .rotateLogs = responder_logrotate,
+    .clearMemcache = responder_clear_memcache,
     .sysbusReconnect = ifp_sysbus_reconnect,
+    .getLatencyStats = responder_get_latency_stats,
 };
 
 static struct data_provider_iface ifp_dp_methods = {
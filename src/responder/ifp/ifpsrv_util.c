@@ -272,7 +272,7 @@ ifp_is_user_attr_allowed(struct ifp_ctx *ifp_ctx, const char *attr)
     return ifp_attr_allowed(ifp_ctx->user_whitelist, attr);
 }
 
-static uint32_t ifp_list_limit(struct ifp_ctx *ctx, uint32_t limit)
+uint32_t ifp_list_limit(struct ifp_ctx *ctx, uint32_t limit)
 {
     if (limit == 0) {
         return ctx->wildcard_limit;
@@ -323,3 +323,321 @@ size_t ifp_list_ctx_remaining_capacity(struct ifp_list_ctx *list_ctx,
         return entries;
     }
 }
+
+/* Entries are ordered by name with the comparison ldb uses for the name
+ * attribute so that the order agrees with the (name>=cookie) filter. */
+struct ifp_fetch_order {
+    struct ldb_context *ldb;
+    const struct ldb_schema_attribute *attr;
+};
+
+static int ifp_fetch_cmp_names(struct ifp_fetch_order *order,
+                               const char *name_a,
+                               const char *name_b)
+{
+    struct ldb_val val_a;
+    struct ldb_val val_b;
+
+    val_a.data = discard_const(name_a);
+    val_a.length = strlen(name_a);
+    val_b.data = discard_const(name_b);
+    val_b.length = strlen(name_b);
+
+    return order->attr->syntax->comparison_fn(order->ldb, order->ldb,
+                                              &val_a, &val_b);
+}
+
+static int ifp_fetch_cmp_by_name(void *a, void *b, void *opaque)
+{
+    struct ldb_message *msg_a = *(struct ldb_message **) a;
+    struct ldb_message *msg_b = *(struct ldb_message **) b;
+    struct ifp_fetch_order *order = opaque;
+
+    return ifp_fetch_cmp_names(order,
+                       ldb_msg_find_attr_as_string(msg_a, SYSDB_NAME, ""),
+                       ldb_msg_find_attr_as_string(msg_b, SYSDB_NAME, ""));
+}
+
+static errno_t ifp_fetch_add_record(struct ifp_ctx *ctx,
+                                    DBusMessageIter *iter_array,
+                                    struct sss_domain_info *domain,
+                                    struct ldb_message *msg,
+                                    const char **attrs)
+{
+    DBusMessageIter iter_dict;
+    struct ldb_message_element *el;
+    dbus_bool_t dbret;
+    unsigned int i;
+    char *value;
+    errno_t ret;
+    int ai;
+
+    dbret = dbus_message_iter_open_container(iter_array, DBUS_TYPE_ARRAY,
+                                      DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+                                      DBUS_TYPE_STRING_AS_STRING
+                                      DBUS_TYPE_VARIANT_AS_STRING
+                                      DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+                                      &iter_dict);
+    if (!dbret) {
+        return ENOMEM;
+    }
+
+    for (ai = 0; attrs[ai] != NULL; ai++) {
+        el = sss_view_ldb_msg_find_element(domain, msg, attrs[ai]);
+        if (el == NULL || el->num_values == 0) {
+            continue;
+        }
+
+        /* Normalize white space in names */
+        if (ctx->rctx->override_space != '\0'
+                && strcmp(attrs[ai], SYSDB_NAME) == 0) {
+            for (i = 0; i < el->num_values; i++) {
+                value = sss_replace_space(msg,
+                                          (const char *) el->values[i].data,
+                                          ctx->rctx->override_space);
+                if (value == NULL) {
+                    return ENOMEM;
+                }
+                el->values[i].data = (uint8_t *) value;
+            }
+        }
+
+        ret = ifp_add_ldb_el_to_dict(&iter_dict, el);
+        if (ret != EOK) {
+            return ret;
+        }
+    }
+
+    dbret = dbus_message_iter_close_container(iter_array, &iter_dict);
+    if (!dbret) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+int ifp_fetch_by_name(struct sbus_request *sbus_req,
+                      struct ifp_ctx *ctx,
+                      ifp_fetch_search_fn search_fn,
+                      const char **whitelist)
+{
+    TALLOC_CTX *tmp_ctx;
+    DBusError *error;
+    DBusMessage *reply = NULL;
+    DBusMessageIter iter;
+    DBusMessageIter iter_array;
+    struct sss_domain_info *dom;
+    struct sss_domain_info *start_dom;
+    struct ldb_result *res;
+    struct ifp_fetch_order order;
+    const char *name_filter;
+    const char *cookie_domain;
+    const char *cookie_name;
+    const char *cookie_filter;
+    char *sanitized;
+    const char *next_domain = "";
+    const char *next_name = "";
+    const char *name;
+    const char **attrs;
+    char **req_attrs;
+    int num_req_attrs;
+    uint32_t limit;
+    uint32_t count;
+    dbus_bool_t dbret;
+    size_t i;
+    int ri;
+    int ai;
+    int ret;
+
+    if (!sbus_request_parse_or_finish(sbus_req,
+                                      DBUS_TYPE_STRING, &name_filter,
+                                      DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                                      &req_attrs, &num_req_attrs,
+                                      DBUS_TYPE_STRING, &cookie_domain,
+                                      DBUS_TYPE_STRING, &cookie_name,
+                                      DBUS_TYPE_UINT32, &limit,
+                                      DBUS_TYPE_INVALID)) {
+        /* request was handled */
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(sbus_req);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    attrs = talloc_zero_array(tmp_ctx, const char *, num_req_attrs + 1);
+    if (attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (ri = 0, ai = 0; ri < num_req_attrs; ri++) {
+        if (!ifp_attr_allowed(whitelist, req_attrs[ri])) {
+            DEBUG(SSSDBG_MINOR_FAILURE,
+                  "Attribute %s not present in the whitelist, skipping\n",
+                  req_attrs[ri]);
+            continue;
+        }
+
+        attrs[ai] = talloc_strdup(attrs, req_attrs[ri]);
+        if (attrs[ai] == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+        ai++;
+    }
+
+    limit = ifp_list_limit(ctx, limit);
+
+    /* The cookie is the domain and the name of the last entry returned,
+     * entries are ordered by domain and name. Unlike a position it stays
+     * valid when entries are added to or removed from the cache between
+     * two pages. */
+    if (cookie_domain[0] == '\0') {
+        start_dom = ctx->rctx->domains;
+        cookie_name = NULL;
+    } else {
+        start_dom = find_domain_by_name(ctx->rctx->domains, cookie_domain,
+                                        true);
+        if (start_dom == NULL) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unknown domain [%s] in cookie\n",
+                  cookie_domain);
+            ret = ERR_DOMAIN_NOT_FOUND;
+            goto done;
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Fetching [%s] after [%s/%s], limit %"PRIu32
+          "\n", name_filter, cookie_domain,
+          cookie_name == NULL ? "" : cookie_name, limit);
+
+    reply = dbus_message_new_method_return(sbus_req->message);
+    if (reply == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    dbus_message_iter_init_append(reply, &iter);
+    dbret = dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+                                      DBUS_TYPE_ARRAY_AS_STRING
+                                      DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+                                      DBUS_TYPE_STRING_AS_STRING
+                                      DBUS_TYPE_VARIANT_AS_STRING
+                                      DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+                                      &iter_array);
+    if (!dbret) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    count = 0;
+    for (dom = start_dom;
+         dom != NULL;
+         dom = get_next_domain(dom, SSS_GND_DESCEND)) {
+        /* only the entries after the cookie are read from the cache */
+        cookie_filter = NULL;
+        if (cookie_name != NULL) {
+            ret = sss_filter_sanitize(tmp_ctx, cookie_name, &sanitized);
+            if (ret != EOK) {
+                goto done;
+            }
+
+            cookie_filter = talloc_asprintf(tmp_ctx, "(%s>=%s)",
+                                            SYSDB_NAME, sanitized);
+            if (cookie_filter == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+        }
+
+        ret = search_fn(tmp_ctx, dom, name_filter, cookie_filter, &res);
+        if (ret == ENOENT) {
+            cookie_name = NULL;
+            continue;
+        } else if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to search domain %s [%d]: %s\n",
+                  dom->name, ret, sss_strerror(ret));
+            goto done;
+        }
+
+        order.ldb = sysdb_ctx_get_ldb(dom->sysdb);
+        order.attr = ldb_schema_attribute_by_name(order.ldb, SYSDB_NAME);
+        ldb_qsort(res->msgs, res->count, sizeof(struct ldb_message *),
+                  &order, ifp_fetch_cmp_by_name);
+
+        for (i = 0; i < res->count; i++) {
+            if (limit != 0 && count == limit) {
+                break;
+            }
+
+            name = ldb_msg_find_attr_as_string(res->msgs[i], SYSDB_NAME, "");
+            if (cookie_name != NULL
+                    && ifp_fetch_cmp_names(&order, name, cookie_name) <= 0) {
+                /* the cookie itself */
+                continue;
+            }
+
+            /* The record may normalize the name in place */
+            next_name = talloc_strdup(tmp_ctx, name);
+            if (next_name == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+
+            ret = ifp_fetch_add_record(ctx, &iter_array, dom,
+                                       res->msgs[i], attrs);
+            if (ret != EOK) {
+                DEBUG(SSSDBG_OP_FAILURE, "Unable to add entry to the reply "
+                      "[%d]: %s\n", ret, sss_strerror(ret));
+                goto done;
+            }
+            count++;
+        }
+        cookie_name = NULL;
+        talloc_free(res);
+
+        if (limit != 0 && count == limit) {
+            /* the next page may turn out empty */
+            next_domain = dom->name;
+            break;
+        }
+    }
+
+    if (next_domain[0] == '\0') {
+        next_name = "";
+    }
+
+    dbret = dbus_message_iter_close_container(&iter, &iter_array);
+    if (!dbret) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    dbret = dbus_message_append_args(reply,
+                                     DBUS_TYPE_STRING, &next_domain,
+                                     DBUS_TYPE_STRING, &next_name,
+                                     DBUS_TYPE_INVALID);
+    if (!dbret) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    if (ret != EOK) {
+        if (reply != NULL) {
+            dbus_message_unref(reply);
+        }
+        error = sbus_error_new(sbus_req, DBUS_ERROR_FAILED,
+                               "Failed to fetch objects [%d]: %s\n",
+                               ret, sss_strerror(ret));
+        return sbus_request_fail_and_finish(sbus_req, error);
+    }
+
+    ret = sbus_request_finish(sbus_req, reply);
+    dbus_message_unref(reply);
+    return ret;
+}
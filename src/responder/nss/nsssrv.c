@@ -69,6 +69,7 @@ struct mon_cli_iface monitor_nss_methods = {
     .clearMemcache = nss_clear_memcache,
     .clearEnumCache = nss_clear_netgroup_hash_table,
     .sysbusReconnect = NULL,
+    .getLatencyStats = responder_get_latency_stats,
 };
 
 static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
@@ -78,6 +79,9 @@ static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
     struct resp_ctx *rctx = talloc_get_type(data, struct resp_ctx);
     struct nss_ctx *nctx = (struct nss_ctx*) rctx->pvt_ctx;
 
+    /* sss_cache may have started new cache generations */
+    responder_reset_cache_generations(rctx);
+
     ret = unlink(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG);
     if (ret != 0) {
         ret = errno;
@@ -133,6 +137,15 @@ static int nss_clear_memcache(struct sbus_request *dbus_req, void *data)
         return ret;
     }
 
+    ret = sss_mmap_cache_reinit(nctx, SSS_MC_CACHE_ELEMENTS,
+                                (time_t)memcache_timeout,
+                                &nctx->svc_mc_ctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "services mmap cache invalidation failed\n");
+        return ret;
+    }
+
 done:
     return sbus_request_return_and_finish(dbus_req, DBUS_TYPE_INVALID);
 }
@@ -490,6 +503,13 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
         goto fail;
     }
 
+    ret = nss_grent_memo_init(nctx);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_FATAL_FAILURE,
+              "Unable to initialize the group record table\n");
+        goto fail;
+    }
+
     /* create mmap caches */
     /* Remove the CLEAR_MC_FLAG file if exists. */
     ret = unlink(SSS_NSS_MCACHE_DIR"/"CLEAR_MC_FLAG);
@@ -533,6 +553,13 @@ int nss_process_init(TALLOC_CTX *mem_ctx,
         DEBUG(SSSDBG_CRIT_FAILURE, "inigroups mmap cache is DISABLED\n");
     }
 
+    ret = sss_mmap_cache_init(nctx, "services", SSS_MC_SERVICES,
+                              SSS_MC_CACHE_ELEMENTS, (time_t)memcache_timeout,
+                              &nctx->svc_mc_ctx);
+    if (ret) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "services mmap cache is DISABLED\n");
+    }
+
     /* Set up file descriptor limits */
     ret = confdb_get_int(nctx->rctx->cdb,
                          CONFDB_NSS_CONF_ENTRY,
@@ -55,6 +55,8 @@ struct nss_ctx {
     struct getent_ctx *gctx;
     struct getent_ctx *svcctx;
     hash_table_t *netgroups;
+    /* serialized records of large groups, see fill_grent() */
+    hash_table_t *grent_memo;
 
     bool filter_users_in_groups;
 
@@ -73,6 +75,7 @@ struct nss_ctx {
     struct sss_mc_ctx *pwd_mc_ctx;
     struct sss_mc_ctx *grp_mc_ctx;
     struct sss_mc_ctx *initgr_mc_ctx;
+    struct sss_mc_ctx *svc_mc_ctx;
 
     struct sss_idmap_ctx *idmap_ctx;
     struct sss_names_ctx *global_names;
@@ -22,6 +22,7 @@
 #include "util/util.h"
 #include "util/sss_nss.h"
 #include "util/sss_cli_cmd.h"
+#include "util/murmurhash3.h"
 #include "responder/nss/nsssrv.h"
 #include "responder/nss/nsssrv_private.h"
 #include "responder/nss/nsssrv_netgroup.h"
@@ -327,6 +328,25 @@ static const char *get_shell_override(TALLOC_CTX *mem_ctx,
     return talloc_strdup(mem_ctx, NOLOGIN_SHELL);
 }
 
+/* Uses the lower-case alias stored with the cached entry so that the name
+ * is not case-folded again for every reply */
+static const char *nss_get_cased_name(TALLOC_CTX *mem_ctx,
+                                      struct sss_domain_info *dom,
+                                      struct ldb_message *msg,
+                                      const char *orig_name)
+{
+    const char *lc_name;
+
+    if (!dom->case_preserve) {
+        lc_name = sysdb_msg_get_lc_name_alias(msg, orig_name);
+        if (lc_name != NULL) {
+            return lc_name;
+        }
+    }
+
+    return sss_get_cased_name(mem_ctx, orig_name, dom->case_preserve);
+}
+
 static int fill_pwent(struct sss_packet *packet,
                       struct sss_domain_info *dom,
                       struct nss_ctx *nctx,
@@ -426,7 +446,7 @@ static int fill_pwent(struct sss_packet *packet,
             packet_initialized = true;
         }
 
-        tmpstr = sss_get_cased_name(tmp_ctx, orig_name, dom->case_preserve);
+        tmpstr = nss_get_cased_name(tmp_ctx, dom, msg, orig_name);
         if (tmpstr == NULL) {
             DEBUG(SSSDBG_CRIT_FAILURE,
                   "sss_get_cased_name failed, skipping\n");
@@ -645,6 +665,7 @@ static void get_dp_name_and_id(TALLOC_CTX *mem_ctx,
             }
             break;
         case SSS_DP_GROUP:
+        case SSS_DP_GROUP_NO_MEMBERS:
             ret = sysdb_getgrnam_with_views(tmp_ctx, dom, opt_name, &res);
             if (ret != EOK) {
                 DEBUG(SSSDBG_CONF_SETTINGS,
@@ -685,6 +706,7 @@ static void get_dp_name_and_id(TALLOC_CTX *mem_ctx,
             attr = SYSDB_UIDNUM;
             break;
         case SSS_DP_GROUP:
+        case SSS_DP_GROUP_NO_MEMBERS:
             ret = sysdb_getgrgid_with_views(tmp_ctx, dom, opt_id, &res);
             if (ret != EOK) {
                 DEBUG(SSSDBG_CONF_SETTINGS,
@@ -719,7 +741,51 @@ done:
     talloc_free(tmp_ctx);
 }
 
+static bool nss_cache_is_invalidated(struct sss_domain_info *domain,
+                                     enum sss_dp_acct_type req_type,
+                                     struct ldb_message *msg)
+{
+    enum sysdb_cache_type type;
+
+    switch (req_type) {
+    case SSS_DP_USER:
+    case SSS_DP_INITGROUPS:
+        type = SYSDB_CACHE_TYPE_USER;
+        break;
+    case SSS_DP_GROUP:
+    case SSS_DP_GROUP_NO_MEMBERS:
+        type = SYSDB_CACHE_TYPE_GROUP;
+        break;
+    case SSS_DP_NETGR:
+        type = SYSDB_CACHE_TYPE_NETGROUP;
+        break;
+    default:
+        return false;
+    }
+
+    return sysdb_is_invalidated(domain, type, msg);
+}
+
 /* FIXME: do not check res->count, but get in a msgs and check in parent */
+/* Groups added without their members by sysdb_add_incomplete_group() are
+ * stored expired by one second. A group whose expiration was lowered later,
+ * e.g. by sss_cache, is not considered. */
+static bool nss_group_stored_without_members(struct ldb_message *msg,
+                                             uint64_t cache_expire)
+{
+    uint64_t last_update;
+
+    if (ldb_msg_find_element(msg, SYSDB_MEMBER) != NULL
+            || ldb_msg_find_element(msg, SYSDB_MEMBERUID) != NULL
+            || ldb_msg_find_element(msg, SYSDB_GHOST) != NULL) {
+        return false;
+    }
+
+    last_update = ldb_msg_find_attr_as_uint64(msg, SYSDB_LAST_UPDATE, 0);
+
+    return last_update != 0 && cache_expire + 1 == last_update;
+}
+
 errno_t check_cache(struct nss_dom_ctx *dctx,
                     struct nss_ctx *nctx,
                     struct ldb_result *res,
@@ -769,6 +835,21 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
                                                       0);
         }
 
+        if (req_type == SSS_DP_GROUP_NO_MEMBERS
+                && nss_group_stored_without_members(res->msgs[0],
+                                                    cacheExpire)) {
+            /* A group stored without its members is already expired for
+             * the lookups that return them, but its name and GID are as
+             * fresh as those of a complete group. */
+            cacheExpire = ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                      SYSDB_LAST_UPDATE, 0)
+                              + dctx->domain->group_timeout;
+        }
+
+        if (nss_cache_is_invalidated(dctx->domain, req_type, res->msgs[0])) {
+            cacheExpire = 0;
+        }
+
         /* Check if background refresh is enabled for this entry */
         refreshed_on_bg = is_refreshed_on_bg(req_type, bg_refresh_interval);
 
@@ -778,6 +859,7 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
                                   cacheExpire);
         if (ret == EOK || (ret == EAGAIN && refreshed_on_bg))  {
             DEBUG(SSSDBG_TRACE_FUNC, "Cached entry is valid, returning..\n");
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_CACHE_HIT);
             return EOK;
         } else if (ret != EAGAIN && ret != ENOENT) {
             DEBUG(SSSDBG_CRIT_FAILURE, "Error checking cache: %d\n", ret);
@@ -788,6 +870,12 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
         ret = ENOENT;
     }
 
+    /* The back end only adds groups without members if they are not cached
+     * at all, a cached group must be refreshed completely. */
+    if (res->count > 0 && req_type == SSS_DP_GROUP_NO_MEMBERS) {
+        req_type = SSS_DP_GROUP;
+    }
+
     /* EAGAIN (off band) or ENOENT (cache miss) -> check cache */
     if (ret == EAGAIN) {
         /* No callback required
@@ -797,6 +885,7 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
          */
         DEBUG(SSSDBG_TRACE_FUNC,
              "Performing midpoint cache update on [%s]\n", name);
+        rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_CACHE_MIDPOINT);
 
         req = sss_dp_get_account_send(cctx, cctx->rctx, dctx->domain, true,
                                       req_type, name, id, extra);
@@ -848,6 +937,7 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
         cb_ctx->mem_ctx = dctx;
 
         tevent_req_set_callback(req, nsssrv_dp_send_acct_req_done, cb_ctx);
+        rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_DP);
 
         return EAGAIN;
     }
@@ -1017,6 +1107,7 @@ static int nss_cmd_getpwnam_search(struct nss_dom_ctx *dctx)
             DEBUG(SSSDBG_TRACE_FUNC,
                   "User [%s] does not exist in [%s]! (negative cache)\n",
                    name, dom->name);
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_NEGCACHE);
             /* if a multidomain search, try with next */
             if (cmdctx->check_next) {
                 if (cmdctx->name_is_upn) {
@@ -1482,6 +1573,7 @@ static int nss_cmd_getbynam(enum sss_cli_command cmd, struct cli_ctx *cctx)
     switch(cmd) {
     case SSS_NSS_GETPWNAM:
     case SSS_NSS_GETGRNAM:
+    case SSS_NSS_GETGRNAM_NOMEM:
     case SSS_NSS_INITGR:
     case SSS_NSS_GETSIDBYNAME:
     case SSS_NSS_GETORIGBYNAME:
@@ -1498,6 +1590,11 @@ static int nss_cmd_getbynam(enum sss_cli_command cmd, struct cli_ctx *cctx)
     }
     cmdctx->cctx = cctx;
     cmdctx->cmd = cmd;
+    if (cmd == SSS_NSS_GETGRNAM_NOMEM) {
+        /* same lookup, only the reply differs */
+        cmdctx->cmd = SSS_NSS_GETGRNAM;
+        cmdctx->no_members = true;
+    }
 
     dctx = talloc_zero(cmdctx, struct nss_dom_ctx);
     if (!dctx) {
@@ -1912,6 +2009,7 @@ static int nss_cmd_getbyid(enum sss_cli_command cmd, struct cli_ctx *cctx)
     switch (cmd) {
     case SSS_NSS_GETPWUID:
     case SSS_NSS_GETGRGID:
+    case SSS_NSS_GETGRGID_NOMEM:
     case SSS_NSS_GETSIDBYID:
         break;
     default:
@@ -1928,6 +2026,11 @@ static int nss_cmd_getbyid(enum sss_cli_command cmd, struct cli_ctx *cctx)
     }
     cmdctx->cctx = cctx;
     cmdctx->cmd = cmd;
+    if (cmd == SSS_NSS_GETGRGID_NOMEM) {
+        /* same lookup, only the reply differs */
+        cmdctx->cmd = SSS_NSS_GETGRGID;
+        cmdctx->no_members = true;
+    }
 
     dctx = talloc_zero(cmdctx, struct nss_dom_ctx);
     if (!dctx) {
@@ -1956,6 +2059,7 @@ static int nss_cmd_getbyid(enum sss_cli_command cmd, struct cli_ctx *cctx)
             DEBUG(SSSDBG_TRACE_FUNC,
                   "Uid [%"PRIu32"] does not exist! (negative cache)\n",
                    cmdctx->id);
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_NEGCACHE);
             ret = ENOENT;
             goto done;
         }
@@ -1967,6 +2071,7 @@ static int nss_cmd_getbyid(enum sss_cli_command cmd, struct cli_ctx *cctx)
             DEBUG(SSSDBG_TRACE_FUNC,
                   "Gid [%"PRIu32"] does not exist! (negative cache)\n",
                    cmdctx->id);
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_NEGCACHE);
             ret = ENOENT;
             goto done;
         }
@@ -1982,6 +2087,7 @@ static int nss_cmd_getbyid(enum sss_cli_command cmd, struct cli_ctx *cctx)
             DEBUG(SSSDBG_TRACE_FUNC,
                   "Id [%"PRIu32"] does not exist! (negative cache)\n",
                    cmdctx->id);
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_NEGCACHE);
             ret = ENOENT;
             goto done;
         }
@@ -2902,15 +3008,317 @@ done:
     return ret;
 }
 
+/* The records of large groups are kept after they were built so that a
+ * getgrnam or getgrgid which misses the memory cache does not have to
+ * process every member again. A record is reused as long as the name, GID
+ * and member values it was built from have the same fingerprint and, if
+ * members are filtered with the negative cache, none of the members was
+ * added to the negative cache since. The members of a kept record are
+ * watched in the negative cache so that adding other users does not
+ * outdate it. Records of groups where a member was skipped are not kept. */
+#define NSS_GRENT_MEMO_MIN_MEMBERS 1000
+#define NSS_GRENT_MEMO_MAX_ENTRIES 64
+
+struct nss_grent_memo {
+    uint64_t fingerprint;
+    uint64_t ncache_gen;
+    time_t last_used;
+    int memnum;
+    size_t len;
+    uint8_t *record;
+    unsigned long *watched;
+    size_t num_watched;
+};
+
+static void nss_grent_memo_unwatch(struct nss_ctx *nctx,
+                                   struct nss_grent_memo *memo)
+{
+    size_t i;
+
+    for (i = 0; i < memo->num_watched; i++) {
+        sss_ncache_unwatch_user(nctx->ncache, memo->watched[i]);
+    }
+    memo->num_watched = 0;
+}
+
+static void nss_grent_memo_delete_cb(hash_entry_t *item,
+                                     hash_destroy_enum deltype, void *pvt)
+{
+    struct nss_ctx *nctx = talloc_get_type(pvt, struct nss_ctx);
+    struct nss_grent_memo *memo;
+
+    /* When the whole table is destroyed the negative cache may already be
+     * gone, the records are freed together with the table then. */
+    if (deltype != HASH_ENTRY_DESTROY) {
+        return;
+    }
+
+    memo = talloc_get_type(item->value.ptr, struct nss_grent_memo);
+    if (memo != NULL && nctx != NULL) {
+        nss_grent_memo_unwatch(nctx, memo);
+    }
+
+    talloc_free(item->value.ptr);
+}
+
+errno_t nss_grent_memo_init(struct nss_ctx *nctx)
+{
+    return sss_hash_create_ex(nctx, NSS_GRENT_MEMO_MAX_ENTRIES,
+                              &nctx->grent_memo, 0, 0, 0, 0,
+                              nss_grent_memo_delete_cb, nctx);
+}
+
+static void nss_grent_fingerprint_el(struct ldb_message_element *el,
+                                     uint32_t *h1, uint32_t *h2)
+{
+    uint32_t num = (el != NULL) ? el->num_values : 0;
+    unsigned int i;
+
+    *h1 = murmurhash3((const char *) &num, sizeof(num), *h1);
+    *h2 = murmurhash3((const char *) &num, sizeof(num), *h2);
+
+    for (i = 0; i < num; i++) {
+        *h1 = murmurhash3((const char *) el->values[i].data,
+                          el->values[i].length, *h1);
+        *h2 = murmurhash3((const char *) el->values[i].data,
+                          el->values[i].length, *h2);
+    }
+}
+
+static uint64_t nss_grent_fingerprint(const char *name, uint32_t gid,
+                                      bool add_domain,
+                                      struct ldb_message_element *memberuid,
+                                      struct ldb_message_element *ghost)
+{
+    uint32_t h1 = gid;
+    uint32_t h2 = ~gid ^ add_domain;
+
+    h1 = murmurhash3(name, strlen(name), h1);
+    h2 = murmurhash3(name, strlen(name), h2);
+    nss_grent_fingerprint_el(memberuid, &h1, &h2);
+    nss_grent_fingerprint_el(ghost, &h1, &h2);
+
+    return ((uint64_t) h1 << 32) | h2;
+}
+
+static struct nss_grent_memo *
+nss_grent_memo_get(struct nss_ctx *nctx, struct ldb_message *msg,
+                   uint64_t fingerprint)
+{
+    struct nss_grent_memo *memo;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    if (nctx->grent_memo == NULL) {
+        return NULL;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_linearized(msg->dn));
+    if (key.str == NULL) {
+        return NULL;
+    }
+
+    hret = hash_lookup(nctx->grent_memo, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return NULL;
+    }
+
+    memo = talloc_get_type(value.ptr, struct nss_grent_memo);
+    if (memo == NULL
+            || memo->fingerprint != fingerprint
+            || (nctx->filter_users_in_groups
+                && memo->ncache_gen != sss_ncache_user_generation(
+                                                            nctx->ncache))) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Kept record of group [%s] is outdated\n", key.str);
+        hash_delete(nctx->grent_memo, &key);
+        return NULL;
+    }
+
+    memo->last_used = time(NULL);
+    return memo;
+}
+
+static void nss_grent_memo_evict(struct nss_ctx *nctx)
+{
+    struct nss_grent_memo *memo;
+    hash_entry_t *entries;
+    unsigned long count;
+    unsigned long oldest = 0;
+    time_t oldest_used = 0;
+    hash_key_t key;
+    unsigned long i;
+    int hret;
+
+    hret = hash_entries(nctx->grent_memo, &count, &entries);
+    if (hret != HASH_SUCCESS || count == 0) {
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        memo = talloc_get_type(entries[i].value.ptr, struct nss_grent_memo);
+        if (memo != NULL && (i == 0 || memo->last_used < oldest_used)) {
+            oldest = i;
+            oldest_used = memo->last_used;
+        }
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = talloc_strdup(entries, entries[oldest].key.str);
+    if (key.str != NULL) {
+        hash_delete(nctx->grent_memo, &key);
+    }
+
+    talloc_free(entries);
+}
+
+/* Watches the members of the record the same way fill_members() checks
+ * them in the negative cache */
+static errno_t nss_grent_memo_watch(struct nss_ctx *nctx,
+                                    struct sss_domain_info *dom,
+                                    struct nss_grent_memo *memo,
+                                    struct ldb_message_element *el)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *tmpstr;
+    unsigned int i;
+    errno_t ret;
+
+    if (el == NULL) {
+        return EOK;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < el->num_values; i++) {
+        tmpstr = sss_get_cased_name(tmp_ctx, (char *)el->values[i].data,
+                                    dom->case_preserve);
+        if (tmpstr == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        tmpstr = sss_replace_space(tmp_ctx, tmpstr,
+                                   nctx->rctx->override_space);
+        if (tmpstr == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sss_ncache_watch_user(nctx->ncache, dom, tmpstr,
+                                    &memo->watched[memo->num_watched]);
+        if (ret != EOK) {
+            goto done;
+        }
+        memo->num_watched++;
+
+        talloc_free_children(tmp_ctx);
+    }
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static void nss_grent_memo_set(struct nss_ctx *nctx,
+                               struct sss_domain_info *dom,
+                               struct ldb_message *msg,
+                               struct ldb_message_element *memberuid_el,
+                               struct ldb_message_element *ghost_el,
+                               uint64_t fingerprint, int memnum,
+                               const uint8_t *record, size_t len)
+{
+    struct nss_grent_memo *memo;
+    hash_key_t key;
+    errno_t ret;
+    hash_value_t value;
+    int hret;
+
+    if (nctx->grent_memo == NULL) {
+        return;
+    }
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(ldb_dn_get_linearized(msg->dn));
+    if (key.str == NULL) {
+        return;
+    }
+
+    if (hash_has_key(nctx->grent_memo, &key)) {
+        hash_delete(nctx->grent_memo, &key);
+    } else if (hash_count(nctx->grent_memo) >= NSS_GRENT_MEMO_MAX_ENTRIES) {
+        nss_grent_memo_evict(nctx);
+    }
+
+    memo = talloc_zero(nctx->grent_memo, struct nss_grent_memo);
+    if (memo == NULL) {
+        return;
+    }
+
+    memo->record = talloc_memdup(memo, record, len);
+    if (memo->record == NULL) {
+        talloc_free(memo);
+        return;
+    }
+
+    if (nctx->filter_users_in_groups) {
+        memo->watched = talloc_array(memo, unsigned long, memnum);
+        if (memo->watched == NULL) {
+            talloc_free(memo);
+            return;
+        }
+
+        ret = nss_grent_memo_watch(nctx, dom, memo, memberuid_el);
+        if (ret == EOK) {
+            ret = nss_grent_memo_watch(nctx, dom, memo, ghost_el);
+        }
+        if (ret != EOK) {
+            DEBUG(SSSDBG_MINOR_FAILURE, "Unable to watch the members of "
+                  "group [%s]: %d\n", key.str, ret);
+            nss_grent_memo_unwatch(nctx, memo);
+            talloc_free(memo);
+            return;
+        }
+    }
+
+    memo->fingerprint = fingerprint;
+    memo->ncache_gen = sss_ncache_user_generation(nctx->ncache);
+    memo->last_used = time(NULL);
+    memo->memnum = memnum;
+    memo->len = len;
+
+    value.type = HASH_VALUE_PTR;
+    value.ptr = memo;
+
+    hret = hash_enter(nctx->grent_memo, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to keep the record of group "
+              "[%s]: %s\n", key.str, hash_error_string(hret));
+        nss_grent_memo_unwatch(nctx, memo);
+        talloc_free(memo);
+        return;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Keeping the record of group [%s] with %d "
+          "members\n", key.str, memnum);
+}
+
 static int fill_grent(struct sss_packet *packet,
                       struct sss_domain_info *dom,
                       struct nss_ctx *nctx,
                       bool filter_groups, bool gr_mmap_cache,
+                      bool no_members,
                       struct ldb_message **msgs,
                       int *count)
 {
     struct ldb_message *msg;
-    struct ldb_message_element *el;
     uint8_t *body;
     size_t blen;
     uint32_t gid;
@@ -2926,6 +3334,11 @@ static int fill_grent(struct sss_packet *packet,
     bool add_domain = (!IS_SUBDOMAIN(dom) && dom->fqnames);
     const char *domain = dom->name;
     TALLOC_CTX *tmp_ctx = NULL;
+    struct ldb_message_element *memberuid_el;
+    struct ldb_message_element *ghost_el;
+    struct nss_grent_memo *memo;
+    uint64_t fingerprint = 0;
+    unsigned int num_values;
 
     to_sized_string(&pwfield, nctx->pwfield);
 
@@ -2998,108 +3411,147 @@ static int fill_grent(struct sss_packet *packet,
             }
         }
 
-        tmpstr = sss_get_cased_name(tmp_ctx, orig_name, dom->case_preserve);
-        if (tmpstr == NULL) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "sss_get_cased_name failed, skipping\n");
-            continue;
+        memberuid_el = NULL;
+        ghost_el = NULL;
+        if (!dom->ignore_group_members && !no_members) {
+            memberuid_el = sss_view_ldb_msg_find_element(dom, msg,
+                                                         SYSDB_MEMBERUID);
+            ghost_el = ldb_msg_find_element(msg, SYSDB_GHOST);
         }
+        num_values = (memberuid_el ? memberuid_el->num_values : 0)
+                     + (ghost_el ? ghost_el->num_values : 0);
 
-        tmpstr = sss_replace_space(tmp_ctx, tmpstr,
-                                   nctx->rctx->override_space);
-        if (tmpstr == NULL) {
-            DEBUG(SSSDBG_CRIT_FAILURE,
-                  "sss_replace_space failed, skipping\n");
-            continue;
+        memo = NULL;
+        if (num_values >= NSS_GRENT_MEMO_MIN_MEMBERS) {
+            fingerprint = nss_grent_fingerprint(orig_name, gid, add_domain,
+                                                memberuid_el, ghost_el);
+            memo = nss_grent_memo_get(nctx, msg, fingerprint);
         }
 
-        to_sized_string(&name, tmpstr);
-
-        /* fill in gid and name and set pointer for number of members */
-        rsize = STRS_ROFFSET + name.len + pwfield.len; /* name\0x\0 */
+        if (memo != NULL) {
+            rsize = memo->len;
+            ret = sss_packet_grow(packet, rsize);
+            if (ret != EOK) {
+                num = 0;
+                goto done;
+            }
+            sss_packet_get_body(packet, &body, &blen);
 
-        if (add_domain) {
-            fq_len = sss_fqname(NULL, 0, dom->names, dom, name.str);
-            if (fq_len >= 0) {
-                fq_len += 1;
-                rsize -= name.len;
-                rsize += fq_len;
-            } else {
-                /* Other failures caught below */
-                fq_len = 0;
+            memcpy(&body[rzero], memo->record, rsize);
+            memnum = memo->memnum;
+            to_sized_string(&name, (const char *)&body[rzero+STRS_ROFFSET]);
+        } else {
+            tmpstr = nss_get_cased_name(tmp_ctx, dom, msg, orig_name);
+            if (tmpstr == NULL) {
+                DEBUG(SSSDBG_CRIT_FAILURE,
+                      "sss_get_cased_name failed, skipping\n");
+                continue;
             }
-        }
 
-        ret = sss_packet_grow(packet, rsize);
-        if (ret != EOK) {
-            num = 0;
-            goto done;
-        }
-        sss_packet_get_body(packet, &body, &blen);
+            tmpstr = sss_replace_space(tmp_ctx, tmpstr,
+                                       nctx->rctx->override_space);
+            if (tmpstr == NULL) {
+                DEBUG(SSSDBG_CRIT_FAILURE,
+                      "sss_replace_space failed, skipping\n");
+                continue;
+            }
 
-        /*  0-3: 32bit number gid */
-        SAFEALIGN_SET_UINT32(&body[rzero+GID_ROFFSET], gid, NULL);
+            to_sized_string(&name, tmpstr);
 
-        /*  4-7: 32bit unsigned number of members */
-        SAFEALIGN_SET_UINT32(&body[rzero+MNUM_ROFFSET], 0, NULL);
+            /* fill in gid and name and set pointer for number of members */
+            rsize = STRS_ROFFSET + name.len + pwfield.len; /* name\0x\0 */
 
-        /*  8-X: sequence of strings (name, passwd, mem..) */
-        if (add_domain) {
-            ret = sss_fqname((char *)&body[rzero+STRS_ROFFSET], fq_len,
-                             dom->names, dom, name.str);
-            if (ret < 0 || ret != fq_len - 1) {
-                DEBUG(SSSDBG_CRIT_FAILURE,
-                      "Failed to generate a fully qualified name for"
-                          " group [%s] in [%s]! Skipping\n", name.str, domain);
-                /* reclaim space */
-                ret = sss_packet_shrink(packet, rsize);
-                if (ret != EOK) {
-                    num = 0;
-                    goto done;
+            if (add_domain) {
+                fq_len = sss_fqname(NULL, 0, dom->names, dom, name.str);
+                if (fq_len >= 0) {
+                    fq_len += 1;
+                    rsize -= name.len;
+                    rsize += fq_len;
+                } else {
+                    /* Other failures caught below */
+                    fq_len = 0;
                 }
-                rsize = 0;
-                continue;
             }
-        } else {
-            memcpy(&body[rzero+STRS_ROFFSET], name.str, name.len);
-        }
-        to_sized_string(&fullname, (const char *)&body[rzero+STRS_ROFFSET]);
 
-        /* group passwd field */
-        memcpy(&body[rzero+STRS_ROFFSET + fullname.len],
-                                            pwfield.str, pwfield.len);
+            ret = sss_packet_grow(packet, rsize);
+            if (ret != EOK) {
+                num = 0;
+                goto done;
+            }
+            sss_packet_get_body(packet, &body, &blen);
+
+            /*  0-3: 32bit number gid */
+            SAFEALIGN_SET_UINT32(&body[rzero+GID_ROFFSET], gid, NULL);
 
-        memnum = 0;
-        if (!dom->ignore_group_members) {
-            el = sss_view_ldb_msg_find_element(dom, msg, SYSDB_MEMBERUID);
-            if (el) {
-                ret = fill_members(packet, dom, nctx, el, &rzero, &rsize,
-                                   &memnum);
-                if (ret != EOK) {
-                    num = 0;
-                    goto done;
+            /*  4-7: 32bit unsigned number of members */
+            SAFEALIGN_SET_UINT32(&body[rzero+MNUM_ROFFSET], 0, NULL);
+
+            /*  8-X: sequence of strings (name, passwd, mem..) */
+            if (add_domain) {
+                ret = sss_fqname((char *)&body[rzero+STRS_ROFFSET], fq_len,
+                                 dom->names, dom, name.str);
+                if (ret < 0 || ret != fq_len - 1) {
+                    DEBUG(SSSDBG_CRIT_FAILURE,
+                          "Failed to generate a fully qualified name for"
+                          " group [%s] in [%s]! Skipping\n",
+                          name.str, domain);
+                    /* reclaim space */
+                    ret = sss_packet_shrink(packet, rsize);
+                    if (ret != EOK) {
+                        num = 0;
+                        goto done;
+                    }
+                    rsize = 0;
+                    continue;
                 }
-                sss_packet_get_body(packet, &body, &blen);
+            } else {
+                memcpy(&body[rzero+STRS_ROFFSET], name.str, name.len);
             }
-            el = ldb_msg_find_element(msg, SYSDB_GHOST);
-            if (el) {
-                if (DOM_HAS_VIEWS(dom) && !is_local_view(dom->view_name)
-                        && el->num_values != 0) {
-                    DEBUG(SSSDBG_CRIT_FAILURE,
-                          "Domain has a view [%s] but group [%s] still has " \
-                          "ghost members.\n", dom->view_name, orig_name);
-                    num = 0;
-                    goto done;
+            to_sized_string(&fullname,
+                            (const char *)&body[rzero+STRS_ROFFSET]);
+
+            /* group passwd field */
+            memcpy(&body[rzero+STRS_ROFFSET + fullname.len],
+                                                pwfield.str, pwfield.len);
+
+            memnum = 0;
+            if (!dom->ignore_group_members && !no_members) {
+                if (memberuid_el) {
+                    ret = fill_members(packet, dom, nctx, memberuid_el,
+                                       &rzero, &rsize, &memnum);
+                    if (ret != EOK) {
+                        num = 0;
+                        goto done;
+                    }
+                    sss_packet_get_body(packet, &body, &blen);
                 }
-                ret = fill_members(packet, dom, nctx, el, &rzero, &rsize,
-                                   &memnum);
-                if (ret != EOK) {
-                    num = 0;
-                    goto done;
+                if (ghost_el) {
+                    if (DOM_HAS_VIEWS(dom) && !is_local_view(dom->view_name)
+                            && ghost_el->num_values != 0) {
+                        DEBUG(SSSDBG_CRIT_FAILURE,
+                              "Domain has a view [%s] but group [%s] still "
+                              "has ghost members.\n",
+                              dom->view_name, orig_name);
+                        num = 0;
+                        goto done;
+                    }
+                    ret = fill_members(packet, dom, nctx, ghost_el,
+                                       &rzero, &rsize, &memnum);
+                    if (ret != EOK) {
+                        num = 0;
+                        goto done;
+                    }
+                    sss_packet_get_body(packet, &body, &blen);
                 }
-                sss_packet_get_body(packet, &body, &blen);
+            }
+
+            if (num_values >= NSS_GRENT_MEMO_MIN_MEMBERS
+                    && memnum == num_values) {
+                nss_grent_memo_set(nctx, dom, msg, memberuid_el, ghost_el,
+                                   fingerprint, memnum, &body[rzero], rsize);
             }
         }
+
         if (memnum) {
             /* set num of members */
             SAFEALIGN_SET_UINT32(&body[rzero+MNUM_ROFFSET], memnum, NULL);
@@ -3162,9 +3614,10 @@ static int nss_cmd_getgr_send_reply(struct nss_dom_ctx *dctx, bool filter)
         return EFAULT;
     }
     i = dctx->res->count;
+    /* a reply without members must not end up in the memory cache */
     ret = fill_grent(cctx->creq->out,
                      dctx->domain,
-                     nctx, filter, true,
+                     nctx, filter, !cmdctx->no_members, cmdctx->no_members,
                      dctx->res->msgs, &i);
     if (ret) {
         return ret;
@@ -3174,6 +3627,16 @@ static int nss_cmd_getgr_send_reply(struct nss_dom_ctx *dctx, bool filter)
     return EOK;
 }
 
+static enum sss_dp_acct_type nss_group_dp_type(struct nss_cmd_ctx *cmdctx,
+                                               struct sss_domain_info *dom)
+{
+    if (cmdctx->no_members && dom->lazy_group_members) {
+        return SSS_DP_GROUP_NO_MEMBERS;
+    }
+
+    return SSS_DP_GROUP;
+}
+
 /* search for a group.
  * Returns:
  *   ENOENT, if group is definitely not found
@@ -3234,6 +3697,7 @@ static int nss_cmd_getgrnam_search(struct nss_dom_ctx *dctx)
             DEBUG(SSSDBG_TRACE_FUNC,
                   "Group [%s] does not exist in [%s]! (negative cache)\n",
                    name, dom->name);
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_NEGCACHE);
             /* if a multidomain search, try with next */
             if (cmdctx->check_next) {
                 dom = get_next_domain(dom, 0);
@@ -3312,7 +3776,8 @@ static int nss_cmd_getgrnam_search(struct nss_dom_ctx *dctx)
                 extra_flag = NULL;
             }
 
-            ret = check_cache(dctx, nctx, dctx->res, SSS_DP_GROUP, name, 0,
+            ret = check_cache(dctx, nctx, dctx->res,
+                              nss_group_dp_type(cmdctx, dom), name, 0,
                               extra_flag, nss_cmd_getby_dp_callback, dctx);
             if (ret != EOK) {
                 /* Anything but EOK means we should reenter the mainloop
@@ -3339,6 +3804,11 @@ static int nss_cmd_getgrnam(struct cli_ctx *cctx)
     return nss_cmd_getbynam(SSS_NSS_GETGRNAM, cctx);
 }
 
+static int nss_cmd_getgrnam_nomem(struct cli_ctx *cctx)
+{
+    return nss_cmd_getbynam(SSS_NSS_GETGRNAM_NOMEM, cctx);
+}
+
 /* search for a gid.
  * Returns:
  *   ENOENT, if gid is definitely not found
@@ -3439,7 +3909,8 @@ static int nss_cmd_getgrgid_search(struct nss_dom_ctx *dctx)
                 extra_flag = NULL;
             }
 
-            ret = check_cache(dctx, nctx, dctx->res, SSS_DP_GROUP, NULL,
+            ret = check_cache(dctx, nctx, dctx->res,
+                              nss_group_dp_type(cmdctx, dom), NULL,
                               cmdctx->id, extra_flag, nss_cmd_getby_dp_callback,
                               dctx);
             if (ret != EOK) {
@@ -3481,6 +3952,11 @@ static int nss_cmd_getgrgid(struct cli_ctx *cctx)
     return nss_cmd_getbyid(SSS_NSS_GETGRGID, cctx);
 }
 
+static int nss_cmd_getgrgid_nomem(struct cli_ctx *cctx)
+{
+    return nss_cmd_getbyid(SSS_NSS_GETGRGID_NOMEM, cctx);
+}
+
 /* to keep it simple at this stage we are retrieving the
  * full enumeration again for each request for each process
  * and we also block on setgrent() for the full time needed
@@ -3888,7 +4364,7 @@ static int nss_cmd_retgrent(struct cli_ctx *cctx, int num)
 
         ret = fill_grent(cctx->creq->out,
                          gdom->domain,
-                         nctx, true, false, msgs, &n);
+                         nctx, true, false, false, msgs, &n);
 
         cctx->grent_cur += n;
     }
@@ -4352,6 +4828,7 @@ static int nss_cmd_initgroups_search(struct nss_dom_ctx *dctx)
             DEBUG(SSSDBG_TRACE_FUNC,
                   "User [%s] does not exist in [%s]! (negative cache)\n",
                    name, dom->name);
+            rsp_latency_set_outcome(cctx, SSS_CMD_OUTCOME_NEGCACHE);
             /* if a multidomain search, try with next */
             if (cmdctx->check_next) {
                 dom = get_next_domain(dom, 0);
@@ -5546,6 +6023,8 @@ static struct sss_cmd_table nss_cmds[] = {
     {SSS_NSS_GETGRENT, nss_cmd_getgrent},
     {SSS_NSS_ENDGRENT, nss_cmd_endgrent},
     {SSS_NSS_INITGR, nss_cmd_initgroups},
+    {SSS_NSS_GETGRNAM_NOMEM, nss_cmd_getgrnam_nomem},
+    {SSS_NSS_GETGRGID_NOMEM, nss_cmd_getgrgid_nomem},
     {SSS_NSS_SETNETGRENT, nss_cmd_setnetgrent},
     {SSS_NSS_GETNETGRENT, nss_cmd_getnetgrent},
     {SSS_NSS_ENDNETGRENT, nss_cmd_endnetgrent},
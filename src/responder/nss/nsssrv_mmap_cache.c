@@ -33,6 +33,8 @@
 #define SSS_AVG_GROUP_PAYLOAD (MC_SLOT_SIZE * 3)
 /* average place for 40 supplementary groups + 2 names */
 #define SSS_AVG_INITGROUP_PAYLOAD (MC_SLOT_SIZE * 5)
+/* short service name and protocol and an alias or two */
+#define SSS_AVG_SERVICES_PAYLOAD (MC_SLOT_SIZE * 3)
 
 #define MC_NEXT_BARRIER(val) ((((val) + 1) & 0x00ffffff) | 0xf0000000)
 
@@ -478,6 +480,9 @@ static errno_t sss_mc_get_strs_offset(struct sss_mc_ctx *mcc,
     case SSS_MC_INITGROUPS:
         *_offset = offsetof(struct sss_mc_initgr_data, gids);
         return EOK;
+    case SSS_MC_SERVICES:
+        *_offset = offsetof(struct sss_mc_svc_data, strs);
+        return EOK;
     default:
         DEBUG(SSSDBG_FATAL_FAILURE, "Unknown memory cache type.\n");
         return EINVAL;
@@ -498,6 +503,9 @@ static errno_t sss_mc_get_strs_len(struct sss_mc_ctx *mcc,
     case SSS_MC_INITGROUPS:
         *_len = ((struct sss_mc_initgr_data *)&rec->data)->data_len;
         return EOK;
+    case SSS_MC_SERVICES:
+        *_len = ((struct sss_mc_svc_data *)&rec->data)->strs_len;
+        return EOK;
     default:
         DEBUG(SSSDBG_FATAL_FAILURE, "Unknown memory cache type.\n");
         return EINVAL;
@@ -1036,6 +1044,235 @@ errno_t sss_mmap_cache_initgr_invalidate(struct sss_mc_ctx *mcc,
     return sss_mmap_cache_invalidate(mcc, name);
 }
 
+/***************************************************************************
+ * services map
+ ***************************************************************************/
+
+/* Finds the record of the service on the port, the protocol is the end of
+ * the "name/protocol" key of the record. */
+static struct sss_mc_rec *
+sss_mc_find_svc_by_port(struct sss_mc_ctx *mcc, uint16_t port,
+                        struct sized_string *protocol)
+{
+    struct sss_mc_rec *rec = NULL;
+    struct sss_mc_svc_data *data;
+    uint32_t hash;
+    uint32_t slot;
+    char *portstr;
+    char *rec_key;
+    size_t rec_key_len;
+    size_t proto_len;
+    const size_t strs_offset = offsetof(struct sss_mc_svc_data, strs);
+
+    portstr = talloc_asprintf(NULL, "%"PRIu16"/%s", port, protocol->str);
+    if (portstr == NULL) {
+        return NULL;
+    }
+
+    hash = sss_mc_hash(mcc, portstr, strlen(portstr) + 1);
+    talloc_free(portstr);
+
+    slot = mcc->hash_table[hash];
+    if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
+        return NULL;
+    }
+
+    /* the length of the protocol without the NULL terminator */
+    proto_len = protocol->len - 1;
+
+    while (slot != MC_INVALID_VAL) {
+        if (!MC_SLOT_WITHIN_BOUNDS(slot, mcc->dt_size)) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Corrupted fastcache.\n");
+            sss_mc_save_corrupted(mcc);
+            sss_mmap_cache_reset(mcc);
+            return NULL;
+        }
+
+        rec = MC_SLOT_TO_PTR(mcc->data_table, slot, struct sss_mc_rec);
+        data = (struct sss_mc_svc_data *)(&rec->data);
+
+        if (data->name < strs_offset
+            || data->name >= strs_offset + data->strs_len) {
+            DEBUG(SSSDBG_FATAL_FAILURE,
+                  "Corrupted fastcache. name_ptr value is %u.\n", data->name);
+            sss_mc_save_corrupted(mcc);
+            sss_mmap_cache_reset(mcc);
+            return NULL;
+        }
+
+        if (port == data->port) {
+            rec_key = (char *)data + data->name;
+            rec_key_len = strnlen(rec_key, strs_offset + data->strs_len
+                                           - data->name);
+            if (rec_key_len > proto_len
+                && rec_key[rec_key_len - proto_len - 1] == '/'
+                && strcmp(protocol->str,
+                          rec_key + rec_key_len - proto_len) == 0) {
+                return rec;
+            }
+        }
+
+        slot = sss_mc_next_slot_with_hash(rec, hash);
+    }
+
+    return NULL;
+}
+
+/* A service is only unique together with its protocol, both keys of the
+ * record are therefore qualified by it: "name/protocol" and
+ * "port/protocol". */
+errno_t sss_mmap_cache_svc_store(struct sss_mc_ctx **_mcc,
+                                 struct sized_string *name,
+                                 struct sized_string *protocol,
+                                 uint16_t port, uint32_t num_aliases,
+                                 char *aliasbuf, size_t aliassize)
+{
+    struct sss_mc_ctx *mcc = *_mcc;
+    struct sss_mc_rec *rec;
+    struct sss_mc_svc_data *data;
+    struct sized_string namekey;
+    struct sized_string portkey;
+    char *namestr = NULL;
+    char *portstr = NULL;
+    size_t data_len;
+    size_t rec_len;
+    size_t pos;
+    int ret;
+
+    if (mcc == NULL) {
+        /* cache not initialized ? */
+        return EINVAL;
+    }
+
+    namestr = talloc_asprintf(NULL, "%s/%s", name->str, protocol->str);
+    if (namestr == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    to_sized_string(&namekey, namestr);
+
+    portstr = talloc_asprintf(NULL, "%"PRIu16"/%s", port, protocol->str);
+    if (portstr == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    to_sized_string(&portkey, portstr);
+
+    data_len = namekey.len + name->len + protocol->len + aliassize;
+    rec_len = sizeof(struct sss_mc_rec) +
+              sizeof(struct sss_mc_svc_data) +
+              data_len;
+    if (rec_len > mcc->dt_size) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    /* The record of the service is reused in place by sss_mc_get_record()
+     * and stays chained under its old port. If the port of the service
+     * changed, drop the old record instead. */
+    rec = sss_mc_find_record(mcc, &namekey);
+    if (rec != NULL
+            && ((struct sss_mc_svc_data *)rec->data)->port != port) {
+        sss_mc_invalidate_rec(mcc, rec);
+    }
+
+    /* the port now belongs to this service */
+    rec = sss_mc_find_svc_by_port(mcc, port, protocol);
+    if (rec != NULL) {
+        data = (struct sss_mc_svc_data *)rec->data;
+        if (strcmp(namekey.str, (char *)data + data->name) != 0) {
+            sss_mc_invalidate_rec(mcc, rec);
+        }
+    }
+
+    ret = sss_mc_get_record(_mcc, rec_len, &namekey, &rec);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    data = (struct sss_mc_svc_data *)rec->data;
+    pos = 0;
+
+    MC_RAISE_BARRIER(rec);
+
+    /* header */
+    sss_mmap_set_rec_header(mcc, rec, rec_len, mcc->valid_time_slot,
+                            namekey.str, namekey.len,
+                            portkey.str, portkey.len);
+
+    /* service struct */
+    data->name = MC_PTR_DIFF(data->strs, data);
+    data->port = port;
+    data->aliases = num_aliases;
+    data->strs_len = data_len;
+    memcpy(&data->strs[pos], namekey.str, namekey.len);
+    pos += namekey.len;
+    memcpy(&data->strs[pos], name->str, name->len);
+    pos += name->len;
+    memcpy(&data->strs[pos], protocol->str, protocol->len);
+    pos += protocol->len;
+    memcpy(&data->strs[pos], aliasbuf, aliassize);
+    pos += aliassize;
+
+    MC_LOWER_BARRIER(rec);
+
+    /* finally chain the rec in the hash table */
+    sss_mmap_chain_in_rec(mcc, rec);
+
+    ret = EOK;
+
+done:
+    talloc_free(namestr);
+    talloc_free(portstr);
+    return ret;
+}
+
+errno_t sss_mmap_cache_svc_invalidate(struct sss_mc_ctx *mcc,
+                                      struct sized_string *name,
+                                      struct sized_string *protocol)
+{
+    struct sized_string namekey;
+    char *namestr;
+    errno_t ret;
+
+    if (mcc == NULL) {
+        /* cache not initialized ? */
+        return EINVAL;
+    }
+
+    namestr = talloc_asprintf(NULL, "%s/%s", name->str, protocol->str);
+    if (namestr == NULL) {
+        return ENOMEM;
+    }
+    to_sized_string(&namekey, namestr);
+
+    ret = sss_mmap_cache_invalidate(mcc, &namekey);
+    talloc_free(namestr);
+    return ret;
+}
+
+errno_t sss_mmap_cache_svc_invalidate_port(struct sss_mc_ctx *mcc,
+                                           uint16_t port,
+                                           struct sized_string *protocol)
+{
+    struct sss_mc_rec *rec;
+
+    if (mcc == NULL) {
+        /* cache not initialized ? */
+        return EINVAL;
+    }
+
+    rec = sss_mc_find_svc_by_port(mcc, port, protocol);
+    if (rec == NULL) {
+        /* nothing to invalidate */
+        return ENOENT;
+    }
+
+    sss_mc_invalidate_rec(mcc, rec);
+
+    return EOK;
+}
+
 /***************************************************************************
  * initialization
  ***************************************************************************/
@@ -1228,6 +1465,9 @@ errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
     case SSS_MC_INITGROUPS:
         payload = SSS_AVG_INITGROUP_PAYLOAD;
         break;
+    case SSS_MC_SERVICES:
+        payload = SSS_AVG_SERVICES_PAYLOAD;
+        break;
     default:
         return EINVAL;
     }
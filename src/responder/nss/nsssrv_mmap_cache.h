@@ -31,6 +31,7 @@ enum sss_mc_type {
     SSS_MC_PASSWD,
     SSS_MC_GROUP,
     SSS_MC_INITGROUPS,
+    SSS_MC_SERVICES,
 };
 
 errno_t sss_mmap_cache_init(TALLOC_CTX *mem_ctx, const char *name,
@@ -57,6 +58,12 @@ errno_t sss_mmap_cache_initgr_store(struct sss_mc_ctx **_mcc,
                                     uint32_t num_groups,
                                     uint8_t *gids_buf);
 
+errno_t sss_mmap_cache_svc_store(struct sss_mc_ctx **_mcc,
+                                 struct sized_string *name,
+                                 struct sized_string *protocol,
+                                 uint16_t port, uint32_t num_aliases,
+                                 char *aliasbuf, size_t aliassize);
+
 errno_t sss_mmap_cache_pw_invalidate(struct sss_mc_ctx *mcc,
                                      struct sized_string *name);
 
@@ -70,6 +77,14 @@ errno_t sss_mmap_cache_gr_invalidate_gid(struct sss_mc_ctx *mcc, gid_t gid);
 errno_t sss_mmap_cache_initgr_invalidate(struct sss_mc_ctx *mcc,
                                          struct sized_string *name);
 
+errno_t sss_mmap_cache_svc_invalidate(struct sss_mc_ctx *mcc,
+                                      struct sized_string *name,
+                                      struct sized_string *protocol);
+
+errno_t sss_mmap_cache_svc_invalidate_port(struct sss_mc_ctx *mcc,
+                                           uint16_t port,
+                                           struct sized_string *protocol);
+
 errno_t sss_mmap_cache_reinit(TALLOC_CTX *mem_ctx, size_t n_elem,
                               time_t timeout, struct sss_mc_ctx **mc_ctx);
 
@@ -478,13 +478,229 @@ done:
     return ret;
 }
 
+static errno_t netgr_add_seen(hash_table_t *table, char *key, bool *_seen)
+{
+    hash_key_t hkey;
+    hash_value_t value;
+    int hret;
+
+    hkey.type = HASH_KEY_STRING;
+    hkey.str = key;
+
+    if (hash_has_key(table, &hkey)) {
+        *_seen = true;
+        return EOK;
+    }
+
+    value.type = HASH_VALUE_UNDEF;
+    hret = hash_enter(table, &hkey, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to add [%s] to hash [%d][%s]\n",
+              key, hret, hash_error_string(hret));
+        return EIO;
+    }
+
+    *_seen = false;
+    return EOK;
+}
+
+/* Flatten the entries of a netgroup: every nested netgroup that is cached
+ * in the same domain and not expired is replaced by its own entries,
+ * recursively, and duplicate triples are dropped. Nested netgroups that
+ * would need a round trip to the data provider are kept as they are, the
+ * client resolves them with another setnetgrent() call.
+ *
+ * _min_expire is set to the earliest cache expiration of the expanded
+ * netgroups, or to 0 if none of them expires.
+ *
+ * Without this innetgr() has to call setnetgrent() for every nested
+ * netgroup and each of these calls searches and parses it again. */
+static errno_t netgr_expand_nested(TALLOC_CTX *mem_ctx,
+                                   struct sss_domain_info *dom,
+                                   const char *name,
+                                   struct sysdb_netgroup_ctx **entries,
+                                   struct sysdb_netgroup_ctx ***_expanded,
+                                   time_t *_min_expire)
+{
+    TALLOC_CTX *tmp_ctx;
+    hash_table_t *seen_groups;
+    hash_table_t *seen_triples;
+    struct sysdb_netgroup_ctx **queue;
+    struct sysdb_netgroup_ctx **nested;
+    struct sysdb_netgroup_ctx **expanded;
+    struct sysdb_netgroup_ctx *entry;
+    struct ldb_result *res;
+    size_t num_queue;
+    size_t num_nested;
+    size_t num_expanded = 0;
+    uint64_t expire;
+    time_t min_expire = 0;
+    char *key;
+    bool seen;
+    size_t i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = sss_hash_create(tmp_ctx, 32, &seen_groups);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_hash_create(tmp_ctx, 64, &seen_triples);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (num_queue = 0; entries[num_queue] != NULL; num_queue++);
+
+    queue = talloc_array(tmp_ctx, struct sysdb_netgroup_ctx *, num_queue);
+    if (queue == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    memcpy(queue, entries, num_queue * sizeof(struct sysdb_netgroup_ctx *));
+
+    key = talloc_strdup(tmp_ctx, name);
+    if (key == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = netgr_add_seen(seen_groups, key, &seen);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    /* the queue grows while the nested netgroups are expanded */
+    for (i = 0; i < num_queue; i++) {
+        entry = queue[i];
+
+        if (entry->type == SYSDB_NETGROUP_TRIPLE_VAL) {
+            /* no part of a triple can contain a comma */
+            key = talloc_asprintf(tmp_ctx, "%s,%s,%s",
+                    entry->value.triple.hostname ?: "",
+                    entry->value.triple.username ?: "",
+                    entry->value.triple.domainname ?: "");
+            if (key == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+
+            ret = netgr_add_seen(seen_triples, key, &seen);
+            if (ret != EOK) {
+                goto done;
+            }
+        } else if (entry->type == SYSDB_NETGROUP_GROUP_VAL
+                && entry->value.groupname != NULL
+                && entry->value.groupname[0] != '\0') {
+            key = sss_get_cased_name(tmp_ctx, entry->value.groupname,
+                                     dom->case_sensitive);
+            if (key == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+
+            ret = netgr_add_seen(seen_groups, key, &seen);
+            if (ret != EOK) {
+                goto done;
+            }
+
+            if (!seen) {
+                ret = sysdb_getnetgr(tmp_ctx, dom, key, &res);
+                if (ret != EOK && ret != ENOENT) {
+                    goto done;
+                }
+
+                if (ret == EOK && res->count == 1) {
+                    expire = ldb_msg_find_attr_as_uint64(res->msgs[0],
+                                                         SYSDB_CACHE_EXPIRE,
+                                                         0);
+                    if (!NEED_CHECK_PROVIDER(dom->provider)
+                            || expire > time(NULL)) {
+                        ret = sysdb_netgr_to_entries(tmp_ctx, res, &nested);
+                        if (ret != EOK) {
+                            goto done;
+                        }
+
+                        if (NEED_CHECK_PROVIDER(dom->provider)
+                                && (min_expire == 0
+                                    || (time_t) expire < min_expire)) {
+                            min_expire = (time_t) expire;
+                        }
+
+                        for (num_nested = 0; nested[num_nested] != NULL;
+                             num_nested++);
+
+                        queue = talloc_realloc(tmp_ctx, queue,
+                                               struct sysdb_netgroup_ctx *,
+                                               num_queue + num_nested);
+                        if (queue == NULL) {
+                            ret = ENOMEM;
+                            goto done;
+                        }
+                        memcpy(&queue[num_queue], nested,
+                               num_nested * sizeof(struct sysdb_netgroup_ctx *));
+                        num_queue += num_nested;
+
+                        DEBUG(SSSDBG_TRACE_INTERNAL,
+                              "Expanded nested netgroup [%s] of [%s]\n",
+                              key, name);
+                        /* replaced by its entries */
+                        seen = true;
+                    }
+                }
+            }
+        } else {
+            /* left for nss_cmd_retnetgrent() to complain about */
+            seen = false;
+        }
+
+        if (seen) {
+            continue;
+        }
+
+        queue[num_expanded] = entry;
+        num_expanded++;
+    }
+
+    expanded = talloc_array(mem_ctx, struct sysdb_netgroup_ctx *,
+                            num_expanded + 1);
+    if (expanded == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < num_expanded; i++) {
+        expanded[i] = talloc_steal(expanded, queue[i]);
+    }
+    expanded[num_expanded] = NULL;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Netgroup [%s] has %zu entries\n",
+          name, num_expanded);
+
+    *_expanded = expanded;
+    *_min_expire = min_expire;
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
 static errno_t lookup_netgr_step(struct setent_step_ctx *step_ctx)
 {
     errno_t ret;
     struct sss_domain_info *dom = step_ctx->dctx->domain;
     struct getent_ctx *netgr;
+    struct sysdb_netgroup_ctx **expanded;
     char *name = NULL;
     uint32_t lifetime;
+    time_t min_expire = 0;
+    time_t now;
     TALLOC_CTX *tmp_ctx;
 
     tmp_ctx = talloc_new(NULL);
@@ -608,6 +824,20 @@ static errno_t lookup_netgr_step(struct setent_step_ctx *step_ctx)
             }
         }
 
+        if (netgr->entries != NULL) {
+            ret = netgr_expand_nested(netgr, dom, name, netgr->entries,
+                                      &expanded, &min_expire);
+            if (ret == EOK) {
+                talloc_free(netgr->entries);
+                netgr->entries = expanded;
+            } else {
+                /* the client can still resolve the nested netgroups */
+                DEBUG(SSSDBG_MINOR_FAILURE,
+                      "Unable to expand nested netgroups of [%s] [%d]: %s\n",
+                      name, ret, sss_strerror(ret));
+            }
+        }
+
         /* Results found */
         DEBUG(SSSDBG_TRACE_FUNC, "Returning info for netgroup [%s@%s]\n",
                   name, dom->name);
@@ -620,6 +850,13 @@ static errno_t lookup_netgr_step(struct setent_step_ctx *step_ctx)
             lifetime = dom->netgroup_timeout;
         }
         if (lifetime < 10) lifetime = 10;
+
+        /* The expanded entries must not outlive the cached netgroups they
+         * were taken from */
+        now = time(NULL);
+        if (min_expire != 0 && min_expire - now < lifetime) {
+            lifetime = min_expire > now ? min_expire - now : 0;
+        }
         set_netgr_lifetime(lifetime, step_ctx, netgr);
 
         ret = EOK;
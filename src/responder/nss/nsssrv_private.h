@@ -39,6 +39,8 @@ struct nss_cmd_ctx {
     bool immediate;
     bool check_next;
     bool enum_cached;
+    /* the group is returned without members */
+    bool no_members;
 
     int saved_dom_idx;
     int saved_cur;
@@ -130,6 +132,8 @@ errno_t check_cache(struct nss_dom_ctx *dctx,
                     sss_dp_callback_t callback,
                     void *pvt);
 
+errno_t nss_grent_memo_init(struct nss_ctx *nctx);
+
 void nss_update_pw_memcache(struct nss_ctx *nctx);
 void nss_update_gr_memcache(struct nss_ctx *nctx);
 void nss_update_initgr_memcache(struct nss_ctx *nctx,
@@ -26,6 +26,7 @@
 #include "responder/nss/nsssrv.h"
 #include "responder/nss/nsssrv_private.h"
 #include "responder/nss/nsssrv_services.h"
+#include "responder/nss/nsssrv_mmap_cache.h"
 #include "responder/common/negcache.h"
 #include "confdb/confdb.h"
 #include "db/sysdb.h"
@@ -321,6 +322,10 @@ getserv_send(TALLOC_CTX *mem_ctx,
 
          cacheExpire = ldb_msg_find_attr_as_uint64(state->res->msgs[0],
                                                    SYSDB_CACHE_EXPIRE, 0);
+         if (sysdb_is_invalidated(dom, SYSDB_CACHE_TYPE_SERVICE,
+                                  state->res->msgs[0])) {
+             cacheExpire = 0;
+         }
 
          midpoint_refresh = 0;
          if(nctx->cache_refresh_percent) {
@@ -587,13 +592,15 @@ getserv_recv(TALLOC_CTX *mem_ctx,
 static errno_t
 fill_service(struct sss_packet *packet,
              struct sss_domain_info *dom,
+             struct nss_ctx *nctx,
+             bool svc_mmap_cache,
              const char *protocol,
              struct ldb_message **msgs,
              unsigned int *count)
 {
     errno_t ret;
     unsigned int msg_count = *count;
-    size_t rzero, rsize, aptr;
+    size_t rzero, rsize, aptr, alias_start;
     unsigned int num = 0;
     unsigned int i, j;
     uint32_t num_aliases, written_aliases;
@@ -755,6 +762,23 @@ fill_service(struct sss_packet *packet,
         SAFEALIGN_SETMEM_UINT32(&body[aptr], written_aliases, NULL);
 
         num++;
+
+        /* Only lookups for a specific protocol are cached, the client can
+         * not know which protocol the responder picks otherwise. */
+        if (svc_mmap_cache && protocol && nctx->svc_mc_ctx) {
+            alias_start = aptr + sizeof(uint32_t)
+                          + cased_name.len + cased_proto.len;
+            ret = sss_mmap_cache_svc_store(&nctx->svc_mc_ctx,
+                                           &cased_name, &cased_proto, port,
+                                           written_aliases,
+                                           (char *)&body[alias_start],
+                                           rzero + rsize - alias_start);
+            if (ret != EOK && ret != ENOMEM) {
+                DEBUG(SSSDBG_CRIT_FAILURE,
+                      "Failed to store service %s/%s in mmap cache!\n",
+                       cased_name.str, cased_proto.str);
+            }
+        }
     }
 
     ret = EOK;
@@ -837,6 +861,7 @@ int nss_cmd_getservbyname(struct cli_ctx *cctx)
     }
 
     dctx->protocol = service_protocol;
+    cmdctx->name = service_name;
 
     DEBUG(SSSDBG_TRACE_FUNC,
           "Requesting info for service [%s:%s] from [%s]\n",
@@ -986,6 +1011,80 @@ done:
     return ret;
 }
 
+/* The service was not found, remove the record the client would find for
+ * the same lookup from the memory cache. */
+static void
+delete_service_from_memcache(struct nss_ctx *nctx,
+                             struct nss_cmd_ctx *cmdctx,
+                             const char *protocol)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sized_string name;
+    struct sized_string proto;
+    char *lc_name = NULL;
+    char *lc_proto;
+    errno_t ret;
+
+    if (nctx->svc_mc_ctx == NULL || protocol == NULL) {
+        /* lookups without a protocol are not cached */
+        return;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory.\n");
+        return;
+    }
+
+    /* The record was stored with the lowercased name and protocol if the
+     * domain is case insensitive, remove that one as well. */
+    lc_proto = sss_tc_utf8_str_tolower(tmp_ctx, protocol);
+    if (cmdctx->name != NULL) {
+        lc_name = sss_tc_utf8_str_tolower(tmp_ctx, cmdctx->name);
+    }
+    if (lc_proto == NULL || (cmdctx->name != NULL && lc_name == NULL)) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Out of memory.\n");
+        goto done;
+    }
+
+    to_sized_string(&proto, protocol);
+    if (cmdctx->name != NULL) {
+        to_sized_string(&name, cmdctx->name);
+        ret = sss_mmap_cache_svc_invalidate(nctx->svc_mc_ctx, &name, &proto);
+    } else {
+        ret = sss_mmap_cache_svc_invalidate_port(nctx->svc_mc_ctx,
+                                                 cmdctx->id, &proto);
+    }
+    if (ret != EOK && ret != ENOENT) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Internal failure in memory cache code: %d [%s]\n",
+              ret, strerror(ret));
+        goto done;
+    }
+
+    if ((lc_name == NULL || strcmp(lc_name, cmdctx->name) == 0)
+            && strcmp(lc_proto, protocol) == 0) {
+        goto done;
+    }
+
+    to_sized_string(&proto, lc_proto);
+    if (lc_name != NULL) {
+        to_sized_string(&name, lc_name);
+        ret = sss_mmap_cache_svc_invalidate(nctx->svc_mc_ctx, &name, &proto);
+    } else {
+        ret = sss_mmap_cache_svc_invalidate_port(nctx->svc_mc_ctx,
+                                                 cmdctx->id, &proto);
+    }
+    if (ret != EOK && ret != ENOENT) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Internal failure in memory cache code: %d [%s]\n",
+              ret, strerror(ret));
+    }
+
+done:
+    talloc_free(tmp_ctx);
+}
+
 static void
 nss_cmd_getserv_done(struct tevent_req *req)
 {
@@ -995,6 +1094,8 @@ nss_cmd_getserv_done(struct tevent_req *req)
     struct nss_dom_ctx *dctx =
             tevent_req_callback_data(req, struct nss_dom_ctx);
     struct nss_cmd_ctx *cmdctx = dctx->cmdctx;
+    struct nss_ctx *nctx =
+            talloc_get_type(cmdctx->cctx->rctx->pvt_ctx, struct nss_ctx);
 
     reqret = getserv_recv(dctx, req, &dctx->res);
     talloc_zfree(req);
@@ -1011,12 +1112,16 @@ nss_cmd_getserv_done(struct tevent_req *req)
                          &cmdctx->cctx->creq->out);
     if (ret == EOK) {
         if (reqret == ENOENT) {
+            /* Service not found in ldb -> delete it from memory cache. */
+            delete_service_from_memcache(nctx, cmdctx, dctx->protocol);
+
             /* Notify the caller that this entry wasn't found */
             ret = sss_cmd_empty_packet(cmdctx->cctx->creq->out);
         } else {
             i = dctx->res->count;
             ret = fill_service(cmdctx->cctx->creq->out,
                                dctx->domain,
+                               nctx, true,
                                dctx->protocol,
                                dctx->res->msgs,
                                &i);
@@ -1148,6 +1253,7 @@ int nss_cmd_getservbyport(struct cli_ctx *cctx)
     }
 
     dctx->protocol = service_protocol;
+    cmdctx->id = port;
 
     DEBUG(SSSDBG_TRACE_FUNC,
           "Requesting info for service on port [%"PRIu16"/%s]\n",
@@ -1791,6 +1897,7 @@ retservent(struct cli_ctx *cctx, int num)
 
         ret = fill_service(cctx->creq->out,
                            pdom->domain,
+                           nctx, false,
                            NULL, msgs,
                            &n);
 
@@ -61,9 +61,10 @@ struct mon_cli_iface monitor_pam_methods = {
     .goOffline = NULL,
     .resetOffline = NULL,
     .rotateLogs = responder_logrotate,
-    .clearMemcache = NULL,
+    .clearMemcache = responder_clear_memcache,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getLatencyStats = responder_get_latency_stats,
 };
 
 static struct data_provider_iface pam_dp_methods = {
@@ -1535,7 +1535,8 @@ static int pam_check_user_search(struct pam_auth_req *preq)
         if (preq->check_provider) {
             cacheExpire = ldb_msg_find_attr_as_uint64(msg,
                                                       SYSDB_CACHE_EXPIRE, 0);
-            if (cacheExpire < time(NULL)) {
+            if (cacheExpire < time(NULL)
+                    || sysdb_is_invalidated(dom, SYSDB_CACHE_TYPE_USER, msg)) {
                 break;
             }
         }
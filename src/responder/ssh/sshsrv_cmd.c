@@ -344,7 +344,8 @@ ssh_host_pubkeys_search_next(struct ssh_cmd_ctx *cmd_ctx)
 {
     errno_t ret;
     struct sysdb_ctx *sysdb;
-    const char *attrs[] = { SYSDB_NAME, SYSDB_SSH_PUBKEY, NULL };
+    const char *attrs[] = { SYSDB_NAME, SYSDB_NAME_ALIAS, SYSDB_SSH_PUBKEY,
+                            NULL };
 
     DEBUG(SSSDBG_TRACE_FUNC,
           "Requesting SSH host public keys for [%s@%s]\n",
@@ -534,45 +535,100 @@ done:
     return result;
 }
 
+/* A host written to the known_hosts file, the unhashed entry tells whether
+ * the host changed since then. */
+struct ssh_known_host {
+    char *entry;
+};
+
+static char *
+ssh_known_host_key(TALLOC_CTX *mem_ctx,
+                   struct sss_domain_info *dom,
+                   const char *name)
+{
+    return talloc_asprintf(mem_ctx, "%s@%s", name, dom->name);
+}
+
+/* Returns true if the host the client asked for is not in the known_hosts
+ * file as it is now. */
+static bool
+ssh_known_hosts_host_changed(TALLOC_CTX *mem_ctx,
+                             struct ssh_ctx *ssh_ctx,
+                             struct ssh_cmd_ctx *cmd_ctx)
+{
+    struct sss_domain_info *dom;
+    struct ssh_known_host *host;
+    struct sss_ssh_ent *ent;
+    const char *name;
+    char *entry;
+    hash_key_t key;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+
+    if (cmd_ctx->result == NULL) {
+        /* the host might have been removed from the cache */
+        for (dom = cmd_ctx->cctx->rctx->domains; dom != NULL;
+                dom = get_next_domain(dom, false)) {
+            key.str = ssh_known_host_key(mem_ctx, dom, cmd_ctx->name);
+            if (key.str == NULL || hash_has_key(ssh_ctx->known_hosts, &key)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    name = ldb_msg_find_attr_as_string(cmd_ctx->result, SYSDB_NAME, NULL);
+    if (name == NULL) {
+        return true;
+    }
+
+    key.str = ssh_known_host_key(mem_ctx, cmd_ctx->domain, name);
+    if (key.str == NULL) {
+        return true;
+    }
+
+    hret = hash_lookup(ssh_ctx->known_hosts, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return true;
+    }
+    host = talloc_get_type(value.ptr, struct ssh_known_host);
+
+    ret = sss_ssh_make_ent(mem_ctx, cmd_ctx->result, &ent);
+    if (ret != EOK) {
+        return true;
+    }
+
+    entry = ssh_host_pubkeys_format_known_host_plain(mem_ctx, ent);
+    if (entry == NULL) {
+        return true;
+    }
+
+    return strcmp(entry, host->entry) != 0;
+}
+
 static errno_t
-ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
+ssh_known_hosts_write(struct ssh_ctx *ssh_ctx,
+                      struct sss_ssh_ent **ents,
+                      const char **entries,
+                      size_t num_ents)
 {
     TALLOC_CTX *tmp_ctx;
     errno_t ret;
-    const char *attrs[] = {
-        SYSDB_NAME,
-        SYSDB_NAME_ALIAS,
-        SYSDB_SSH_PUBKEY,
-        NULL
-    };
-    struct cli_ctx *cctx = cmd_ctx->cctx;
-    struct sss_domain_info *dom = cctx->rctx->domains;
-    struct ssh_ctx *ssh_ctx = (struct ssh_ctx *)cctx->rctx->pvt_ctx;
-    struct sysdb_ctx *sysdb;
-    time_t now = time(NULL);
-    struct ldb_message **hosts;
-    size_t num_hosts, i;
-    struct sss_ssh_ent *ent;
     int fd = -1;
-    char *filename = NULL;
+    char *filename;
     char *entstr;
     ssize_t wret;
+    size_t i;
 
     tmp_ctx = talloc_new(NULL);
     if (!tmp_ctx) {
         return ENOMEM;
     }
 
-    if (cmd_ctx->domain) {
-        ret = sysdb_update_ssh_known_host_expire(cmd_ctx->domain,
-                                                 cmd_ctx->name, now,
-                                                 ssh_ctx->known_hosts_timeout);
-        if (ret != EOK && ret != ENOENT) {
-            goto done;
-        }
-    }
-
-    /* write known_hosts file */
     filename = talloc_strdup(tmp_ctx, SSS_SSH_KNOWN_HOSTS_TEMP_TMPL);
     if (!filename) {
         ret = ENOMEM;
@@ -581,13 +637,109 @@ ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
 
     fd = sss_unique_file_ex(tmp_ctx, filename, 0133, &ret);
     if (fd == -1) {
-        filename = NULL;
         goto done;
     }
 
-    for (; dom; dom = get_next_domain(dom, false)) {
-        sysdb = dom->sysdb;
-        if (sysdb == NULL) {
+    for (i = 0; i < num_ents; i++) {
+        if (ssh_ctx->hash_known_hosts) {
+            entstr = ssh_host_pubkeys_format_known_host_hashed(tmp_ctx,
+                                                               ents[i]);
+            if (!entstr) {
+                DEBUG(SSSDBG_OP_FAILURE,
+                      "Failed to format known_hosts data for [%s]\n",
+                       ents[i]->name);
+                continue;
+            }
+        } else {
+            entstr = discard_const(entries[i]);
+        }
+
+        wret = sss_atomic_write_s(fd, entstr, strlen(entstr));
+        if (wret == -1) {
+            ret = errno;
+            goto done;
+        }
+
+        if (entstr != entries[i]) {
+            talloc_free(entstr);
+        }
+    }
+
+    ret = fchmod(fd, 0644);
+    if (ret == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    ret = rename(filename, SSS_SSH_KNOWN_HOSTS_PATH);
+    if (ret == -1) {
+        ret = errno;
+        goto done;
+    }
+
+    ret = EOK;
+
+done:
+    if (fd != -1) {
+        close(fd);
+    }
+    talloc_free(tmp_ctx);
+
+    return ret;
+}
+
+/* Reads all known hosts from the cache and writes the known_hosts file if
+ * the result differs from what was written last time. */
+static errno_t
+ssh_known_hosts_rebuild(struct ssh_ctx *ssh_ctx,
+                        struct sss_domain_info *domains,
+                        time_t now)
+{
+    TALLOC_CTX *tmp_ctx;
+    errno_t ret;
+    const char *attrs[] = {
+        SYSDB_NAME,
+        SYSDB_NAME_ALIAS,
+        SYSDB_SSH_PUBKEY,
+        SYSDB_CACHE_EXPIRE,
+        SYSDB_SSH_KNOWN_HOSTS_EXPIRE,
+        SYSDB_LAST_UPDATE,
+        NULL
+    };
+    struct sss_domain_info *dom;
+    struct ldb_message **hosts;
+    size_t num_hosts, i;
+    struct sss_ssh_ent **ents = NULL;
+    const char **entries = NULL;
+    size_t num_ents = 0;
+    struct ssh_known_host *host;
+    hash_table_t *table;
+    hash_key_t key;
+    hash_value_t value;
+    time_t next_expire = 0;
+    time_t expire;
+    time_t cache_expire;
+    uint64_t generation;
+    bool changed;
+    int hret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (!tmp_ctx) {
+        return ENOMEM;
+    }
+
+    ret = sss_hash_create(tmp_ctx, SSH_KNOWN_HOSTS_HASH_SIZE, &table);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    changed = (ssh_ctx->known_hosts == NULL);
+
+    key.type = HASH_KEY_STRING;
+    value.type = HASH_VALUE_PTR;
+
+    for (dom = domains; dom; dom = get_next_domain(dom, false)) {
+        if (dom->sysdb == NULL) {
             DEBUG(SSSDBG_FATAL_FAILURE,
                   "Fatal: Sysdb CTX not found for this domain!\n");
             ret = EFAULT;
@@ -604,56 +756,164 @@ ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
             continue;
         }
 
+        ret = sysdb_get_cache_generation(dom, SYSDB_CACHE_TYPE_SSH_HOST,
+                                         &generation);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to read the cache generation "
+                  "of domain [%s]\n", dom->name);
+            generation = 0;
+        }
+
+        ents = talloc_realloc(tmp_ctx, ents, struct sss_ssh_ent *,
+                              num_ents + num_hosts);
+        entries = talloc_realloc(tmp_ctx, entries, const char *,
+                                 num_ents + num_hosts);
+        if (ents == NULL || entries == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
         for (i = 0; i < num_hosts; i++) {
-            ret = sss_ssh_make_ent(tmp_ctx, hosts[i], &ent);
+            if (generation != 0
+                    && ldb_msg_find_attr_as_uint64(hosts[i], SYSDB_LAST_UPDATE,
+                                                   0) <= generation) {
+                /* invalidated by sss_cache */
+                continue;
+            }
+
+            ret = sss_ssh_make_ent(tmp_ctx, hosts[i], &ents[num_ents]);
             if (ret != EOK) {
                 DEBUG(SSSDBG_OP_FAILURE,
                       "Failed to get SSH host public keys\n");
                 continue;
             }
 
-            if (ssh_ctx->hash_known_hosts) {
-                entstr = ssh_host_pubkeys_format_known_host_hashed(ent, ent);
-            } else {
-                entstr = ssh_host_pubkeys_format_known_host_plain(ent, ent);
+            host = talloc_zero(table, struct ssh_known_host);
+            if (host == NULL) {
+                ret = ENOMEM;
+                goto done;
             }
-            if (!entstr) {
+
+            host->entry = ssh_host_pubkeys_format_known_host_plain(host,
+                                                             ents[num_ents]);
+            if (!host->entry) {
                 DEBUG(SSSDBG_OP_FAILURE,
                       "Failed to format known_hosts data for [%s]\n",
-                       ent->name);
+                       ents[num_ents]->name);
+                talloc_free(host);
                 continue;
             }
 
-            wret = sss_atomic_write_s(fd, entstr, strlen(entstr));
-            if (wret == -1) {
-                ret = errno;
+            key.str = ssh_known_host_key(tmp_ctx, dom, ents[num_ents]->name);
+            if (key.str == NULL) {
+                ret = ENOMEM;
                 goto done;
             }
 
-            talloc_free(ent);
+            value.ptr = host;
+            hret = hash_enter(table, &key, &value);
+            if (hret != HASH_SUCCESS) {
+                DEBUG(SSSDBG_OP_FAILURE, "Unable to add [%s] to the table "
+                      "[%d]: %s\n", key.str, hret, hash_error_string(hret));
+                ret = EIO;
+                goto done;
+            }
+
+            if (!changed) {
+                hret = hash_lookup(ssh_ctx->known_hosts, &key, &value);
+                if (hret != HASH_SUCCESS
+                        || strcmp(talloc_get_type(value.ptr,
+                                        struct ssh_known_host)->entry,
+                                  host->entry) != 0) {
+                    changed = true;
+                }
+            }
+
+            /* the host is left out of the file as soon as either its cache
+             * entry or its known_hosts entry expire */
+            expire = ldb_msg_find_attr_as_uint64(hosts[i],
+                                                 SYSDB_SSH_KNOWN_HOSTS_EXPIRE,
+                                                 0);
+            cache_expire = ldb_msg_find_attr_as_uint64(hosts[i],
+                                                       SYSDB_CACHE_EXPIRE, 0);
+            if (cache_expire != 0 && cache_expire < expire) {
+                expire = cache_expire;
+            }
+            if (next_expire == 0 || expire < next_expire) {
+                next_expire = expire;
+            }
+
+            entries[num_ents] = host->entry;
+            num_ents++;
         }
 
         talloc_free(hosts);
     }
 
-    ret = fchmod(fd, 0644);
-    if (ret == -1) {
-        ret = errno;
-        goto done;
+    if (!changed && hash_count(table) != hash_count(ssh_ctx->known_hosts)) {
+        changed = true;
     }
 
-    ret = rename(filename, SSS_SSH_KNOWN_HOSTS_PATH);
-    if (ret == -1) {
-        ret = errno;
-        goto done;
+    if (changed) {
+        DEBUG(SSSDBG_TRACE_FUNC,
+              "Writing known_hosts file with %zu hosts\n", num_ents);
+
+        ret = ssh_known_hosts_write(ssh_ctx, ents, entries, num_ents);
+        if (ret != EOK) {
+            goto done;
+        }
+    } else {
+        DEBUG(SSSDBG_TRACE_FUNC, "known_hosts file did not change\n");
     }
 
+    talloc_free(ssh_ctx->known_hosts);
+    ssh_ctx->known_hosts = talloc_steal(ssh_ctx, table);
+    ssh_ctx->known_hosts_next_expire = next_expire;
+
     ret = EOK;
 
 done:
-    if (fd != -1) {
-        close(fd);
+    talloc_free(tmp_ctx);
+
+    return ret;
+}
+
+static errno_t
+ssh_host_pubkeys_update_known_hosts(struct ssh_cmd_ctx *cmd_ctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    errno_t ret;
+    struct cli_ctx *cctx = cmd_ctx->cctx;
+    struct ssh_ctx *ssh_ctx = (struct ssh_ctx *)cctx->rctx->pvt_ctx;
+    time_t now = time(NULL);
+
+    tmp_ctx = talloc_new(NULL);
+    if (!tmp_ctx) {
+        return ENOMEM;
     }
+
+    if (cmd_ctx->domain) {
+        ret = sysdb_update_ssh_known_host_expire(cmd_ctx->domain,
+                                                 cmd_ctx->name, now,
+                                                 ssh_ctx->known_hosts_timeout);
+        if (ret != EOK && ret != ENOENT) {
+            goto done;
+        }
+    }
+
+    /* The file only has to be written again if a host entered or left it,
+     * not on every request. */
+    if (ssh_ctx->known_hosts != NULL
+            && (ssh_ctx->known_hosts_next_expire == 0
+                    || now < ssh_ctx->known_hosts_next_expire)
+            && !ssh_known_hosts_host_changed(tmp_ctx, ssh_ctx, cmd_ctx)) {
+        ret = EOK;
+        goto done;
+    }
+
+    ret = ssh_known_hosts_rebuild(ssh_ctx, cctx->rctx->domains, now);
+
+done:
     talloc_free(tmp_ctx);
 
     return ret;
@@ -26,6 +26,8 @@
 #define SSS_SSH_KNOWN_HOSTS_PATH PUBCONF_PATH"/known_hosts"
 #define SSS_SSH_KNOWN_HOSTS_TEMP_TMPL PUBCONF_PATH"/.known_hosts.XXXXXX"
 
+#define SSH_KNOWN_HOSTS_HASH_SIZE 256
+
 struct ssh_ctx {
     struct resp_ctx *rctx;
     struct sss_names_ctx *snctx;
@@ -33,6 +35,11 @@ struct ssh_ctx {
     bool hash_known_hosts;
     int known_hosts_timeout;
     char *ca_db;
+
+    /* hosts in the known_hosts file, NULL until it is written first */
+    hash_table_t *known_hosts;
+    /* when the first of them expires, 0 if there are none */
+    time_t known_hosts_next_expire;
 };
 
 struct ssh_cmd_ctx {
@@ -37,9 +37,10 @@ struct mon_cli_iface monitor_sudo_methods = {
     .goOffline = NULL,
     .resetOffline = NULL,
     .rotateLogs = responder_logrotate,
-    .clearMemcache = NULL,
+    .clearMemcache = responder_clear_memcache,
     .clearEnumCache = NULL,
     .sysbusReconnect = NULL,
+    .getLatencyStats = responder_get_latency_stats,
 };
 
 static struct data_provider_iface sudo_dp_methods = {
@@ -113,7 +113,31 @@ sort_sudo_rules(struct sysdb_attrs **rules, size_t count, bool lower_wins)
     return EOK;
 }
 
+static errno_t sudosrv_query_index(TALLOC_CTX *mem_ctx,
+                                   struct sudo_ctx *sudo_ctx,
+                                   struct sss_domain_info *domain,
+                                   const char **attrs,
+                                   unsigned int flags,
+                                   const char *username,
+                                   uid_t uid,
+                                   char **groupnames,
+                                   struct sysdb_attrs ***_rules,
+                                   uint32_t *_count)
+{
+    struct sudosrv_index *index;
+    errno_t ret;
+
+    ret = sudosrv_index_get(sudo_ctx, domain, &index);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return sudosrv_index_query(mem_ctx, index, attrs, flags, username, uid,
+                               groupnames, _rules, _count);
+}
+
 static errno_t sudosrv_query_cache(TALLOC_CTX *mem_ctx,
+                                   struct sudo_ctx *sudo_ctx,
                                    struct sss_domain_info *domain,
                                    const char **attrs,
                                    unsigned int flags,
@@ -131,6 +155,15 @@ static errno_t sudosrv_query_cache(TALLOC_CTX *mem_ctx,
     struct sysdb_attrs **rules;
     struct ldb_message **msgs;
 
+    ret = sudosrv_query_index(mem_ctx, sudo_ctx, domain, attrs, flags,
+                              username, uid, groupnames, _rules, _count);
+    if (ret == EOK) {
+        return EOK;
+    }
+
+    DEBUG(SSSDBG_MINOR_FAILURE, "Unable to use index of sudo rules, "
+          "searching sysdb directly [%d]: %s\n", ret, sss_strerror(ret));
+
     tmp_ctx = talloc_new(NULL);
     if (tmp_ctx == NULL) {
         return ENOMEM;
@@ -187,6 +220,7 @@ done:
 }
 
 static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
+                                     struct sudo_ctx *sudo_ctx,
                                      struct sss_domain_info *domain,
                                      uid_t uid,
                                      const char *username,
@@ -203,7 +237,7 @@ static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
             | SYSDB_SUDO_FILTER_ONLY_EXPIRED
             | SYSDB_SUDO_FILTER_USERINFO;
 
-    ret = sudosrv_query_cache(mem_ctx, domain, attrs, flags,
+    ret = sudosrv_query_cache(mem_ctx, sudo_ctx, domain, attrs, flags,
                               username, uid, groups, false,
                               _rules, _num_rules);
 
@@ -211,6 +245,7 @@ static errno_t sudosrv_expired_rules(TALLOC_CTX *mem_ctx,
 }
 
 static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
+                                    struct sudo_ctx *sudo_ctx,
                                     enum sss_sudo_type type,
                                     struct sss_domain_info *domain,
                                     uid_t uid,
@@ -254,7 +289,7 @@ static errno_t sudosrv_cached_rules(TALLOC_CTX *mem_ctx,
         break;
     }
 
-    ret = sudosrv_query_cache(mem_ctx, domain, attrs, flags,
+    ret = sudosrv_query_cache(mem_ctx, sudo_ctx, domain, attrs, flags,
                               username, uid, groups,
                               inverse_order, &rules, &num_rules);
     if (ret != EOK) {
@@ -281,6 +316,7 @@ sudosrv_dp_oob_req_done(struct tevent_req *req)
 
 struct sudosrv_refresh_rules_state {
     struct resp_ctx *rctx;
+    struct sudo_ctx *sudo_ctx;
     struct sss_domain_info *domain;
     const char *username;
 };
@@ -290,7 +326,7 @@ static void sudosrv_refresh_rules_done(struct tevent_req *subreq);
 static struct tevent_req *
 sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
                            struct tevent_context *ev,
-                           struct resp_ctx *rctx,
+                           struct sudo_ctx *sudo_ctx,
                            struct sss_domain_info *domain,
                            uid_t uid,
                            const char *username,
@@ -310,12 +346,13 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
         return NULL;
     }
 
-    state->rctx = rctx;
+    state->rctx = sudo_ctx->rctx;
+    state->sudo_ctx = sudo_ctx;
     state->domain = domain;
     state->username = username;
 
-    ret = sudosrv_expired_rules(state, domain, uid, username, groups,
-                                &rules, &num_rules);
+    ret = sudosrv_expired_rules(state, sudo_ctx, domain, uid, username,
+                                groups, &rules, &num_rules);
     if (ret != EOK) {
         DEBUG(SSSDBG_CRIT_FAILURE,
               "Unable to retrieve expired sudo rules [%d]: %s\n",
@@ -333,7 +370,7 @@ sudosrv_refresh_rules_send(TALLOC_CTX *mem_ctx,
     DEBUG(SSSDBG_TRACE_INTERNAL, "Refreshing %d expired rules of [%s@%s]\n",
           num_rules, username, domain->name);
 
-    subreq = sss_dp_get_sudoers_send(state, rctx, domain, false,
+    subreq = sss_dp_get_sudoers_send(state, state->rctx, domain, false,
                                      SSS_DP_SUDO_REFRESH_RULES,
                                      username, num_rules, rules);
     if (subreq == NULL) {
@@ -416,6 +453,7 @@ static errno_t sudosrv_refresh_rules_recv(struct tevent_req *req)
 struct sudosrv_get_rules_state {
     struct tevent_context *ev;
     struct resp_ctx *rctx;
+    struct sudo_ctx *sudo_ctx;
     enum sss_sudo_type type;
     uid_t uid;
     char *username;
@@ -450,6 +488,7 @@ struct tevent_req *sudosrv_get_rules_send(TALLOC_CTX *mem_ctx,
 
     state->ev = ev;
     state->rctx = sudo_ctx->rctx;
+    state->sudo_ctx = sudo_ctx;
     state->type = type;
     state->uid = uid;
     state->inverse_order = sudo_ctx->inverse_order;
@@ -504,7 +543,7 @@ static void sudosrv_get_rules_initgr_done(struct tevent_req *subreq)
         goto done;
     }
 
-    subreq = sudosrv_refresh_rules_send(state, state->ev, state->rctx,
+    subreq = sudosrv_refresh_rules_send(state, state->ev, state->sudo_ctx,
                                         state->domain, state->uid,
                                         state->username, state->groups);
     if (subreq == NULL) {
@@ -542,7 +581,10 @@ static void sudosrv_get_rules_done(struct tevent_req *subreq)
               "in cache.\n");
     }
 
-    ret = sudosrv_cached_rules(state, state->type, state->domain, state->uid,
+    /* Rules returned from the index are used to build the reply before
+     * returning to the main loop so the index cannot change meanwhile. */
+    ret = sudosrv_cached_rules(state, state->sudo_ctx, state->type,
+                               state->domain, state->uid,
                                state->username, state->groups,
                                state->inverse_order,
                                &state->rules, &state->num_rules);
@@ -0,0 +1,849 @@
+/*
+    SSSD
+
+    In-memory index of cached sudo rules
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <talloc.h>
+
+#include "util/util.h"
+#include "util/dlinklist.h"
+#include "db/sysdb_sudo.h"
+#include "responder/sudo/sudosrv_private.h"
+
+#define SUDOSRV_INDEX_HASH_SIZE 1024
+
+/* flags of sysdb_get_sudo_filter() which restrict the set of rules */
+#define SUDOSRV_INDEX_SELECTORS (SYSDB_SUDO_FILTER_INCLUDE_ALL    \
+                                 | SYSDB_SUDO_FILTER_INCLUDE_DFL  \
+                                 | SYSDB_SUDO_FILTER_USERNAME     \
+                                 | SYSDB_SUDO_FILTER_UID          \
+                                 | SYSDB_SUDO_FILTER_GROUPS       \
+                                 | SYSDB_SUDO_FILTER_NGRS)
+
+/* Attributes kept in the index. These are the attributes sent to the sudo
+ * client, see sudosrv_build_response(), and the name needed to refresh
+ * expired rules. Queries can only ask for a subset of them. The expiration
+ * is kept in struct sudosrv_index_rule so that it can be updated in place
+ * when unchanged rules are refreshed. */
+static const char *sudosrv_index_attrs[] = { SYSDB_OBJECTCLASS,
+                                             SYSDB_SUDO_CACHE_AT_CN,
+                                             SYSDB_SUDO_CACHE_AT_USER,
+                                             SYSDB_SUDO_CACHE_AT_HOST,
+                                             SYSDB_SUDO_CACHE_AT_COMMAND,
+                                             SYSDB_SUDO_CACHE_AT_OPTION,
+                                             SYSDB_SUDO_CACHE_AT_RUNAS,
+                                             SYSDB_SUDO_CACHE_AT_RUNASUSER,
+                                             SYSDB_SUDO_CACHE_AT_RUNASGROUP,
+                                             SYSDB_SUDO_CACHE_AT_NOTBEFORE,
+                                             SYSDB_SUDO_CACHE_AT_NOTAFTER,
+                                             SYSDB_SUDO_CACHE_AT_ORDER,
+                                             SYSDB_NAME,
+                                             NULL };
+
+struct sudosrv_index_rule {
+    /* only the attributes listed in sudosrv_index_attrs */
+    struct sysdb_attrs *attrs;
+    const char *name;
+    uint32_t order;
+    bool has_expire;
+    uint64_t expire;
+};
+
+/* positions of rules in the sorted rule array */
+struct sudosrv_index_list {
+    size_t count;
+    size_t *pos;
+};
+
+struct sudosrv_index {
+    struct sudosrv_index *prev;
+    struct sudosrv_index *next;
+
+    const char *domain;
+    uint64_t generation;
+    uint64_t expire_generation;
+    /* when the expiration of the rules was last read */
+    time_t synced;
+
+    struct sudosrv_index_rule *rules;
+    size_t num_rules;
+
+    /* rule name -> position in the rule array */
+    hash_table_t *by_name;
+    /* sudoUser value -> struct sudosrv_index_list */
+    hash_table_t *by_user;
+    struct sudosrv_index_list netgroups;
+    struct sudosrv_index_list defaults;
+};
+
+static int sudosrv_index_order_cmp(const void *a, const void *b,
+                                   bool lower_wins)
+{
+    const struct sudosrv_index_rule *r1 = a;
+    const struct sudosrv_index_rule *r2 = b;
+
+    if (r1->order == r2->order) {
+        return 0;
+    }
+
+    if (lower_wins) {
+        /* The lowest value takes priority. Original wrong SSSD behaviour. */
+        return r1->order > r2->order ? 1 : -1;
+    }
+
+    /* The higher value takes priority. Standard LDAP behaviour. */
+    return r1->order < r2->order ? 1 : -1;
+}
+
+static int sudosrv_index_low_cmp_fn(const void *a, const void *b)
+{
+    return sudosrv_index_order_cmp(a, b, true);
+}
+
+static int sudosrv_index_high_cmp_fn(const void *a, const void *b)
+{
+    return sudosrv_index_order_cmp(a, b, false);
+}
+
+static errno_t sudosrv_index_list_add(TALLOC_CTX *mem_ctx,
+                                      struct sudosrv_index_list *list,
+                                      size_t pos)
+{
+    size_t *new_pos;
+
+    new_pos = talloc_realloc(mem_ctx, list->pos, size_t, list->count + 1);
+    if (new_pos == NULL) {
+        return ENOMEM;
+    }
+
+    new_pos[list->count] = pos;
+    list->pos = new_pos;
+    list->count++;
+
+    return EOK;
+}
+
+static errno_t sudosrv_index_add_user(struct sudosrv_index *index,
+                                      const char *user,
+                                      size_t pos)
+{
+    struct sudosrv_index_list *list;
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(user);
+
+    hret = hash_lookup(index->by_user, &key, &value);
+    if (hret == HASH_SUCCESS) {
+        list = talloc_get_type(value.ptr, struct sudosrv_index_list);
+    } else if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        list = talloc_zero(index->by_user, struct sudosrv_index_list);
+        if (list == NULL) {
+            return ENOMEM;
+        }
+
+        value.type = HASH_VALUE_PTR;
+        value.ptr = list;
+
+        hret = hash_enter(index->by_user, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to add [%s] to the index "
+                  "[%d]: %s\n", user, hret, hash_error_string(hret));
+            talloc_free(list);
+            return EIO;
+        }
+    } else {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up [%s] in the index "
+              "[%d]: %s\n", user, hret, hash_error_string(hret));
+        return EIO;
+    }
+
+    /* the same user may be listed more than once in a single rule */
+    if (list->count > 0 && list->pos[list->count - 1] == pos) {
+        return EOK;
+    }
+
+    return sudosrv_index_list_add(list, list, pos);
+}
+
+static errno_t sudosrv_index_add_name(struct sudosrv_index *index,
+                                      const char *name,
+                                      size_t pos)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+    value.type = HASH_VALUE_ULONG;
+    value.ul = pos;
+
+    hret = hash_enter(index->by_name, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to add rule [%s] to the index "
+              "[%d]: %s\n", name, hret, hash_error_string(hret));
+        return EIO;
+    }
+
+    return EOK;
+}
+
+static errno_t sudosrv_index_build(TALLOC_CTX *mem_ctx,
+                                   struct sss_domain_info *domain,
+                                   uint64_t generation,
+                                   uint64_t expire_generation,
+                                   time_t synced,
+                                   bool inverse_order,
+                                   struct sudosrv_index **_index)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index *index;
+    struct sudosrv_index_rule *rule;
+    struct ldb_message **msgs = NULL;
+    struct ldb_message_element *el;
+    struct sysdb_attrs **attrs;
+    const char **search_attrs;
+    const char *name;
+    size_t num_attrs;
+    size_t count;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    index = talloc_zero(tmp_ctx, struct sudosrv_index);
+    if (index == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    index->generation = generation;
+    index->expire_generation = expire_generation;
+    index->synced = synced;
+    index->domain = talloc_strdup(index, domain->name);
+    if (index->domain == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sss_hash_create(index, SUDOSRV_INDEX_HASH_SIZE, &index->by_user);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    ret = sss_hash_create(index, SUDOSRV_INDEX_HASH_SIZE, &index->by_name);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    for (num_attrs = 0; sudosrv_index_attrs[num_attrs] != NULL; num_attrs++);
+
+    search_attrs = talloc_zero_array(tmp_ctx, const char *, num_attrs + 2);
+    if (search_attrs == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    memcpy(search_attrs, sudosrv_index_attrs, num_attrs * sizeof(char *));
+    search_attrs[num_attrs] = SYSDB_CACHE_EXPIRE;
+
+    ret = sysdb_search_custom(tmp_ctx, domain,
+                              "("SYSDB_OBJECTCLASS"="SYSDB_SUDO_CACHE_OC")",
+                              SUDORULE_SUBDIR, search_attrs,
+                              &count, &msgs);
+    if (ret == ENOENT) {
+        count = 0;
+    } else if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE, "Error looking up SUDO rules\n");
+        goto done;
+    }
+
+    index->rules = talloc_zero_array(index, struct sudosrv_index_rule, count);
+    if (index->rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        rule = &index->rules[i];
+
+        name = ldb_msg_find_attr_as_string(msgs[i], SYSDB_NAME, NULL);
+        if (name != NULL) {
+            rule->name = talloc_strdup(index->rules, name);
+            if (rule->name == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+        }
+
+        /* man sudoers-ldap: If the sudoOrder attribute is not present,
+         * a value of 0 is assumed */
+        rule->order = ldb_msg_find_attr_as_uint(msgs[i],
+                                                SYSDB_SUDO_CACHE_AT_ORDER, 0);
+        rule->has_expire = ldb_msg_find_element(msgs[i],
+                                                SYSDB_CACHE_EXPIRE) != NULL;
+        rule->expire = ldb_msg_find_attr_as_uint64(msgs[i],
+                                                   SYSDB_CACHE_EXPIRE, 0);
+        ldb_msg_remove_attr(msgs[i], SYSDB_CACHE_EXPIRE);
+    }
+
+    ret = sysdb_msg2attrs(index, count, msgs, &attrs);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Could not convert ldb message to sysdb_attrs\n");
+        goto done;
+    }
+
+    for (i = 0; i < count; i++) {
+        index->rules[i].attrs = attrs[i];
+    }
+
+    qsort(index->rules, count, sizeof(struct sudosrv_index_rule),
+          inverse_order ? sudosrv_index_low_cmp_fn
+                        : sudosrv_index_high_cmp_fn);
+    index->num_rules = count;
+
+    for (i = 0; i < count; i++) {
+        rule = &index->rules[i];
+
+        if (rule->name != NULL) {
+            ret = sudosrv_index_add_name(index, rule->name, i);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+
+        if (rule->name != NULL && strcmp(rule->name, "defaults") == 0) {
+            ret = sudosrv_index_list_add(index, &index->defaults, i);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+
+        ret = sysdb_attrs_get_el_ext(rule->attrs, SYSDB_SUDO_CACHE_AT_USER,
+                                     false, &el);
+        if (ret == ENOENT) {
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            if (el->values[j].data[0] == '+') {
+                if (index->netgroups.count == 0
+                        || index->netgroups.pos[index->netgroups.count - 1]
+                           != i) {
+                    ret = sudosrv_index_list_add(index, &index->netgroups, i);
+                    if (ret != EOK) {
+                        goto done;
+                    }
+                }
+            }
+
+            ret = sudosrv_index_add_user(index,
+                                         (const char *) el->values[j].data, i);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Indexed %zu sudo rules of domain [%s]\n",
+          count, domain->name);
+
+    *_index = talloc_steal(mem_ctx, index);
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+/* Only the expiration of some rules changed, e.g. after the expired rules
+ * of a user were refreshed. Their new expiration is read without rebuilding
+ * the index. */
+static errno_t sudosrv_index_update_expire(struct sudosrv_index *index,
+                                           struct sss_domain_info *domain,
+                                           uint64_t expire_generation,
+                                           time_t synced)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *attrs[] = { SYSDB_NAME, SYSDB_CACHE_EXPIRE, NULL };
+    struct ldb_message **msgs = NULL;
+    struct sudosrv_index_rule *rule;
+    const char *name;
+    char *filter;
+    hash_key_t key;
+    hash_value_t value;
+    size_t count;
+    size_t i;
+    errno_t ret;
+    int hret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    /* Rules stored since the expiration was last read expire later than
+     * that, the other rules that match keep their expiration. */
+    filter = talloc_asprintf(tmp_ctx, "(&("SYSDB_OBJECTCLASS"="
+                             SYSDB_SUDO_CACHE_OC")("SYSDB_CACHE_EXPIRE
+                             ">=%lld))", (long long) index->synced);
+    if (filter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_search_custom(tmp_ctx, domain, filter, SUDORULE_SUBDIR,
+                              attrs, &count, &msgs);
+    if (ret == ENOENT) {
+        count = 0;
+    } else if (ret != EOK) {
+        goto done;
+    }
+
+    key.type = HASH_KEY_STRING;
+    for (i = 0; i < count; i++) {
+        name = ldb_msg_find_attr_as_string(msgs[i], SYSDB_NAME, NULL);
+        if (name == NULL) {
+            continue;
+        }
+
+        key.str = discard_const(name);
+        hret = hash_lookup(index->by_name, &key, &value);
+        if (hret != HASH_SUCCESS) {
+            /* a new rule changes the generation of the rules */
+            DEBUG(SSSDBG_TRACE_FUNC, "Rule [%s] is not indexed\n", name);
+            ret = ENOENT;
+            goto done;
+        }
+
+        rule = &index->rules[value.ul];
+        rule->has_expire = true;
+        rule->expire = ldb_msg_find_attr_as_uint64(msgs[i],
+                                                   SYSDB_CACHE_EXPIRE, 0);
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Updated the expiration of %zu sudo rules of "
+          "domain [%s]\n", count, domain->name);
+
+    index->expire_generation = expire_generation;
+    index->synced = synced;
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+errno_t sudosrv_index_get(struct sudo_ctx *sudo_ctx,
+                          struct sss_domain_info *domain,
+                          struct sudosrv_index **_index)
+{
+    struct sudosrv_index *index;
+    struct sudosrv_index *new_index;
+    uint64_t generation;
+    uint64_t expire_generation;
+    time_t synced;
+    errno_t ret;
+
+    if (IS_SUBDOMAIN(domain)) {
+        /* rules are stored inside parent domain tree */
+        domain = domain->parent;
+    }
+
+    /* The generations must be read before the rules, if they change in the
+     * meantime the index is simply updated on the next request. */
+    synced = time(NULL);
+    ret = sysdb_sudo_get_rules_generation(domain, &generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read sudo rules generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    ret = sysdb_sudo_get_expire_generation(domain, &expire_generation);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to read sudo expire generation "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    DLIST_FOR_EACH(index, sudo_ctx->indexes) {
+        if (strcmp(index->domain, domain->name) == 0) {
+            break;
+        }
+    }
+
+    if (index != NULL && index->generation == generation) {
+        if (index->expire_generation == expire_generation) {
+            *_index = index;
+            return EOK;
+        }
+
+        ret = sudosrv_index_update_expire(index, domain, expire_generation,
+                                          synced);
+        if (ret == EOK) {
+            *_index = index;
+            return EOK;
+        }
+
+        DEBUG(SSSDBG_MINOR_FAILURE, "Unable to update the expiration of "
+              "sudo rules [%d]: %s\n", ret, sss_strerror(ret));
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Sudo rules of [%s] have changed, "
+          "rebuilding index\n", domain->name);
+
+    ret = sudosrv_index_build(sudo_ctx, domain, generation,
+                              expire_generation, synced,
+                              sudo_ctx->inverse_order, &new_index);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to build sudo rules index "
+              "[%d]: %s\n", ret, sss_strerror(ret));
+        return ret;
+    }
+
+    if (index != NULL) {
+        DLIST_REMOVE(sudo_ctx->indexes, index);
+        talloc_free(index);
+    }
+
+    DLIST_ADD(sudo_ctx->indexes, new_index);
+
+    *_index = new_index;
+    return EOK;
+}
+
+static errno_t sudosrv_index_collect(TALLOC_CTX *mem_ctx,
+                                     struct sudosrv_index_list *list,
+                                     size_t **_pos,
+                                     size_t *_count)
+{
+    size_t *pos;
+
+    if (list == NULL || list->count == 0) {
+        return EOK;
+    }
+
+    pos = talloc_realloc(mem_ctx, *_pos, size_t, *_count + list->count);
+    if (pos == NULL) {
+        return ENOMEM;
+    }
+
+    memcpy(pos + *_count, list->pos, list->count * sizeof(size_t));
+    *_pos = pos;
+    *_count += list->count;
+
+    return EOK;
+}
+
+static errno_t sudosrv_index_collect_user(TALLOC_CTX *mem_ctx,
+                                          struct sudosrv_index *index,
+                                          const char *user,
+                                          size_t **_pos,
+                                          size_t *_count)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(user);
+
+    hret = hash_lookup(index->by_user, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return EOK;
+    } else if (hret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_OP_FAILURE, "Unable to look up [%s] in the index "
+              "[%d]: %s\n", user, hret, hash_error_string(hret));
+        return EIO;
+    }
+
+    return sudosrv_index_collect(mem_ctx,
+                                 talloc_get_type(value.ptr,
+                                                 struct sudosrv_index_list),
+                                 _pos, _count);
+}
+
+static bool sudosrv_index_has_attrs(const char **attrs)
+{
+    size_t i;
+    size_t j;
+
+    /* all attributes were requested */
+    if (attrs == NULL) {
+        return false;
+    }
+
+    for (i = 0; attrs[i] != NULL; i++) {
+        for (j = 0; sudosrv_index_attrs[j] != NULL; j++) {
+            if (strcasecmp(attrs[i], sudosrv_index_attrs[j]) == 0) {
+                break;
+            }
+        }
+
+        if (sudosrv_index_attrs[j] == NULL) {
+            DEBUG(SSSDBG_TRACE_FUNC, "Attribute [%s] is not indexed\n",
+                  attrs[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Returns a new sysdb_attrs with only @attrs of @rule. Unless @copy is set,
+ * the values are shared with the index. */
+static errno_t sudosrv_index_project(TALLOC_CTX *mem_ctx,
+                                     struct sudosrv_index_rule *rule,
+                                     const char **attrs,
+                                     bool copy,
+                                     struct sysdb_attrs **_projected)
+{
+    struct sysdb_attrs *projected;
+    struct ldb_message_element *el;
+    size_t num_attrs;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    projected = sysdb_new_attrs(mem_ctx);
+    if (projected == NULL) {
+        return ENOMEM;
+    }
+
+    for (num_attrs = 0; attrs[num_attrs] != NULL; num_attrs++);
+
+    if (!copy) {
+        projected->a = talloc_array(projected, struct ldb_message_element,
+                                    num_attrs);
+        if (projected->a == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+    }
+
+    for (i = 0; i < num_attrs; i++) {
+        ret = sysdb_attrs_get_el_ext(rule->attrs, attrs[i], false, &el);
+        if (ret == ENOENT) {
+            continue;
+        } else if (ret != EOK) {
+            goto done;
+        }
+
+        if (!copy) {
+            projected->a[projected->num] = *el;
+            projected->num++;
+            continue;
+        }
+
+        for (j = 0; j < el->num_values; j++) {
+            ret = sysdb_attrs_add_val(projected, el->name, &el->values[j]);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    *_projected = projected;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(projected);
+    }
+    return ret;
+}
+
+static int sudosrv_index_pos_cmp(const void *a, const void *b)
+{
+    size_t p1 = *(const size_t *) a;
+    size_t p2 = *(const size_t *) b;
+
+    if (p1 == p2) {
+        return 0;
+    }
+
+    return p1 < p2 ? -1 : 1;
+}
+
+errno_t sudosrv_index_query(TALLOC_CTX *mem_ctx,
+                            struct sudosrv_index *index,
+                            const char **attrs,
+                            unsigned int flags,
+                            const char *username,
+                            uid_t uid,
+                            char **groupnames,
+                            struct sysdb_attrs ***_rules,
+                            uint32_t *_count)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index_rule *rule;
+    struct sudosrv_index_list all = { 0, NULL };
+    struct sysdb_attrs **rules;
+    size_t *pos = NULL;
+    size_t num_pos = 0;
+    size_t count;
+    size_t i;
+    char *key;
+    time_t now;
+    errno_t ret;
+
+    if (!sudosrv_index_has_attrs(attrs)) {
+        return ENOTSUP;
+    }
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    if (flags & SYSDB_SUDO_FILTER_INCLUDE_ALL) {
+        ret = sudosrv_index_collect_user(tmp_ctx, index, "ALL",
+                                         &pos, &num_pos);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if (flags & SYSDB_SUDO_FILTER_INCLUDE_DFL) {
+        ret = sudosrv_index_collect(tmp_ctx, &index->defaults,
+                                    &pos, &num_pos);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if ((flags & SYSDB_SUDO_FILTER_USERNAME) && (username != NULL)) {
+        ret = sudosrv_index_collect_user(tmp_ctx, index, username,
+                                         &pos, &num_pos);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if ((flags & SYSDB_SUDO_FILTER_UID) && (uid != 0)) {
+        key = talloc_asprintf(tmp_ctx, "#%llu", (unsigned long long) uid);
+        if (key == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sudosrv_index_collect_user(tmp_ctx, index, key, &pos, &num_pos);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if ((flags & SYSDB_SUDO_FILTER_GROUPS) && (groupnames != NULL)) {
+        for (i = 0; groupnames[i] != NULL; i++) {
+            key = talloc_asprintf(tmp_ctx, "%%%s", groupnames[i]);
+            if (key == NULL) {
+                ret = ENOMEM;
+                goto done;
+            }
+
+            ret = sudosrv_index_collect_user(tmp_ctx, index, key,
+                                             &pos, &num_pos);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+    }
+
+    if (flags & SYSDB_SUDO_FILTER_NGRS) {
+        ret = sudosrv_index_collect(tmp_ctx, &index->netgroups,
+                                    &pos, &num_pos);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if ((flags & SUDOSRV_INDEX_SELECTORS) == 0) {
+        /* the sysdb filter would match all rules as well */
+        for (i = 0; i < index->num_rules; i++) {
+            ret = sudosrv_index_list_add(tmp_ctx, &all, i);
+            if (ret != EOK) {
+                goto done;
+            }
+        }
+
+        ret = sudosrv_index_collect(tmp_ctx, &all, &pos, &num_pos);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    /* positions in the rule array preserve the sudoOrder sorting */
+    if (num_pos > 1) {
+        qsort(pos, num_pos, sizeof(size_t), sudosrv_index_pos_cmp);
+    }
+
+    rules = talloc_array(tmp_ctx, struct sysdb_attrs *, num_pos);
+    if (rules == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    now = time(NULL);
+    count = 0;
+    for (i = 0; i < num_pos; i++) {
+        if (i > 0 && pos[i] == pos[i - 1]) {
+            continue;
+        }
+
+        rule = &index->rules[pos[i]];
+
+        if ((flags & SYSDB_SUDO_FILTER_ONLY_EXPIRED)
+                && (!rule->has_expire || rule->expire > now)) {
+            continue;
+        }
+
+        /* expired rules are sent to the data provider and must not depend
+         * on the lifetime of the index */
+        ret = sudosrv_index_project(rules, rule, attrs,
+                                    flags & SYSDB_SUDO_FILTER_ONLY_EXPIRED,
+                                    &rules[count]);
+        if (ret != EOK) {
+            goto done;
+        }
+
+        count++;
+    }
+
+    *_rules = talloc_steal(mem_ctx, rules);
+    *_count = count;
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
@@ -40,6 +40,8 @@ enum sss_sudo_type {
     SSS_SUDO_USER
 };
 
+struct sudosrv_index;
+
 struct sudo_ctx {
     struct resp_ctx *rctx;
 
@@ -51,6 +53,9 @@ struct sudo_ctx {
      */
     bool timed;
     bool inverse_order;
+
+    /* per-domain indexes of cached rules, see sudosrv_index.c */
+    struct sudosrv_index *indexes;
 };
 
 struct sudo_cmd_ctx {
@@ -69,6 +74,27 @@ struct sudo_cmd_ctx {
 
 struct sss_cmd_table *get_sudo_cmds(void);
 
+/* Returns the index of cached rules of @domain, the index is rebuilt
+ * when the rules in sysdb have changed since it was created. */
+errno_t sudosrv_index_get(struct sudo_ctx *sudo_ctx,
+                          struct sss_domain_info *domain,
+                          struct sudosrv_index **_index);
+
+/* Returns rules matching the sysdb_get_sudo_filter() @flags, sorted by
+ * sudoOrder, with only the attributes listed in @attrs. ENOTSUP is returned
+ * if some of @attrs are not kept in the index. Unless
+ * SYSDB_SUDO_FILTER_ONLY_EXPIRED is set, the returned values are owned by
+ * the index and must not be used after returning to the main loop. */
+errno_t sudosrv_index_query(TALLOC_CTX *mem_ctx,
+                            struct sudosrv_index *index,
+                            const char **attrs,
+                            unsigned int flags,
+                            const char *username,
+                            uid_t uid,
+                            char **groupnames,
+                            struct sysdb_attrs ***_rules,
+                            uint32_t *_count);
+
 struct tevent_req *sudosrv_get_rules_send(TALLOC_CTX *mem_ctx,
                                           struct tevent_context *ev,
                                           struct sudo_ctx *sudo_ctx,
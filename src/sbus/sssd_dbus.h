@@ -276,8 +276,24 @@ struct sbus_request {
     struct sbus_interface *intf;
     const struct sbus_method_meta *method;
     const char *path;
+
+    /* Private data of the handlers, see sbus_request_set_object_data(). */
+    void *object_data;
 };
 
+/*
+ * Attach @data to the request so that the property getters which are
+ * invoked for the same request (e.g. by GetAll) can share the object they
+ * have looked up instead of fetching it again for every property.
+ *
+ * @data is stolen onto @dbus_req, any previously set data is freed. Set
+ * NULL to drop a cached object that is no longer valid.
+ */
+void sbus_request_set_object_data(struct sbus_request *dbus_req, void *data);
+
+#define sbus_request_get_object_data(dbus_req, type) \
+    talloc_get_type((dbus_req)->object_data, type)
+
 /*
  * Complete a DBus request, and free the @dbus_req context. The @dbus_req
  * and associated talloc context are no longer valid after this function
@@ -336,7 +336,7 @@ static int sbus_properties_get_all(struct sbus_request *sbus_req, void *pvt)
         DEBUG(SSSDBG_TRACE_FUNC, "No get all invoker set,"
               "using the default one\n");
 
-        sbus_invoke_get_all(sbus_req);
+        sbus_invoke_get_all(sbus_subreq);
     } else {
         iface->vtable->meta->invoker_get_all(sbus_subreq);
     }
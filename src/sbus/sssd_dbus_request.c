@@ -97,6 +97,16 @@ int sbus_request_finish(struct sbus_request *dbus_req,
     return talloc_free(dbus_req);
 }
 
+void sbus_request_set_object_data(struct sbus_request *dbus_req, void *data)
+{
+    if (dbus_req->object_data == data) {
+        return;
+    }
+
+    talloc_free(dbus_req->object_data);
+    dbus_req->object_data = talloc_steal(dbus_req, data);
+}
+
 static int sbus_request_valist_check(va_list va, int first_arg_type)
 {
     int ret = EOK;
@@ -625,6 +625,132 @@ out:
     return nret;
 }
 
+/* The _nomem_r calls return the group without members, the responder does
+ * not have to resolve them. They are meant for callers that only map names
+ * to GIDs and back and are not called by glibc. */
+static enum nss_status sss_nss_getgr_nomem(enum sss_cli_command cmd,
+                                           struct sss_cli_req_data *rd,
+                                           struct group *result,
+                                           char *buffer, size_t buflen,
+                                           int *errnop)
+{
+    struct sss_nss_gr_rep grrep;
+    uint8_t *repbuf;
+    size_t replen, len;
+    uint32_t num_results;
+    enum nss_status nret;
+    int ret;
+
+    sss_nss_lock();
+
+    /* The replies are not saved in the getgr cache, it holds complete
+     * groups only. */
+    nret = sss_nss_make_request(cmd, rd, &repbuf, &replen, errnop);
+    if (nret != NSS_STATUS_SUCCESS) {
+        goto out;
+    }
+
+    grrep.result = result;
+    grrep.buffer = buffer;
+    grrep.buflen = buflen;
+
+    /* Get number of results from repbuf. */
+    SAFEALIGN_COPY_UINT32(&num_results, repbuf, NULL);
+
+    /* no results if not found */
+    if (num_results == 0) {
+        free(repbuf);
+        nret = NSS_STATUS_NOTFOUND;
+        goto out;
+    }
+
+    /* only 1 result is accepted for this function */
+    if (num_results != 1) {
+        *errnop = EBADMSG;
+        free(repbuf);
+        nret = NSS_STATUS_TRYAGAIN;
+        goto out;
+    }
+
+    len = replen - 8;
+    ret = sss_nss_getgr_readrep(&grrep, repbuf+8, &len);
+    free(repbuf);
+    if (ret) {
+        *errnop = ret;
+        nret = NSS_STATUS_TRYAGAIN;
+        goto out;
+    }
+
+    nret = NSS_STATUS_SUCCESS;
+
+out:
+    sss_nss_unlock();
+    return nret;
+}
+
+enum nss_status _nss_sss_getgrnam_nomem_r(const char *name,
+                                          struct group *result,
+                                          char *buffer, size_t buflen,
+                                          int *errnop)
+{
+    struct sss_cli_req_data rd;
+    size_t name_len;
+    int ret;
+
+    if (!buffer || !buflen) {
+        *errnop = ERANGE;
+        return NSS_STATUS_TRYAGAIN;
+    }
+
+    ret = sss_strnlen(name, SSS_NAME_MAX, &name_len);
+    if (ret != 0) {
+        *errnop = EINVAL;
+        return NSS_STATUS_NOTFOUND;
+    }
+
+    /* A complete group from the mmaped cache is fine as well, but if its
+     * members do not fit into the buffer the group is requested without
+     * them. */
+    ret = sss_nss_mc_getgrnam(name, name_len, result, buffer, buflen);
+    if (ret == 0) {
+        *errnop = 0;
+        return NSS_STATUS_SUCCESS;
+    }
+
+    rd.len = name_len + 1;
+    rd.data = name;
+
+    return sss_nss_getgr_nomem(SSS_NSS_GETGRNAM_NOMEM, &rd,
+                               result, buffer, buflen, errnop);
+}
+
+enum nss_status _nss_sss_getgrgid_nomem_r(gid_t gid, struct group *result,
+                                          char *buffer, size_t buflen,
+                                          int *errnop)
+{
+    struct sss_cli_req_data rd;
+    uint32_t group_gid;
+    int ret;
+
+    if (!buffer || !buflen) {
+        *errnop = ERANGE;
+        return NSS_STATUS_TRYAGAIN;
+    }
+
+    ret = sss_nss_mc_getgrgid(gid, result, buffer, buflen);
+    if (ret == 0) {
+        *errnop = 0;
+        return NSS_STATUS_SUCCESS;
+    }
+
+    group_gid = gid;
+    rd.len = sizeof(uint32_t);
+    rd.data = &group_gid;
+
+    return sss_nss_getgr_nomem(SSS_NSS_GETGRGID_NOMEM, &rd,
+                               result, buffer, buflen, errnop);
+}
+
 enum nss_status _nss_sss_setgrent(void)
 {
     enum nss_status nret;
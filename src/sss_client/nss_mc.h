@@ -26,6 +26,7 @@
 #include <stdbool.h>
 #include <pwd.h>
 #include <grp.h>
+#include <netdb.h>
 #include "util/mmap_cache.h"
 
 #ifndef HAVE_ERRNO_T
@@ -90,4 +91,14 @@ errno_t sss_nss_mc_initgroups_dyn(const char *name, size_t name_len,
                                   gid_t group, long int *start, long int *size,
                                   gid_t **groups, long int limit);
 
+/* services db */
+errno_t sss_nss_mc_getservbyname(const char *name, size_t name_len,
+                                 const char *protocol, size_t proto_len,
+                                 struct servent *result,
+                                 char *buffer, size_t buflen);
+errno_t sss_nss_mc_getservbyport(int port,
+                                 const char *protocol, size_t proto_len,
+                                 struct servent *result,
+                                 char *buffer, size_t buflen);
+
 #endif /* _NSS_MC_H_ */
@@ -0,0 +1,312 @@
+/*
+ * System Security Services Daemon. NSS client interface
+ *
+ * Copyright (C) 2016 Red Hat
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* SERVICES database NSS interface using mmap cache */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include "nss_mc.h"
+#include "util/util_safealign.h"
+
+struct sss_cli_mc_ctx svc_mc_ctx = { UNINITIALIZED, -1, 0, NULL, 0, NULL, 0,
+                                     NULL, 0, 0 };
+
+static errno_t sss_nss_mc_parse_result(struct sss_mc_rec *rec,
+                                       struct servent *result,
+                                       char *buffer, size_t buflen)
+{
+    struct sss_mc_svc_data *data;
+    time_t expire;
+    void *cookie;
+    char *strbuf;
+    char *key;
+    size_t aliassize;
+    int ret;
+    int i;
+
+    /* additional checks before filling result*/
+    expire = rec->expire;
+    if (expire < time(NULL)) {
+        /* entry is now invalid */
+        return EINVAL;
+    }
+
+    data = (struct sss_mc_svc_data *)rec->data;
+
+    aliassize = (data->aliases + 1) * sizeof(char *);
+    if (data->strs_len + aliassize > buflen) {
+        return ERANGE;
+    }
+
+    /* fill in glibc provided structs */
+
+    /* copy in buffer */
+    strbuf = buffer + aliassize;
+    memcpy(strbuf, data->strs, data->strs_len);
+
+    /* fill in servent, the port is kept in network byte order */
+    result->s_port = htons((uint16_t)data->port);
+
+    /* The address &buffer[0] must be aligned to sizeof(char *) */
+    if (!IS_ALIGNED(buffer, char *)) {
+        /* The buffer is not properly aligned. */
+        return EFAULT;
+    }
+
+    result->s_aliases = DISCARD_ALIGN(buffer, char **);
+    result->s_aliases[data->aliases] = NULL;
+
+    cookie = NULL;
+    /* the lookup key is not part of the result */
+    ret = sss_nss_str_ptr_from_buffer(&key, &cookie,
+                                      strbuf, data->strs_len);
+    if (ret) {
+        return ret;
+    }
+    ret = sss_nss_str_ptr_from_buffer(&result->s_name, &cookie,
+                                      strbuf, data->strs_len);
+    if (ret) {
+        return ret;
+    }
+    ret = sss_nss_str_ptr_from_buffer(&result->s_proto, &cookie,
+                                      strbuf, data->strs_len);
+    if (ret) {
+        return ret;
+    }
+
+    for (i = 0; i < data->aliases; i++) {
+        ret = sss_nss_str_ptr_from_buffer(&result->s_aliases[i], &cookie,
+                                          strbuf, data->strs_len);
+        if (ret) {
+            return ret;
+        }
+    }
+    if (cookie != NULL) {
+        return EINVAL;
+    }
+
+    return 0;
+}
+
+errno_t sss_nss_mc_getservbyname(const char *name, size_t name_len,
+                                 const char *protocol, size_t proto_len,
+                                 struct servent *result,
+                                 char *buffer, size_t buflen)
+{
+    struct sss_mc_rec *rec = NULL;
+    struct sss_mc_svc_data *data;
+    char *rec_key;
+    char *key = NULL;
+    size_t key_len;
+    uint32_t hash;
+    uint32_t slot;
+    int ret;
+    const size_t strs_offset = offsetof(struct sss_mc_svc_data, strs);
+    size_t data_size;
+
+    ret = sss_nss_mc_get_ctx("services", &svc_mc_ctx);
+    if (ret) {
+        return ret;
+    }
+
+    /* Get max size of data table. */
+    data_size = svc_mc_ctx.dt_size;
+
+    /* records are keyed by "name/protocol" */
+    key_len = name_len + 1 + proto_len;
+    key = malloc(key_len + 1);
+    if (key == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+    memcpy(key, name, name_len);
+    key[name_len] = '/';
+    memcpy(key + name_len + 1, protocol, proto_len + 1);
+
+    /* hashes are calculated including the NULL terminator */
+    hash = sss_nss_mc_hash(&svc_mc_ctx, key, key_len + 1);
+    slot = svc_mc_ctx.hash_table[hash];
+
+    /* If slot is not within the bounds of mmaped region and
+     * it's value is not MC_INVALID_VAL, then the cache is
+     * probbably corrupted. */
+    while (MC_SLOT_WITHIN_BOUNDS(slot, data_size)) {
+        /* free record from previous iteration */
+        free(rec);
+        rec = NULL;
+
+        ret = sss_nss_mc_get_record(&svc_mc_ctx, slot, &rec);
+        if (ret) {
+            goto done;
+        }
+
+        /* check record matches what we are searching for */
+        if (hash != rec->hash1) {
+            /* if name hash does not match we can skip this immediately */
+            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            continue;
+        }
+
+        data = (struct sss_mc_svc_data *)rec->data;
+        /* Integrity check
+         * - key_len cannot be longer than all strings
+         * - data->name cannot point outside strings
+         * - all strings must be within copy of record
+         * - size of record must be lower that data table size */
+        if (key_len > data->strs_len
+            || (data->name + key_len) > (strs_offset + data->strs_len)
+            || data->strs_len > rec->len
+            || rec->len > data_size) {
+            ret = ENOENT;
+            goto done;
+        }
+
+        rec_key = (char *)data + data->name;
+        if (strcmp(key, rec_key) == 0) {
+            break;
+        }
+
+        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+    }
+
+    if (!MC_SLOT_WITHIN_BOUNDS(slot, data_size)) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    ret = sss_nss_mc_parse_result(rec, result, buffer, buflen);
+
+done:
+    free(key);
+    free(rec);
+    __sync_sub_and_fetch(&svc_mc_ctx.active_threads, 1);
+    return ret;
+}
+
+errno_t sss_nss_mc_getservbyport(int port,
+                                 const char *protocol, size_t proto_len,
+                                 struct servent *result,
+                                 char *buffer, size_t buflen)
+{
+    struct sss_mc_rec *rec = NULL;
+    struct sss_mc_svc_data *data;
+    char *key = NULL;
+    char *rec_key;
+    size_t rec_key_len;
+    uint16_t hport;
+    uint32_t hash;
+    uint32_t slot;
+    size_t key_len;
+    int len;
+    int ret;
+    const size_t strs_offset = offsetof(struct sss_mc_svc_data, strs);
+
+    ret = sss_nss_mc_get_ctx("services", &svc_mc_ctx);
+    if (ret) {
+        return ret;
+    }
+
+    /* port is passed in network byte order, records are keyed by
+     * "port/protocol" with the port in host byte order */
+    hport = ntohs((uint16_t)port);
+
+    key_len = 6 + proto_len;
+    key = malloc(key_len + 1);
+    if (key == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    len = snprintf(key, key_len + 1, "%u/%s", (unsigned int)hport, protocol);
+    if (len < 0 || (size_t)len > key_len) {
+        ret = EINVAL;
+        goto done;
+    }
+
+    /* hashes are calculated including the NULL terminator */
+    hash = sss_nss_mc_hash(&svc_mc_ctx, key, len + 1);
+    slot = svc_mc_ctx.hash_table[hash];
+
+    /* If slot is not within the bounds of mmaped region and
+     * it's value is not MC_INVALID_VAL, then the cache is
+     * probbably corrupted. */
+    while (MC_SLOT_WITHIN_BOUNDS(slot, svc_mc_ctx.dt_size)) {
+        /* free record from previous iteration */
+        free(rec);
+        rec = NULL;
+
+        ret = sss_nss_mc_get_record(&svc_mc_ctx, slot, &rec);
+        if (ret) {
+            goto done;
+        }
+
+        /* check record matches what we are searching for */
+        if (hash != rec->hash2) {
+            /* if port hash does not match we can skip this immediately */
+            slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+            continue;
+        }
+
+        data = (struct sss_mc_svc_data *)rec->data;
+        /* Integrity check
+         * - data->name cannot point outside strings
+         * - all strings must be within copy of record
+         * - size of record must be lower that data table size */
+        if (data->name < strs_offset
+            || data->name >= strs_offset + data->strs_len
+            || data->strs_len > rec->len
+            || rec->len > svc_mc_ctx.dt_size) {
+            ret = ENOENT;
+            goto done;
+        }
+
+        if (hport == data->port) {
+            /* the protocol is the end of the "name/protocol" key */
+            rec_key = (char *)data + data->name;
+            rec_key_len = strnlen(rec_key, strs_offset + data->strs_len
+                                           - data->name);
+            if (rec_key_len > proto_len
+                && rec_key[rec_key_len - proto_len - 1] == '/'
+                && strcmp(protocol, rec_key + rec_key_len - proto_len) == 0) {
+                break;
+            }
+        }
+
+        slot = sss_nss_mc_next_slot_with_hash(rec, hash);
+    }
+
+    if (!MC_SLOT_WITHIN_BOUNDS(slot, svc_mc_ctx.dt_size)) {
+        ret = ENOENT;
+        goto done;
+    }
+
+    ret = sss_nss_mc_parse_result(rec, result, buffer, buflen);
+
+done:
+    free(key);
+    free(rec);
+    __sync_sub_and_fetch(&svc_mc_ctx.active_threads, 1);
+    return ret;
+}
@@ -87,6 +87,11 @@ enum sss_cli_command {
     SSS_NSS_GETGRENT       = 0x0024,
     SSS_NSS_ENDGRENT       = 0x0025,
     SSS_NSS_INITGR         = 0x0026,
+    SSS_NSS_GETGRNAM_NOMEM = 0x0027, /**< Same as SSS_NSS_GETGRNAM but the
+                                      * reply never contains the members, so
+                                      * they do not have to be resolved */
+    SSS_NSS_GETGRGID_NOMEM = 0x0028, /**< Same as SSS_NSS_GETGRGID but the
+                                      * reply never contains the members */
 
 #if 0
 /* aliases */
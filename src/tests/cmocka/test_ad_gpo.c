@@ -329,6 +329,446 @@ void test_ad_gpo_ace_includes_client_sid_false(void **state)
                                         ace_dom_sid, false);
 }
 
+static struct gp_gpo *test_chain_gpo(TALLOC_CTX *mem_ctx, const char *guid)
+{
+    struct gp_gpo *gpo;
+
+    gpo = talloc_zero(mem_ctx, struct gp_gpo);
+    assert_non_null(gpo);
+
+    gpo->gpo_dn = talloc_asprintf(gpo, "cn=%s,cn=policies,dc=foo,dc=com",
+                                  guid);
+    gpo->gpo_guid = talloc_strdup(gpo, guid);
+    gpo->smb_server = talloc_strdup(gpo, "smb://adserver.foo.com");
+    gpo->smb_share = talloc_strdup(gpo, "SysVol");
+    gpo->smb_path = talloc_asprintf(gpo, "/foo.com/Policies/%s", guid);
+    gpo->gpc_version = 3;
+    assert_non_null(gpo->gpo_dn);
+    assert_non_null(gpo->gpo_guid);
+    assert_non_null(gpo->smb_server);
+    assert_non_null(gpo->smb_share);
+    assert_non_null(gpo->smb_path);
+
+    return gpo;
+}
+
+void test_ad_gpo_chain(void **state)
+{
+    struct ad_access_ctx *access_ctx;
+    struct ad_gpo_chain *chain;
+    struct gp_gpo **gpos;
+    struct gp_gpo **copy;
+    errno_t ret;
+
+    access_ctx = talloc_zero(test_ctx, struct ad_access_ctx);
+    assert_non_null(access_ctx);
+    access_ctx->gpo_cache_timeout = 5;
+
+    assert_null(ad_gpo_chain_lookup(access_ctx));
+
+    gpos = talloc_zero_array(test_ctx, struct gp_gpo *, 3);
+    assert_non_null(gpos);
+    gpos[0] = test_chain_gpo(gpos, "{31B2F340-016D-11D2-945F-00C04FB984F9}");
+    gpos[1] = test_chain_gpo(gpos, "{6AC1786C-016F-11D2-945F-00C04FB984F9}");
+
+    ret = ad_gpo_chain_store(access_ctx, gpos, 2);
+    assert_int_equal(ret, EOK);
+
+    chain = ad_gpo_chain_lookup(access_ctx);
+    assert_non_null(chain);
+    assert_int_equal(chain->num_gpos, 2);
+
+    /* the evaluation works on a copy that outlives the chain */
+    ret = ad_gpo_chain_copy(test_ctx, chain, &copy);
+    assert_int_equal(ret, EOK);
+    assert_non_null(copy[0]);
+    assert_non_null(copy[1]);
+    assert_null(copy[2]);
+    copy[1]->send_to_child = true;
+    assert_false(chain->gpos[1]->send_to_child);
+
+    ret = ad_gpo_chain_store(access_ctx, NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    assert_string_equal(copy[0]->gpo_guid,
+                        "{31B2F340-016D-11D2-945F-00C04FB984F9}");
+    assert_string_equal(copy[1]->smb_path,
+                        "/foo.com/Policies/{6AC1786C-016F-11D2-945F-00C04FB984F9}");
+    assert_int_equal(copy[1]->gpc_version, 3);
+    talloc_free(copy);
+
+    /* no GPOs apply is remembered as well */
+    chain = ad_gpo_chain_lookup(access_ctx);
+    assert_non_null(chain);
+    assert_int_equal(chain->num_gpos, 0);
+
+    chain->expire = time(NULL) - 1;
+    assert_null(ad_gpo_chain_lookup(access_ctx));
+
+    /* a zero timeout disables the cache */
+    access_ctx->gpo_cache_timeout = 0;
+    ret = ad_gpo_chain_store(access_ctx, NULL, 0);
+    assert_int_equal(ret, EOK);
+    assert_null(ad_gpo_chain_lookup(access_ctx));
+
+    talloc_free(access_ctx);
+}
+
+#define TEST_CHAIN_GPOS 12
+
+void test_ad_gpo_chain_replaced(void **state)
+{
+    struct ad_access_ctx *access_ctx;
+    struct gp_gpo **gpos;
+    struct gp_gpo **copy;
+    struct gp_gpo *gpo;
+    char *guid;
+    errno_t ret;
+    int i;
+
+    access_ctx = talloc_zero(test_ctx, struct ad_access_ctx);
+    assert_non_null(access_ctx);
+    access_ctx->gpo_cache_timeout = 5;
+
+    /* more GPOs than are downloaded in parallel */
+    gpos = talloc_zero_array(test_ctx, struct gp_gpo *, TEST_CHAIN_GPOS + 1);
+    assert_non_null(gpos);
+    for (i = 0; i < TEST_CHAIN_GPOS; i++) {
+        guid = talloc_asprintf(gpos, "{%08X-016D-11D2-945F-00C04FB984F9}", i);
+        assert_non_null(guid);
+
+        gpo = test_chain_gpo(gpos, guid);
+        gpo->gpo_sd = talloc_zero(gpo, struct security_descriptor);
+        assert_non_null(gpo->gpo_sd);
+        gpo->gpo_sd->revision = SECURITY_DESCRIPTOR_REVISION_1;
+
+        gpo->gpo_cse_guids = talloc_zero_array(gpo, const char *, 2);
+        assert_non_null(gpo->gpo_cse_guids);
+        gpo->gpo_cse_guids[0] = talloc_strdup(gpo->gpo_cse_guids,
+                                              GP_EXT_GUID_SECURITY);
+        assert_non_null(gpo->gpo_cse_guids[0]);
+        gpo->num_gpo_cse_guids = 1;
+
+        gpos[i] = gpo;
+        talloc_free(guid);
+    }
+
+    ret = ad_gpo_chain_store(access_ctx, gpos, TEST_CHAIN_GPOS);
+    assert_int_equal(ret, EOK);
+
+    ret = ad_gpo_chain_copy(test_ctx, ad_gpo_chain_lookup(access_ctx), &copy);
+    assert_int_equal(ret, EOK);
+
+    /* another request replaces the chain while the downloads of the first
+     * GPOs are in progress, twice */
+    ret = ad_gpo_chain_store(access_ctx, NULL, 0);
+    assert_int_equal(ret, EOK);
+    ret = ad_gpo_chain_store(access_ctx, NULL, 0);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(ad_gpo_chain_lookup(access_ctx)->num_gpos, 0);
+
+    /* the rest of the GPOs is still usable by the first evaluation, the
+     * security descriptor is only needed before the downloads start */
+    for (i = 0; i < TEST_CHAIN_GPOS; i++) {
+        assert_non_null(copy[i]);
+        assert_string_equal(copy[i]->smb_share, "SysVol");
+        assert_int_equal(copy[i]->num_gpo_cse_guids, 1);
+        assert_string_equal(copy[i]->gpo_cse_guids[0], GP_EXT_GUID_SECURITY);
+        assert_true(ad_gpo_includes_cse_guid(GP_EXT_GUID_SECURITY,
+                                             copy[i]->gpo_cse_guids,
+                                             copy[i]->num_gpo_cse_guids));
+    }
+    assert_null(copy[TEST_CHAIN_GPOS]);
+
+    talloc_free(copy);
+    talloc_free(access_ctx);
+}
+
+void test_ad_gpo_candidates_digest(void **state)
+{
+    struct be_access_cache *cache;
+    struct gp_gpo *gpos[2];
+    struct gp_gpo *tmp;
+    uint64_t digest;
+    int decision;
+    errno_t ret;
+
+    gpos[0] = test_chain_gpo(test_ctx,
+                             "{31B2F340-016D-11D2-945F-00C04FB984F9}");
+    gpos[1] = test_chain_gpo(test_ctx,
+                             "{6AC1786C-016F-11D2-945F-00C04FB984F9}");
+
+    ret = be_access_cache_init(test_ctx, 60, &cache);
+    assert_int_equal(ret, EOK);
+
+    digest = ad_gpo_candidates_digest(gpos, 2);
+    be_access_cache_set_version(cache, digest);
+    ret = be_access_cache_store(cache, "user", "sshd", "host", 6);
+    assert_int_equal(ret, EOK);
+
+    /* the same GPOs keep the decision */
+    be_access_cache_set_version(cache, ad_gpo_candidates_digest(gpos, 2));
+    ret = be_access_cache_lookup(cache, "user", "sshd", "host", &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 6);
+
+    /* a changed GPO drops it */
+    gpos[1]->gpc_version++;
+    assert_true(ad_gpo_candidates_digest(gpos, 2) != digest);
+    be_access_cache_set_version(cache, ad_gpo_candidates_digest(gpos, 2));
+    ret = be_access_cache_lookup(cache, "user", "sshd", "host", &decision);
+    assert_int_equal(ret, ENOENT);
+    gpos[1]->gpc_version--;
+    assert_true(ad_gpo_candidates_digest(gpos, 2) == digest);
+
+    /* so does a changed precedence of the GPOs */
+    tmp = gpos[0];
+    gpos[0] = gpos[1];
+    gpos[1] = tmp;
+    assert_true(ad_gpo_candidates_digest(gpos, 2) != digest);
+
+    talloc_free(cache);
+    talloc_free(gpos[0]);
+    talloc_free(gpos[1]);
+}
+
+/*
+ * The policy file downloads are driven by ad_gpo_cse_step(); the gpo_child
+ * requests are replaced by requests the tests complete by hand.
+ */
+#define TEST_CSE_GPOS 10
+#define TEST_CSE_GPT_VERSION 5
+
+struct test_cse_ctx {
+    struct tevent_req *req;
+    struct ad_gpo_access_state *state;
+
+    struct tevent_req *fetches[TEST_CSE_GPOS];
+    bool send_to_child[TEST_CSE_GPOS];
+    int num_fetches;
+};
+
+static struct test_cse_ctx *cse_ctx;
+
+struct tevent_req *
+__wrap_ad_gpo_process_cse_send(TALLOC_CTX *mem_ctx,
+                               struct tevent_context *ev,
+                               bool send_to_child,
+                               struct sss_domain_info *domain,
+                               const char *gpo_guid,
+                               const char *smb_server,
+                               const char *smb_share,
+                               const char *smb_path,
+                               const char *smb_cse_suffix,
+                               int cached_gpt_version,
+                               int gpo_timeout_option)
+{
+    struct tevent_req *req;
+    int *dummy;
+
+    assert_true(cse_ctx->num_fetches < TEST_CSE_GPOS);
+
+    req = tevent_req_create(mem_ctx, &dummy, int);
+    assert_non_null(req);
+
+    cse_ctx->fetches[cse_ctx->num_fetches] = req;
+    cse_ctx->send_to_child[cse_ctx->num_fetches] = send_to_child;
+    cse_ctx->num_fetches++;
+
+    return req;
+}
+
+int __wrap_ad_gpo_process_cse_recv(struct tevent_req *req)
+{
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+    return EOK;
+}
+
+/* every GPO is cached with the same version, the policy files expired */
+errno_t __wrap_sysdb_gpo_get_gpo_by_guid(TALLOC_CTX *mem_ctx,
+                                         struct sss_domain_info *domain,
+                                         const char *gpo_guid,
+                                         struct ldb_result **_result)
+{
+    struct ldb_result *res;
+    int ret;
+
+    res = talloc_zero(mem_ctx, struct ldb_result);
+    assert_non_null(res);
+    res->msgs = talloc_zero_array(res, struct ldb_message *, 2);
+    assert_non_null(res->msgs);
+    res->msgs[0] = ldb_msg_new(res->msgs);
+    assert_non_null(res->msgs[0]);
+    res->count = 1;
+
+    ret = ldb_msg_add_fmt(res->msgs[0], SYSDB_GPO_VERSION_ATTR, "%d",
+                          TEST_CSE_GPT_VERSION);
+    assert_int_equal(ret, LDB_SUCCESS);
+    ret = ldb_msg_add_fmt(res->msgs[0], SYSDB_GPO_TIMEOUT_ATTR, "%d", 0);
+    assert_int_equal(ret, LDB_SUCCESS);
+
+    *_result = res;
+    return EOK;
+}
+
+static int test_cse_setup(void **state)
+{
+    struct ad_access_ctx *access_ctx;
+    char *guid;
+    errno_t ret;
+    int i;
+
+    ad_gpo_test_setup(state);
+
+    cse_ctx = talloc_zero(test_ctx, struct test_cse_ctx);
+    assert_non_null(cse_ctx);
+
+    cse_ctx->req = tevent_req_create(cse_ctx, &cse_ctx->state,
+                                     struct ad_gpo_access_state);
+    assert_non_null(cse_ctx->req);
+
+    cse_ctx->state->ev = tevent_context_init(cse_ctx->state);
+    assert_non_null(cse_ctx->state->ev);
+
+    access_ctx = talloc_zero(cse_ctx->state, struct ad_access_ctx);
+    assert_non_null(access_ctx);
+    ret = be_access_cache_init(access_ctx, 60,
+                               &access_ctx->gpo_decision_cache);
+    assert_int_equal(ret, EOK);
+    cse_ctx->state->access_ctx = access_ctx;
+
+    cse_ctx->state->cse_filtered_gpos = talloc_zero_array(cse_ctx->state,
+                                                          struct gp_gpo *,
+                                                          TEST_CSE_GPOS + 1);
+    assert_non_null(cse_ctx->state->cse_filtered_gpos);
+    for (i = 0; i < TEST_CSE_GPOS; i++) {
+        guid = talloc_asprintf(cse_ctx, "{%08X-016D-11D2-945F-00C04FB984F9}",
+                               i);
+        assert_non_null(guid);
+        cse_ctx->state->cse_filtered_gpos[i] =
+                test_chain_gpo(cse_ctx->state->cse_filtered_gpos, guid);
+        talloc_free(guid);
+    }
+    cse_ctx->state->num_cse_filtered_gpos = TEST_CSE_GPOS;
+
+    return 0;
+}
+
+static int test_cse_teardown(void **state)
+{
+    talloc_zfree(cse_ctx);
+    return ad_gpo_test_teardown(state);
+}
+
+static void test_cse_finish(int i, errno_t ret)
+{
+    struct tevent_req *fetch = cse_ctx->fetches[i];
+
+    assert_non_null(fetch);
+    cse_ctx->fetches[i] = NULL;
+
+    if (ret == EOK) {
+        tevent_req_done(fetch);
+    } else {
+        tevent_req_error(fetch, ret);
+    }
+}
+
+void test_ad_gpo_cse_max_parallel(void **state)
+{
+    errno_t ret;
+    int i;
+
+    ret = ad_gpo_cse_step(cse_ctx->req);
+    assert_int_equal(ret, EAGAIN);
+    assert_int_equal(cse_ctx->num_fetches, AD_GPO_CSE_MAX_PARALLEL);
+    assert_int_equal(cse_ctx->state->cse_pending, AD_GPO_CSE_MAX_PARALLEL);
+
+    /* each finished download makes room for the next one */
+    test_cse_finish(3, EOK);
+    assert_int_equal(cse_ctx->num_fetches, AD_GPO_CSE_MAX_PARALLEL + 1);
+    test_cse_finish(0, EOK);
+    assert_int_equal(cse_ctx->num_fetches, TEST_CSE_GPOS);
+    assert_int_equal(cse_ctx->state->cse_pending, AD_GPO_CSE_MAX_PARALLEL);
+
+    /* the last GPO is already being downloaded */
+    test_cse_finish(1, EOK);
+    assert_int_equal(cse_ctx->num_fetches, TEST_CSE_GPOS);
+    assert_int_equal(cse_ctx->state->cse_pending,
+                     AD_GPO_CSE_MAX_PARALLEL - 1);
+    assert_true(tevent_req_is_in_progress(cse_ctx->req));
+
+    for (i = 0; i < TEST_CSE_GPOS; i++) {
+        assert_true(cse_ctx->send_to_child[i]);
+    }
+}
+
+void test_ad_gpo_cse_error_pending(void **state)
+{
+    errno_t ret;
+    int i;
+
+    ret = ad_gpo_cse_step(cse_ctx->req);
+    assert_int_equal(ret, EAGAIN);
+    assert_int_equal(cse_ctx->num_fetches, AD_GPO_CSE_MAX_PARALLEL);
+
+    /* no download is started after a failure and the request waits for
+     * the ones in progress */
+    test_cse_finish(2, EIO);
+    assert_int_equal(cse_ctx->state->cse_error, EIO);
+    assert_int_equal(cse_ctx->num_fetches, AD_GPO_CSE_MAX_PARALLEL);
+    assert_true(tevent_req_is_in_progress(cse_ctx->req));
+
+    test_cse_finish(5, ENOMEM);
+    assert_int_equal(cse_ctx->state->cse_error, EIO);
+
+    for (i = 0; i < AD_GPO_CSE_MAX_PARALLEL; i++) {
+        if (cse_ctx->fetches[i] == NULL) {
+            continue;
+        }
+
+        assert_true(tevent_req_is_in_progress(cse_ctx->req));
+        test_cse_finish(i, EOK);
+    }
+
+    /* the first error is reported once the last download finished */
+    assert_int_equal(cse_ctx->state->cse_pending, 0);
+    assert_int_equal(cse_ctx->num_fetches, AD_GPO_CSE_MAX_PARALLEL);
+    assert_false(tevent_req_is_in_progress(cse_ctx->req));
+    assert_true(tevent_req_is_unix_error(cse_ctx->req, &ret));
+    assert_int_equal(ret, EIO);
+}
+
+void test_ad_gpo_cse_version_skip(void **state)
+{
+    struct gp_gpo **gpos = cse_ctx->state->cse_filtered_gpos;
+    errno_t ret;
+
+    /* the version in LDAP is the one of the cached policy files */
+    gpos[0]->gpc_version = TEST_CSE_GPT_VERSION;
+    ret = ad_gpo_cse_start(cse_ctx->req, gpos[0]);
+    assert_int_equal(ret, EOK);
+    assert_false(gpos[0]->send_to_child);
+    assert_int_equal(gpos[0]->cached_gpt_version, TEST_CSE_GPT_VERSION);
+
+    /* a newer version is downloaded */
+    gpos[1]->gpc_version = TEST_CSE_GPT_VERSION + 1;
+    ret = ad_gpo_cse_start(cse_ctx->req, gpos[1]);
+    assert_int_equal(ret, EOK);
+    assert_true(gpos[1]->send_to_child);
+
+    /* so is a GPO without a versionNumber */
+    gpos[2]->gpc_version = -1;
+    ret = ad_gpo_cse_start(cse_ctx->req, gpos[2]);
+    assert_int_equal(ret, EOK);
+    assert_true(gpos[2]->send_to_child);
+
+    assert_int_equal(cse_ctx->num_fetches, 3);
+    assert_false(cse_ctx->send_to_child[0]);
+    assert_true(cse_ctx->send_to_child[1]);
+    assert_true(cse_ctx->send_to_child[2]);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -364,6 +804,24 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_ad_gpo_ace_includes_client_sid_false,
                                         ad_gpo_test_setup,
                                         ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_chain,
+                                        ad_gpo_test_setup,
+                                        ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_chain_replaced,
+                                        ad_gpo_test_setup,
+                                        ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_candidates_digest,
+                                        ad_gpo_test_setup,
+                                        ad_gpo_test_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_cse_max_parallel,
+                                        test_cse_setup,
+                                        test_cse_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_cse_error_pending,
+                                        test_cse_setup,
+                                        test_cse_teardown),
+        cmocka_unit_test_setup_teardown(test_ad_gpo_cse_version_skip,
+                                        test_cse_setup,
+                                        test_cse_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
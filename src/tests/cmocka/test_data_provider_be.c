@@ -21,7 +21,9 @@
 #include <popt.h>
 #include <time.h>
 
-#include "providers/dp_backend.h"
+/* In order to access opaque types */
+#include "providers/data_provider_be.c"
+
 #include "tests/cmocka/common_mock.h"
 #include "tests/cmocka/common_mock_be.h"
 #include "tests/common.h"
@@ -36,6 +38,7 @@
 
 static TALLOC_CTX *global_mock_context = NULL;
 static bool global_timer_added;
+static bool global_replied;
 
 struct tevent_timer *__real__tevent_add_timer(struct tevent_context *ev,
                                               TALLOC_CTX *mem_ctx,
@@ -60,6 +63,13 @@ struct tevent_timer *__wrap__tevent_add_timer(struct tevent_context *ev,
                                     location);
 }
 
+int __wrap_sbus_request_return_and_finish(struct sbus_request *dbus_req,
+                                          int first_arg_type,
+                                          ...)
+{
+    global_replied = true;
+    return EOK;
+}
 
 struct test_ctx {
     struct sss_test_ctx *tctx;
@@ -199,6 +209,132 @@ static void test_mark_subdom_offline_disabled(void **state)
                         DOM_DISABLED);
 }
 
+/* What the ID handler saw of the request */
+struct test_acct_seen {
+    bool handled;
+    bool same_trace;
+    char *trace_id;
+    char *trace_desc;
+    bool received;
+    bool dispatched;
+    bool connected;
+};
+
+static struct test_acct_seen global_acct_seen;
+
+static void test_acct_handler(struct be_req *be_req)
+{
+    struct be_acct_req *ar;
+
+    ar = talloc_get_type(be_req_get_data(be_req), struct be_acct_req);
+    assert_non_null(ar);
+
+    global_acct_seen.handled = true;
+    global_acct_seen.same_trace = (ar->trace == be_req->trace);
+    if (ar->trace != NULL) {
+        global_acct_seen.trace_id = talloc_strdup(be_req->be_ctx,
+                                                  ar->trace->id);
+        global_acct_seen.trace_desc = talloc_strdup(be_req->be_ctx,
+                                                    ar->trace->desc);
+        global_acct_seen.received = !tevent_timeval_is_zero(
+                                   &ar->trace->points[BE_TRACE_RECEIVED]);
+        global_acct_seen.dispatched = !tevent_timeval_is_zero(
+                                   &ar->trace->points[BE_TRACE_DISPATCHED]);
+        global_acct_seen.connected = !tevent_timeval_is_zero(
+                                   &ar->trace->points[BE_TRACE_CONNECTED]);
+    }
+
+    be_req_terminate(be_req, DP_ERR_OK, EOK, NULL);
+}
+
+static struct bet_ops test_id_ops = {
+    .handler = test_acct_handler,
+    .finalize = NULL,
+};
+
+/* Sends a getAccountInfo request the way the responder does. */
+static void test_get_account_info(struct test_ctx *test_ctx,
+                                  const char *trace_id)
+{
+    struct sbus_request *dbus_req;
+    struct be_client *becli;
+    dbus_uint32_t type = BE_REQ_USER;
+    dbus_uint32_t attrs = BE_ATTR_CORE;
+    const char *filter = "name=testuser";
+    const char *domain = TEST_DOM_NAME;
+    dbus_bool_t dbret;
+    int ret;
+
+    memset(&global_acct_seen, 0, sizeof(struct test_acct_seen));
+    global_replied = false;
+
+    test_ctx->be_ctx->bet_info[BET_ID].bet_ops = &test_id_ops;
+
+    becli = talloc_zero(test_ctx, struct be_client);
+    assert_non_null(becli);
+    becli->bectx = test_ctx->be_ctx;
+
+    dbus_req = talloc_zero(test_ctx, struct sbus_request);
+    assert_non_null(dbus_req);
+
+    dbus_req->message = dbus_message_new_method_call(NULL, DP_PATH,
+                                        DATA_PROVIDER_IFACE,
+                                        DATA_PROVIDER_IFACE_GETACCOUNTINFO);
+    assert_non_null(dbus_req->message);
+
+    dbret = dbus_message_append_args(dbus_req->message,
+                                     DBUS_TYPE_UINT32, &type,
+                                     DBUS_TYPE_UINT32, &attrs,
+                                     DBUS_TYPE_STRING, &filter,
+                                     DBUS_TYPE_STRING, &domain,
+                                     DBUS_TYPE_STRING, &trace_id,
+                                     DBUS_TYPE_INVALID);
+    assert_true(dbret);
+
+    ret = be_get_account_info(dbus_req, becli);
+    assert_int_equal(ret, EOK);
+
+    /* the handler is dispatched from the event loop */
+    assert_false(global_acct_seen.handled);
+    while (!global_replied) {
+        tevent_loop_once(test_ctx->tctx->ev);
+    }
+    assert_true(global_acct_seen.handled);
+
+    dbus_message_unref(dbus_req->message);
+    talloc_free(dbus_req);
+    talloc_free(becli);
+}
+
+static void test_get_account_info_trace(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    test_get_account_info(test_ctx, "4242.17");
+
+    /* the ID from the responder reaches the provider handler */
+    assert_true(global_acct_seen.same_trace);
+    assert_non_null(global_acct_seen.trace_id);
+    assert_string_equal(global_acct_seen.trace_id, "4242.17");
+    assert_string_equal(global_acct_seen.trace_desc,
+                        "BE_REQ_USER name=testuser@"TEST_DOM_NAME);
+
+    /* the provider did not mark the connection point */
+    assert_true(global_acct_seen.received);
+    assert_true(global_acct_seen.dispatched);
+    assert_false(global_acct_seen.connected);
+}
+
+static void test_get_account_info_no_trace(void **state)
+{
+    struct test_ctx *test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    test_get_account_info(test_ctx, "");
+
+    assert_true(global_acct_seen.same_trace);
+    assert_null(global_acct_seen.trace_id);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -223,6 +359,12 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_mark_subdom_offline_disabled,
                                         test_setup,
                                         test_teardown),
+        cmocka_unit_test_setup_teardown(test_get_account_info_trace,
+                                        test_setup,
+                                        test_teardown),
+        cmocka_unit_test_setup_teardown(test_get_account_info_no_trace,
+                                        test_setup,
+                                        test_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
@@ -0,0 +1,362 @@
+/*
+    SSSD
+
+    Access control decision cache - tests
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <popt.h>
+#include <unistd.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "db/sysdb.h"
+#include "providers/dp_access_cache.h"
+
+#define TEST_TTL 60
+
+struct access_cache_test_ctx {
+    struct be_access_cache *cache;
+};
+
+static int test_setup(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct access_cache_test_ctx);
+    assert_non_null(test_ctx);
+
+    ret = be_access_cache_init(test_ctx, TEST_TTL, &test_ctx->cache);
+    assert_int_equal(ret, EOK);
+
+    check_leaks_push(test_ctx);
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_teardown(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_cache_test_ctx);
+
+    assert_true(check_leaks_pop(test_ctx));
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+void test_access_cache_miss(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+    int decision;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_cache_test_ctx);
+
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, ENOENT);
+}
+
+void test_access_cache_hit(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+    int decision;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_cache_test_ctx);
+
+    ret = be_access_cache_store(test_ctx->cache, "user", "sshd", "host", 6);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_store(test_ctx->cache, "user", "crond", NULL, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 6);
+
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "crond", NULL,
+                                 &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 0);
+
+    /* different host */
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "sshd", "other",
+                                 &decision);
+    assert_int_equal(ret, ENOENT);
+
+    /* overwrite */
+    ret = be_access_cache_store(test_ctx->cache, "user", "sshd", "host", 0);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 0);
+
+    be_access_cache_invalidate(test_ctx->cache);
+}
+
+void test_access_cache_version(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+    int decision;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_cache_test_ctx);
+
+    be_access_cache_set_version(test_ctx->cache, 1);
+
+    ret = be_access_cache_store(test_ctx->cache, "user", "sshd", "host", 6);
+    assert_int_equal(ret, EOK);
+
+    /* same version keeps the decisions */
+    be_access_cache_set_version(test_ctx->cache, 1);
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 6);
+
+    /* new version drops them */
+    be_access_cache_set_version(test_ctx->cache, 2);
+    ret = be_access_cache_lookup(test_ctx->cache, "user", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, ENOENT);
+
+    be_access_cache_invalidate(test_ctx->cache);
+}
+
+void test_access_cache_ttl(void **state)
+{
+    struct be_access_cache *cache;
+    int decision;
+    errno_t ret;
+
+    ret = be_access_cache_init(global_talloc_context, 1, &cache);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_store(cache, "user", "sshd", "host", 6);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(cache, "user", "sshd", "host", &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 6);
+
+    sleep(2);
+
+    ret = be_access_cache_lookup(cache, "user", "sshd", "host", &decision);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(cache);
+}
+
+static struct sysdb_attrs *test_rule(TALLOC_CTX *mem_ctx,
+                                     const char *name,
+                                     const char *enabled,
+                                     const char **users)
+{
+    struct sysdb_attrs *rule;
+    errno_t ret;
+    int i;
+
+    rule = sysdb_new_attrs(mem_ctx);
+    assert_non_null(rule);
+
+    ret = sysdb_attrs_add_string(rule, "cn", name);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_attrs_add_string(rule, "ipaEnabledFlag", enabled);
+    assert_int_equal(ret, EOK);
+
+    for (i = 0; users[i] != NULL; i++) {
+        ret = sysdb_attrs_add_string(rule, "memberUser", users[i]);
+        assert_int_equal(ret, EOK);
+    }
+
+    return rule;
+}
+
+static uint64_t test_rules_digest(struct sysdb_attrs *rule1,
+                                  struct sysdb_attrs *rule2)
+{
+    struct be_access_digest digest;
+    struct sysdb_attrs *rules[] = { rule1, rule2 };
+    errno_t ret;
+
+    be_access_digest_init(&digest);
+    ret = be_access_digest_add_attrs(&digest, 2, rules);
+    assert_int_equal(ret, EOK);
+
+    return be_access_digest_value(&digest);
+}
+
+void test_access_digest_attrs(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+    TALLOC_CTX *tmp_ctx;
+    uint64_t digest;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_cache_test_ctx);
+
+    tmp_ctx = talloc_new(test_ctx);
+    assert_non_null(tmp_ctx);
+
+    digest = test_rules_digest(
+                test_rule(tmp_ctx, "rule1", "TRUE",
+                          (const char *[]) { "u1", "u2", NULL }),
+                test_rule(tmp_ctx, "rule2", "FALSE",
+                          (const char *[]) { "u3", NULL }));
+
+    /* the order of the rules and of the values does not matter */
+    assert_true(test_rules_digest(
+                test_rule(tmp_ctx, "rule2", "FALSE",
+                          (const char *[]) { "u3", NULL }),
+                test_rule(tmp_ctx, "rule1", "TRUE",
+                          (const char *[]) { "u2", "u1", NULL })) == digest);
+
+    /* a value moved to the other rule changes it */
+    assert_true(test_rules_digest(
+                test_rule(tmp_ctx, "rule1", "TRUE",
+                          (const char *[]) { "u1", NULL }),
+                test_rule(tmp_ctx, "rule2", "FALSE",
+                          (const char *[]) { "u2", "u3", NULL })) != digest);
+
+    /* and so do swapped enabled flags */
+    assert_true(test_rules_digest(
+                test_rule(tmp_ctx, "rule1", "FALSE",
+                          (const char *[]) { "u1", "u2", NULL }),
+                test_rule(tmp_ctx, "rule2", "TRUE",
+                          (const char *[]) { "u3", NULL })) != digest);
+
+    talloc_free(tmp_ctx);
+}
+
+void test_access_cache_rule_changed(void **state)
+{
+    struct access_cache_test_ctx *test_ctx;
+    struct sysdb_attrs *rule1;
+    struct sysdb_attrs *rule2;
+    int decision;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct access_cache_test_ctx);
+
+    rule1 = test_rule(test_ctx, "rule1", "TRUE",
+                      (const char *[]) { "u1", NULL });
+    rule2 = test_rule(test_ctx, "rule2", "TRUE",
+                      (const char *[]) { "u2", NULL });
+
+    be_access_cache_set_version(test_ctx->cache,
+                                test_rules_digest(rule1, rule2));
+
+    ret = be_access_cache_store(test_ctx->cache, "u1", "sshd", "host", 0);
+    assert_int_equal(ret, EOK);
+
+    /* the rules are downloaded again unchanged */
+    be_access_cache_set_version(test_ctx->cache,
+                                test_rules_digest(rule2, rule1));
+    ret = be_access_cache_lookup(test_ctx->cache, "u1", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(decision, 0);
+
+    /* rule1 was disabled on the server */
+    talloc_free(rule1);
+    rule1 = test_rule(test_ctx, "rule1", "FALSE",
+                      (const char *[]) { "u1", NULL });
+
+    be_access_cache_set_version(test_ctx->cache,
+                                test_rules_digest(rule1, rule2));
+    ret = be_access_cache_lookup(test_ctx->cache, "u1", "sshd", "host",
+                                 &decision);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(rule1);
+    talloc_free(rule2);
+    be_access_cache_invalidate(test_ctx->cache);
+}
+
+void test_access_cache_disabled(void **state)
+{
+    struct be_access_cache *cache;
+    int decision;
+    errno_t ret;
+
+    ret = be_access_cache_init(global_talloc_context, 0, &cache);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_store(cache, "user", "sshd", "host", 6);
+    assert_int_equal(ret, EOK);
+
+    ret = be_access_cache_lookup(cache, "user", "sshd", "host", &decision);
+    assert_int_equal(ret, ENOENT);
+
+    talloc_free(cache);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_access_cache_miss,
+                                        test_setup, test_teardown),
+        cmocka_unit_test_setup_teardown(test_access_cache_hit,
+                                        test_setup, test_teardown),
+        cmocka_unit_test_setup_teardown(test_access_cache_version,
+                                        test_setup, test_teardown),
+        cmocka_unit_test_setup_teardown(test_access_cache_rule_changed,
+                                        test_setup, test_teardown),
+        cmocka_unit_test_setup_teardown(test_access_digest_attrs,
+                                        test_setup, test_teardown),
+        cmocka_unit_test(test_access_cache_ttl),
+        cmocka_unit_test(test_access_cache_disabled),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -26,8 +26,71 @@
 #include "tests/cmocka/common_mock.h"
 #include "tests/cmocka/common_mock_resp.h"
 #include "responder/ifp/ifp_private.h"
+#include "responder/ifp/ifp_users.h"
+#include "responder/ifp/ifp_groups.h"
 #include "sbus/sssd_dbus_private.h"
 
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ifp_conf.ldb"
+#define TEST_ID_PROVIDER "ldap"
+
+const char *fetch_domains[] = {"ifp_fetch_test_a",
+                               "ifp_fetch_test_b",
+                               "ifp_fetch_test_c",
+                               NULL};
+
+/* the last reply sent to the client, NULL if the request failed */
+static DBusMessage *sent_reply;
+static bool sent_error;
+
+int __wrap_sbus_request_finish(struct sbus_request *dbus_req,
+                               DBusMessage *reply)
+{
+    if (reply != NULL) {
+        sent_reply = dbus_message_ref(reply);
+    }
+    return talloc_free(dbus_req);
+}
+
+int __wrap_sbus_request_fail_and_finish(struct sbus_request *dbus_req,
+                                        const DBusError *error)
+{
+    sent_error = true;
+    return talloc_free(dbus_req);
+}
+
+/* the number of user and group lookups done by the object getters */
+static int getpwuid_calls;
+static int getgrgid_calls;
+
+errno_t __real_sysdb_getpwuid_with_views(TALLOC_CTX *mem_ctx,
+                                         struct sss_domain_info *domain,
+                                         uid_t uid,
+                                         struct ldb_result **res);
+
+errno_t __wrap_sysdb_getpwuid_with_views(TALLOC_CTX *mem_ctx,
+                                         struct sss_domain_info *domain,
+                                         uid_t uid,
+                                         struct ldb_result **res)
+{
+    getpwuid_calls++;
+    return __real_sysdb_getpwuid_with_views(mem_ctx, domain, uid, res);
+}
+
+int __real_sysdb_getgrgid_with_views(TALLOC_CTX *mem_ctx,
+                                     struct sss_domain_info *domain,
+                                     gid_t gid,
+                                     struct ldb_result **res);
+
+int __wrap_sysdb_getgrgid_with_views(TALLOC_CTX *mem_ctx,
+                                     struct sss_domain_info *domain,
+                                     gid_t gid,
+                                     struct ldb_result **res)
+{
+    getgrgid_calls++;
+    return __real_sysdb_getgrgid_with_views(mem_ctx, domain, gid, res);
+}
+
 /* dbus library checks for valid object paths when unit testing, we don't
  * want that */
 #undef DBUS_TYPE_OBJECT_PATH
@@ -398,6 +461,522 @@ static int ifp_test_req_teardown(void **state)
     return 0;
 }
 
+struct ifp_fetch_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct ifp_ctx *ifp_ctx;
+    struct sss_domain_info *dom_a;
+    struct sss_domain_info *dom_b;
+    struct sss_domain_info *dom_c;
+};
+
+static int ifp_fetch_setup(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(global_talloc_context, struct ifp_fetch_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_multidom_test_ctx(test_ctx, TESTS_PATH,
+                                              TEST_CONF_DB, fetch_domains,
+                                              TEST_ID_PROVIDER, NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->ifp_ctx = mock_ifp_ctx(test_ctx);
+    test_ctx->ifp_ctx->rctx->domains = test_ctx->tctx->dom;
+
+    test_ctx->dom_a = find_domain_by_name(test_ctx->tctx->dom,
+                                          fetch_domains[0], true);
+    assert_non_null(test_ctx->dom_a);
+    test_ctx->dom_b = find_domain_by_name(test_ctx->tctx->dom,
+                                          fetch_domains[1], true);
+    assert_non_null(test_ctx->dom_b);
+    test_ctx->dom_c = find_domain_by_name(test_ctx->tctx->dom,
+                                          fetch_domains[2], true);
+    assert_non_null(test_ctx->dom_c);
+
+    sent_reply = NULL;
+    sent_error = false;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int ifp_fetch_teardown(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+
+    if (sent_reply != NULL) {
+        dbus_message_unref(sent_reply);
+        sent_reply = NULL;
+    }
+
+    talloc_free(test_ctx);
+    test_multidom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, fetch_domains);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static void fetch_store_user(struct sss_domain_info *dom,
+                             const char *name, uid_t uid)
+{
+    errno_t ret;
+
+    ret = sysdb_store_user(dom, name, NULL, uid, uid, NULL, NULL, NULL,
+                           NULL, NULL, NULL, 1000, time(NULL));
+    assert_int_equal(ret, EOK);
+}
+
+/* Calls Users.FetchByName and returns the names in the reply and the
+ * cookie for the next page. */
+static void fetch_users_page(struct ifp_fetch_test_ctx *test_ctx,
+                             const char *cookie_domain,
+                             const char *cookie_name,
+                             uint32_t limit,
+                             const char **_names,
+                             size_t names_size,
+                             size_t *_count,
+                             const char **_next_domain,
+                             const char **_next_name)
+{
+    static const char *whitelist[] = { SYSDB_NAME, SYSDB_UIDNUM, NULL };
+    const char *name_filter = "*";
+    const char *req_attrs[] = { SYSDB_NAME };
+    const char **req_attrs_ptr = req_attrs;
+    struct sbus_request *sr;
+    DBusMessage *msg;
+    DBusMessageIter iter;
+    DBusMessageIter iter_array;
+    DBusMessageIter iter_dict;
+    DBusMessageIter iter_entry;
+    DBusMessageIter iter_variant;
+    DBusMessageIter iter_values;
+    const char *key;
+    const char *value;
+    dbus_bool_t dbret;
+    size_t count = 0;
+    int ret;
+
+    if (sent_reply != NULL) {
+        dbus_message_unref(sent_reply);
+        sent_reply = NULL;
+    }
+
+    sr = mock_sbus_request(test_ctx, geteuid());
+    dbret = dbus_message_append_args(sr->message,
+                                     DBUS_TYPE_STRING, &name_filter,
+                                     DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                                     &req_attrs_ptr, 1,
+                                     DBUS_TYPE_STRING, &cookie_domain,
+                                     DBUS_TYPE_STRING, &cookie_name,
+                                     DBUS_TYPE_UINT32, &limit,
+                                     DBUS_TYPE_INVALID);
+    assert_true(dbret == TRUE);
+
+    /* the request is freed once it is finished */
+    msg = sr->message;
+    ret = ifp_fetch_by_name(sr, test_ctx->ifp_ctx,
+                            sysdb_enumpwent_filter_with_views, whitelist);
+    dbus_message_unref(msg);
+    assert_int_equal(ret, EOK);
+    assert_false(sent_error);
+    assert_non_null(sent_reply);
+
+    dbret = dbus_message_iter_init(sent_reply, &iter);
+    assert_true(dbret == TRUE);
+    dbus_message_iter_recurse(&iter, &iter_array);
+
+    while (dbus_message_iter_get_arg_type(&iter_array) == DBUS_TYPE_ARRAY) {
+        dbus_message_iter_recurse(&iter_array, &iter_dict);
+        dbus_message_iter_recurse(&iter_dict, &iter_entry);
+
+        dbus_message_iter_get_basic(&iter_entry, &key);
+        assert_string_equal(key, SYSDB_NAME);
+
+        dbus_message_iter_next(&iter_entry);
+        dbus_message_iter_recurse(&iter_entry, &iter_variant);
+        dbus_message_iter_recurse(&iter_variant, &iter_values);
+        dbus_message_iter_get_basic(&iter_values, &value);
+
+        assert_true(count < names_size);
+        _names[count] = value;
+        count++;
+
+        dbus_message_iter_next(&iter_array);
+    }
+
+    dbus_message_iter_next(&iter);
+    dbus_message_iter_get_basic(&iter, _next_domain);
+    dbus_message_iter_next(&iter);
+    dbus_message_iter_get_basic(&iter, _next_name);
+
+    *_count = count;
+}
+
+void test_fetch_by_name_paging(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    const char *names[3];
+    const char *next_domain;
+    const char *next_name;
+    size_t count;
+
+    /* the cache is filled out of order, domain c stays empty */
+    fetch_store_user(test_ctx->dom_b, "user-b1", 2001);
+    fetch_store_user(test_ctx->dom_a, "user-a3", 1003);
+    fetch_store_user(test_ctx->dom_a, "user-a1", 1001);
+    fetch_store_user(test_ctx->dom_b, "user-b2", 2002);
+    fetch_store_user(test_ctx->dom_a, "user-a2", 1002);
+
+    fetch_users_page(test_ctx, "", "", 2, names, 3, &count,
+                     &next_domain, &next_name);
+    assert_int_equal(count, 2);
+    assert_string_equal(names[0], "user-a1");
+    assert_string_equal(names[1], "user-a2");
+    assert_string_equal(next_domain, test_ctx->dom_a->name);
+    assert_string_equal(next_name, "user-a2");
+
+    /* the page spans two domains */
+    fetch_users_page(test_ctx, test_ctx->dom_a->name, "user-a2", 2,
+                     names, 3, &count, &next_domain, &next_name);
+    assert_int_equal(count, 2);
+    assert_string_equal(names[0], "user-a3");
+    assert_string_equal(names[1], "user-b1");
+    assert_string_equal(next_domain, test_ctx->dom_b->name);
+    assert_string_equal(next_name, "user-b1");
+
+    /* the empty domain is skipped and the listing ends */
+    fetch_users_page(test_ctx, test_ctx->dom_b->name, "user-b1", 2,
+                     names, 3, &count, &next_domain, &next_name);
+    assert_int_equal(count, 1);
+    assert_string_equal(names[0], "user-b2");
+    assert_string_equal(next_domain, "");
+    assert_string_equal(next_name, "");
+}
+
+void test_fetch_by_name_all_pages(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    const char *stored[] = { "user-a10", "user-a9", "user-a100", "u",
+                             "user-b", NULL };
+    const char *names[2];
+    const char *next_domain = "";
+    const char *next_name = "";
+    bool seen[5] = { false };
+    size_t count;
+    size_t pages;
+    size_t i;
+    size_t j;
+
+    for (i = 0; stored[i] != NULL; i++) {
+        fetch_store_user(test_ctx->dom_a, stored[i], 1000 + i);
+    }
+
+    /* one entry per page, every name is returned exactly once */
+    for (pages = 0; pages < 10; pages++) {
+        fetch_users_page(test_ctx, next_domain, next_name, 1,
+                         names, 2, &count, &next_domain, &next_name);
+
+        for (i = 0; i < count; i++) {
+            for (j = 0; stored[j] != NULL; j++) {
+                if (strcmp(names[i], stored[j]) == 0) {
+                    break;
+                }
+            }
+            assert_non_null(stored[j]);
+            assert_false(seen[j]);
+            seen[j] = true;
+        }
+
+        if (next_domain[0] == '\0') {
+            break;
+        }
+
+        /* the cookie is part of the reply which is freed by the next call */
+        next_domain = talloc_strdup(test_ctx, next_domain);
+        next_name = talloc_strdup(test_ctx, next_name);
+    }
+
+    for (i = 0; stored[i] != NULL; i++) {
+        assert_true(seen[i]);
+    }
+}
+
+void test_fetch_by_name_cache_changed(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    const char *names[3];
+    const char *next_domain;
+    const char *next_name;
+    size_t count;
+    errno_t ret;
+
+    fetch_store_user(test_ctx->dom_a, "user-a1", 1001);
+    fetch_store_user(test_ctx->dom_a, "user-a2", 1002);
+    fetch_store_user(test_ctx->dom_a, "user-a3", 1003);
+    fetch_store_user(test_ctx->dom_b, "user-b1", 2001);
+
+    fetch_users_page(test_ctx, "", "", 2, names, 3, &count,
+                     &next_domain, &next_name);
+    assert_int_equal(count, 2);
+    assert_string_equal(next_name, "user-a2");
+
+    /* entries that were already returned go away and a new one shows up
+     * before the cookie, the next page neither skips nor repeats entries */
+    ret = sysdb_delete_user(test_ctx->dom_a, "user-a1", 0);
+    assert_int_equal(ret, EOK);
+    fetch_store_user(test_ctx->dom_a, "user-a0", 1000);
+
+    next_domain = talloc_strdup(test_ctx, next_domain);
+    next_name = talloc_strdup(test_ctx, next_name);
+    fetch_users_page(test_ctx, next_domain, next_name, 2,
+                     names, 3, &count, &next_domain, &next_name);
+    assert_int_equal(count, 2);
+    assert_string_equal(names[0], "user-a3");
+    assert_string_equal(names[1], "user-b1");
+}
+
+void test_fetch_by_name_unknown_domain(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    static const char *whitelist[] = { SYSDB_NAME, NULL };
+    const char *name_filter = "*";
+    const char *cookie_domain = "ifp_fetch_test_unknown";
+    const char *cookie_name = "user-a1";
+    const char *req_attrs[] = { SYSDB_NAME };
+    const char **req_attrs_ptr = req_attrs;
+    uint32_t limit = 2;
+    struct sbus_request *sr;
+    DBusMessage *msg;
+    dbus_bool_t dbret;
+    int ret;
+
+    sr = mock_sbus_request(test_ctx, geteuid());
+    dbret = dbus_message_append_args(sr->message,
+                                     DBUS_TYPE_STRING, &name_filter,
+                                     DBUS_TYPE_ARRAY, DBUS_TYPE_STRING,
+                                     &req_attrs_ptr, 1,
+                                     DBUS_TYPE_STRING, &cookie_domain,
+                                     DBUS_TYPE_STRING, &cookie_name,
+                                     DBUS_TYPE_UINT32, &limit,
+                                     DBUS_TYPE_INVALID);
+    assert_true(dbret == TRUE);
+
+    msg = sr->message;
+    ret = ifp_fetch_by_name(sr, test_ctx->ifp_ctx,
+                            sysdb_enumpwent_filter_with_views, whitelist);
+    dbus_message_unref(msg);
+    assert_int_equal(ret, EOK);
+    assert_true(sent_error);
+    assert_null(sent_reply);
+}
+
+static int ifp_object_setup(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx;
+    int ret;
+
+    ret = ifp_fetch_setup(state);
+    if (ret != 0) {
+        return ret;
+    }
+
+    test_ctx = talloc_get_type_abort(*state, struct ifp_fetch_test_ctx);
+    test_ctx->ifp_ctx->user_whitelist = ifp_parse_user_attr_list(
+                                                    test_ctx->ifp_ctx, NULL);
+    assert_non_null(test_ctx->ifp_ctx->user_whitelist);
+
+    getpwuid_calls = 0;
+    getgrgid_calls = 0;
+    return 0;
+}
+
+static struct sbus_request *
+mock_object_request(struct ifp_fetch_test_ctx *test_ctx,
+                    const char *base,
+                    struct sss_domain_info *dom,
+                    const char *id)
+{
+    struct sbus_request *sr;
+
+    sr = mock_sbus_request(test_ctx, geteuid());
+    assert_non_null(sr);
+
+    sr->path = sbus_opath_compose(sr, base, dom->name, id);
+    assert_non_null(sr->path);
+
+    return sr;
+}
+
+static void object_store_user(struct sss_domain_info *dom,
+                              const char *name, uid_t uid, const char *gecos)
+{
+    errno_t ret;
+
+    ret = sysdb_store_user(dom, name, NULL, uid, uid, gecos, NULL, NULL,
+                           NULL, NULL, NULL, 1000, time(NULL));
+    assert_int_equal(ret, EOK);
+}
+
+void test_user_object_cache_hit(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    struct sbus_request *sr;
+    const char *name;
+    const char *gecos;
+    uint32_t uid;
+
+    object_store_user(test_ctx->dom_a, "user-a1", 1001, "User A1");
+
+    sr = mock_object_request(test_ctx, IFP_PATH_USERS, test_ctx->dom_a,
+                             "1001");
+
+    /* all getters of one request share a single lookup */
+    ifp_users_user_get_name(sr, test_ctx->ifp_ctx, &name);
+    ifp_users_user_get_uid_number(sr, test_ctx->ifp_ctx, &uid);
+    ifp_users_user_get_gecos(sr, test_ctx->ifp_ctx, &gecos);
+    assert_string_equal(name, "user-a1");
+    assert_int_equal(uid, 1001);
+    assert_string_equal(gecos, "User A1");
+    assert_int_equal(getpwuid_calls, 1);
+
+    talloc_free(sr);
+
+    /* a new request looks the user up again */
+    sr = mock_object_request(test_ctx, IFP_PATH_USERS, test_ctx->dom_a,
+                             "1001");
+    ifp_users_user_get_name(sr, test_ctx->ifp_ctx, &name);
+    assert_string_equal(name, "user-a1");
+    assert_int_equal(getpwuid_calls, 2);
+
+    talloc_free(sr);
+}
+
+void test_user_object_cache_miss(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    struct sbus_request *sr;
+    const char *name;
+    uint32_t uid;
+
+    sr = mock_object_request(test_ctx, IFP_PATH_USERS, test_ctx->dom_a,
+                             "1001");
+
+    /* the miss is remembered for the request as well */
+    ifp_users_user_get_name(sr, test_ctx->ifp_ctx, &name);
+    ifp_users_user_get_uid_number(sr, test_ctx->ifp_ctx, &uid);
+    assert_null(name);
+    assert_int_equal(uid, 0);
+    assert_int_equal(getpwuid_calls, 1);
+
+    talloc_free(sr);
+
+    /* but not by the next one */
+    object_store_user(test_ctx->dom_a, "user-a1", 1001, NULL);
+
+    sr = mock_object_request(test_ctx, IFP_PATH_USERS, test_ctx->dom_a,
+                             "1001");
+    ifp_users_user_get_name(sr, test_ctx->ifp_ctx, &name);
+    assert_string_equal(name, "user-a1");
+    assert_int_equal(getpwuid_calls, 2);
+
+    talloc_free(sr);
+}
+
+void test_user_object_cache_invalidate(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    struct sbus_request *sr;
+    const char *gecos;
+
+    object_store_user(test_ctx->dom_a, "user-a1", 1001, "User A1");
+
+    sr = mock_object_request(test_ctx, IFP_PATH_USERS, test_ctx->dom_a,
+                             "1001");
+    ifp_users_user_get_gecos(sr, test_ctx->ifp_ctx, &gecos);
+    assert_string_equal(gecos, "User A1");
+
+    object_store_user(test_ctx->dom_a, "user-a1", 1001, "Changed");
+
+    /* the object cached for the request is still used */
+    ifp_users_user_get_gecos(sr, test_ctx->ifp_ctx, &gecos);
+    assert_string_equal(gecos, "User A1");
+    assert_int_equal(getpwuid_calls, 1);
+
+    /* until it is dropped */
+    sbus_request_set_object_data(sr, NULL);
+    ifp_users_user_get_gecos(sr, test_ctx->ifp_ctx, &gecos);
+    assert_string_equal(gecos, "Changed");
+    assert_int_equal(getpwuid_calls, 2);
+
+    talloc_free(sr);
+}
+
+void test_group_object_cache(void **state)
+{
+    struct ifp_fetch_test_ctx *test_ctx = talloc_get_type_abort(*state,
+                                                struct ifp_fetch_test_ctx);
+    struct sbus_request *sr;
+    const char *name;
+    uint32_t gid;
+    errno_t ret;
+
+    ret = sysdb_store_group(test_ctx->dom_a, "group-a1", 3001, NULL,
+                            1000, time(NULL));
+    assert_int_equal(ret, EOK);
+
+    sr = mock_object_request(test_ctx, IFP_PATH_GROUPS, test_ctx->dom_a,
+                             "3001");
+
+    /* hit */
+    ifp_groups_group_get_name(sr, test_ctx->ifp_ctx, &name);
+    ifp_groups_group_get_gid_number(sr, test_ctx->ifp_ctx, &gid);
+    assert_string_equal(name, "group-a1");
+    assert_int_equal(gid, 3001);
+    assert_int_equal(getgrgid_calls, 1);
+
+    /* the group is replaced by another one with the same GID */
+    ret = sysdb_delete_group(test_ctx->dom_a, "group-a1", 0);
+    assert_int_equal(ret, EOK);
+    ret = sysdb_store_group(test_ctx->dom_a, "group-a2", 3001, NULL,
+                            1000, time(NULL));
+    assert_int_equal(ret, EOK);
+
+    ifp_groups_group_get_name(sr, test_ctx->ifp_ctx, &name);
+    assert_string_equal(name, "group-a1");
+    assert_int_equal(getgrgid_calls, 1);
+
+    /* invalidated as after UpdateMemberList */
+    sbus_request_set_object_data(sr, NULL);
+    ifp_groups_group_get_name(sr, test_ctx->ifp_ctx, &name);
+    assert_string_equal(name, "group-a2");
+    assert_int_equal(getgrgid_calls, 2);
+
+    talloc_free(sr);
+
+    /* miss */
+    sr = mock_object_request(test_ctx, IFP_PATH_GROUPS, test_ctx->dom_a,
+                             "3002");
+    ifp_groups_group_get_name(sr, test_ctx->ifp_ctx, &name);
+    ifp_groups_group_get_gid_number(sr, test_ctx->ifp_ctx, &gid);
+    assert_null(name);
+    assert_int_equal(gid, 0);
+    assert_int_equal(getgrgid_calls, 3);
+
+    talloc_free(sr);
+}
+
 int main(int argc, const char *argv[])
 {
     poptContext pc;
@@ -417,6 +996,30 @@ int main(int argc, const char *argv[])
         cmocka_unit_test(test_attr_acl),
         cmocka_unit_test(test_attr_acl_ex),
         cmocka_unit_test(test_attr_allowed),
+        cmocka_unit_test_setup_teardown(test_fetch_by_name_paging,
+                                        ifp_fetch_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_fetch_by_name_all_pages,
+                                        ifp_fetch_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_fetch_by_name_cache_changed,
+                                        ifp_fetch_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_fetch_by_name_unknown_domain,
+                                        ifp_fetch_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_user_object_cache_hit,
+                                        ifp_object_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_user_object_cache_miss,
+                                        ifp_object_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_user_object_cache_invalidate,
+                                        ifp_object_setup,
+                                        ifp_fetch_teardown),
+        cmocka_unit_test_setup_teardown(test_group_object_cache,
+                                        ifp_object_setup,
+                                        ifp_fetch_teardown),
     };
 
     /* Set debug level to invalid value so we can deside if -d 0 was used. */
@@ -0,0 +1,300 @@
+/*
+    SSSD
+
+    IPA extdom extended operation - tests of the request window
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+/* In order to access opaque types */
+#include "providers/ipa/ipa_s2n_exop.c"
+
+#include "tests/cmocka/common_mock.h"
+
+#define TEST_DOM_NAME "s2n.test"
+#define TEST_NUM_IDS 25
+#define TEST_WINDOW 10
+
+struct s2n_test_ctx {
+    struct tevent_context *ev;
+    struct sss_domain_info *dom;
+    struct ipa_id_ctx *ipa_ctx;
+    struct sdap_handle *sh;
+    char **list;
+
+    /* operations sent to the server and not answered yet */
+    struct sdap_op *ops[TEST_NUM_IDS];
+    size_t num_sent;
+};
+
+static struct s2n_test_ctx *test_ctx;
+
+int __wrap_ldap_extended_operation(LDAP *ld,
+                                   LDAP_CONST char *reqoid,
+                                   struct berval *reqdata,
+                                   LDAPControl **serverctrls,
+                                   LDAPControl **clientctrls,
+                                   int *msgidp)
+{
+    assert_true(test_ctx->num_sent < TEST_NUM_IDS);
+
+    *msgidp = test_ctx->num_sent + 1;
+    return LDAP_SUCCESS;
+}
+
+int __wrap_sdap_op_add(TALLOC_CTX *memctx, struct tevent_context *ev,
+                       struct sdap_handle *sh, int msgid,
+                       sdap_op_callback_t *callback, void *data,
+                       int timeout, struct sdap_op **_op)
+{
+    struct sdap_op *op;
+
+    op = talloc_zero(memctx, struct sdap_op);
+    assert_non_null(op);
+
+    op->sh = sh;
+    op->msgid = msgid;
+    op->callback = callback;
+    op->data = data;
+    op->ev = ev;
+
+    test_ctx->ops[test_ctx->num_sent] = op;
+    test_ctx->num_sent++;
+
+    *_op = op;
+    return EOK;
+}
+
+static int test_s2n_setup(void **state)
+{
+    size_t i;
+    int ret;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context, struct s2n_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    test_ctx->dom = named_domain(test_ctx, TEST_DOM_NAME, NULL);
+    assert_non_null(test_ctx->dom);
+
+    test_ctx->sh = talloc_zero(test_ctx, struct sdap_handle);
+    assert_non_null(test_ctx->sh);
+
+    test_ctx->ipa_ctx = talloc_zero(test_ctx, struct ipa_id_ctx);
+    assert_non_null(test_ctx->ipa_ctx);
+    test_ctx->ipa_ctx->view_name = talloc_strdup(test_ctx->ipa_ctx,
+                                                 SYSDB_DEFAULT_VIEW_NAME);
+    assert_non_null(test_ctx->ipa_ctx->view_name);
+
+    test_ctx->ipa_ctx->ipa_options = talloc_zero(test_ctx->ipa_ctx,
+                                                 struct ipa_options);
+    assert_non_null(test_ctx->ipa_ctx->ipa_options);
+
+    ret = dp_copy_defaults(test_ctx->ipa_ctx->ipa_options, ipa_basic_opts,
+                           IPA_OPTS_BASIC,
+                           &test_ctx->ipa_ctx->ipa_options->basic);
+    assert_int_equal(ret, EOK);
+
+    ret = dp_opt_set_int(test_ctx->ipa_ctx->ipa_options->basic,
+                         IPA_EXTDOM_MAX_OUTSTANDING, TEST_WINDOW);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->list = talloc_zero_array(test_ctx, char *, TEST_NUM_IDS + 1);
+    assert_non_null(test_ctx->list);
+    for (i = 0; i < TEST_NUM_IDS; i++) {
+        test_ctx->list[i] = talloc_asprintf(test_ctx->list, "%zu", 1000 + i);
+        assert_non_null(test_ctx->list[i]);
+    }
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_s2n_teardown(void **state)
+{
+    talloc_zfree(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static struct tevent_req *test_s2n_get_list_send(char **list)
+{
+    struct tevent_req *req;
+
+    req = ipa_s2n_get_list_send(test_ctx, test_ctx->ev, test_ctx->ipa_ctx,
+                                test_ctx->dom, test_ctx->sh, 5,
+                                BE_REQ_GROUP, REQ_FULL, REQ_INP_ID, list);
+    assert_non_null(req);
+
+    return req;
+}
+
+void test_s2n_get_list_window(void **state)
+{
+    struct ipa_s2n_get_list_state *list_state;
+    struct tevent_req *req;
+    size_t expected;
+    size_t i;
+    errno_t ret;
+
+    req = test_s2n_get_list_send(test_ctx->list);
+    list_state = tevent_req_data(req, struct ipa_s2n_get_list_state);
+
+    /* only the first requests are sent */
+    assert_int_equal(test_ctx->num_sent, TEST_WINDOW);
+    assert_int_equal(list_state->outstanding, TEST_WINDOW);
+    assert_true(tevent_req_is_in_progress(req));
+
+    /* every finished request makes room for the next list entry; all but
+     * the last one are finished so that nothing is saved */
+    for (i = 0; i < TEST_NUM_IDS - 1; i++) {
+        ret = ipa_s2n_get_list_item_done(req);
+        assert_int_equal(ret, EAGAIN);
+
+        expected = MIN(TEST_WINDOW + i + 1, TEST_NUM_IDS);
+        assert_int_equal(test_ctx->num_sent, expected);
+        assert_int_equal(list_state->outstanding, expected - i - 1);
+        assert_true(list_state->outstanding <= TEST_WINDOW);
+    }
+
+    assert_int_equal(list_state->outstanding, 1);
+    assert_int_equal(list_state->next_idx, TEST_NUM_IDS);
+
+    /* each entry was sent exactly once, in list order */
+    for (i = 0; i < TEST_NUM_IDS; i++) {
+        assert_int_equal(test_ctx->ops[i]->msgid, i + 1);
+        assert_int_equal(list_state->items[i].req_input.inp.id, 1000 + i);
+    }
+
+    talloc_free(req);
+}
+
+void test_s2n_get_list_window_one(void **state)
+{
+    struct tevent_req *req;
+    errno_t ret;
+
+    ret = dp_opt_set_int(test_ctx->ipa_ctx->ipa_options->basic,
+                         IPA_EXTDOM_MAX_OUTSTANDING, 1);
+    assert_int_equal(ret, EOK);
+
+    req = test_s2n_get_list_send(test_ctx->list);
+
+    /* the requests are sent one after the other */
+    assert_int_equal(test_ctx->num_sent, 1);
+
+    ret = ipa_s2n_get_list_item_done(req);
+    assert_int_equal(ret, EAGAIN);
+    assert_int_equal(test_ctx->num_sent, 2);
+
+    talloc_free(req);
+}
+
+void test_s2n_get_list_empty(void **state)
+{
+    struct tevent_req *req;
+    char *list[] = { NULL };
+    errno_t ret;
+
+    req = test_s2n_get_list_send(list);
+    assert_int_equal(test_ctx->num_sent, 0);
+
+    while (tevent_req_is_in_progress(req)) {
+        tevent_loop_once(test_ctx->ev);
+    }
+
+    ret = ipa_s2n_get_list_recv(req);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(req);
+}
+
+void test_s2n_get_list_error(void **state)
+{
+    struct tevent_req *req;
+    struct sdap_op *op;
+    errno_t ret;
+
+    req = test_s2n_get_list_send(test_ctx->list);
+    assert_int_equal(test_ctx->num_sent, TEST_WINDOW);
+
+    /* the server did not answer one of the requests */
+    op = test_ctx->ops[3];
+    op->callback(op, NULL, ETIMEDOUT, op->data);
+
+    assert_false(tevent_req_is_in_progress(req));
+    ret = ipa_s2n_get_list_recv(req);
+    assert_int_equal(ret, ETIMEDOUT);
+
+    /* no further requests are sent */
+    assert_int_equal(test_ctx->num_sent, TEST_WINDOW);
+
+    talloc_free(req);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_window,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_window_one,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_empty,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+        cmocka_unit_test_setup_teardown(test_s2n_get_list_error,
+                                        test_s2n_setup,
+                                        test_s2n_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,220 @@
+/*
+    SSSD
+
+    IPA SELinux provider - tests of the stored login mapping
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+/* In order to access opaque types */
+#include "providers/ipa/ipa_selinux.c"
+
+#include "tests/cmocka/common_mock.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_ipa_selinux_conf.ldb"
+#define TEST_DOM_NAME "ipa_selinux_test"
+#define TEST_ID_PROVIDER "ipa"
+
+#define TEST_USER "testuser"
+
+struct selinux_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct selinux_child_input sci;
+};
+
+static int test_selinux_setup(void **state)
+{
+    struct selinux_test_ctx *test_ctx;
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(global_talloc_context, struct selinux_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    ret = sysdb_store_user(test_ctx->tctx->dom, TEST_USER, NULL,
+                           10001, 10001, NULL, "/home/" TEST_USER, "/bin/sh",
+                           NULL, NULL, NULL, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->sci.username = TEST_USER;
+    test_ctx->sci.seuser = "staff_u";
+    test_ctx->sci.mls_range = "s0-s0:c0.c1023";
+
+    check_leaks_push(test_ctx);
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_selinux_teardown(void **state)
+{
+    struct selinux_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_test_ctx);
+
+    assert_true(check_leaks_pop(test_ctx));
+    talloc_free(test_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+void test_selinux_mapping_not_stored(void **state)
+{
+    struct selinux_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_test_ctx);
+
+    /* the child has not been run for this user yet */
+    assert_false(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom, TEST_USER,
+                                               &test_ctx->sci));
+}
+
+void test_selinux_mapping_unchanged(void **state)
+{
+    struct selinux_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_test_ctx);
+
+    ret = ipa_selinux_mapping_save(test_ctx->tctx->dom, TEST_USER,
+                                   &test_ctx->sci);
+    assert_int_equal(ret, EOK);
+
+    assert_true(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom, TEST_USER,
+                                              &test_ctx->sci));
+}
+
+void test_selinux_mapping_changed(void **state)
+{
+    struct selinux_test_ctx *test_ctx;
+    struct selinux_child_input sci;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_test_ctx);
+
+    ret = ipa_selinux_mapping_save(test_ctx->tctx->dom, TEST_USER,
+                                   &test_ctx->sci);
+    assert_int_equal(ret, EOK);
+
+    /* a different SELinux user */
+    sci = test_ctx->sci;
+    sci.seuser = "user_u";
+    assert_false(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom, TEST_USER,
+                                               &sci));
+
+    /* a different MLS range */
+    sci = test_ctx->sci;
+    sci.mls_range = "s0";
+    assert_false(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom, TEST_USER,
+                                               &sci));
+
+    /* the child ran again and set the new mapping */
+    ret = ipa_selinux_mapping_save(test_ctx->tctx->dom, TEST_USER, &sci);
+    assert_int_equal(ret, EOK);
+
+    assert_true(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom, TEST_USER,
+                                              &sci));
+    assert_false(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom, TEST_USER,
+                                               &test_ctx->sci));
+}
+
+void test_selinux_mapping_no_user(void **state)
+{
+    struct selinux_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct selinux_test_ctx);
+
+    ret = ipa_selinux_mapping_save(test_ctx->tctx->dom, "nosuchuser",
+                                   &test_ctx->sci);
+    assert_int_not_equal(ret, EOK);
+
+    assert_false(ipa_selinux_mapping_unchanged(test_ctx->tctx->dom,
+                                               "nosuchuser", &test_ctx->sci));
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    int no_cleanup = 0;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_selinux_mapping_not_stored,
+                                        test_selinux_setup,
+                                        test_selinux_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_mapping_unchanged,
+                                        test_selinux_setup,
+                                        test_selinux_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_mapping_changed,
+                                        test_selinux_setup,
+                                        test_selinux_teardown),
+        cmocka_unit_test_setup_teardown(test_selinux_mapping_no_user,
+                                        test_selinux_setup,
+                                        test_selinux_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
@@ -409,6 +409,56 @@ static void test_sss_ncache_user(void **state)
  * sss_ncache_check_group
  * sss_ncache_set_group
  */
+static void test_sss_ncache_watch_user(void **state)
+{
+    int ret;
+    uint64_t gen;
+    unsigned long key;
+    unsigned long key_upper;
+    struct test_state *ts;
+    struct sss_domain_info *dom;
+
+    ts = talloc_get_type_abort(*state, struct test_state);
+    dom = talloc(ts, struct sss_domain_info);
+    dom->name = discard_const_p(char, TEST_DOM_NAME);
+    dom->case_sensitive = false;
+
+    /* nobody is watched, the generation does not change */
+    gen = sss_ncache_user_generation(ts->ctx);
+    ret = sss_ncache_set_user(ts->ctx, false, dom, NAME);
+    assert_int_equal(ret, EOK);
+    assert_true(gen == sss_ncache_user_generation(ts->ctx));
+
+    ret = sss_ncache_watch_user(ts->ctx, dom, NAME, &key);
+    assert_int_equal(ret, EOK);
+
+    /* the watched key is the one set and checked for the name */
+    ret = sss_ncache_watch_user(ts->ctx, dom, "FOO_NAME", &key_upper);
+    assert_int_equal(ret, EOK);
+    assert_true(key == key_upper);
+
+    ret = sss_ncache_set_user(ts->ctx, false, dom, "bar_name");
+    assert_int_equal(ret, EOK);
+    assert_true(gen == sss_ncache_user_generation(ts->ctx));
+
+    ret = sss_ncache_set_user(ts->ctx, false, dom, NAME);
+    assert_int_equal(ret, EOK);
+    assert_true(gen != sss_ncache_user_generation(ts->ctx));
+
+    /* the user is watched until every watch is released */
+    sss_ncache_unwatch_user(ts->ctx, key_upper);
+    gen = sss_ncache_user_generation(ts->ctx);
+    ret = sss_ncache_set_user(ts->ctx, false, dom, NAME);
+    assert_int_equal(ret, EOK);
+    assert_true(gen != sss_ncache_user_generation(ts->ctx));
+
+    sss_ncache_unwatch_user(ts->ctx, key);
+    gen = sss_ncache_user_generation(ts->ctx);
+    ret = sss_ncache_set_user(ts->ctx, false, dom, NAME);
+    assert_int_equal(ret, EOK);
+    assert_true(gen == sss_ncache_user_generation(ts->ctx));
+}
+
 static void test_sss_ncache_group(void **state)
 {
     int ret, ttl;
@@ -852,6 +902,8 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_sss_ncache_sid, setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_cert, setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_user, setup, teardown),
+        cmocka_unit_test_setup_teardown(test_sss_ncache_watch_user, setup,
+                                        teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_group, setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_netgr, setup, teardown),
         cmocka_unit_test_setup_teardown(test_sss_ncache_service_name, setup,
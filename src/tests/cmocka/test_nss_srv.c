@@ -30,6 +30,8 @@
 #include "responder/common/negcache.h"
 #include "responder/nss/nsssrv.h"
 #include "responder/nss/nsssrv_private.h"
+#include "responder/nss/nsssrv_netgroup.h"
+#include "responder/nss/nsssrv_mmap_cache.h"
 #include "sss_client/idmap/sss_nss_idmap.h"
 #include "util/util_sss_idmap.h"
 #include "db/sysdb_private.h"   /* new_subdomain() */
@@ -114,6 +116,37 @@ void __wrap_sss_packet_get_body(struct sss_packet *packet,
     return;
 }
 
+/* Count how often the name of a cached entry is case-folded again */
+static const char *global_cased_name;
+static int global_cased_name_calls;
+
+char *__real_sss_get_cased_name(TALLOC_CTX *mem_ctx, const char *orig_name,
+                                bool case_sensitive);
+
+char *__wrap_sss_get_cased_name(TALLOC_CTX *mem_ctx, const char *orig_name,
+                                bool case_sensitive)
+{
+    if (global_cased_name != NULL && orig_name != NULL
+            && strcmp(orig_name, global_cased_name) == 0) {
+        global_cased_name_calls++;
+    }
+
+    return __real_sss_get_cased_name(mem_ctx, orig_name, case_sensitive);
+}
+
+/* Count the groups stored in the memory cache instead of storing them */
+static int global_gr_mc_stores;
+
+errno_t __wrap_sss_mmap_cache_gr_store(struct sss_mc_ctx **_mcc,
+                                       struct sized_string *name,
+                                       struct sized_string *pw,
+                                       gid_t gid, size_t memnum,
+                                       char *membuf, size_t memsize)
+{
+    global_gr_mc_stores++;
+    return EOK;
+}
+
 /* Mock returning result to client. Terminate the unit test instead. */
 typedef int (*cmd_cb_fn_t)(uint32_t, uint8_t *, size_t );
 
@@ -782,6 +815,129 @@ void test_nss_getpwnam_fqdn_fancy(void **state)
     assert_int_equal(ret, EOK);
 }
 
+/* In a case-insensitive domain the reply carries the lower-case alias
+ * stored with the entry, the cached name is not folded again */
+static int test_nss_getpwnam_case_insensitive_check(uint32_t status,
+                                                    uint8_t *body,
+                                                    size_t blen)
+{
+    struct passwd pwd;
+    errno_t ret;
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_user_packet(body, blen, &pwd);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(pwd.pw_uid, 131);
+    assert_int_equal(pwd.pw_gid, 464);
+    assert_string_equal(pwd.pw_name, "camelcaseuser");
+    return EOK;
+}
+
+void test_nss_getpwnam_case_insensitive(void **state)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(nss_test_ctx);
+    assert_non_null(attrs);
+    ret = sysdb_attrs_add_lc_name_alias(attrs, "CamelCaseUser");
+    assert_int_equal(ret, EOK);
+
+    /* Prime the cache the way the back end stores the user */
+    ret = sysdb_add_user(nss_test_ctx->tctx->dom,
+                         "CamelCaseUser", 131, 464, "test user",
+                         "/home/camelcaseuser", "/bin/sh", NULL,
+                         attrs, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    global_cased_name = "CamelCaseUser";
+    global_cased_name_calls = 0;
+
+    mock_input_user_or_group("CAMELCASEUSER");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETPWNAM);
+    mock_fill_user();
+
+    /* Query for that user, call a callback when command finishes */
+    set_cmd_cb(test_nss_getpwnam_case_insensitive_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETPWNAM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(global_cased_name_calls, 0);
+    global_cased_name = NULL;
+    talloc_free(attrs);
+}
+
+static int test_nss_getgrnam_case_insensitive_check(uint32_t status,
+                                                    uint8_t *body,
+                                                    size_t blen)
+{
+    int ret;
+    uint32_t nmem;
+    struct group gr;
+    struct group expected = {
+        .gr_gid = 1131,
+        .gr_name = discard_const("camelcasegroup"),
+        .gr_passwd = discard_const("*"),
+        .gr_mem = NULL,
+    };
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(nmem, 0);
+
+    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    assert_int_equal(ret, EOK);
+
+    return EOK;
+}
+
+void test_nss_getgrnam_case_insensitive(void **state)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(nss_test_ctx);
+    assert_non_null(attrs);
+    ret = sysdb_attrs_add_lc_name_alias(attrs, "CamelCaseGroup");
+    assert_int_equal(ret, EOK);
+
+    /* Prime the cache the way the back end stores the group */
+    ret = sysdb_add_group(nss_test_ctx->tctx->dom,
+                          "CamelCaseGroup", 1131,
+                          attrs, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    global_cased_name = "CamelCaseGroup";
+    global_cased_name_calls = 0;
+
+    mock_input_user_or_group("camelCASEgroup");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM);
+    mock_fill_group_with_members(0);
+
+    /* Query for that group, call a callback when command finishes */
+    set_cmd_cb(test_nss_getgrnam_case_insensitive_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(global_cased_name_calls, 0);
+    global_cased_name = NULL;
+    talloc_free(attrs);
+}
+
 /* Check getting cached and valid id from cache. Account callback will
  * not be called and test_nss_getpwuid_check will make sure the id is
  * the same as the test entered before starting
@@ -1091,42 +1247,325 @@ static int test_nss_getgrnam_no_members_check(uint32_t status,
 
     assert_int_equal(status, EOK);
 
-    ret = parse_group_packet(body, blen, &gr, &nmem);
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(nmem, 0);
+
+    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    assert_int_equal(ret, EOK);
+
+    return EOK;
+}
+
+/* Test that requesting a valid, cached group with no members returns a valid
+ * group structure
+ */
+void test_nss_getgrnam_no_members(void **state)
+{
+    errno_t ret;
+
+    /* Prime the cache with a valid group */
+    ret = sysdb_add_group(nss_test_ctx->tctx->dom,
+                          "testgroup", 1123,
+                          NULL, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    mock_input_user_or_group("testgroup");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM);
+    mock_fill_group_with_members(0);
+
+    /* Query for that group, call a callback when command finishes */
+    set_cmd_cb(test_nss_getgrnam_no_members_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
+static int test_nss_getgrnam_nomem_check(uint32_t status,
+                                         uint8_t *body, size_t blen)
+{
+    int ret;
+    uint32_t nmem;
+    struct group gr;
+    struct group expected = {
+        .gr_gid = 1125,
+        .gr_name = discard_const("testgroup_nomem"),
+        .gr_passwd = discard_const("*"),
+        .gr_mem = NULL,
+    };
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(nmem, 0);
+
+    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    assert_int_equal(ret, EOK);
+
+    return EOK;
+}
+
+static int test_nss_getgrnam_nomem_inv_check(uint32_t status,
+                                             uint8_t *body, size_t blen)
+{
+    int ret;
+    uint32_t nmem;
+    struct group gr;
+    struct group expected = {
+        .gr_gid = 1126,
+        .gr_name = discard_const("testgroup_nomem_inv"),
+        .gr_passwd = discard_const("*"),
+        .gr_mem = NULL,
+    };
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(nmem, 0);
+
+    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    assert_int_equal(ret, EOK);
+
+    return EOK;
+}
+
+/* Test that a group stored without its members is returned from the cache
+ * without contacting the DP if the members are not requested
+ */
+void test_nss_getgrnam_nomem(void **state)
+{
+    errno_t ret;
+
+    nss_test_ctx->tctx->dom->lazy_group_members = true;
+
+    /* The group is expired right away */
+    ret = sysdb_add_incomplete_group(nss_test_ctx->tctx->dom,
+                                     "testgroup_nomem", 1125,
+                                     NULL, NULL, NULL, true, 0);
+    assert_int_equal(ret, EOK);
+
+    /* No mock_account_recv(), the DP must not be asked */
+    mock_input_user_or_group("testgroup_nomem");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM_NOMEM);
+    mock_fill_group_with_members(0);
+
+    set_cmd_cb(test_nss_getgrnam_nomem_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM_NOMEM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
+/* Test that a group stored without its members is refreshed if it was
+ * invalidated, even if the members are not requested
+ */
+void test_nss_getgrnam_nomem_invalidated(void **state)
+{
+    errno_t ret;
+    struct sysdb_attrs *attrs;
+
+    nss_test_ctx->tctx->dom->lazy_group_members = true;
+
+    ret = sysdb_add_incomplete_group(nss_test_ctx->tctx->dom,
+                                     "testgroup_nomem", 1125,
+                                     NULL, NULL, NULL, true, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_incomplete_group(nss_test_ctx->tctx->dom,
+                                     "testgroup_nomem_inv", 1126,
+                                     NULL, NULL, NULL, true, 0);
+    assert_int_equal(ret, EOK);
+
+    /* The same as sss_cache -g testgroup_nomem_inv */
+    attrs = sysdb_new_attrs(nss_test_ctx);
+    assert_non_null(attrs);
+
+    ret = sysdb_attrs_add_time_t(attrs, SYSDB_CACHE_EXPIRE, 1);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_set_group_attr(nss_test_ctx->tctx->dom,
+                               "testgroup_nomem_inv", attrs,
+                               SYSDB_MOD_REP);
+    assert_int_equal(ret, EOK);
+    talloc_free(attrs);
+
+    /* The group that was not invalidated is still returned from the cache */
+    mock_input_user_or_group("testgroup_nomem");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM_NOMEM);
+    mock_fill_group_with_members(0);
+
+    set_cmd_cb(test_nss_getgrnam_nomem_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM_NOMEM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+
+    /* The invalidated group must be requested from the DP */
+    nss_test_ctx->tctx->done = false;
+
+    mock_input_user_or_group("testgroup_nomem_inv");
+    mock_account_recv_simple();
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM_NOMEM);
+    mock_fill_group_with_members(0);
+
+    set_cmd_cb(test_nss_getgrnam_nomem_inv_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM_NOMEM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
+static int test_nss_getgr_nomem_members_check(uint32_t status,
+                                              uint8_t *body, size_t blen)
+{
+    int ret;
+    uint32_t nmem;
+    struct group gr;
+    struct group expected = {
+        .gr_gid = 1127,
+        .gr_name = discard_const("testgroup_nomem_mem"),
+        .gr_passwd = discard_const("*"),
+        .gr_mem = NULL,
+    };
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(nmem, 0);
+
+    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    assert_int_equal(ret, EOK);
+
+    return EOK;
+}
+
+static int test_nss_getgr_nomem_all_members_check(uint32_t status,
+                                                  uint8_t *body, size_t blen)
+{
+    int ret;
+    uint32_t nmem;
+    struct group gr;
+    const char *exp_members[] = { "testmember_nm1", "testmember_nm2" };
+    struct group expected = {
+        .gr_gid = 1127,
+        .gr_name = discard_const("testgroup_nomem_mem"),
+        .gr_passwd = discard_const("*"),
+        .gr_mem = discard_const(exp_members)
+    };
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(nmem, 2);
+
+    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    assert_int_equal(ret, EOK);
+
+    return EOK;
+}
+
+/* Test that the members of a cached group are left out of the replies to
+ * the lookups without members and that these replies are not stored in the
+ * memory cache, where they would be found by the lookups with members
+ */
+void test_nss_getgr_nomem_members(void **state)
+{
+    errno_t ret;
+    int fake_mc_ctx;
+
+    ret = sysdb_add_group(nss_test_ctx->tctx->dom,
+                          "testgroup_nomem_mem", 1127,
+                          NULL, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_user(nss_test_ctx->tctx->dom,
+                         "testmember_nm1", 2011, 456, "test member1",
+                         "/home/testmember_nm1", "/bin/sh", NULL,
+                         NULL, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_user(nss_test_ctx->tctx->dom,
+                         "testmember_nm2", 2012, 456, "test member2",
+                         "/home/testmember_nm2", "/bin/sh", NULL,
+                         NULL, 300, 0);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_group_member(nss_test_ctx->tctx->dom,
+                                 "testgroup_nomem_mem", "testmember_nm1",
+                                 SYSDB_MEMBER_USER, false);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_add_group_member(nss_test_ctx->tctx->dom,
+                                 "testgroup_nomem_mem", "testmember_nm2",
+                                 SYSDB_MEMBER_USER, false);
+    assert_int_equal(ret, EOK);
+
+    /* Only checked for NULL, the stores are counted by the wrapper */
+    nss_test_ctx->nctx->grp_mc_ctx = (struct sss_mc_ctx *) &fake_mc_ctx;
+    global_gr_mc_stores = 0;
+
+    /* By name */
+    mock_input_user_or_group("testgroup_nomem_mem");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM_NOMEM);
+    mock_fill_group_with_members(0);
+
+    set_cmd_cb(test_nss_getgr_nomem_members_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM_NOMEM,
+                          nss_test_ctx->nss_cmds);
     assert_int_equal(ret, EOK);
-    assert_int_equal(nmem, 0);
 
-    ret = test_nss_getgrnam_check(&expected, &gr, nmem);
+    ret = test_ev_loop(nss_test_ctx->tctx);
     assert_int_equal(ret, EOK);
+    assert_int_equal(global_gr_mc_stores, 0);
 
-    return EOK;
-}
+    /* By GID */
+    nss_test_ctx->tctx->done = false;
 
-/* Test that requesting a valid, cached group with no members returns a valid
- * group structure
- */
-void test_nss_getgrnam_no_members(void **state)
-{
-    errno_t ret;
+    mock_input_id(nss_test_ctx, 1127);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRGID_NOMEM);
+    mock_fill_group_with_members(0);
 
-    /* Prime the cache with a valid group */
-    ret = sysdb_add_group(nss_test_ctx->tctx->dom,
-                          "testgroup", 1123,
-                          NULL, 300, 0);
+    set_cmd_cb(test_nss_getgr_nomem_members_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRGID_NOMEM,
+                          nss_test_ctx->nss_cmds);
     assert_int_equal(ret, EOK);
 
-    mock_input_user_or_group("testgroup");
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(global_gr_mc_stores, 0);
+
+    /* The complete group is still returned and stored */
+    nss_test_ctx->tctx->done = false;
+
+    mock_input_user_or_group("testgroup_nomem_mem");
     will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM);
-    mock_fill_group_with_members(0);
+    mock_fill_group_with_members(2);
 
-    /* Query for that group, call a callback when command finishes */
-    set_cmd_cb(test_nss_getgrnam_no_members_check);
+    set_cmd_cb(test_nss_getgr_nomem_all_members_check);
     ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM,
                           nss_test_ctx->nss_cmds);
     assert_int_equal(ret, EOK);
 
-    /* Wait until the test finishes with EOK */
     ret = test_ev_loop(nss_test_ctx->tctx);
     assert_int_equal(ret, EOK);
+    assert_int_equal(global_gr_mc_stores, 1);
+
+    nss_test_ctx->nctx->grp_mc_ctx = NULL;
 }
 
 static int test_nss_getgrnam_members_check(uint32_t status,
@@ -1627,6 +2066,415 @@ void test_nss_getgrnam_space_sub(void **state)
     assert_int_equal(ret, EOK);
 }
 
+#define LARGE_GROUP_MEMBERS 1000
+
+static int test_nss_getgrnam_large_check(uint32_t status,
+                                         uint8_t *body, size_t blen)
+{
+    int ret;
+    uint32_t nmem;
+    uint32_t exp_nmem = sss_mock_type(uint32_t);
+    struct group gr;
+    char *exp_member;
+    uint32_t i;
+
+    assert_int_equal(status, EOK);
+
+    ret = parse_group_packet(body, blen, &gr, &nmem);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(gr.gr_gid, 1130);
+    assert_string_equal(gr.gr_name, "large_group");
+    assert_int_equal(nmem, exp_nmem);
+
+    for (i = 0; i < nmem; i++) {
+        exp_member = talloc_asprintf(gr.gr_mem, "largemember%u", i);
+        assert_non_null(exp_member);
+        assert_string_equal(gr.gr_mem[i], exp_member);
+    }
+
+    talloc_free(gr.gr_mem);
+    return EOK;
+}
+
+static void large_group_store(unsigned members)
+{
+    struct sysdb_attrs *attrs;
+    unsigned i;
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(nss_test_ctx);
+    assert_non_null(attrs);
+
+    for (i = 0; i < members; i++) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_GHOST,
+                                     talloc_asprintf(attrs, "largemember%u",
+                                                     i));
+        assert_int_equal(ret, EOK);
+    }
+
+    ret = sysdb_store_group(nss_test_ctx->tctx->dom, "large_group", 1130,
+                            attrs, 300, 0);
+    assert_int_equal(ret, EOK);
+    talloc_free(attrs);
+}
+
+static void large_group_getgrnam(unsigned exp_members, unsigned processed)
+{
+    errno_t ret;
+
+    mock_input_user_or_group("large_group");
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETGRNAM);
+    mock_fill_group_with_members(processed);
+    will_return(test_nss_getgrnam_large_check, exp_members);
+
+    set_cmd_cb(test_nss_getgrnam_large_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETGRNAM,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+}
+
+/* Test that the record of a large group is built once and reused until the
+ * members of the group change
+ */
+void test_nss_getgrnam_large_memo(void **state)
+{
+    errno_t ret;
+
+    ret = nss_grent_memo_init(nss_test_ctx->nctx);
+    assert_int_equal(ret, EOK);
+
+    large_group_store(LARGE_GROUP_MEMBERS);
+
+    large_group_getgrnam(LARGE_GROUP_MEMBERS, LARGE_GROUP_MEMBERS);
+    assert_int_equal(hash_count(nss_test_ctx->nctx->grent_memo), 1);
+
+    /* the kept record is used, no member is processed */
+    nss_test_ctx->tctx->done = false;
+    large_group_getgrnam(LARGE_GROUP_MEMBERS, 0);
+
+    /* a new member makes the record outdated */
+    large_group_store(LARGE_GROUP_MEMBERS + 1);
+
+    nss_test_ctx->tctx->done = false;
+    large_group_getgrnam(LARGE_GROUP_MEMBERS + 1, LARGE_GROUP_MEMBERS + 1);
+    assert_int_equal(hash_count(nss_test_ctx->nctx->grent_memo), 1);
+}
+
+/* Test that the record of a large group is only outdated by the negative
+ * cache when one of its members is added to it
+ */
+void test_nss_getgrnam_large_memo_ncache(void **state)
+{
+    errno_t ret;
+
+    nss_test_ctx->nctx->filter_users_in_groups = true;
+
+    ret = nss_grent_memo_init(nss_test_ctx->nctx);
+    assert_int_equal(ret, EOK);
+
+    large_group_store(LARGE_GROUP_MEMBERS);
+
+    large_group_getgrnam(LARGE_GROUP_MEMBERS, LARGE_GROUP_MEMBERS);
+    assert_int_equal(hash_count(nss_test_ctx->nctx->grent_memo), 1);
+
+    /* a user who is not a member does not outdate the record */
+    ret = sss_ncache_set_user(nss_test_ctx->nctx->ncache, false,
+                              nss_test_ctx->tctx->dom, "nosuchuser");
+    assert_int_equal(ret, EOK);
+
+    nss_test_ctx->tctx->done = false;
+    large_group_getgrnam(LARGE_GROUP_MEMBERS, 0);
+
+    /* a member does, it is filtered out and the record is not kept */
+    ret = sss_ncache_set_user(nss_test_ctx->nctx->ncache, false,
+                              nss_test_ctx->tctx->dom, "largemember999");
+    assert_int_equal(ret, EOK);
+
+    nss_test_ctx->tctx->done = false;
+    large_group_getgrnam(LARGE_GROUP_MEMBERS - 1, LARGE_GROUP_MEMBERS - 1);
+    assert_int_equal(hash_count(nss_test_ctx->nctx->grent_memo), 0);
+
+    nss_test_ctx->nctx->filter_users_in_groups = false;
+}
+
+static void netgr_store(const char *name, const char **triples,
+                        const char **members, int cache_timeout, time_t now)
+{
+    struct sysdb_attrs *attrs;
+    errno_t ret;
+    size_t i;
+
+    attrs = sysdb_new_attrs(nss_test_ctx);
+    assert_non_null(attrs);
+
+    for (i = 0; triples != NULL && triples[i] != NULL; i++) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_NETGROUP_TRIPLE,
+                                     triples[i]);
+        assert_int_equal(ret, EOK);
+    }
+
+    for (i = 0; members != NULL && members[i] != NULL; i++) {
+        ret = sysdb_attrs_add_string(attrs, SYSDB_NETGROUP_MEMBER,
+                                     members[i]);
+        assert_int_equal(ret, EOK);
+    }
+
+    ret = sysdb_add_netgroup(nss_test_ctx->tctx->dom, name, NULL, attrs,
+                             NULL, cache_timeout, now);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(attrs);
+}
+
+static int test_nss_setnetgrent_check(uint32_t status,
+                                      uint8_t *body, size_t blen)
+{
+    uint32_t found;
+
+    assert_int_equal(status, EOK);
+
+    SAFEALIGN_COPY_UINT32(&found, body, NULL);
+    assert_int_equal(found, 1);
+    return EOK;
+}
+
+static void netgr_setnetgrent(const char *name)
+{
+    errno_t ret;
+
+    mock_input_user_or_group(name);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_SETNETGRENT);
+    will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+
+    set_cmd_cb(test_nss_setnetgrent_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_SETNETGRENT,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+    nss_test_ctx->tctx->done = false;
+}
+
+/* The entries are compared as "host,user,domain" for triples and as the
+ * name for netgroups, the order does not matter */
+static int test_nss_getnetgrent_check(uint32_t status,
+                                      uint8_t *body, size_t blen)
+{
+    const char **expected = sss_mock_ptr_type(const char **);
+    size_t rp = 2 * sizeof(uint32_t);
+    uint32_t num;
+    uint32_t type;
+    const char *host;
+    const char *user;
+    const char *domain;
+    char *entry;
+    bool *seen;
+    size_t num_expected;
+    size_t i;
+    size_t j;
+
+    assert_int_equal(status, EOK);
+
+    for (num_expected = 0; expected[num_expected] != NULL; num_expected++);
+    seen = talloc_zero_array(nss_test_ctx, bool, num_expected);
+    assert_non_null(seen);
+
+    SAFEALIGN_COPY_UINT32(&num, body, NULL);
+    assert_int_equal(num, num_expected);
+
+    for (i = 0; i < num; i++) {
+        SAFEALIGN_COPY_UINT32(&type, body+rp, &rp);
+
+        if (type == SSS_NETGR_REP_TRIPLE) {
+            host = (const char *) body+rp;
+            rp += strlen(host) + 1;
+            user = (const char *) body+rp;
+            rp += strlen(user) + 1;
+            domain = (const char *) body+rp;
+            rp += strlen(domain) + 1;
+
+            entry = talloc_asprintf(seen, "%s,%s,%s", host, user, domain);
+        } else {
+            assert_int_equal(type, SSS_NETGR_REP_GROUP);
+
+            entry = talloc_strdup(seen, (const char *) body+rp);
+            rp += strlen(entry) + 1;
+        }
+        assert_non_null(entry);
+        assert_true(rp <= blen);
+
+        for (j = 0; j < num_expected; j++) {
+            if (strcmp(entry, expected[j]) == 0) {
+                break;
+            }
+        }
+        assert_true(j < num_expected);
+
+        /* every entry is returned only once */
+        assert_false(seen[j]);
+        seen[j] = true;
+    }
+
+    /* Make sure we exactly matched the end of the packet */
+    assert_int_equal(rp, blen);
+
+    talloc_free(seen);
+    return EOK;
+}
+
+static void netgr_getnetgrent(const char **expected)
+{
+    errno_t ret;
+    size_t i;
+
+    /* the maximal number of entries returned at once */
+    mock_input_id(nss_test_ctx, 100);
+    will_return(__wrap_sss_packet_get_cmd, SSS_NSS_GETNETGRENT);
+
+    /* One packet per entry and one for num entries */
+    will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+    for (i = 0; expected[i] != NULL; i++) {
+        will_return(__wrap_sss_packet_get_body, WRAP_CALL_REAL);
+    }
+    will_return(test_nss_getnetgrent_check, expected);
+
+    set_cmd_cb(test_nss_getnetgrent_check);
+    ret = sss_cmd_execute(nss_test_ctx->cctx, SSS_NSS_GETNETGRENT,
+                          nss_test_ctx->nss_cmds);
+    assert_int_equal(ret, EOK);
+
+    /* Wait until the test finishes with EOK */
+    ret = test_ev_loop(nss_test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+    nss_test_ctx->tctx->done = false;
+}
+
+void test_nss_netgr_nested_cached(void **state)
+{
+    netgr_store("ng_child",
+                (const char *[]) { "(host2,user2,dom2)", NULL },
+                NULL, 300, 0);
+    netgr_store("ng_parent",
+                (const char *[]) { "(host1,user1,dom1)", NULL },
+                (const char *[]) { "ng_child", NULL }, 300, 0);
+
+    netgr_setnetgrent("ng_parent");
+
+    /* the cached nested netgroup is replaced by its triples */
+    netgr_getnetgrent((const char *[]) { "host1,user1,dom1",
+                                         "host2,user2,dom2",
+                                         NULL });
+}
+
+void test_nss_netgr_nested_expired(void **state)
+{
+    netgr_store("ng_expired",
+                (const char *[]) { "(host2,user2,dom2)", NULL },
+                NULL, 1, time(NULL) - 10);
+    netgr_store("ng_parent",
+                (const char *[]) { "(host1,user1,dom1)", NULL },
+                (const char *[]) { "ng_expired", "ng_missing", NULL },
+                300, 0);
+
+    netgr_setnetgrent("ng_parent");
+
+    /* the client resolves the expired and the missing netgroup */
+    netgr_getnetgrent((const char *[]) { "host1,user1,dom1",
+                                         "ng_expired",
+                                         "ng_missing",
+                                         NULL });
+}
+
+void test_nss_netgr_nested_cycle(void **state)
+{
+    netgr_store("ng_a",
+                (const char *[]) { "(host_a,user_a,dom_a)", NULL },
+                (const char *[]) { "ng_b", NULL }, 300, 0);
+    netgr_store("ng_b",
+                (const char *[]) { "(host_b,user_b,dom_b)", NULL },
+                (const char *[]) { "ng_a", NULL }, 300, 0);
+
+    netgr_setnetgrent("ng_a");
+
+    netgr_getnetgrent((const char *[]) { "host_a,user_a,dom_a",
+                                         "host_b,user_b,dom_b",
+                                         NULL });
+}
+
+void test_nss_netgr_nested_duplicates(void **state)
+{
+    /* both nested netgroups and the parent share triples */
+    netgr_store("ng_child1",
+                (const char *[]) { "(host1,user1,dom1)", "(host3,,)", NULL },
+                NULL, 300, 0);
+    netgr_store("ng_child2",
+                (const char *[]) { "(host3,,)", NULL },
+                (const char *[]) { "ng_child1", NULL }, 300, 0);
+    netgr_store("ng_parent",
+                (const char *[]) { "(host1,user1,dom1)", NULL },
+                (const char *[]) { "ng_child1", "ng_child2", NULL },
+                300, 0);
+
+    netgr_setnetgrent("ng_parent");
+
+    netgr_getnetgrent((const char *[]) { "host1,user1,dom1",
+                                         "host3,,",
+                                         NULL });
+}
+
+static void netgr_lifetime_timeout(struct tevent_context *ev,
+                                   struct tevent_timer *te,
+                                   struct timeval current_time,
+                                   void *pvt)
+{
+    bool *timed_out = talloc_get_type_abort(pvt, bool);
+
+    *timed_out = true;
+}
+
+void test_nss_netgr_nested_lifetime(void **state)
+{
+    struct tevent_timer *te;
+    hash_key_t key;
+    bool *timed_out;
+
+    netgr_store("ng_child",
+                (const char *[]) { "(host2,user2,dom2)", NULL },
+                NULL, 2, 0);
+    netgr_store("ng_parent",
+                (const char *[]) { "(host1,user1,dom1)", NULL },
+                (const char *[]) { "ng_child", NULL }, 300, 0);
+
+    netgr_setnetgrent("ng_parent");
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const("ng_parent");
+    assert_true(hash_has_key(nss_test_ctx->nctx->netgroups, &key));
+
+    timed_out = talloc_zero(nss_test_ctx, bool);
+    assert_non_null(timed_out);
+
+    te = tevent_add_timer(nss_test_ctx->tctx->ev, timed_out,
+                          tevent_timeval_current_ofs(5, 0),
+                          netgr_lifetime_timeout, timed_out);
+    assert_non_null(te);
+
+    /* The flattened entries are dropped when the nested netgroup expires,
+     * long before the netgroup timeout of the parent */
+    while (!*timed_out
+            && hash_has_key(nss_test_ctx->nctx->netgroups, &key)) {
+        assert_int_equal(tevent_loop_once(nss_test_ctx->tctx->ev), 0);
+    }
+    assert_false(*timed_out);
+
+    talloc_free(timed_out);
+}
+
 static int test_nss_well_known_sid_check(uint32_t status,
                                          uint8_t *body, size_t blen)
 {
@@ -2658,6 +3506,18 @@ static int nss_fqdn_test_setup(void **state)
     return 0;
 }
 
+static int nss_case_insensitive_test_setup(void **state)
+{
+    struct sss_test_conf_param params[] = {
+        { "enumerate", "false" },
+        { "case_sensitive", "false" },
+        { NULL, NULL },             /* Sentinel */
+    };
+
+    test_nss_setup(params, state);
+    return 0;
+}
+
 static int nss_test_setup_extra_attr(void **state)
 {
     struct sss_test_conf_param params[] = {
@@ -2708,6 +3568,20 @@ static int nss_fqdn_fancy_test_setup(void **state)
     return 0;
 }
 
+static int nss_netgr_test_setup(void **state)
+{
+    errno_t ret;
+
+    nss_test_setup(state);
+
+    /* Create the lookup table for netgroup results */
+    ret = sss_hash_create_ex(nss_test_ctx->nctx, 10,
+                             &nss_test_ctx->nctx->netgroups, 0, 0, 0, 0,
+                             netgroup_hash_delete_cb, NULL);
+    assert_int_equal(ret, EOK);
+    return 0;
+}
+
 static int nss_test_teardown(void **state)
 {
     talloc_free(nss_test_ctx);
@@ -2941,6 +3815,12 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_nss_getpwnam_fqdn_fancy,
                                         nss_fqdn_fancy_test_setup,
                                         nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getpwnam_case_insensitive,
+                                        nss_case_insensitive_test_setup,
+                                        nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getgrnam_case_insensitive,
+                                        nss_case_insensitive_test_setup,
+                                        nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_getpwnam_space,
                                         nss_test_setup, nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_getpwnam_space_sub,
@@ -2953,6 +3833,16 @@ int main(int argc, const char *argv[])
                                         nss_test_setup, nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_getgrnam_members_fqdn,
                                         nss_fqdn_test_setup, nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getgrnam_large_memo,
+                                        nss_test_setup, nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getgrnam_large_memo_ncache,
+                                        nss_test_setup, nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getgrnam_nomem,
+                                        nss_test_setup, nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getgrnam_nomem_invalidated,
+                                        nss_test_setup, nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_getgr_nomem_members,
+                                        nss_test_setup, nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_getgrnam_members_subdom,
                                         nss_subdom_test_setup,
                                         nss_test_teardown),
@@ -2969,6 +3859,21 @@ int main(int argc, const char *argv[])
                                         nss_test_setup, nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_getgrnam_space_sub,
                                         nss_test_setup, nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_netgr_nested_cached,
+                                        nss_netgr_test_setup,
+                                        nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_netgr_nested_expired,
+                                        nss_netgr_test_setup,
+                                        nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_netgr_nested_cycle,
+                                        nss_netgr_test_setup,
+                                        nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_netgr_nested_duplicates,
+                                        nss_netgr_test_setup,
+                                        nss_test_teardown),
+        cmocka_unit_test_setup_teardown(test_nss_netgr_nested_lifetime,
+                                        nss_netgr_test_setup,
+                                        nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_well_known_getnamebysid,
                                         nss_test_setup, nss_test_teardown),
         cmocka_unit_test_setup_teardown(test_nss_well_known_getnamebysid_special,
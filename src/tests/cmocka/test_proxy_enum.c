@@ -0,0 +1,421 @@
+/*
+    SSSD
+
+    Proxy provider - tests of the enumeration child
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+/* In order to access opaque types */
+#include "providers/proxy/proxy_id.c"
+
+#include "tests/cmocka/common_mock.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_proxy_enum_conf.ldb"
+#define TEST_DOM_NAME "proxy_enum_test"
+#define TEST_ID_PROVIDER "proxy"
+
+/* enough users to make the child flush several chunks */
+#define TEST_NUM_USERS 1000
+#define TEST_GECOS_LEN 300
+
+struct proxy_enum_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct proxy_id_ctx *ctx;
+};
+
+/* State of the mocked NSS module, the child gets a copy of it */
+static size_t mock_pos;
+static size_t mock_num_users;
+static size_t mock_die_at;
+static char mock_gecos[TEST_GECOS_LEN + 1];
+
+static enum nss_status mock_setpwent(void)
+{
+    mock_pos = 0;
+    return NSS_STATUS_SUCCESS;
+}
+
+static enum nss_status mock_getpwent_r(struct passwd *result,
+                                       char *buffer, size_t buflen,
+                                       int *errnop)
+{
+    int len;
+
+    if (mock_die_at != 0 && mock_pos == mock_die_at) {
+        /* the module crashes the enumeration child */
+        _exit(1);
+    }
+
+    if (mock_pos == mock_num_users) {
+        *errnop = ENOENT;
+        return NSS_STATUS_NOTFOUND;
+    }
+
+    len = snprintf(buffer, buflen, "user%zu", mock_pos);
+    if (len < 0 || (size_t) len >= buflen) {
+        *errnop = ERANGE;
+        return NSS_STATUS_TRYAGAIN;
+    }
+
+    result->pw_name = buffer;
+    result->pw_passwd = discard_const("*");
+    result->pw_uid = 10000 + mock_pos;
+    result->pw_gid = 10000 + mock_pos;
+    result->pw_gecos = mock_gecos;
+    result->pw_dir = discard_const("/home/user");
+    result->pw_shell = discard_const("/bin/sh");
+
+    mock_pos++;
+    return NSS_STATUS_SUCCESS;
+}
+
+static enum nss_status mock_endpwent(void)
+{
+    return NSS_STATUS_SUCCESS;
+}
+
+static int test_proxy_enum_setup(void **state)
+{
+    struct proxy_enum_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(global_talloc_context, struct proxy_enum_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->ctx = talloc_zero(test_ctx, struct proxy_id_ctx);
+    assert_non_null(test_ctx->ctx);
+
+    /* no such module, the child keeps using the mocked functions */
+    test_ctx->ctx->libname = talloc_strdup(test_ctx->ctx,
+                                           "sss_proxy_enum_test_missing");
+    assert_non_null(test_ctx->ctx->libname);
+
+    test_ctx->ctx->ops.setpwent = mock_setpwent;
+    test_ctx->ctx->ops.getpwent_r = mock_getpwent_r;
+    test_ctx->ctx->ops.endpwent = mock_endpwent;
+
+    memset(mock_gecos, 'g', TEST_GECOS_LEN);
+    mock_gecos[TEST_GECOS_LEN] = '\0';
+    mock_num_users = TEST_NUM_USERS;
+    mock_die_at = 0;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_proxy_enum_teardown(void **state)
+{
+    struct proxy_enum_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_enum_test_ctx);
+
+    /* the SIGCHLD handler of the child hangs off the event context */
+    talloc_free(test_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+static struct proxy_enum_state *
+test_proxy_enum_state(struct proxy_enum_test_ctx *test_ctx,
+                      enum proxy_enum_type type)
+{
+    struct proxy_enum_state *state;
+
+    state = talloc_zero(test_ctx, struct proxy_enum_state);
+    assert_non_null(state);
+
+    state->ctx = test_ctx->ctx;
+    state->dom = test_ctx->tctx->dom;
+    state->type = type;
+    state->fd = -1;
+
+    return state;
+}
+
+/* Hands the buffer over to the reading side. */
+static void test_proxy_enum_feed(struct proxy_enum_state *state,
+                                 struct proxy_enum_wbuf *wbuf,
+                                 size_t len)
+{
+    state->buf = talloc_realloc(state, state->buf, uint8_t,
+                                state->len + len);
+    assert_non_null(state->buf);
+
+    memcpy(state->buf + state->len, wbuf->data, len);
+    state->len += len;
+    state->size = state->len;
+
+    memmove(wbuf->data, wbuf->data + len, wbuf->len - len);
+    wbuf->len -= len;
+}
+
+static size_t test_proxy_enum_count_users(struct proxy_enum_test_ctx *test_ctx)
+{
+    struct ldb_result *res;
+    size_t count;
+    errno_t ret;
+
+    ret = sysdb_enumpwent(test_ctx, test_ctx->tctx->dom, &res);
+    assert_int_equal(ret, EOK);
+
+    count = res->count;
+    talloc_free(res);
+    return count;
+}
+
+void test_proxy_enum_framing(void **state)
+{
+    struct proxy_enum_test_ctx *test_ctx;
+    struct proxy_enum_state *enum_state;
+    struct proxy_enum_wbuf wbuf = { NULL, 0, 0 };
+    char *members[] = { discard_const("user0"), discard_const("user1"), NULL };
+    struct group grp;
+    struct ldb_result *res;
+    size_t start;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_enum_test_ctx);
+    enum_state = test_proxy_enum_state(test_ctx, PROXY_ENUM_GROUPS);
+
+    memset(&grp, 0, sizeof(struct group));
+    grp.gr_name = discard_const("group0");
+    grp.gr_passwd = discard_const("*");
+    grp.gr_gid = 20000;
+    grp.gr_mem = members;
+
+    ret = proxy_enum_wbuf_add_group(&wbuf, &grp);
+    assert_int_equal(ret, EOK);
+
+    grp.gr_name = discard_const("group1");
+    grp.gr_gid = 20001;
+    grp.gr_mem = NULL;
+
+    ret = proxy_enum_wbuf_add_group(&wbuf, &grp);
+    assert_int_equal(ret, EOK);
+
+    ret = proxy_enum_wbuf_begin(&wbuf, PROXY_ENUM_REC_END, &start);
+    assert_int_equal(ret, EOK);
+    ret = proxy_enum_wbuf_add_uint32(&wbuf, EOK);
+    assert_int_equal(ret, EOK);
+    proxy_enum_wbuf_end(&wbuf, start);
+
+    /* a partial header and a partial record are kept for later */
+    test_proxy_enum_feed(enum_state, &wbuf, 3);
+    ret = proxy_enum_process(enum_state);
+    assert_int_equal(ret, EAGAIN);
+    assert_int_equal(enum_state->len, 3);
+
+    test_proxy_enum_feed(enum_state, &wbuf, PROXY_ENUM_REC_HDR_SIZE + 2);
+    ret = proxy_enum_process(enum_state);
+    assert_int_equal(ret, EAGAIN);
+    assert_int_equal(enum_state->len, PROXY_ENUM_REC_HDR_SIZE + 5);
+    assert_int_equal(enum_state->num_saved, 0);
+
+    /* everything but the last byte of the final record */
+    test_proxy_enum_feed(enum_state, &wbuf, wbuf.len - 1);
+    ret = proxy_enum_process(enum_state);
+    assert_int_equal(ret, EAGAIN);
+    assert_int_equal(enum_state->num_saved, 2);
+    assert_int_equal(enum_state->len,
+                     PROXY_ENUM_REC_HDR_SIZE + sizeof(uint32_t) - 1);
+
+    /* the complete records are saved before the enumeration ends */
+    ret = sysdb_getgrnam(test_ctx, test_ctx->tctx->dom, "group0", &res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(res->count, 1);
+    assert_int_equal(ldb_msg_find_attr_as_uint(res->msgs[0], SYSDB_GIDNUM, 0),
+                     20000);
+    talloc_free(res);
+
+    test_proxy_enum_feed(enum_state, &wbuf, 1);
+    ret = proxy_enum_process(enum_state);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(enum_state->result, EOK);
+    assert_int_equal(enum_state->len, 0);
+
+    ret = sysdb_getgrnam(test_ctx, test_ctx->tctx->dom, "group1", &res);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(res->count, 1);
+    talloc_free(res);
+
+    talloc_free(wbuf.data);
+    talloc_free(enum_state);
+}
+
+void test_proxy_enum_malformed(void **state)
+{
+    struct proxy_enum_test_ctx *test_ctx;
+    struct proxy_enum_state *enum_state;
+    struct proxy_enum_wbuf wbuf = { NULL, 0, 0 };
+    size_t start;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_enum_test_ctx);
+
+    /* unknown record type */
+    enum_state = test_proxy_enum_state(test_ctx, PROXY_ENUM_USERS);
+    ret = proxy_enum_wbuf_begin(&wbuf, 42, &start);
+    assert_int_equal(ret, EOK);
+    proxy_enum_wbuf_end(&wbuf, start);
+
+    test_proxy_enum_feed(enum_state, &wbuf, wbuf.len);
+    ret = proxy_enum_process(enum_state);
+    assert_int_equal(ret, EINVAL);
+    talloc_free(enum_state);
+
+    /* data after the final record */
+    enum_state = test_proxy_enum_state(test_ctx, PROXY_ENUM_USERS);
+    ret = proxy_enum_wbuf_begin(&wbuf, PROXY_ENUM_REC_END, &start);
+    assert_int_equal(ret, EOK);
+    ret = proxy_enum_wbuf_add_uint32(&wbuf, EOK);
+    assert_int_equal(ret, EOK);
+    proxy_enum_wbuf_end(&wbuf, start);
+    ret = proxy_enum_wbuf_add_uint32(&wbuf, 0);
+    assert_int_equal(ret, EOK);
+
+    test_proxy_enum_feed(enum_state, &wbuf, wbuf.len);
+    ret = proxy_enum_process(enum_state);
+    assert_int_equal(ret, EINVAL);
+    talloc_free(enum_state);
+
+    talloc_free(wbuf.data);
+}
+
+static errno_t test_proxy_enum_run(struct proxy_enum_test_ctx *test_ctx)
+{
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = proxy_enum_send(test_ctx, test_ctx->tctx->ev, test_ctx->ctx,
+                          test_ctx->tctx->dom, PROXY_ENUM_USERS);
+    assert_non_null(req);
+
+    while (tevent_req_is_in_progress(req)) {
+        tevent_loop_once(test_ctx->tctx->ev);
+    }
+
+    ret = proxy_enum_recv(req);
+    talloc_free(req);
+    return ret;
+}
+
+void test_proxy_enum_users(void **state)
+{
+    struct proxy_enum_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_enum_test_ctx);
+
+    ret = test_proxy_enum_run(test_ctx);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(test_proxy_enum_count_users(test_ctx), TEST_NUM_USERS);
+}
+
+void test_proxy_enum_child_died(void **state)
+{
+    struct proxy_enum_test_ctx *test_ctx;
+    size_t count;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct proxy_enum_test_ctx);
+
+    /* several chunks reach the back end before the child dies */
+    mock_die_at = TEST_NUM_USERS - 1;
+
+    ret = test_proxy_enum_run(test_ctx);
+    assert_int_equal(ret, EIO);
+
+    /* the chunks received before are saved */
+    count = test_proxy_enum_count_users(test_ctx);
+    assert_true(count > 0);
+    assert_true(count < TEST_NUM_USERS);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    int no_cleanup = 0;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_proxy_enum_framing,
+                                        test_proxy_enum_setup,
+                                        test_proxy_enum_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_enum_malformed,
+                                        test_proxy_enum_setup,
+                                        test_proxy_enum_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_enum_users,
+                                        test_proxy_enum_setup,
+                                        test_proxy_enum_teardown),
+        cmocka_unit_test_setup_teardown(test_proxy_enum_child_died,
+                                        test_proxy_enum_setup,
+                                        test_proxy_enum_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
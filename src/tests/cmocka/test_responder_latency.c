@@ -0,0 +1,193 @@
+/*
+    SSSD
+
+    Responder request latency statistics - tests
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "responder/common/responder.h"
+
+void test_latency_bucket_small(void **state)
+{
+    uint64_t v;
+
+    /* every value below the sub-bucket count has its own bucket */
+    for (v = 0; v < 8; v++) {
+        assert_int_equal(rsp_latency_bucket(v), v);
+        assert_int_equal(rsp_latency_bucket_max(v), v);
+    }
+
+    assert_int_equal(rsp_latency_bucket(8), 8);
+    assert_int_equal(rsp_latency_bucket(15), 15);
+    assert_int_equal(rsp_latency_bucket(16), 16);
+    assert_int_equal(rsp_latency_bucket(17), 16);
+    assert_int_equal(rsp_latency_bucket_max(16), 17);
+}
+
+void test_latency_bucket_bounds(void **state)
+{
+    uint64_t max;
+    uint64_t v;
+    size_t b;
+
+    for (v = 1; v < (1ULL << 30); v += v / 7 + 1) {
+        b = rsp_latency_bucket(v);
+        max = rsp_latency_bucket_max(b);
+
+        /* the value is inside its bucket */
+        assert_true(v <= max);
+        if (b > 0) {
+            assert_true(rsp_latency_bucket_max(b - 1) < v);
+        }
+
+        /* and the bucket is at most 1/8 of the value wide */
+        assert_true(max - v <= v / 8);
+    }
+}
+
+void test_latency_bucket_overflow(void **state)
+{
+    size_t last;
+
+    last = rsp_latency_bucket(UINT64_MAX);
+    assert_int_equal(rsp_latency_bucket(1ULL << 40), last);
+    assert_true(rsp_latency_bucket((1ULL << 32) - 1) <= last);
+}
+
+void test_latency_outcome(void **state)
+{
+    struct cli_request creq;
+    struct cli_ctx cctx;
+
+    memset(&cctx, 0, sizeof(cctx));
+    memset(&creq, 0, sizeof(creq));
+    cctx.creq = &creq;
+
+    rsp_latency_set_outcome(&cctx, SSS_CMD_OUTCOME_NEGCACHE);
+    assert_int_equal(creq.outcome, SSS_CMD_OUTCOME_NEGCACHE);
+
+    /* found in the cache of the next domain */
+    rsp_latency_set_outcome(&cctx, SSS_CMD_OUTCOME_CACHE_HIT);
+    assert_int_equal(creq.outcome, SSS_CMD_OUTCOME_CACHE_HIT);
+
+    rsp_latency_set_outcome(&cctx, SSS_CMD_OUTCOME_DP);
+    assert_int_equal(creq.outcome, SSS_CMD_OUTCOME_DP);
+
+    /* the data provider round trip is kept */
+    rsp_latency_set_outcome(&cctx, SSS_CMD_OUTCOME_CACHE_HIT);
+    assert_int_equal(creq.outcome, SSS_CMD_OUTCOME_DP);
+
+    /* no request, nothing to do */
+    cctx.creq = NULL;
+    rsp_latency_set_outcome(&cctx, SSS_CMD_OUTCOME_CACHE_HIT);
+}
+
+static int dummy_cmd(struct cli_ctx *cctx)
+{
+    return EOK;
+}
+
+void test_latency_stats(void **state)
+{
+    struct sss_cmd_table cmds[] = {
+        { SSS_NSS_GETPWNAM, dummy_cmd },
+        { SSS_NSS_GETGRNAM, dummy_cmd },
+        { SSS_CLI_NULL, NULL }
+    };
+    struct resp_ctx *rctx;
+    struct cli_request creq;
+    struct cli_ctx cctx;
+    char *stats;
+    errno_t ret;
+
+    rctx = talloc_zero(NULL, struct resp_ctx);
+    assert_non_null(rctx);
+    rctx->sss_cmds = cmds;
+
+    /* not collected */
+    ret = rsp_latency_init(rctx, false);
+    assert_int_equal(ret, EOK);
+    ret = rsp_latency_get_stats(rctx, rctx, &stats);
+    assert_int_equal(ret, ENOTSUP);
+
+    ret = rsp_latency_init(rctx, true);
+    assert_int_equal(ret, EOK);
+
+    memset(&cctx, 0, sizeof(cctx));
+    memset(&creq, 0, sizeof(creq));
+    cctx.rctx = rctx;
+    cctx.creq = &creq;
+
+    creq.start = tevent_timeval_current();
+    creq.cmd_idx = 1;
+    rsp_latency_set_outcome(&cctx, SSS_CMD_OUTCOME_CACHE_HIT);
+    rsp_latency_done(&cctx);
+
+    ret = rsp_latency_get_stats(rctx, rctx, &stats);
+    assert_int_equal(ret, EOK);
+
+    /* only the command which was called is listed */
+    assert_non_null(strstr(stats, "SSS_NSS_GETGRNAM"));
+    assert_non_null(strstr(stats, "cache_hit"));
+    assert_null(strstr(stats, "SSS_NSS_GETPWNAM"));
+
+    talloc_free(rctx);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_latency_bucket_small),
+        cmocka_unit_test(test_latency_bucket_bounds),
+        cmocka_unit_test(test_latency_bucket_overflow),
+        cmocka_unit_test(test_latency_outcome),
+        cmocka_unit_test(test_latency_stats),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,507 @@
+/*
+    SSSD
+
+    LDAP initgroups - tests of the RFC2307bis nested group expansion
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+
+/* In order to access opaque types */
+#include "providers/ldap/sdap_async_initgroups.c"
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/cmocka/common_mock_sysdb_objects.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_sdap_initgr_nested_conf.ldb"
+#define TEST_DOM_NAME "sdap_initgr_nested_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define GROUP_BASE_DN "cn=groups,dc=test,dc=com"
+
+/* more groups in one level than searches and batches can be outstanding */
+#define WIDE_LEVEL_GROUPS 300
+
+struct initgr_nested_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sdap_options *opts;
+    struct sdap_handle *sh;
+    hash_table_t *group_hash;
+
+    /* the groups on the server */
+    struct sysdb_attrs **directory;
+    size_t num_directory;
+
+    /* the matched values control is announced by the server */
+    bool vrf;
+
+    size_t searches;
+    size_t outstanding;
+    size_t max_outstanding;
+};
+
+static struct initgr_nested_test_ctx *test_ctx;
+
+struct test_search_state {
+    size_t count;
+    struct sysdb_attrs **reply;
+};
+
+/* A server that knows the groups of test_ctx->directory and understands
+ * the filters of the nested group expansion */
+struct tevent_req *
+__wrap_sdap_get_and_parse_generic_send(TALLOC_CTX *memctx,
+                                       struct tevent_context *ev,
+                                       struct sdap_options *opts,
+                                       struct sdap_handle *sh,
+                                       const char *search_base,
+                                       int scope,
+                                       const char *filter,
+                                       const char **attrs,
+                                       struct sdap_attr_map *map,
+                                       int map_num_attrs,
+                                       int attrsonly,
+                                       LDAPControl **serverctrls,
+                                       LDAPControl **clientctrls,
+                                       int sizelimit,
+                                       int timeout,
+                                       bool allow_paging)
+{
+    struct tevent_req *req;
+    struct test_search_state *state;
+    struct ldb_message_element *el;
+    struct sysdb_attrs *entry;
+    struct sysdb_attrs *group;
+    const char *orig_dn;
+    const char *name;
+    char *item;
+    bool member_requested = false;
+    bool matched;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    req = tevent_req_create(memctx, &state, struct test_search_state);
+    assert_non_null(req);
+
+    test_ctx->searches++;
+    test_ctx->outstanding++;
+    if (test_ctx->outstanding > test_ctx->max_outstanding) {
+        test_ctx->max_outstanding = test_ctx->outstanding;
+    }
+
+    for (i = 0; attrs[i] != NULL; i++) {
+        if (strcmp(attrs[i], "member") == 0) {
+            member_requested = true;
+        }
+    }
+
+    /* the member values are only requested if they can be limited */
+    if (test_ctx->vrf) {
+        assert_true(member_requested);
+        assert_non_null(serverctrls);
+        assert_non_null(serverctrls[0]);
+        assert_string_equal(serverctrls[0]->ldctl_oid,
+                            LDAP_CONTROL_VALUESRETURNFILTER);
+    } else {
+        assert_false(member_requested);
+        assert_null(serverctrls);
+    }
+
+    state->reply = talloc_zero_array(state, struct sysdb_attrs *,
+                                     test_ctx->num_directory + 1);
+    assert_non_null(state->reply);
+
+    for (i = 0; i < test_ctx->num_directory; i++) {
+        group = test_ctx->directory[i];
+
+        ret = sysdb_attrs_get_el_ext(group, SYSDB_MEMBER, false, &el);
+        if (ret == ENOENT) {
+            continue;
+        }
+        assert_int_equal(ret, EOK);
+
+        ret = sysdb_attrs_get_string(group, SYSDB_ORIG_DN, &orig_dn);
+        assert_int_equal(ret, EOK);
+        ret = sysdb_attrs_get_string(group, SYSDB_NAME, &name);
+        assert_int_equal(ret, EOK);
+
+        entry = mock_sysdb_group_rfc2307bis(state->reply, GROUP_BASE_DN,
+                                            1000 + i, name, NULL);
+        assert_non_null(entry);
+
+        matched = false;
+        for (j = 0; j < el->num_values; j++) {
+            item = talloc_asprintf(entry, "(member=%s)",
+                                   (const char *) el->values[j].data);
+            assert_non_null(item);
+
+            if (strstr(filter, item) == NULL) {
+                continue;
+            }
+            matched = true;
+
+            if (test_ctx->vrf) {
+                ret = sysdb_attrs_add_string(entry, SYSDB_MEMBER,
+                                    (const char *) el->values[j].data);
+                assert_int_equal(ret, EOK);
+            }
+        }
+
+        if (!matched) {
+            talloc_free(entry);
+            continue;
+        }
+
+        state->reply[state->count] = entry;
+        state->count++;
+    }
+
+    tevent_req_done(req);
+    tevent_req_post(req, ev);
+    return req;
+}
+
+int __wrap_sdap_get_and_parse_generic_recv(struct tevent_req *req,
+                                           TALLOC_CTX *mem_ctx,
+                                           size_t *reply_count,
+                                           struct sysdb_attrs ***reply)
+{
+    struct test_search_state *state =
+            tevent_req_data(req, struct test_search_state);
+
+    test_ctx->outstanding--;
+
+    TEVENT_REQ_RETURN_ON_ERROR(req);
+
+    *reply_count = state->count;
+    *reply = talloc_steal(mem_ctx, state->reply);
+    return EOK;
+}
+
+static void test_add_group(const char *name, const char **member_names)
+{
+    struct sysdb_attrs *group;
+    char *dn;
+    errno_t ret;
+    size_t i;
+
+    test_ctx->directory = talloc_realloc(test_ctx, test_ctx->directory,
+                                         struct sysdb_attrs *,
+                                         test_ctx->num_directory + 1);
+    assert_non_null(test_ctx->directory);
+
+    group = mock_sysdb_group_rfc2307bis(test_ctx->directory, GROUP_BASE_DN,
+                                        1000 + test_ctx->num_directory, name,
+                                        NULL);
+    assert_non_null(group);
+
+    for (i = 0; member_names != NULL && member_names[i] != NULL; i++) {
+        dn = talloc_asprintf(group, "cn=%s,%s", member_names[i],
+                             GROUP_BASE_DN);
+        assert_non_null(dn);
+
+        ret = sysdb_attrs_add_string(group, SYSDB_MEMBER, dn);
+        assert_int_equal(ret, EOK);
+    }
+
+    test_ctx->directory[test_ctx->num_directory] = group;
+    test_ctx->num_directory++;
+}
+
+static struct sysdb_attrs *test_direct_group(const char *name)
+{
+    struct sysdb_attrs *group;
+
+    group = mock_sysdb_group_rfc2307bis(test_ctx, GROUP_BASE_DN, 1, name,
+                                        NULL);
+    assert_non_null(group);
+
+    return group;
+}
+
+static void test_nested_done(struct tevent_req *req)
+{
+    test_ctx->tctx->error = rfc2307bis_nested_groups_recv(req);
+    talloc_zfree(req);
+
+    test_ctx->tctx->done = true;
+}
+
+static void test_expand(struct sysdb_attrs **groups, size_t num_groups)
+{
+    struct tevent_req *req;
+    errno_t ret;
+
+    req = rfc2307bis_nested_groups_send(test_ctx, test_ctx->tctx->ev,
+                                        test_ctx->opts,
+                                        test_ctx->tctx->sysdb,
+                                        test_ctx->tctx->dom, test_ctx->sh,
+                                        test_ctx->opts->sdom->group_search_bases,
+                                        groups, num_groups,
+                                        test_ctx->group_hash, 0);
+    assert_non_null(req);
+    tevent_req_set_callback(req, test_nested_done, NULL);
+
+    ret = test_ev_loop(test_ctx->tctx);
+    assert_int_equal(ret, EOK);
+
+    assert_int_equal(test_ctx->outstanding, 0);
+    assert_true(test_ctx->max_outstanding <= RFC2307BIS_NESTED_MAX_OUTSTANDING);
+}
+
+/* Checks the parents found for the group, the order does not matter */
+static void test_assert_parents(const char *name, const char **parents)
+{
+    struct sdap_nested_group *ngr;
+    struct ldb_message_element *el;
+    const char *parent_name;
+    hash_key_t key;
+    hash_value_t value;
+    size_t num_parents;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    key.type = HASH_KEY_STRING;
+    key.str = discard_const(name);
+
+    assert_int_equal(hash_lookup(test_ctx->group_hash, &key, &value),
+                     HASH_SUCCESS);
+    ngr = talloc_get_type(value.ptr, struct sdap_nested_group);
+    assert_non_null(ngr);
+
+    /* only the searched member values were returned, they must not be
+     * kept as the members of the group */
+    ret = sysdb_attrs_get_el_ext(ngr->group, SYSDB_MEMBER, false, &el);
+    if (ret == EOK) {
+        assert_int_equal(el->num_values, 0);
+    } else {
+        assert_int_equal(ret, ENOENT);
+    }
+
+    for (num_parents = 0; parents[num_parents] != NULL; num_parents++);
+    assert_int_equal(ngr->parents_count, num_parents);
+
+    for (i = 0; i < ngr->parents_count; i++) {
+        ret = sysdb_attrs_get_string(ngr->ldap_parents[i], SYSDB_NAME,
+                                     &parent_name);
+        assert_int_equal(ret, EOK);
+
+        for (j = 0; j < num_parents; j++) {
+            if (strcmp(parent_name, parents[j]) == 0) {
+                break;
+            }
+        }
+        assert_true(j < num_parents);
+    }
+}
+
+static int test_initgr_nested_setup(void **state)
+{
+    static struct sss_test_conf_param params[] = {
+        { "ldap_schema", "rfc2307bis" },
+        { "ldap_group_search_base", GROUP_BASE_DN },
+        { "ldap_group_nesting_level", "4" },
+        { NULL, NULL }
+    };
+    errno_t ret;
+
+    assert_true(leak_check_setup());
+
+    test_dom_suite_setup(TESTS_PATH);
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct initgr_nested_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         params);
+    assert_non_null(test_ctx->tctx);
+
+    ret = ldap_get_options(test_ctx, test_ctx->tctx->dom,
+                           test_ctx->tctx->confdb,
+                           test_ctx->tctx->conf_dom_path, &test_ctx->opts);
+    assert_int_equal(ret, EOK);
+
+    test_ctx->sh = talloc_zero(test_ctx, struct sdap_handle);
+    assert_non_null(test_ctx->sh);
+
+    ret = sss_hash_create(test_ctx, 0, &test_ctx->group_hash);
+    assert_int_equal(ret, EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_initgr_nested_vrf_setup(void **state)
+{
+    test_initgr_nested_setup(state);
+
+    test_ctx->vrf = true;
+    test_ctx->sh->supported_controls.vals = talloc_array(test_ctx->sh,
+                                                         char *, 1);
+    assert_non_null(test_ctx->sh->supported_controls.vals);
+    test_ctx->sh->supported_controls.vals[0] = discard_const(
+                                            LDAP_CONTROL_VALUESRETURNFILTER);
+    test_ctx->sh->supported_controls.num_vals = 1;
+
+    return 0;
+}
+
+static int test_initgr_nested_teardown(void **state)
+{
+    talloc_zfree(test_ctx);
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+/* g1 and g2 are both members of diamond, which is a member of loop, which
+ * is a member of g1 again */
+void test_initgr_nested_cycle_diamond(void **state)
+{
+    struct sysdb_attrs *groups[2];
+
+    test_add_group("g1", (const char *[]) { "loop", NULL });
+    test_add_group("g2", NULL);
+    test_add_group("diamond", (const char *[]) { "g1", "g2", NULL });
+    test_add_group("loop", (const char *[]) { "diamond", NULL });
+
+    groups[0] = test_direct_group("g1");
+    groups[1] = test_direct_group("g2");
+
+    test_expand(groups, 2);
+    assert_int_equal(test_ctx->tctx->error, EOK);
+
+    /* every group was searched for once */
+    assert_int_equal(hash_count(test_ctx->group_hash), 4);
+    assert_int_equal(test_ctx->searches, test_ctx->vrf ? 3 : 4);
+
+    test_assert_parents("g1", (const char *[]) { "diamond", NULL });
+    test_assert_parents("g2", (const char *[]) { "diamond", NULL });
+    test_assert_parents("diamond", (const char *[]) { "loop", NULL });
+    test_assert_parents("loop", (const char *[]) { "g1", NULL });
+}
+
+/* more searches in one level than can be outstanding at once, all groups
+ * are members of the same parent */
+void test_initgr_nested_wide(void **state)
+{
+    struct sysdb_attrs *groups[WIDE_LEVEL_GROUPS];
+    const char *members[WIDE_LEVEL_GROUPS + 1];
+    size_t exp_searches;
+    size_t i;
+
+    for (i = 0; i < WIDE_LEVEL_GROUPS; i++) {
+        members[i] = talloc_asprintf(test_ctx, "wide%zu", i);
+        assert_non_null(members[i]);
+
+        test_add_group(members[i], NULL);
+        groups[i] = test_direct_group(members[i]);
+    }
+    members[WIDE_LEVEL_GROUPS] = NULL;
+
+    test_add_group("top", members);
+
+    test_expand(groups, WIDE_LEVEL_GROUPS);
+    assert_int_equal(test_ctx->tctx->error, EOK);
+
+    /* the searches of the first level and the one for top */
+    if (test_ctx->vrf) {
+        exp_searches = (WIDE_LEVEL_GROUPS + RFC2307BIS_NESTED_BATCH_SIZE - 1)
+                           / RFC2307BIS_NESTED_BATCH_SIZE;
+    } else {
+        exp_searches = WIDE_LEVEL_GROUPS;
+    }
+    assert_true(exp_searches > RFC2307BIS_NESTED_MAX_OUTSTANDING);
+    assert_int_equal(test_ctx->searches, exp_searches + 1);
+    assert_int_equal(test_ctx->max_outstanding,
+                     RFC2307BIS_NESTED_MAX_OUTSTANDING);
+
+    assert_int_equal(hash_count(test_ctx->group_hash),
+                     WIDE_LEVEL_GROUPS + 1);
+
+    for (i = 0; i < WIDE_LEVEL_GROUPS; i++) {
+        test_assert_parents(members[i], (const char *[]) { "top", NULL });
+    }
+    test_assert_parents("top", (const char *[]) { NULL });
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    int no_cleanup = 0;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_initgr_nested_cycle_diamond,
+                                        test_initgr_nested_setup,
+                                        test_initgr_nested_teardown),
+        cmocka_unit_test_setup_teardown(test_initgr_nested_cycle_diamond,
+                                        test_initgr_nested_vrf_setup,
+                                        test_initgr_nested_teardown),
+        cmocka_unit_test_setup_teardown(test_initgr_nested_wide,
+                                        test_initgr_nested_setup,
+                                        test_initgr_nested_teardown),
+        cmocka_unit_test_setup_teardown(test_initgr_nested_wide,
+                                        test_initgr_nested_vrf_setup,
+                                        test_initgr_nested_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
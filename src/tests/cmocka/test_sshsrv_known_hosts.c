@@ -0,0 +1,358 @@
+/*
+    SSSD
+
+    SSH responder known_hosts file - tests
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* In order to access opaque types */
+#include "responder/ssh/sshsrv_cmd.c"
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/common.h"
+#include "db/sysdb_ssh.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_sshsrv_known_hosts_conf.ldb"
+#define TEST_DOM_NAME "sshsrv_known_hosts_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define TEST_HOST "host.example.com"
+#define TEST_OTHER_HOST "other.example.com"
+
+/* "ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIKEY1 host" */
+#define TEST_KEY1 "c3NoLWVkMjU1MTkgQUFBQUMzTnphQzFsWkRJ" \
+                  "MU5URTVBQUFBSUtFWTEgaG9zdA=="
+/* "ssh-ed25519 AAAAC3NzaC1lZDI1NTE5AAAAIKEY2 host" */
+#define TEST_KEY2 "c3NoLWVkMjU1MTkgQUFBQUMzTnphQzFsWkRJ" \
+                  "MU5URTVBQUFBSUtFWTIgaG9zdA=="
+
+struct known_hosts_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct ssh_ctx *ssh_ctx;
+    struct resp_ctx *rctx;
+    struct cli_ctx *cctx;
+
+    /* number of times the known_hosts file was replaced */
+    int num_writes;
+    /* a copy of the descriptor of the last written file */
+    int last_fd;
+};
+
+static struct known_hosts_test_ctx *test_ctx;
+
+int __real_rename(const char *oldpath, const char *newpath);
+
+int __wrap_sss_unique_file_ex(TALLOC_CTX *mem_ctx,
+                              char *path_tmpl,
+                              mode_t file_umask,
+                              errno_t *_err)
+{
+    char path[] = TESTS_PATH"/known_hosts.XXXXXX";
+    int fd;
+
+    fd = mkstemp(path);
+    assert_true(fd != -1);
+
+    /* only the content matters */
+    unlink(path);
+
+    if (test_ctx->last_fd != -1) {
+        close(test_ctx->last_fd);
+    }
+    test_ctx->last_fd = dup(fd);
+    assert_true(test_ctx->last_fd != -1);
+
+    *_err = EOK;
+    return fd;
+}
+
+int __wrap_rename(const char *oldpath, const char *newpath)
+{
+    if (strcmp(newpath, SSS_SSH_KNOWN_HOSTS_PATH) != 0) {
+        return __real_rename(oldpath, newpath);
+    }
+
+    test_ctx->num_writes++;
+    return 0;
+}
+
+static void store_host(const char *name, const char *key)
+{
+    struct sysdb_attrs *attrs;
+    time_t now = time(NULL);
+    errno_t ret;
+
+    attrs = sysdb_new_attrs(test_ctx);
+    assert_non_null(attrs);
+
+    ret = sysdb_attrs_add_string(attrs, SYSDB_SSH_PUBKEY, key);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_store_ssh_host(test_ctx->tctx->dom, name, NULL, 3600, now,
+                               attrs);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_update_ssh_known_host_expire(test_ctx->tctx->dom, name, now,
+                                             180);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(attrs);
+}
+
+static char *read_known_hosts(TALLOC_CTX *mem_ctx)
+{
+    char buf[1024];
+    ssize_t len;
+
+    assert_true(test_ctx->last_fd != -1);
+
+    len = pread(test_ctx->last_fd, buf, sizeof(buf) - 1, 0);
+    assert_true(len >= 0);
+    buf[len] = '\0';
+
+    return talloc_strdup(mem_ctx, buf);
+}
+
+static void rebuild(void)
+{
+    errno_t ret;
+
+    ret = ssh_known_hosts_rebuild(test_ctx->ssh_ctx, test_ctx->tctx->dom,
+                                  time(NULL));
+    assert_int_equal(ret, EOK);
+}
+
+static int test_known_hosts_setup(void **state)
+{
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct known_hosts_test_ctx);
+    assert_non_null(test_ctx);
+    test_ctx->last_fd = -1;
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    test_ctx->rctx = talloc_zero(test_ctx, struct resp_ctx);
+    assert_non_null(test_ctx->rctx);
+    test_ctx->rctx->domains = test_ctx->tctx->dom;
+
+    test_ctx->cctx = talloc_zero(test_ctx, struct cli_ctx);
+    assert_non_null(test_ctx->cctx);
+    test_ctx->cctx->rctx = test_ctx->rctx;
+
+    test_ctx->ssh_ctx = talloc_zero(test_ctx, struct ssh_ctx);
+    assert_non_null(test_ctx->ssh_ctx);
+    test_ctx->ssh_ctx->rctx = test_ctx->rctx;
+    test_ctx->ssh_ctx->known_hosts_timeout = 180;
+    test_ctx->rctx->pvt_ctx = test_ctx->ssh_ctx;
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_known_hosts_teardown(void **state)
+{
+    if (test_ctx->last_fd != -1) {
+        close(test_ctx->last_fd);
+    }
+
+    talloc_zfree(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+void test_known_hosts_unchanged(void **state)
+{
+    char *content;
+
+    store_host(TEST_HOST, TEST_KEY1);
+
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 1);
+    assert_int_equal(hash_count(test_ctx->ssh_ctx->known_hosts), 1);
+    assert_true(test_ctx->ssh_ctx->known_hosts_next_expire > time(NULL));
+
+    content = read_known_hosts(test_ctx);
+    assert_non_null(strstr(content, TEST_HOST" ssh-ed25519 "));
+
+    /* nothing changed, the file is not written again */
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 1);
+    assert_int_equal(hash_count(test_ctx->ssh_ctx->known_hosts), 1);
+
+    talloc_free(content);
+}
+
+void test_known_hosts_key_changed(void **state)
+{
+    char *content;
+
+    store_host(TEST_HOST, TEST_KEY1);
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 1);
+
+    store_host(TEST_HOST, TEST_KEY2);
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 2);
+
+    content = read_known_hosts(test_ctx);
+    assert_non_null(strstr(content, "KEY2"));
+    assert_null(strstr(content, "KEY1"));
+
+    talloc_free(content);
+}
+
+void test_known_hosts_added_removed(void **state)
+{
+    errno_t ret;
+
+    store_host(TEST_HOST, TEST_KEY1);
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 1);
+
+    store_host(TEST_OTHER_HOST, TEST_KEY2);
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 2);
+    assert_int_equal(hash_count(test_ctx->ssh_ctx->known_hosts), 2);
+
+    ret = sysdb_delete_ssh_host(test_ctx->tctx->dom, TEST_OTHER_HOST);
+    assert_int_equal(ret, EOK);
+
+    rebuild();
+    assert_int_equal(test_ctx->num_writes, 3);
+    assert_int_equal(hash_count(test_ctx->ssh_ctx->known_hosts), 1);
+}
+
+void test_known_hosts_host_changed(void **state)
+{
+    struct ssh_cmd_ctx *cmd_ctx;
+    const char *attrs[] = { SYSDB_NAME, SYSDB_NAME_ALIAS, SYSDB_SSH_PUBKEY,
+                            NULL };
+    errno_t ret;
+
+    store_host(TEST_HOST, TEST_KEY1);
+    rebuild();
+
+    cmd_ctx = talloc_zero(test_ctx, struct ssh_cmd_ctx);
+    assert_non_null(cmd_ctx);
+    cmd_ctx->cctx = test_ctx->cctx;
+    cmd_ctx->domain = test_ctx->tctx->dom;
+    cmd_ctx->name = talloc_strdup(cmd_ctx, TEST_HOST);
+    assert_non_null(cmd_ctx->name);
+
+    ret = sysdb_get_ssh_host(cmd_ctx, test_ctx->tctx->dom, TEST_HOST, attrs,
+                             &cmd_ctx->result);
+    assert_int_equal(ret, EOK);
+
+    /* the host is in the file as it is in the cache */
+    assert_false(ssh_known_hosts_host_changed(cmd_ctx, test_ctx->ssh_ctx,
+                                              cmd_ctx));
+
+    /* the keys of the host changed */
+    store_host(TEST_HOST, TEST_KEY2);
+    talloc_zfree(cmd_ctx->result);
+    ret = sysdb_get_ssh_host(cmd_ctx, test_ctx->tctx->dom, TEST_HOST, attrs,
+                             &cmd_ctx->result);
+    assert_int_equal(ret, EOK);
+
+    assert_true(ssh_known_hosts_host_changed(cmd_ctx, test_ctx->ssh_ctx,
+                                             cmd_ctx));
+
+    /* the host is in the file but not in the cache anymore */
+    talloc_zfree(cmd_ctx->result);
+    assert_true(ssh_known_hosts_host_changed(cmd_ctx, test_ctx->ssh_ctx,
+                                             cmd_ctx));
+
+    /* an unknown host is neither in the file nor in the cache */
+    cmd_ctx->name = talloc_strdup(cmd_ctx, TEST_OTHER_HOST);
+    assert_non_null(cmd_ctx->name);
+    assert_false(ssh_known_hosts_host_changed(cmd_ctx, test_ctx->ssh_ctx,
+                                              cmd_ctx));
+
+    talloc_free(cmd_ctx);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    int no_cleanup = 0;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_known_hosts_unchanged,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+        cmocka_unit_test_setup_teardown(test_known_hosts_key_changed,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+        cmocka_unit_test_setup_teardown(test_known_hosts_added_removed,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+        cmocka_unit_test_setup_teardown(test_known_hosts_host_changed,
+                                        test_known_hosts_setup,
+                                        test_known_hosts_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
@@ -21,6 +21,7 @@
 */
 
 #include <popt.h>
+#include <time.h>
 
 #include "tests/cmocka/common_mock.h"
 
@@ -43,6 +44,10 @@
 #define TEST_OFFSET 1000000
 #define TEST_OFFSET_STR "1000000"
 
+#define TEST_BENCH_DOMAINS 500
+#define TEST_BENCH_ROUNDS 20
+#define TEST_BENCH_DOM_SID "S-1-5-21-1000-2000-%d"
+
 const int TEST_2922_MIN_ID = 1842600000;
 const int TEST_2922_MAX_ID = 1842799999;
 
@@ -442,6 +447,202 @@ void test_map_id_sec_slices(void **state)
     sss_idmap_free_sid(test_ctx->idmap_ctx, sid);
 }
 
+static double elapsed_ms(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0
+               + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+void test_map_id_many_domains(void **state)
+{
+    struct test_ctx *test_ctx;
+    enum idmap_error_code err;
+    struct sss_idmap_range range;
+    struct timespec start;
+    char *dom_sid;
+    char *name;
+    char *sid;
+    uint32_t id;
+    size_t c;
+    size_t r;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    assert_non_null(test_ctx);
+
+    for (c = 0; c < TEST_BENCH_DOMAINS; c++) {
+        name = talloc_asprintf(test_ctx, "bench%zu.dom", c);
+        assert_non_null(name);
+        dom_sid = talloc_asprintf(test_ctx, TEST_BENCH_DOM_SID, (int) c);
+        assert_non_null(dom_sid);
+
+        range.min = TEST_RANGE_MIN * (c + 1);
+        range.max = range.min + TEST_RANGE_MIN - 1;
+
+        err = sss_idmap_add_domain_ex(test_ctx->idmap_ctx, name, dom_sid,
+                                      &range, NULL, 0, false);
+        assert_int_equal(err, IDMAP_SUCCESS);
+
+        talloc_free(name);
+        talloc_free(dom_sid);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < TEST_BENCH_ROUNDS; r++) {
+        for (c = 0; c < TEST_BENCH_DOMAINS; c++) {
+            sid = talloc_asprintf(test_ctx, TEST_BENCH_DOM_SID"-%zu",
+                                  (int) c, c + r);
+            assert_non_null(sid);
+
+            err = sss_idmap_sid_to_unix(test_ctx->idmap_ctx, sid, &id);
+            assert_int_equal(err, IDMAP_SUCCESS);
+            assert_int_equal(id, TEST_RANGE_MIN * (c + 1) + c + r);
+
+            talloc_free(sid);
+        }
+    }
+    DEBUG(SSSDBG_TRACE_FUNC, "%d SID to UNIX mappings with %d domains "
+          "took %.3f ms\n", TEST_BENCH_DOMAINS * TEST_BENCH_ROUNDS,
+          TEST_BENCH_DOMAINS, elapsed_ms(&start));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < TEST_BENCH_ROUNDS; r++) {
+        for (c = 0; c < TEST_BENCH_DOMAINS; c++) {
+            err = sss_idmap_unix_to_sid(test_ctx->idmap_ctx,
+                                        TEST_RANGE_MIN * (c + 1) + r, &sid);
+            assert_int_equal(err, IDMAP_SUCCESS);
+
+            dom_sid = talloc_asprintf(test_ctx, TEST_BENCH_DOM_SID"-%zu",
+                                      (int) c, r);
+            assert_non_null(dom_sid);
+            assert_string_equal(sid, dom_sid);
+
+            talloc_free(dom_sid);
+            sss_idmap_free_sid(test_ctx->idmap_ctx, sid);
+        }
+    }
+    DEBUG(SSSDBG_TRACE_FUNC, "%d UNIX to SID mappings with %d domains "
+          "took %.3f ms\n", TEST_BENCH_DOMAINS * TEST_BENCH_ROUNDS,
+          TEST_BENCH_DOMAINS, elapsed_ms(&start));
+
+    /* unknown domain and ID outside of all ranges */
+    err = sss_idmap_sid_to_unix(test_ctx->idmap_ctx, "S-1-5-21-1000-2000-"
+                                TEST_OFFSET_STR"-1", &id);
+    assert_int_equal(err, IDMAP_NO_DOMAIN);
+
+    err = sss_idmap_unix_to_sid(test_ctx->idmap_ctx, TEST_RANGE_MIN - 1, &sid);
+    assert_int_equal(err, IDMAP_NO_DOMAIN);
+}
+
+void test_map_id_non_canonical_sid(void **state)
+{
+    struct test_ctx *test_ctx;
+    enum idmap_error_code err;
+    struct sss_idmap_range range;
+    uint32_t id;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    assert_non_null(test_ctx);
+
+    /* leading zeros are accepted for domain SIDs and must still match */
+    range.min = TEST_2_RANGE_MIN;
+    range.max = TEST_2_RANGE_MAX;
+    err = sss_idmap_add_domain_ex(test_ctx->idmap_ctx, TEST_2_DOM_NAME,
+                                  "S-1-5-21-0987-654-321", &range, NULL, 0,
+                                  false);
+    assert_int_equal(err, IDMAP_SUCCESS);
+
+    err = sss_idmap_sid_to_unix(test_ctx->idmap_ctx, "S-1-5-21-0987-654-321-1",
+                                &id);
+    assert_int_equal(err, IDMAP_SUCCESS);
+    assert_int_equal(id, TEST_2_RANGE_MIN + 1);
+
+    err = sss_idmap_sid_to_unix(test_ctx->idmap_ctx, TEST_2_DOM_SID"-1", &id);
+    assert_int_equal(err, IDMAP_NO_DOMAIN);
+
+    err = sss_idmap_sid_to_unix(test_ctx->idmap_ctx, TEST_DOM_SID"-1", &id);
+    assert_int_equal(err, IDMAP_SUCCESS);
+    assert_int_equal(id, TEST_RANGE_MIN + 1);
+
+    err = sss_idmap_check_sid_unix(test_ctx->idmap_ctx, TEST_DOM_SID"-1",
+                                   TEST_RANGE_MIN + 1);
+    assert_int_equal(err, IDMAP_SUCCESS);
+}
+
+static uint8_t *test_bin_sid(TALLOC_CTX *mem_ctx, uint32_t sub_auth0,
+                             uint32_t a, uint32_t b, uint32_t c, uint32_t rid)
+{
+    uint32_t sub_auths[] = { sub_auth0, a, b, c, rid };
+    uint8_t *bin_sid;
+    size_t i;
+
+    bin_sid = talloc_zero_array(mem_ctx, uint8_t, 28);
+    assert_non_null(bin_sid);
+
+    bin_sid[0] = 1;
+    bin_sid[1] = 5;
+    bin_sid[7] = 5;
+    for (i = 0; i < 5; i++) {
+        bin_sid[8 + 4 * i] = sub_auths[i] & 0xff;
+        bin_sid[9 + 4 * i] = (sub_auths[i] >> 8) & 0xff;
+        bin_sid[10 + 4 * i] = (sub_auths[i] >> 16) & 0xff;
+        bin_sid[11 + 4 * i] = (sub_auths[i] >> 24) & 0xff;
+    }
+
+    return bin_sid;
+}
+
+void test_map_bin_sids(void **state)
+{
+    struct test_ctx *test_ctx;
+    enum idmap_error_code err;
+    uint8_t *bin_sids[5];
+    size_t lengths[5];
+    uint32_t ids[5];
+    enum idmap_error_code errs[5];
+    size_t i;
+
+    test_ctx = talloc_get_type(*state, struct test_ctx);
+
+    assert_non_null(test_ctx);
+
+    bin_sids[0] = test_bin_sid(test_ctx, 21, 123, 456, 789, 0);
+    bin_sids[1] = test_bin_sid(test_ctx, 21, 123, 456, 789, TEST_OFFSET);
+    bin_sids[2] = test_bin_sid(test_ctx, 21, 123, 456, 789, 400000);
+    bin_sids[3] = test_bin_sid(test_ctx, 21, 123, 456, 780, 0);
+    bin_sids[4] = test_bin_sid(test_ctx, 32, 544, 0, 0, 0);
+    for (i = 0; i < 5; i++) {
+        lengths[i] = 28;
+    }
+
+    err = sss_idmap_bin_sids_to_unix(test_ctx->idmap_ctx, 5, bin_sids,
+                                     lengths, ids, errs);
+    assert_int_equal(err, IDMAP_SUCCESS);
+
+    assert_int_equal(errs[0], IDMAP_SUCCESS);
+    assert_int_equal(ids[0], TEST_RANGE_MIN);
+    assert_int_equal(errs[1], IDMAP_SUCCESS);
+    assert_int_equal(ids[1], TEST_RANGE_MIN + TEST_OFFSET);
+    assert_int_equal(errs[2], IDMAP_NO_RANGE);
+    assert_int_equal(errs[3], IDMAP_NO_DOMAIN);
+    assert_int_equal(errs[4], IDMAP_BUILTIN_SID);
+
+    /* the results must match the single SID call */
+    for (i = 0; i < 5; i++) {
+        err = sss_idmap_bin_sid_to_unix(test_ctx->idmap_ctx, bin_sids[i],
+                                        lengths[i], &ids[0]);
+        assert_int_equal(err, errs[i]);
+    }
+
+    for (i = 0; i < 5; i++) {
+        talloc_free(bin_sids[i]);
+    }
+}
+
 void test_map_id_external(void **state)
 {
     struct test_ctx *test_ctx;
@@ -697,6 +898,15 @@ int main(int argc, const char *argv[])
         cmocka_unit_test_setup_teardown(test_map_id_sec_slices,
                                         test_sss_idmap_setup_with_domains_sec_slices,
                                         test_sss_idmap_teardown),
+        cmocka_unit_test_setup_teardown(test_map_id_many_domains,
+                                        test_sss_idmap_setup,
+                                        test_sss_idmap_teardown),
+        cmocka_unit_test_setup_teardown(test_map_id_non_canonical_sid,
+                                        test_sss_idmap_setup_with_domains,
+                                        test_sss_idmap_teardown),
+        cmocka_unit_test_setup_teardown(test_map_bin_sids,
+                                        test_sss_idmap_setup_with_domains,
+                                        test_sss_idmap_teardown),
         cmocka_unit_test_setup_teardown(test_map_id_external,
                                         test_sss_idmap_setup_with_external_mappings,
                                         test_sss_idmap_teardown),
@@ -0,0 +1,584 @@
+/*
+    SSSD
+
+    Sudo responder index of cached rules - tests
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <errno.h>
+#include <popt.h>
+
+#include "tests/cmocka/common_mock.h"
+#include "tests/common.h"
+#include "util/dlinklist.h"
+#include "db/sysdb_sudo.h"
+#include "responder/sudo/sudosrv_private.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "test_sudosrv_index_conf.ldb"
+#define TEST_DOM_NAME "sudosrv_index_test"
+#define TEST_ID_PROVIDER "ldap"
+
+#define TEST_USER "alice"
+#define TEST_UID 1000
+
+struct test_rule {
+    const char *cn;
+    const char *users[3];
+    const char *order;
+};
+
+static struct test_rule test_rules[] = {
+    { "defaults", { NULL }, NULL },
+    { "rule_user", { TEST_USER, NULL }, "10" },
+    { "rule_user_group", { TEST_USER, "%wheel", NULL }, "15" },
+    { "rule_uid", { "#1000", NULL }, "20" },
+    { "rule_group", { "%wheel", NULL }, "30" },
+    { "rule_netgroup", { "+admins", NULL }, "5" },
+    { "rule_all", { "ALL", NULL }, "40" },
+    { "rule_other", { "bob", "%staff", NULL }, "50" },
+    { NULL, { NULL }, NULL }
+};
+
+static const char *test_attrs[] = { SYSDB_SUDO_CACHE_AT_CN,
+                                    SYSDB_OBJECTCLASS,
+                                    SYSDB_SUDO_CACHE_AT_USER,
+                                    SYSDB_SUDO_CACHE_AT_OPTION,
+                                    SYSDB_SUDO_CACHE_AT_ORDER,
+                                    NULL };
+
+struct sudosrv_index_test_ctx {
+    struct sss_test_ctx *tctx;
+    struct sudo_ctx *sudo_ctx;
+    char **groups;
+};
+
+static struct sysdb_attrs *build_rule(TALLOC_CTX *mem_ctx,
+                                      struct test_rule *test_rule)
+{
+    struct sysdb_attrs *rule;
+    size_t j;
+    errno_t ret;
+
+    rule = sysdb_new_attrs(mem_ctx);
+    assert_non_null(rule);
+
+    ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_CN,
+                                 test_rule->cn);
+    assert_int_equal(ret, EOK);
+
+    for (j = 0; test_rule->users[j] != NULL; j++) {
+        ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_USER,
+                                     test_rule->users[j]);
+        assert_int_equal(ret, EOK);
+    }
+
+    if (test_rule->order != NULL) {
+        ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_ORDER,
+                                     test_rule->order);
+        assert_int_equal(ret, EOK);
+    } else {
+        ret = sysdb_attrs_add_string(rule, SYSDB_SUDO_CACHE_AT_OPTION,
+                                     "!authenticate");
+        assert_int_equal(ret, EOK);
+    }
+
+    return rule;
+}
+
+static void store_rules(struct sss_domain_info *domain)
+{
+    struct sysdb_attrs **rules;
+    size_t count;
+    size_t i;
+    errno_t ret;
+
+    for (count = 0; test_rules[count].cn != NULL; count++);
+
+    rules = talloc_array(global_talloc_context, struct sysdb_attrs *, count);
+    assert_non_null(rules);
+
+    for (i = 0; i < count; i++) {
+        rules[i] = build_rule(rules, &test_rules[i]);
+    }
+
+    ret = sysdb_sudo_store(domain, rules, count);
+    assert_int_equal(ret, EOK);
+
+    talloc_free(rules);
+}
+
+/* The same steps as a refresh of some rules in the data provider */
+static void refresh_rules(struct sss_domain_info *domain,
+                          const char *delete_filter,
+                          struct sysdb_attrs **rules,
+                          size_t count)
+{
+    errno_t ret;
+
+    ret = sysdb_transaction_start(domain->sysdb);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_purge(domain, delete_filter, rules, count);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_store(domain, rules, count);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_transaction_commit(domain->sysdb);
+    assert_int_equal(ret, EOK);
+}
+
+static int test_sudosrv_index_setup(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+
+    assert_true(leak_check_setup());
+
+    test_ctx = talloc_zero(global_talloc_context,
+                           struct sudosrv_index_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->tctx = create_dom_test_ctx(test_ctx, TESTS_PATH, TEST_CONF_DB,
+                                         TEST_DOM_NAME, TEST_ID_PROVIDER,
+                                         NULL);
+    assert_non_null(test_ctx->tctx);
+
+    /* every rule is stored as expired */
+    test_ctx->tctx->dom->sudo_timeout = 0;
+    store_rules(test_ctx->tctx->dom);
+
+    test_ctx->sudo_ctx = talloc_zero(test_ctx, struct sudo_ctx);
+    assert_non_null(test_ctx->sudo_ctx);
+
+    test_ctx->groups = talloc_zero_array(test_ctx, char *, 2);
+    assert_non_null(test_ctx->groups);
+    test_ctx->groups[0] = talloc_strdup(test_ctx->groups, "wheel");
+    assert_non_null(test_ctx->groups[0]);
+
+    check_leaks_push(test_ctx);
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_sudosrv_index_teardown(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+    struct sudosrv_index *index;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    /* the indexes are kept for the lifetime of the responder */
+    while ((index = test_ctx->sudo_ctx->indexes) != NULL) {
+        DLIST_REMOVE(test_ctx->sudo_ctx->indexes, index);
+        talloc_free(index);
+    }
+    assert_true(check_leaks_pop(test_ctx));
+
+    talloc_free(test_ctx);
+    assert_true(leak_check_teardown());
+    return 0;
+}
+
+/* The rules and attributes sudosrv_query_cache() returned before the
+ * index was introduced. */
+static void query_sysdb(TALLOC_CTX *mem_ctx,
+                        struct sss_domain_info *domain,
+                        const char **attrs,
+                        unsigned int flags,
+                        char **groups,
+                        struct sysdb_attrs ***_rules,
+                        size_t *_count)
+{
+    struct ldb_message **msgs;
+    struct sysdb_attrs **rules = NULL;
+    char *filter;
+    size_t count;
+    errno_t ret;
+
+    ret = sysdb_get_sudo_filter(mem_ctx, TEST_USER, TEST_UID, groups,
+                                flags, &filter);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_search_custom(mem_ctx, domain, filter, SUDORULE_SUBDIR,
+                              attrs, &count, &msgs);
+    if (ret == ENOENT) {
+        count = 0;
+    } else {
+        assert_int_equal(ret, EOK);
+
+        ret = sysdb_msg2attrs(mem_ctx, count, msgs, &rules);
+        assert_int_equal(ret, EOK);
+    }
+
+    *_rules = rules;
+    *_count = count;
+}
+
+static void assert_same_rule(struct sysdb_attrs *expected,
+                             struct sysdb_attrs *rule)
+{
+    struct ldb_message_element *el;
+    int i;
+    int ret;
+
+    assert_int_equal(rule->num, expected->num);
+
+    for (i = 0; i < expected->num; i++) {
+        ret = sysdb_attrs_get_el_ext(rule, expected->a[i].name, false, &el);
+        assert_int_equal(ret, EOK);
+        assert_int_equal(el->num_values, expected->a[i].num_values);
+    }
+}
+
+/* Rules are matched by the value of the first attribute in @attrs. */
+static void assert_same_as_sysdb(struct sudosrv_index_test_ctx *test_ctx,
+                                 const char **attrs,
+                                 unsigned int flags,
+                                 size_t expected_count)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sudosrv_index *index;
+    struct sysdb_attrs **expected;
+    struct sysdb_attrs **rules;
+    const char *expected_name;
+    const char *name;
+    size_t num_expected;
+    uint32_t prev_order;
+    uint32_t order;
+    uint32_t count;
+    size_t i;
+    size_t j;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    assert_non_null(tmp_ctx);
+
+    query_sysdb(tmp_ctx, test_ctx->tctx->dom, attrs, flags,
+                test_ctx->groups, &expected, &num_expected);
+    assert_int_equal(num_expected, expected_count);
+
+    ret = sudosrv_index_get(test_ctx->sudo_ctx, test_ctx->tctx->dom, &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sudosrv_index_query(tmp_ctx, index, attrs, flags, TEST_USER,
+                              TEST_UID, test_ctx->groups, &rules, &count);
+    assert_int_equal(ret, EOK);
+    assert_int_equal(count, num_expected);
+
+    for (i = 0; i < num_expected; i++) {
+        ret = sysdb_attrs_get_string(expected[i], attrs[0], &expected_name);
+        assert_int_equal(ret, EOK);
+
+        for (j = 0; j < count; j++) {
+            ret = sysdb_attrs_get_string(rules[j], attrs[0], &name);
+            assert_int_equal(ret, EOK);
+            if (strcmp(name, expected_name) == 0) {
+                break;
+            }
+        }
+        assert_true(j < count);
+
+        assert_same_rule(expected[i], rules[j]);
+    }
+
+    /* the index keeps the sudoOrder sorting */
+    prev_order = UINT32_MAX;
+    for (i = 0; i < count; i++) {
+        ret = sysdb_attrs_get_uint32_t(rules[i], SYSDB_SUDO_CACHE_AT_ORDER,
+                                       &order);
+        if (ret == ENOENT) {
+            continue;
+        }
+        assert_int_equal(ret, EOK);
+        assert_true(order <= prev_order);
+        prev_order = order;
+    }
+
+    talloc_free(tmp_ctx);
+}
+
+void test_sudosrv_index_user(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+    const char *attrs[] = { SYSDB_SUDO_CACHE_AT_CN,
+                            SYSDB_SUDO_CACHE_AT_USER,
+                            SYSDB_SUDO_CACHE_AT_ORDER,
+                            NULL };
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    /* rule_user, rule_user_group */
+    assert_same_as_sysdb(test_ctx, attrs, SYSDB_SUDO_FILTER_USERNAME, 2);
+}
+
+void test_sudosrv_index_uid(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+    const char *attrs[] = { SYSDB_SUDO_CACHE_AT_CN,
+                            SYSDB_SUDO_CACHE_AT_USER,
+                            NULL };
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    /* rule_uid */
+    assert_same_as_sysdb(test_ctx, attrs, SYSDB_SUDO_FILTER_UID, 1);
+}
+
+void test_sudosrv_index_group(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    /* rule_user_group, rule_group */
+    assert_same_as_sysdb(test_ctx, test_attrs, SYSDB_SUDO_FILTER_GROUPS, 2);
+}
+
+void test_sudosrv_index_netgroup(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    /* rule_netgroup */
+    assert_same_as_sysdb(test_ctx, test_attrs, SYSDB_SUDO_FILTER_NGRS, 1);
+}
+
+void test_sudosrv_index_all(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    /* rule_all */
+    assert_same_as_sysdb(test_ctx, test_attrs,
+                         SYSDB_SUDO_FILTER_INCLUDE_ALL, 1);
+
+    /* defaults */
+    assert_same_as_sysdb(test_ctx, test_attrs,
+                         SYSDB_SUDO_FILTER_INCLUDE_DFL, 1);
+
+    /* everything but rule_other and defaults */
+    assert_same_as_sysdb(test_ctx, test_attrs,
+                         SYSDB_SUDO_FILTER_USERINFO
+                         | SYSDB_SUDO_FILTER_INCLUDE_ALL, 6);
+}
+
+void test_sudosrv_index_expired(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+    const char *attrs[] = { SYSDB_NAME, NULL };
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    assert_same_as_sysdb(test_ctx, attrs,
+                         SYSDB_SUDO_FILTER_USERINFO
+                         | SYSDB_SUDO_FILTER_INCLUDE_ALL
+                         | SYSDB_SUDO_FILTER_INCLUDE_DFL
+                         | SYSDB_SUDO_FILTER_ONLY_EXPIRED, 7);
+}
+
+void test_sudosrv_index_attrs(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+    struct sudosrv_index *index;
+    struct sysdb_attrs **rules;
+    const char *not_indexed[] = { SYSDB_SUDO_CACHE_AT_CN,
+                                  SYSDB_ORIG_DN,
+                                  NULL };
+    uint32_t count;
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+
+    ret = sudosrv_index_get(test_ctx->sudo_ctx, test_ctx->tctx->dom, &index);
+    assert_int_equal(ret, EOK);
+
+    /* the caller falls back to searching sysdb */
+    ret = sudosrv_index_query(test_ctx, index, not_indexed,
+                              SYSDB_SUDO_FILTER_USERNAME, TEST_USER,
+                              TEST_UID, test_ctx->groups, &rules, &count);
+    assert_int_equal(ret, ENOTSUP);
+
+    ret = sudosrv_index_query(test_ctx, index, NULL,
+                              SYSDB_SUDO_FILTER_USERNAME, TEST_USER,
+                              TEST_UID, test_ctx->groups, &rules, &count);
+    assert_int_equal(ret, ENOTSUP);
+}
+
+void test_sudosrv_index_refresh(void **state)
+{
+    struct sudosrv_index_test_ctx *test_ctx;
+    struct sss_domain_info *domain;
+    struct sudosrv_index *index;
+    struct sudosrv_index *refreshed;
+    struct sysdb_attrs **rules;
+    uint64_t generation;
+    uint64_t new_generation;
+    const char *delete_filter = "(&("SYSDB_OBJECTCLASS"="SYSDB_SUDO_CACHE_OC")"
+                                "(|("SYSDB_NAME"=rule_user)"
+                                "("SYSDB_NAME"=rule_user_group)))";
+    const char *expired_attrs[] = { SYSDB_NAME, NULL };
+    const char *attrs[] = { SYSDB_SUDO_CACHE_AT_CN,
+                            SYSDB_SUDO_CACHE_AT_USER,
+                            SYSDB_SUDO_CACHE_AT_HOST,
+                            NULL };
+    errno_t ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct sudosrv_index_test_ctx);
+    domain = test_ctx->tctx->dom;
+
+    ret = sudosrv_index_get(test_ctx->sudo_ctx, domain, &index);
+    assert_int_equal(ret, EOK);
+
+    ret = sysdb_sudo_get_rules_generation(domain, &generation);
+    assert_int_equal(ret, EOK);
+
+    /* the expired rules of the user are refreshed and did not change */
+    domain->sudo_timeout = 300;
+    rules = talloc_array(test_ctx, struct sysdb_attrs *, 2);
+    assert_non_null(rules);
+    rules[0] = build_rule(rules, &test_rules[1]);
+    rules[1] = build_rule(rules, &test_rules[2]);
+
+    refresh_rules(domain, delete_filter, rules, 2);
+    talloc_free(rules);
+
+    ret = sysdb_sudo_get_rules_generation(domain, &new_generation);
+    assert_int_equal(ret, EOK);
+    assert_true(new_generation == generation);
+
+    /* the index only learns the new expiration */
+    ret = sudosrv_index_get(test_ctx->sudo_ctx, domain, &refreshed);
+    assert_int_equal(ret, EOK);
+    assert_ptr_equal(refreshed, index);
+
+    assert_same_as_sysdb(test_ctx, expired_attrs,
+                         SYSDB_SUDO_FILTER_USERINFO
+                         | SYSDB_SUDO_FILTER_INCLUDE_ALL
+                         | SYSDB_SUDO_FILTER_INCLUDE_DFL
+                         | SYSDB_SUDO_FILTER_ONLY_EXPIRED, 5);
+
+    /* one of the rules changed on the server */
+    rules = talloc_array(test_ctx, struct sysdb_attrs *, 2);
+    assert_non_null(rules);
+    rules[0] = build_rule(rules, &test_rules[1]);
+    rules[1] = build_rule(rules, &test_rules[2]);
+    ret = sysdb_attrs_add_string(rules[0], SYSDB_SUDO_CACHE_AT_HOST, "ALL");
+    assert_int_equal(ret, EOK);
+
+    refresh_rules(domain, delete_filter, rules, 2);
+    talloc_free(rules);
+
+    ret = sysdb_sudo_get_rules_generation(domain, &new_generation);
+    assert_int_equal(ret, EOK);
+    assert_true(new_generation != generation);
+
+    ret = sudosrv_index_get(test_ctx->sudo_ctx, domain, &refreshed);
+    assert_int_equal(ret, EOK);
+    assert_ptr_not_equal(refreshed, index);
+
+    assert_same_as_sysdb(test_ctx, attrs, SYSDB_SUDO_FILTER_USERNAME, 2);
+
+    /* a rule removed on the server is deleted and rebuilds the index */
+    generation = new_generation;
+    rules = talloc_array(test_ctx, struct sysdb_attrs *, 1);
+    assert_non_null(rules);
+    rules[0] = build_rule(rules, &test_rules[2]);
+
+    refresh_rules(domain, delete_filter, rules, 1);
+    talloc_free(rules);
+
+    ret = sysdb_sudo_get_rules_generation(domain, &new_generation);
+    assert_int_equal(ret, EOK);
+    assert_true(new_generation != generation);
+
+    assert_same_as_sysdb(test_ctx, attrs, SYSDB_SUDO_FILTER_USERNAME, 1);
+}
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    int rv;
+    int no_cleanup = 0;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        {"no-cleanup", 'n', POPT_ARG_NONE, &no_cleanup, 0,
+         _("Do not delete the test database after a test run"), NULL },
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_user,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_uid,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_group,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_netgroup,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_all,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_expired,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_attrs,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+        cmocka_unit_test_setup_teardown(test_sudosrv_index_refresh,
+                                        test_sudosrv_index_setup,
+                                        test_sudosrv_index_teardown),
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    /* Even though normally the tests should clean up after themselves
+     * they might not after a failed run. Remove the old db to be sure */
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    rv = cmocka_run_group_tests(tests, NULL, NULL);
+    if (rv == 0 && !no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+    return rv;
+}
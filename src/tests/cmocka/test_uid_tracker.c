@@ -0,0 +1,298 @@
+/*
+    SSSD
+
+    Active UID tracker - tests
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <talloc.h>
+#include <tevent.h>
+#include <errno.h>
+#include <popt.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "tests/cmocka/common_mock.h"
+
+/* In order to access the tracker directly */
+#include "util/uid_tracker.c"
+
+#define TEST_UID 12345
+#define NOT_ACTIVE_UID ((uid_t) -7)
+
+struct uid_tracker_test_ctx {
+    struct tevent_context *ev;
+    bool tracking;
+};
+
+static int test_setup(void **state)
+{
+    struct uid_tracker_test_ctx *test_ctx;
+    errno_t ret;
+
+    test_ctx = talloc_zero(NULL, struct uid_tracker_test_ctx);
+    assert_non_null(test_ctx);
+
+    test_ctx->ev = tevent_context_init(test_ctx);
+    assert_non_null(test_ctx->ev);
+
+    ret = uid_tracker_start(test_ctx, test_ctx->ev);
+    test_ctx->tracking = (ret == EOK);
+
+    *state = test_ctx;
+    return 0;
+}
+
+static int test_teardown(void **state)
+{
+    talloc_free(*state);
+    return 0;
+}
+
+static void assert_uid_active(uid_t uid, bool expected)
+{
+    TALLOC_CTX *tmp_ctx;
+    hash_table_t *table;
+    hash_key_t key;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    assert_non_null(tmp_ctx);
+
+    ret = uid_tracker_get_uid_table(tmp_ctx, &table);
+    assert_int_equal(ret, EOK);
+
+    key.type = HASH_KEY_ULONG;
+    key.ul = (unsigned long) uid;
+    assert_true(hash_has_key(table, &key) == expected);
+
+    talloc_free(tmp_ctx);
+}
+
+void test_uid_tracker_fallback(void **state)
+{
+    /* no tracker is running, /proc is read */
+    assert_uid_active(getuid(), true);
+    assert_uid_active(NOT_ACTIVE_UID, false);
+}
+
+void test_uid_tracker_active(void **state)
+{
+    struct uid_tracker_test_ctx *test_ctx;
+
+    test_ctx = talloc_get_type_abort(*state, struct uid_tracker_test_ctx);
+    if (!test_ctx->tracking) {
+        skip();
+    }
+
+    assert_uid_active(getuid(), true);
+    assert_uid_active(NOT_ACTIVE_UID, false);
+}
+
+void test_uid_tracker_uid_change(void **state)
+{
+    struct uid_tracker_test_ctx *test_ctx;
+    int pipefd[2];
+    pid_t pid;
+    char c;
+    int ret;
+
+    test_ctx = talloc_get_type_abort(*state, struct uid_tracker_test_ctx);
+    if (!test_ctx->tracking || geteuid() != 0) {
+        skip();
+    }
+
+    /* read the tables before the child exists so that only the events
+     * tell about it */
+    assert_uid_active(TEST_UID, false);
+
+    ret = pipe(pipefd);
+    assert_int_equal(ret, 0);
+
+    pid = fork();
+    assert_int_not_equal(pid, -1);
+    if (pid == 0) {
+        close(pipefd[0]);
+        if (setuid(TEST_UID) != 0) {
+            _exit(1);
+        }
+        if (write(pipefd[1], "", 1) != 1) {
+            _exit(1);
+        }
+        pause();
+        _exit(0);
+    }
+
+    close(pipefd[1]);
+    assert_int_equal(read(pipefd[0], &c, 1), 1);
+    close(pipefd[0]);
+
+    assert_uid_active(TEST_UID, true);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+
+    assert_uid_active(TEST_UID, false);
+}
+
+#ifdef HAVE_LINUX_CN_PROC_H
+
+/* error reported by the acknowledgement returned for the socket of a fake
+ * tracker, -1 if there is none */
+static int test_ack_err = -1;
+
+ssize_t __real_recvfrom(int sockfd, void *buf, size_t len, int flags,
+                        struct sockaddr *src_addr, socklen_t *addrlen);
+
+ssize_t __wrap_recvfrom(int sockfd, void *buf, size_t len, int flags,
+                        struct sockaddr *src_addr, socklen_t *addrlen)
+{
+    struct sockaddr_nl *from;
+    struct nlmsghdr *nlh;
+    struct cn_msg *cnmsg;
+    struct proc_event *ev;
+    size_t size;
+
+    if (sockfd != -1) {
+        return __real_recvfrom(sockfd, buf, len, flags, src_addr, addrlen);
+    }
+
+    if (test_ack_err == -1) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    size = NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(struct proc_event));
+    assert_true(len >= size);
+    memset(buf, 0, size);
+
+    nlh = (struct nlmsghdr *) buf;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg)
+                                  + sizeof(struct proc_event));
+    nlh->nlmsg_type = NLMSG_DONE;
+
+    cnmsg = NLMSG_DATA(nlh);
+    cnmsg->id.idx = CN_IDX_PROC;
+    cnmsg->id.val = CN_VAL_PROC;
+    cnmsg->len = sizeof(struct proc_event);
+
+    ev = (struct proc_event *) cnmsg->data;
+    ev->what = PROC_EVENT_NONE;
+    ev->event_data.ack.err = test_ack_err;
+    test_ack_err = -1;
+
+    from = (struct sockaddr_nl *) src_addr;
+    memset(from, 0, sizeof(struct sockaddr_nl));
+    from->nl_family = AF_NETLINK;
+    *addrlen = sizeof(struct sockaddr_nl);
+
+    return size;
+}
+
+/* A tracker which did not read /proc yet and whose socket only returns the
+ * acknowledgement of the subscription. */
+static int test_ack_setup(void **state)
+{
+    struct uid_tracker_test_ctx *test_ctx;
+    struct uid_tracker *tracker;
+
+    test_ctx = talloc_zero(NULL, struct uid_tracker_test_ctx);
+    assert_non_null(test_ctx);
+
+    tracker = talloc_zero(test_ctx, struct uid_tracker);
+    assert_non_null(tracker);
+    tracker->fd = -1;
+    tracker->resync = true;
+    talloc_set_destructor(tracker, uid_tracker_destructor);
+
+    assert_null(uid_tracker);
+    uid_tracker = tracker;
+    test_ctx->tracking = true;
+
+    *state = test_ctx;
+    return 0;
+}
+
+void test_uid_tracker_ack(void **state)
+{
+    test_ack_err = 0;
+
+    assert_uid_active(getuid(), true);
+    assert_int_equal(test_ack_err, -1);
+
+    /* the tracker is kept and the tables were read from /proc */
+    assert_non_null(uid_tracker);
+    assert_false(uid_tracker->resync);
+}
+
+void test_uid_tracker_ack_error(void **state)
+{
+    test_ack_err = EPERM;
+
+    /* /proc is read instead */
+    assert_uid_active(getuid(), true);
+    assert_int_equal(test_ack_err, -1);
+
+    /* and the tracker is stopped */
+    assert_null(uid_tracker);
+}
+
+#endif /* HAVE_LINUX_CN_PROC_H */
+
+int main(int argc, const char *argv[])
+{
+    poptContext pc;
+    int opt;
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        POPT_TABLEEND
+    };
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_uid_tracker_fallback),
+        cmocka_unit_test_setup_teardown(test_uid_tracker_active,
+                                        test_setup, test_teardown),
+        cmocka_unit_test_setup_teardown(test_uid_tracker_uid_change,
+                                        test_setup, test_teardown),
+#ifdef HAVE_LINUX_CN_PROC_H
+        cmocka_unit_test_setup_teardown(test_uid_tracker_ack,
+                                        test_ack_setup, test_teardown),
+        cmocka_unit_test_setup_teardown(test_uid_tracker_ack_error,
+                                        test_ack_setup, test_teardown),
+#endif /* HAVE_LINUX_CN_PROC_H */
+    };
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while((opt = poptGetNextOpt(pc)) != -1) {
+        switch(opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    DEBUG_CLI_INIT(debug_level);
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,146 @@
+/*
+    SSSD
+
+    Debug logger benchmark
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Measures how many DEBUG() calls per second a process can make with the
+ * synchronous and with the asynchronous debug logger. The same mix of
+ * messages is logged with several debug levels so that the cost of the
+ * disabled messages is visible as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <popt.h>
+#include <sys/time.h>
+
+#include "util/util.h"
+
+#define DEFAULT_COUNT 200000
+#define DEFAULT_FILE  "/tmp/sssd-debug-bench.log"
+
+static const int bench_levels[] = { 0, 2, 6, 9 };
+
+static double bench_elapsed(struct timeval *start, struct timeval *end)
+{
+    return (end->tv_sec - start->tv_sec)
+           + (end->tv_usec - start->tv_usec) / 1000000.0;
+}
+
+/* mimics the messages of a busy request path */
+static void bench_log(int i)
+{
+    DEBUG(SSSDBG_OP_FAILURE, "Request [%d] failed [%d]: %s\n",
+          i, EIO, strerror(EIO));
+    DEBUG(SSSDBG_FUNC_DATA, "Looking up [user%d@example.com]\n", i);
+    DEBUG(SSSDBG_TRACE_FUNC, "Issuing request for [%s] with id [%d]\n",
+          "getpwnam", i);
+    DEBUG(SSSDBG_TRACE_INTERNAL, "Searching sysdb with "
+          "[(&(objectCategory=user)(nameAlias=user%d@example.com))]\n", i);
+    DEBUG(SSSDBG_TRACE_ALL, "Entry [%d] has %d attributes\n", i, 42);
+}
+
+static void bench_run(const char *mode, int count)
+{
+    struct timeval start;
+    struct timeval end;
+    double secs;
+    size_t l;
+    int i;
+
+    for (l = 0; l < sizeof(bench_levels) / sizeof(int); l++) {
+        debug_level = debug_convert_old_level(bench_levels[l]);
+
+        gettimeofday(&start, NULL);
+        for (i = 0; i < count; i++) {
+            bench_log(i);
+        }
+        debug_async_flush();
+        gettimeofday(&end, NULL);
+
+        secs = bench_elapsed(&start, &end);
+        printf("%-6s debug_level %d: %10.0f calls/sec (%.3f s)\n",
+               mode, bench_levels[l], count * 5 / secs, secs);
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    int pc_count = DEFAULT_COUNT;
+    const char *pc_file = DEFAULT_FILE;
+    FILE *f;
+    int ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "count", 'c', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_count, 0,
+                    "Number of iterations, each logs five messages", NULL },
+        { "file", 'f', POPT_ARG_STRING | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &pc_file, 0,
+                    "The file to write the debug messages to", NULL },
+        POPT_TABLEEND
+    };
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            poptFreeContext(pc);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    f = fopen(pc_file, "w");
+    if (f == NULL) {
+        fprintf(stderr, "Unable to open [%s]\n", pc_file);
+        return 1;
+    }
+
+    ret = set_debug_file_from_fd(fileno(f));
+    if (ret != EOK) {
+        fprintf(stderr, "Unable to set the debug file\n");
+        return 1;
+    }
+
+    debug_prg_name = "debug-bench";
+    debug_to_file = 1;
+    debug_timestamps = 1;
+    debug_microseconds = 1;
+
+    bench_run("sync", pc_count);
+
+    ret = debug_async_init();
+    if (ret != EOK) {
+        fprintf(stderr, "Unable to start the debug writer thread\n");
+        return 1;
+    }
+
+    bench_run("async", pc_count);
+
+    unlink(pc_file);
+    return 0;
+}
@@ -87,6 +87,19 @@ def group_bis(base_dn, cn, gidNumber, member_uids=[], member_gids=[]):
     return ("cn=" + cn + ",ou=Groups," + base_dn, attr_list)
 
 
+def service(base_dn, cn, port, protocols, aliases=[]):
+    """
+    Generate an RFC2307 service add-modlist for passing to ldap.add*.
+    """
+    attr_list = [
+        ('objectClass', ['top', 'ipService']),
+        ('cn', [cn] + aliases),
+        ('ipServicePort', [str(port)]),
+        ('ipServiceProtocol', protocols)
+    ]
+    return ("cn=" + cn + ",ou=Services," + base_dn, attr_list)
+
+
 class List(list):
     """LDAP add-modlist list"""
 
@@ -124,3 +137,9 @@ class List(list):
         self.append(group_bis(base_dn or self.base_dn,
                               cn, gidNumber,
                               member_uids, member_gids))
+
+    def add_service(self, cn, port, protocols, aliases=[],
+                    base_dn=None):
+        """Add an RFC2307 service add-modlist."""
+        self.append(service(base_dn or self.base_dn,
+                            cn, port, protocols, aliases))
@@ -25,7 +25,7 @@ from ctypes import (cdll, c_int, c_char, c_uint32, c_long, c_char_p,
 
 class NssReturnCode(object):
     """ 'enum' class for name service switch return code """
-    TRYAGAIN = -2,
+    TRYAGAIN = -2
     UNAVAIL = -1
     NOTFOUND = 0
     SUCCESS = 1
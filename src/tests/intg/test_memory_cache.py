@@ -23,12 +23,17 @@ import grp
 import pwd
 import config
 import signal
+import socket
 import subprocess
 import time
+import ldap
 import pytest
 import ds_openldap
 import ldap_ent
 import sssd_id
+from errno import ERANGE
+from ctypes import (cdll, c_int, c_char_p, c_void_p, c_size_t, POINTER,
+                    Structure, sizeof, pointer)
 from util import unindent
 
 LDAP_BASE_DN = "dc=example,dc=com"
@@ -154,6 +159,39 @@ def sanity_rfc2307(request, ldap_conn):
     return None
 
 
+def load_services_to_ldap(request, ldap_conn):
+    ent_list = ldap_ent.List(ldap_conn.ds_inst.base_dn)
+    ent_list.add_service("svc1", 3001, ["tcp", "udp"], ["svc1-alias"])
+    ent_list.add_service("svc2", 3002, ["tcp"])
+    create_ldap_fixture(request, ldap_conn, ent_list)
+
+
+@pytest.fixture
+def services_rfc2307(request, ldap_conn):
+    load_services_to_ldap(request, ldap_conn)
+
+    # the entries in sysdb expire quickly, the memory cache records do not
+    conf = unindent("""\
+        [sssd]
+        domains             = LDAP
+        services            = nss
+
+        [nss]
+
+        [domain/LDAP]
+        ldap_auth_disable_tls_never_use_in_production = true
+        ldap_schema         = rfc2307
+        id_provider         = ldap
+        auth_provider       = ldap
+        ldap_uri            = {ldap_conn.ds_inst.ldap_url}
+        ldap_search_base    = {ldap_conn.ds_inst.base_dn}
+        entry_cache_timeout = 1
+    """).format(**locals())
+    create_conf_fixture(request, conf)
+    create_sssd_fixture(request)
+    return None
+
+
 @pytest.fixture
 def fqname_rfc2307(request, ldap_conn):
     load_data_to_ldap(request, ldap_conn)
@@ -778,3 +816,253 @@ def test_removed_mc(ldap_conn, sanity_rfc2307):
         grp.getgrnam('group1')
     with pytest.raises(KeyError):
         grp.getgrgid(2001)
+
+
+class Servent(Structure):
+    _fields_ = [("s_name", c_char_p),
+                ("s_aliases", POINTER(c_char_p)),
+                ("s_port", c_int),
+                ("s_proto", c_char_p)]
+
+
+def call_sssd_getserv(func_name, key, protocol, buflen):
+    """
+    Look a service up only with the sssd NSS module, the memory cache is
+    read first unless SSS_NSS_USE_MEMCACHE is "NO".
+
+    @param string func_name _nss_sss_getservbyname_r or
+                            _nss_sss_getservbyport_r
+    @param key service name or port in network byte order
+    @param string protocol protocol or None for any
+    @param int buflen size of the buffer for the strings of the result
+
+    @return (int, int, dict) (err, errno, service)
+        service contains name, port in host byte order, proto and aliases
+        if err is NssReturnCode.SUCCESS
+    """
+    libnss_sss_path = config.PREFIX + "/lib/libnss_sss.so.2"
+    libnss_sss = cdll.LoadLibrary(libnss_sss_path)
+
+    func = getattr(libnss_sss, func_name)
+    func.restype = c_int
+    func.argtypes = [c_char_p if isinstance(key, str) else c_int, c_char_p,
+                     POINTER(Servent), c_void_p, c_size_t, POINTER(c_int)]
+
+    result = Servent()
+    # the aliases are stored at the beginning of the buffer, it has to be
+    # aligned for pointers
+    buf = (c_void_p * (buflen // sizeof(c_void_p) + 1))()
+    errno = POINTER(c_int)(c_int(0))
+
+    res = func(key, protocol, pointer(result), buf, c_size_t(buflen), errno)
+
+    service = None
+    if res == sssd_id.NssReturnCode.SUCCESS:
+        aliases = []
+        i = 0
+        while result.s_aliases[i] is not None:
+            aliases.append(result.s_aliases[i])
+            i += 1
+        service = dict(name=result.s_name,
+                       port=socket.ntohs(result.s_port & 0xffff),
+                       proto=result.s_proto,
+                       aliases=aliases)
+
+    return (int(res), errno[0], service)
+
+
+def call_sssd_getservbyname(name, protocol, buflen=1024):
+    return call_sssd_getserv("_nss_sss_getservbyname_r", name, protocol,
+                             buflen)
+
+
+def call_sssd_getservbyport(port, protocol, buflen=1024):
+    return call_sssd_getserv("_nss_sss_getservbyport_r", socket.htons(port),
+                             protocol, buflen)
+
+
+def assert_service(res, errno, service, pattern):
+    assert res == sssd_id.NssReturnCode.SUCCESS, \
+        "Could not find service %s, %d" % (pattern["name"], errno)
+    assert service == pattern, \
+        "result: %s\n expected %s" % (service, pattern)
+
+
+def assert_services():
+    svc1_tcp = dict(name="svc1", port=3001, proto="tcp",
+                    aliases=["svc1-alias"])
+    svc1_udp = dict(name="svc1", port=3001, proto="udp",
+                    aliases=["svc1-alias"])
+    svc2_tcp = dict(name="svc2", port=3002, proto="tcp", aliases=[])
+
+    assert_service(*call_sssd_getservbyname("svc1", "tcp"), pattern=svc1_tcp)
+    assert_service(*call_sssd_getservbyname("svc1", "udp"), pattern=svc1_udp)
+    assert_service(*call_sssd_getservbyname("svc2", "tcp"), pattern=svc2_tcp)
+
+    assert_service(*call_sssd_getservbyport(3001, "tcp"), pattern=svc1_tcp)
+    assert_service(*call_sssd_getservbyport(3001, "udp"), pattern=svc1_udp)
+    assert_service(*call_sssd_getservbyport(3002, "tcp"), pattern=svc2_tcp)
+
+
+def assert_missing_mc_service(name, port, protocol):
+    # sssd is stopped, anything found comes from the memory cache
+    (res, errno, _) = call_sssd_getservbyname(name, protocol)
+    assert res != sssd_id.NssReturnCode.SUCCESS, \
+        "Service %s/%s should not be in the memory cache" % (name, protocol)
+    (res, errno, _) = call_sssd_getservbyport(port, protocol)
+    assert res != sssd_id.NssReturnCode.SUCCESS, \
+        "Service %d/%s should not be in the memory cache" % (port, protocol)
+
+
+def test_getservbyname_getservbyport(ldap_conn, services_rfc2307):
+    assert_services()
+
+
+def test_getservbyname_getservbyport_with_mc(ldap_conn, services_rfc2307):
+    assert_services()
+    stop_sssd()
+    assert_services()
+
+
+def test_getservbyport_network_byte_order_with_mc(ldap_conn,
+                                                  services_rfc2307):
+    assert_service(*call_sssd_getservbyport(3002, "tcp"),
+                   pattern=dict(name="svc2", port=3002, proto="tcp",
+                                aliases=[]))
+    stop_sssd()
+
+    # the port is passed to the module in network byte order
+    (res, errno, _) = call_sssd_getserv("_nss_sss_getservbyport_r", 3002,
+                                        "tcp", 1024)
+    if socket.htons(3002) != 3002:
+        assert res != sssd_id.NssReturnCode.SUCCESS, \
+            "Port in host byte order should not be found"
+
+    assert_service(*call_sssd_getservbyport(3002, "tcp"),
+                   pattern=dict(name="svc2", port=3002, proto="tcp",
+                                aliases=[]))
+
+
+def test_getservbyname_erange_with_mc(ldap_conn, services_rfc2307):
+    assert_service(*call_sssd_getservbyname("svc1", "tcp"),
+                   pattern=dict(name="svc1", port=3001, proto="tcp",
+                                aliases=["svc1-alias"]))
+    stop_sssd()
+
+    # the record is found in the memory cache but it does not fit
+    (res, errno, _) = call_sssd_getservbyname("svc1", "tcp", buflen=8)
+    assert res == sssd_id.NssReturnCode.TRYAGAIN
+    assert errno == ERANGE
+
+    (res, errno, _) = call_sssd_getservbyport(3001, "tcp", buflen=8)
+    assert res == sssd_id.NssReturnCode.TRYAGAIN
+    assert errno == ERANGE
+
+    assert_service(*call_sssd_getservbyname("svc1", "tcp"),
+                   pattern=dict(name="svc1", port=3001, proto="tcp",
+                                aliases=["svc1-alias"]))
+
+
+def test_getservbyname_without_protocol_not_cached(ldap_conn,
+                                                   services_rfc2307):
+    assert_service(*call_sssd_getservbyname("svc2", None),
+                   pattern=dict(name="svc2", port=3002, proto="tcp",
+                                aliases=[]))
+    assert_service(*call_sssd_getservbyport(3002, None),
+                   pattern=dict(name="svc2", port=3002, proto="tcp",
+                                aliases=[]))
+    stop_sssd()
+
+    # the responder picked the protocol, nothing was stored
+    (res, errno, _) = call_sssd_getservbyname("svc2", None)
+    assert res != sssd_id.NssReturnCode.SUCCESS
+    (res, errno, _) = call_sssd_getservbyport(3002, None)
+    assert res != sssd_id.NssReturnCode.SUCCESS
+    assert_missing_mc_service("svc2", 3002, "tcp")
+
+
+def add_removable_service(request, ldap_conn, name, port):
+    svc = ldap_ent.service(ldap_conn.ds_inst.base_dn, name, port, ["tcp"])
+    ldap_conn.add_s(svc[0], svc[1])
+
+    def teardown():
+        try:
+            ldap_conn.delete_s(svc[0])
+        except ldap.NO_SUCH_OBJECT:
+            pass
+    request.addfinalizer(teardown)
+    return svc[0]
+
+
+def ask_responder(request):
+    """Bypass the memory cache in this process until the end of the test"""
+    os.environ["SSS_NSS_USE_MEMCACHE"] = "NO"
+
+    def teardown():
+        os.environ.pop("SSS_NSS_USE_MEMCACHE", None)
+    request.addfinalizer(teardown)
+
+
+def test_invalidate_removed_service_by_name(request, ldap_conn,
+                                            services_rfc2307):
+    dn = add_removable_service(request, ldap_conn, "svc3", 3003)
+    pattern = dict(name="svc3", port=3003, proto="tcp", aliases=[])
+    assert_service(*call_sssd_getservbyname("svc3", "tcp"), pattern=pattern)
+
+    ldap_conn.delete_s(dn)
+    # let the entry in sysdb expire
+    time.sleep(2)
+
+    ask_responder(request)
+    (res, errno, _) = call_sssd_getservbyname("svc3", "tcp")
+    assert res == sssd_id.NssReturnCode.NOTFOUND
+    del os.environ["SSS_NSS_USE_MEMCACHE"]
+
+    stop_sssd()
+    assert_missing_mc_service("svc3", 3003, "tcp")
+
+
+def test_invalidate_removed_service_by_port(request, ldap_conn,
+                                            services_rfc2307):
+    dn = add_removable_service(request, ldap_conn, "svc3", 3003)
+    pattern = dict(name="svc3", port=3003, proto="tcp", aliases=[])
+    assert_service(*call_sssd_getservbyport(3003, "tcp"), pattern=pattern)
+
+    ldap_conn.delete_s(dn)
+    # let the entry in sysdb expire
+    time.sleep(2)
+
+    ask_responder(request)
+    (res, errno, _) = call_sssd_getservbyport(3003, "tcp")
+    assert res == sssd_id.NssReturnCode.NOTFOUND
+    del os.environ["SSS_NSS_USE_MEMCACHE"]
+
+    stop_sssd()
+    assert_missing_mc_service("svc3", 3003, "tcp")
+
+
+def test_invalidate_changed_service_port(request, ldap_conn,
+                                         services_rfc2307):
+    old_pattern = dict(name="svc2", port=3002, proto="tcp", aliases=[])
+    new_pattern = dict(name="svc2", port=3012, proto="tcp", aliases=[])
+    assert_service(*call_sssd_getservbyname("svc2", "tcp"),
+                   pattern=old_pattern)
+
+    ldap_conn.modify_s("cn=svc2,ou=Services," + ldap_conn.ds_inst.base_dn,
+                       [(ldap.MOD_REPLACE, "ipServicePort", "3012")])
+    # let the entry in sysdb expire
+    time.sleep(2)
+
+    ask_responder(request)
+    assert_service(*call_sssd_getservbyname("svc2", "tcp"),
+                   pattern=new_pattern)
+    del os.environ["SSS_NSS_USE_MEMCACHE"]
+
+    stop_sssd()
+    assert_service(*call_sssd_getservbyname("svc2", "tcp"),
+                   pattern=new_pattern)
+    assert_service(*call_sssd_getservbyport(3012, "tcp"),
+                   pattern=new_pattern)
+    (res, errno, _) = call_sssd_getservbyport(3002, "tcp")
+    assert res != sssd_id.NssReturnCode.SUCCESS, \
+        "The old port of the service should not be in the memory cache"
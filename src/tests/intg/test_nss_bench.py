@@ -0,0 +1,132 @@
+#
+# NSS client and responder benchmark
+#
+# Copyright (c) 2016 Red Hat, Inc.
+#
+# This is free software; you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by
+# the Free Software Foundation; version 2 only
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Runs nss-bench against a seeded local domain. By default the run is
+# short and only checks that every lookup path works; set NSS_BENCH_ARGS,
+# e.g. to "-t 8 -d 10", and run pytest with -s to get usable numbers.
+#
+import os
+import stat
+import time
+import config
+import signal
+import subprocess
+import pytest
+from util import unindent
+
+USER_PREFIX = "nssbenchuser"
+GROUP_PREFIX = "nssbenchgroup"
+NUM_NAMES = int(os.environ.get("NSS_BENCH_NAMES", "20"))
+
+
+def stop_sssd():
+    pid_file = open(config.PIDFILE_PATH, "r")
+    pid = int(pid_file.read())
+    os.kill(pid, signal.SIGTERM)
+    while True:
+        try:
+            os.kill(pid, signal.SIGCONT)
+        except:
+            break
+        time.sleep(1)
+
+
+def create_conf_fixture(request, contents):
+    """Generate sssd.conf and add teardown for removing it"""
+    conf = open(config.CONF_PATH, "w")
+    conf.write(contents)
+    conf.close()
+    os.chmod(config.CONF_PATH, stat.S_IRUSR | stat.S_IWUSR)
+    request.addfinalizer(lambda: os.unlink(config.CONF_PATH))
+
+
+def create_sssd_fixture(request):
+    """Start sssd and add teardown for stopping it and removing state"""
+    if subprocess.call(["sssd", "-D", "-f"]) != 0:
+        raise Exception("sssd start failed")
+
+    def teardown():
+        try:
+            stop_sssd()
+        except:
+            pass
+        for path in os.listdir(config.DB_PATH):
+            os.unlink(config.DB_PATH + "/" + path)
+        for path in os.listdir(config.MCACHE_PATH):
+            os.unlink(config.MCACHE_PATH + "/" + path)
+    request.addfinalizer(teardown)
+
+
+@pytest.fixture
+def seeded_local_domain(request):
+    conf = unindent("""\
+        [sssd]
+        domains             = LOCAL
+        services            = nss
+
+        [domain/LOCAL]
+        id_provider         = local
+        min_id = 10000
+        max_id = 20000
+    """).format(**locals())
+    create_conf_fixture(request, conf)
+    create_sssd_fixture(request)
+
+    for i in range(NUM_NAMES):
+        subprocess.check_call(["sss_groupadd", "%s%d" % (GROUP_PREFIX, i)])
+        subprocess.check_call(["sss_useradd", "-M",
+                               "-G", "%s%d" % (GROUP_PREFIX, i),
+                               "%s%d" % (USER_PREFIX, i)])
+    return None
+
+
+def run_nss_bench(args):
+    """Run nss-bench, return the measurements as a list of dicts"""
+    cmd = ["nss-bench",
+           "--names", str(NUM_NAMES),
+           "--user-prefix", USER_PREFIX,
+           "--group-prefix", GROUP_PREFIX] + args
+    output = subprocess.check_output(cmd)
+    print(output)
+
+    columns = ["db", "path", "dist", "threads", "ops", "p50", "p90", "p99",
+               "max", "found", "errors"]
+    results = []
+    for line in output.splitlines():
+        if line.startswith("#") or not line.strip():
+            continue
+        values = dict(zip(columns, line.split()))
+        for key in columns[3:]:
+            values[key] = float(values[key])
+        results.append(values)
+    return results
+
+
+def test_nss_bench(seeded_local_domain):
+    args = os.environ.get("NSS_BENCH_ARGS", "-t 2 -d 1").split()
+    results = run_nss_bench(args)
+
+    # passwd and group, mmap and socket, three distributions each
+    assert len(results) == 12
+    for r in results:
+        assert r["ops"] > 0
+        assert r["errors"] == 0
+        assert r["p50"] <= r["p99"] <= r["max"]
+        if r["dist"] == "miss":
+            assert r["found"] == 0
+        else:
+            assert r["found"] == 100
@@ -0,0 +1,682 @@
+/*
+    SSSD
+
+    NSS client and responder benchmark
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Drives the NSS client code with several threads and reports the lookup
+ * throughput and latency percentiles. The client code is linked in
+ * directly, so the memory cache (mmap) path and the responder (socket) path
+ * are measured separately, each with the following key distributions:
+ *
+ *  hot  - uniformly from the first --hot-set names
+ *  zipf - Zipf distributed over all names
+ *  miss - names that do not exist
+ *
+ * The names are <prefix><n> for n in [0, --names), they are expected to be
+ * present in the cache, for example added with sss_useradd and
+ * sss_groupadd to a local domain. Every name is looked up once over the
+ * socket before the measurements, which fills the memory cache.
+ *
+ * The output has one line per measurement:
+ *   db path dist threads ops/s p50 p90 p99 max found% errors
+ * with the latencies in microseconds.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <popt.h>
+#include <pwd.h>
+#include <grp.h>
+#include <nss.h>
+
+#include "sss_client/nss_mc.h"
+
+enum nss_status _nss_sss_getpwnam_r(const char *name, struct passwd *result,
+                                    char *buffer, size_t buflen, int *errnop);
+enum nss_status _nss_sss_getgrnam_r(const char *name, struct group *result,
+                                    char *buffer, size_t buflen, int *errnop);
+
+#define DEFAULT_THREADS     1
+#define DEFAULT_DURATION    5
+#define DEFAULT_NAMES       100
+#define DEFAULT_HOT_SET     16
+#define DEFAULT_ZIPF_S      1.0
+#define DEFAULT_USER_PREFIX  "nssbenchuser"
+#define DEFAULT_GROUP_PREFIX "nssbenchgroup"
+
+#define BENCH_BUFSIZE       65536
+
+/* latencies are recorded in nanoseconds, 16 buckets per power of two */
+#define HIST_SUB_BITS       4
+#define HIST_SUB_BUCKETS    (1 << HIST_SUB_BITS)
+#define HIST_MAX_EXP        40
+#define HIST_BUCKETS \
+    ((HIST_MAX_EXP - HIST_SUB_BITS + 2) * HIST_SUB_BUCKETS)
+
+enum bench_db {
+    BENCH_DB_PASSWD,
+    BENCH_DB_GROUP,
+    BENCH_DB_NUM
+};
+
+enum bench_path {
+    BENCH_PATH_MMAP,
+    BENCH_PATH_SOCKET,
+    BENCH_PATH_NUM
+};
+
+enum bench_dist {
+    BENCH_DIST_HOT,
+    BENCH_DIST_ZIPF,
+    BENCH_DIST_MISS,
+    BENCH_DIST_NUM
+};
+
+static const char *bench_db_names[] = { "passwd", "group" };
+static const char *bench_path_names[] = { "mmap", "socket" };
+static const char *bench_dist_names[] = { "hot", "zipf", "miss" };
+
+enum bench_result {
+    BENCH_FOUND,
+    BENCH_NOTFOUND,
+    BENCH_ERROR
+};
+
+struct bench_hist {
+    uint64_t count;
+    uint64_t max;
+    uint64_t buckets[HIST_BUCKETS];
+};
+
+struct bench_keys {
+    char **names;
+    size_t *lens;
+    int count;
+};
+
+struct bench_ctx {
+    int threads;
+    int duration;
+    int hot_set;
+    enum bench_db db;
+    enum bench_path path;
+    enum bench_dist dist;
+
+    struct bench_keys exist[BENCH_DB_NUM];
+    struct bench_keys missing[BENCH_DB_NUM];
+    /* cumulative Zipf distribution over the existing names */
+    double *zipf_cdf;
+
+    volatile bool running;
+};
+
+struct bench_thread {
+    struct bench_ctx *ctx;
+    pthread_t tid;
+    unsigned int seed;
+
+    uint64_t found;
+    uint64_t notfound;
+    uint64_t errors;
+    struct bench_hist hist;
+};
+
+static size_t hist_bucket(uint64_t v)
+{
+    unsigned int exp;
+
+    if (v < HIST_SUB_BUCKETS) {
+        return v;
+    }
+
+    for (exp = HIST_SUB_BITS; exp < HIST_MAX_EXP && (v >> (exp + 1)) != 0;
+         exp++);
+
+    if ((v >> (exp + 1)) != 0) {
+        return HIST_BUCKETS - 1;
+    }
+
+    return (exp - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS
+           + ((v >> (exp - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+}
+
+static uint64_t hist_bucket_max(size_t bucket)
+{
+    unsigned int exp;
+    uint64_t sub;
+
+    if (bucket < HIST_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    exp = bucket / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+    sub = bucket % HIST_SUB_BUCKETS;
+
+    return ((HIST_SUB_BUCKETS + sub + 1) << (exp - HIST_SUB_BITS)) - 1;
+}
+
+static void hist_add(struct bench_hist *hist, uint64_t v)
+{
+    hist->count++;
+    if (v > hist->max) {
+        hist->max = v;
+    }
+    hist->buckets[hist_bucket(v)]++;
+}
+
+static void hist_merge(struct bench_hist *dst, struct bench_hist *src)
+{
+    size_t i;
+
+    dst->count += src->count;
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        dst->buckets[i] += src->buckets[i];
+    }
+}
+
+static double hist_percentile_us(struct bench_hist *hist, unsigned int pct)
+{
+    uint64_t wanted;
+    uint64_t seen = 0;
+    uint64_t v;
+    size_t i;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    wanted = (hist->count * pct + 99) / 100;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= wanted) {
+            break;
+        }
+    }
+
+    v = hist_bucket_max(i);
+    if (v > hist->max) {
+        v = hist->max;
+    }
+
+    return v / 1000.0;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int keys_init(struct bench_keys *keys, const char *fmt,
+                     const char *prefix, int count)
+{
+    int i;
+
+    keys->names = calloc(count, sizeof(char *));
+    keys->lens = calloc(count, sizeof(size_t));
+    if (keys->names == NULL || keys->lens == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (asprintf(&keys->names[i], fmt, prefix, i) < 0) {
+            return ENOMEM;
+        }
+        keys->lens[i] = strlen(keys->names[i]);
+    }
+    keys->count = count;
+
+    return 0;
+}
+
+static void keys_free(struct bench_keys *keys)
+{
+    int i;
+
+    for (i = 0; i < keys->count; i++) {
+        free(keys->names[i]);
+    }
+    free(keys->names);
+    free(keys->lens);
+}
+
+static double *zipf_cdf_create(int count, double s)
+{
+    double *cdf;
+    double sum = 0;
+    int i;
+
+    cdf = malloc(count * sizeof(double));
+    if (cdf == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < count; i++) {
+        sum += 1.0 / pow(i + 1, s);
+        cdf[i] = sum;
+    }
+    for (i = 0; i < count; i++) {
+        cdf[i] /= sum;
+    }
+
+    return cdf;
+}
+
+static int pick_key(struct bench_thread *th)
+{
+    struct bench_ctx *ctx = th->ctx;
+    double u;
+    int lo;
+    int hi;
+    int mid;
+
+    switch (ctx->dist) {
+    case BENCH_DIST_HOT:
+        return rand_r(&th->seed) % ctx->hot_set;
+    case BENCH_DIST_ZIPF:
+        u = rand_r(&th->seed) / (RAND_MAX + 1.0);
+        lo = 0;
+        hi = ctx->exist[ctx->db].count - 1;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (ctx->zipf_cdf[mid] < u) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    case BENCH_DIST_MISS:
+    default:
+        return rand_r(&th->seed) % ctx->missing[ctx->db].count;
+    }
+}
+
+static enum bench_result lookup_mmap(enum bench_db db,
+                                     const char *name, size_t len,
+                                     char *buf)
+{
+    struct passwd pwd;
+    struct group grp;
+    errno_t ret;
+
+    if (db == BENCH_DB_PASSWD) {
+        ret = sss_nss_mc_getpwnam(name, len, &pwd, buf, BENCH_BUFSIZE);
+    } else {
+        ret = sss_nss_mc_getgrnam(name, len, &grp, buf, BENCH_BUFSIZE);
+    }
+
+    switch (ret) {
+    case 0:
+        return BENCH_FOUND;
+    case ENOENT:
+        return BENCH_NOTFOUND;
+    default:
+        return BENCH_ERROR;
+    }
+}
+
+static enum bench_result lookup_socket(enum bench_db db, const char *name,
+                                       char *buf)
+{
+    struct passwd pwd;
+    struct group grp;
+    enum nss_status status;
+    int err;
+
+    if (db == BENCH_DB_PASSWD) {
+        status = _nss_sss_getpwnam_r(name, &pwd, buf, BENCH_BUFSIZE, &err);
+    } else {
+        status = _nss_sss_getgrnam_r(name, &grp, buf, BENCH_BUFSIZE, &err);
+    }
+
+    switch (status) {
+    case NSS_STATUS_SUCCESS:
+        return BENCH_FOUND;
+    case NSS_STATUS_NOTFOUND:
+        return BENCH_NOTFOUND;
+    default:
+        return BENCH_ERROR;
+    }
+}
+
+static void *bench_thread_main(void *pvt)
+{
+    struct bench_thread *th = pvt;
+    struct bench_ctx *ctx = th->ctx;
+    struct bench_keys *keys;
+    enum bench_result res;
+    char *buf;
+    uint64_t start;
+    int k;
+
+    buf = malloc(BENCH_BUFSIZE);
+    if (buf == NULL) {
+        return NULL;
+    }
+
+    if (ctx->dist == BENCH_DIST_MISS) {
+        keys = &ctx->missing[ctx->db];
+    } else {
+        keys = &ctx->exist[ctx->db];
+    }
+
+    while (ctx->running) {
+        k = pick_key(th);
+
+        start = now_ns();
+        if (ctx->path == BENCH_PATH_MMAP) {
+            res = lookup_mmap(ctx->db, keys->names[k], keys->lens[k], buf);
+        } else {
+            res = lookup_socket(ctx->db, keys->names[k], buf);
+        }
+        hist_add(&th->hist, now_ns() - start);
+
+        switch (res) {
+        case BENCH_FOUND:
+            th->found++;
+            break;
+        case BENCH_NOTFOUND:
+            th->notfound++;
+            break;
+        case BENCH_ERROR:
+            th->errors++;
+            break;
+        }
+    }
+
+    free(buf);
+    return NULL;
+}
+
+static int bench_run(struct bench_ctx *ctx)
+{
+    struct bench_thread *threads;
+    struct bench_hist *hist;
+    uint64_t found = 0;
+    uint64_t errors = 0;
+    uint64_t start;
+    double secs;
+    int ret;
+    int i;
+
+    threads = calloc(ctx->threads, sizeof(struct bench_thread));
+    hist = calloc(1, sizeof(struct bench_hist));
+    if (threads == NULL || hist == NULL) {
+        free(threads);
+        free(hist);
+        return ENOMEM;
+    }
+
+    /* the socket path consults the memory cache first unless told not to */
+    if (ctx->path == BENCH_PATH_SOCKET) {
+        setenv("SSS_NSS_USE_MEMCACHE", "NO", 1);
+    } else {
+        unsetenv("SSS_NSS_USE_MEMCACHE");
+    }
+
+    ctx->running = true;
+    __sync_synchronize();
+    start = now_ns();
+
+    for (i = 0; i < ctx->threads; i++) {
+        threads[i].ctx = ctx;
+        threads[i].seed = i + 1;
+        ret = pthread_create(&threads[i].tid, NULL,
+                             bench_thread_main, &threads[i]);
+        if (ret != 0) {
+            fprintf(stderr, "pthread_create failed: %s\n", strerror(ret));
+            ctx->threads = i;
+            break;
+        }
+    }
+
+    sleep(ctx->duration);
+    ctx->running = false;
+    __sync_synchronize();
+
+    for (i = 0; i < ctx->threads; i++) {
+        pthread_join(threads[i].tid, NULL);
+        hist_merge(hist, &threads[i].hist);
+        found += threads[i].found;
+        errors += threads[i].errors;
+    }
+    secs = (now_ns() - start) / 1000000000.0;
+
+    printf("%-6s %-6s %-4s %7d %12.0f %9.2f %9.2f %9.2f %9.2f %7.2f %7"PRIu64
+           "\n",
+           bench_db_names[ctx->db], bench_path_names[ctx->path],
+           bench_dist_names[ctx->dist], ctx->threads,
+           hist->count / secs,
+           hist_percentile_us(hist, 50),
+           hist_percentile_us(hist, 90),
+           hist_percentile_us(hist, 99),
+           hist->max / 1000.0,
+           hist->count ? 100.0 * found / hist->count : 0.0,
+           errors);
+    fflush(stdout);
+
+    free(threads);
+    free(hist);
+    return 0;
+}
+
+/* looks every name up once so that it is in the memory cache */
+static void bench_warm_up(struct bench_ctx *ctx, enum bench_db db)
+{
+    char *buf;
+    int i;
+
+    buf = malloc(BENCH_BUFSIZE);
+    if (buf == NULL) {
+        return;
+    }
+
+    unsetenv("SSS_NSS_USE_MEMCACHE");
+    for (i = 0; i < ctx->exist[db].count; i++) {
+        if (lookup_socket(db, ctx->exist[db].names[i], buf) != BENCH_FOUND) {
+            fprintf(stderr, "Warning: %s entry [%s] was not found\n",
+                    bench_db_names[db], ctx->exist[db].names[i]);
+        }
+    }
+
+    free(buf);
+}
+
+static int parse_choice(const char *str, const char **names, int num,
+                        int *_choice)
+{
+    int i;
+
+    if (str == NULL || strcmp(str, "all") == 0) {
+        *_choice = -1;
+        return 0;
+    }
+
+    for (i = 0; i < num; i++) {
+        if (strcmp(str, names[i]) == 0) {
+            *_choice = i;
+            return 0;
+        }
+    }
+
+    return EINVAL;
+}
+
+int main(int argc, const char *argv[])
+{
+    struct bench_ctx ctx;
+    poptContext pc;
+    int opt;
+    int names = DEFAULT_NAMES;
+    double zipf_s = DEFAULT_ZIPF_S;
+    const char *user_prefix = DEFAULT_USER_PREFIX;
+    const char *group_prefix = DEFAULT_GROUP_PREFIX;
+    const char *db_str = NULL;
+    const char *path_str = NULL;
+    const char *dist_str = NULL;
+    int only_db;
+    int only_path;
+    int only_dist;
+    int db;
+    int path;
+    int dist;
+    int ret;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.threads = DEFAULT_THREADS;
+    ctx.duration = DEFAULT_DURATION;
+    ctx.hot_set = DEFAULT_HOT_SET;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        { "threads", 't', POPT_ARG_INT, &ctx.threads, 0,
+          "Number of threads doing lookups", NULL },
+        { "duration", 'd', POPT_ARG_INT, &ctx.duration, 0,
+          "Seconds each measurement runs", NULL },
+        { "names", 'n', POPT_ARG_INT, &names, 0,
+          "Number of names present in the cache", NULL },
+        { "hot-set", 0, POPT_ARG_INT, &ctx.hot_set, 0,
+          "Number of names the hot distribution picks from", NULL },
+        { "zipf-s", 0, POPT_ARG_DOUBLE, &zipf_s, 0,
+          "Exponent of the Zipf distribution", NULL },
+        { "user-prefix", 0, POPT_ARG_STRING, &user_prefix, 0,
+          "Prefix of the user names", NULL },
+        { "group-prefix", 0, POPT_ARG_STRING, &group_prefix, 0,
+          "Prefix of the group names", NULL },
+        { "db", 0, POPT_ARG_STRING, &db_str, 0,
+          "Database to look up in", "passwd|group|all" },
+        { "path", 0, POPT_ARG_STRING, &path_str, 0,
+          "Lookup path to measure", "mmap|socket|all" },
+        { "dist", 0, POPT_ARG_STRING, &dist_str, 0,
+          "Key distribution", "hot|zipf|miss|all" },
+        POPT_TABLEEND
+    };
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            return 1;
+        }
+    }
+
+    if (parse_choice(db_str, bench_db_names, BENCH_DB_NUM, &only_db) != 0
+        || parse_choice(path_str, bench_path_names, BENCH_PATH_NUM,
+                        &only_path) != 0
+        || parse_choice(dist_str, bench_dist_names, BENCH_DIST_NUM,
+                        &only_dist) != 0
+        || ctx.threads < 1 || ctx.duration < 1 || names < 1
+        || ctx.hot_set < 1) {
+        poptPrintUsage(pc, stderr, 0);
+        poptFreeContext(pc);
+        return 1;
+    }
+    if (ctx.hot_set > names) {
+        ctx.hot_set = names;
+    }
+
+    ret = keys_init(&ctx.exist[BENCH_DB_PASSWD], "%s%d", user_prefix, names);
+    if (ret == 0) {
+        ret = keys_init(&ctx.missing[BENCH_DB_PASSWD], "%s-missing-%d",
+                        user_prefix, names);
+    }
+    if (ret == 0) {
+        ret = keys_init(&ctx.exist[BENCH_DB_GROUP], "%s%d",
+                        group_prefix, names);
+    }
+    if (ret == 0) {
+        ret = keys_init(&ctx.missing[BENCH_DB_GROUP], "%s-missing-%d",
+                        group_prefix, names);
+    }
+    if (ret == 0) {
+        ctx.zipf_cdf = zipf_cdf_create(names, zipf_s);
+        if (ctx.zipf_cdf == NULL) {
+            ret = ENOMEM;
+        }
+    }
+    if (ret != 0) {
+        fprintf(stderr, "Out of memory\n");
+        goto done;
+    }
+
+    printf("# %-4s %-6s %-4s %7s %12s %9s %9s %9s %9s %7s %7s\n",
+           "db", "path", "dist", "threads", "ops/s",
+           "p50[us]", "p90[us]", "p99[us]", "max[us]", "found%", "errors");
+
+    for (db = 0; db < BENCH_DB_NUM; db++) {
+        if (only_db != -1 && only_db != db) {
+            continue;
+        }
+
+        bench_warm_up(&ctx, db);
+
+        for (path = 0; path < BENCH_PATH_NUM; path++) {
+            if (only_path != -1 && only_path != path) {
+                continue;
+            }
+
+            for (dist = 0; dist < BENCH_DIST_NUM; dist++) {
+                if (only_dist != -1 && only_dist != dist) {
+                    continue;
+                }
+
+                ctx.db = db;
+                ctx.path = path;
+                ctx.dist = dist;
+
+                ret = bench_run(&ctx);
+                if (ret != 0) {
+                    fprintf(stderr, "Benchmark failed: %s\n", strerror(ret));
+                    goto done;
+                }
+            }
+        }
+    }
+
+    ret = 0;
+
+done:
+    for (db = 0; db < BENCH_DB_NUM; db++) {
+        keys_free(&ctx.exist[db]);
+        keys_free(&ctx.missing[db]);
+    }
+    free(ctx.zipf_cdf);
+    poptFreeContext(pc);
+    return ret == 0 ? 0 : 1;
+}
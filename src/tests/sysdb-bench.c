@@ -0,0 +1,474 @@
+/*
+    SSSD
+
+    System Database benchmark
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * Fills a cache with a synthetic domain and measures how long the back end
+ * operations that dominate large deployments take: storing new and already
+ * cached users and groups, which includes the memberof maintenance, and
+ * the searches behind initgroups, getgrnam and enumeration.
+ *
+ * Group g has the users g * group-size ... (g + 1) * group-size - 1 (modulo
+ * the number of users) as direct members. With a depth above one group g
+ * also contains group g + 1 unless g + 1 starts a new chain, so that the
+ * groups form chains of --depth nested groups.
+ *
+ * Every measurement is printed as one line of key=value pairs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <popt.h>
+#include <sys/time.h>
+
+#include "util/util.h"
+#include "db/sysdb.h"
+#include "tests/common.h"
+
+#define TESTS_PATH "tp_" BASE_FILE_STEM
+#define TEST_CONF_DB "tests_conf.ldb"
+#define TEST_DOM_NAME "sysdb_bench"
+#define TEST_ID_PROVIDER "ldap"
+
+#define BENCH_ID_BASE 100000
+
+struct bench_ctx {
+    struct sss_test_ctx *tctx;
+    int num_users;
+    int num_groups;
+    int group_size;
+    int depth;
+    int iterations;
+};
+
+struct bench_timer {
+    struct timeval start;
+};
+
+static void bench_start(struct bench_timer *timer)
+{
+    gettimeofday(&timer->start, NULL);
+}
+
+static void bench_stop(struct bench_timer *timer, const char *name, int count)
+{
+    struct timeval end;
+    double secs;
+
+    gettimeofday(&end, NULL);
+    secs = (end.tv_sec - timer->start.tv_sec)
+           + (end.tv_usec - timer->start.tv_usec) / 1000000.0;
+
+    printf("bench=%s count=%d seconds=%.6f ops_per_sec=%.1f "
+           "usec_per_op=%.1f\n",
+           name, count, secs,
+           secs > 0 ? count / secs : 0.0,
+           count > 0 ? secs * 1000000.0 / count : 0.0);
+    fflush(stdout);
+}
+
+static const char *bench_user_name(TALLOC_CTX *mem_ctx, int u)
+{
+    return talloc_asprintf(mem_ctx, "benchuser%d", u);
+}
+
+static const char *bench_group_name(TALLOC_CTX *mem_ctx, int g)
+{
+    return talloc_asprintf(mem_ctx, "benchgroup%d", g);
+}
+
+static errno_t bench_store_user(struct bench_ctx *bctx, int u)
+{
+    TALLOC_CTX *tmp_ctx;
+    const char *name;
+    const char *homedir;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    name = bench_user_name(tmp_ctx, u);
+    homedir = talloc_asprintf(tmp_ctx, "/home/%s", name);
+    if (name == NULL || homedir == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    ret = sysdb_store_user(bctx->tctx->dom, name, "x",
+                           BENCH_ID_BASE + u, BENCH_ID_BASE, name, homedir,
+                           "/bin/bash", NULL, NULL, NULL, -1, 0);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t bench_store_group(struct bench_ctx *bctx, int g)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct sysdb_attrs *attrs;
+    const char *name;
+    char *dn;
+    int i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    attrs = sysdb_new_attrs(tmp_ctx);
+    name = bench_group_name(tmp_ctx, g);
+    if (attrs == NULL || name == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    for (i = 0; i < bctx->group_size; i++) {
+        dn = sysdb_user_strdn(tmp_ctx, bctx->tctx->dom->name,
+                              bench_user_name(tmp_ctx,
+                                   (g * bctx->group_size + i)
+                                   % bctx->num_users));
+        if (dn == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sysdb_attrs_steal_string(attrs, SYSDB_MEMBER, dn);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    if (g + 1 < bctx->num_groups && (g + 1) % bctx->depth != 0) {
+        dn = sysdb_group_strdn(tmp_ctx, bctx->tctx->dom->name,
+                               bench_group_name(tmp_ctx, g + 1));
+        if (dn == NULL) {
+            ret = ENOMEM;
+            goto done;
+        }
+
+        ret = sysdb_attrs_steal_string(attrs, SYSDB_MEMBER, dn);
+        if (ret != EOK) {
+            goto done;
+        }
+    }
+
+    ret = sysdb_store_group(bctx->tctx->dom, name, BENCH_ID_BASE + g,
+                            attrs, -1, 0);
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t bench_store_users(struct bench_ctx *bctx, const char *bench)
+{
+    struct bench_timer timer;
+    int u;
+    errno_t ret;
+
+    bench_start(&timer);
+    for (u = 0; u < bctx->num_users; u++) {
+        ret = bench_store_user(bctx, u);
+        if (ret != EOK) {
+            fprintf(stderr, "Unable to store user %d [%d]: %s\n",
+                    u, ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+    bench_stop(&timer, bench, bctx->num_users);
+
+    return EOK;
+}
+
+static errno_t bench_store_groups(struct bench_ctx *bctx, const char *bench)
+{
+    struct bench_timer timer;
+    int g;
+    errno_t ret;
+
+    /* the nested group has to exist before its parent refers to it */
+    bench_start(&timer);
+    for (g = bctx->num_groups - 1; g >= 0; g--) {
+        ret = bench_store_group(bctx, g);
+        if (ret != EOK) {
+            fprintf(stderr, "Unable to store group %d [%d]: %s\n",
+                    g, ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+    bench_stop(&timer, bench, bctx->num_groups);
+
+    return EOK;
+}
+
+static errno_t bench_initgroups(struct bench_ctx *bctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct bench_timer timer;
+    struct ldb_result *res;
+    int count = 0;
+    int i;
+    int u;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    bench_start(&timer);
+    for (i = 0; i < bctx->iterations; i++) {
+        for (u = 0; u < bctx->num_users; u++) {
+            ret = sysdb_initgroups(tmp_ctx, bctx->tctx->dom,
+                                   bench_user_name(tmp_ctx, u), &res);
+            if (ret != EOK) {
+                fprintf(stderr, "initgroups of user %d failed [%d]: %s\n",
+                        u, ret, sss_strerror(ret));
+                goto done;
+            }
+            talloc_free_children(tmp_ctx);
+            count++;
+        }
+    }
+    bench_stop(&timer, "initgroups", count);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t bench_getgrnam(struct bench_ctx *bctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct bench_timer timer;
+    struct ldb_result *res;
+    int count = 0;
+    int i;
+    int g;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    bench_start(&timer);
+    for (i = 0; i < bctx->iterations; i++) {
+        for (g = 0; g < bctx->num_groups; g++) {
+            ret = sysdb_getgrnam(tmp_ctx, bctx->tctx->dom,
+                                 bench_group_name(tmp_ctx, g), &res);
+            if (ret != EOK) {
+                fprintf(stderr, "getgrnam of group %d failed [%d]: %s\n",
+                        g, ret, sss_strerror(ret));
+                goto done;
+            }
+            talloc_free_children(tmp_ctx);
+            count++;
+        }
+    }
+    bench_stop(&timer, "getgrnam", count);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t bench_enumerate(struct bench_ctx *bctx)
+{
+    TALLOC_CTX *tmp_ctx;
+    struct bench_timer timer;
+    struct ldb_result *res;
+    int i;
+    errno_t ret;
+
+    tmp_ctx = talloc_new(NULL);
+    if (tmp_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    bench_start(&timer);
+    for (i = 0; i < bctx->iterations; i++) {
+        ret = sysdb_enumpwent(tmp_ctx, bctx->tctx->dom, &res);
+        if (ret != EOK) {
+            fprintf(stderr, "enumpwent failed [%d]: %s\n",
+                    ret, sss_strerror(ret));
+            goto done;
+        }
+        talloc_free_children(tmp_ctx);
+    }
+    bench_stop(&timer, "enumpwent", bctx->iterations);
+
+    bench_start(&timer);
+    for (i = 0; i < bctx->iterations; i++) {
+        ret = sysdb_enumgrent(tmp_ctx, bctx->tctx->dom, &res);
+        if (ret != EOK) {
+            fprintf(stderr, "enumgrent failed [%d]: %s\n",
+                    ret, sss_strerror(ret));
+            goto done;
+        }
+        talloc_free_children(tmp_ctx);
+    }
+    bench_stop(&timer, "enumgrent", bctx->iterations);
+
+    ret = EOK;
+
+done:
+    talloc_free(tmp_ctx);
+    return ret;
+}
+
+static errno_t bench_run(struct bench_ctx *bctx)
+{
+    errno_t ret;
+
+    ret = bench_store_users(bctx, "store_user_new");
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = bench_store_groups(bctx, "store_group_new");
+    if (ret != EOK) {
+        return ret;
+    }
+
+    /* the same entries again, this is what a cache refresh does */
+    ret = bench_store_users(bctx, "store_user_update");
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = bench_store_groups(bctx, "store_group_update");
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = bench_initgroups(bctx);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    ret = bench_getgrnam(bctx);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    return bench_enumerate(bctx);
+}
+
+int main(int argc, const char *argv[])
+{
+    int opt;
+    poptContext pc;
+    struct bench_ctx bctx;
+    int no_cleanup = 0;
+    int ret;
+
+    struct poptOption long_options[] = {
+        POPT_AUTOHELP
+        SSSD_DEBUG_OPTS
+        { "users", 'u', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.num_users, 0,
+                    "Number of users in the domain", NULL },
+        { "groups", 'g', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.num_groups, 0,
+                    "Number of groups in the domain", NULL },
+        { "group-size", 's', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.group_size, 0,
+                    "Number of user members of every group", NULL },
+        { "depth", 'n', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.depth, 0,
+                    "Length of the chains of nested groups", NULL },
+        { "iterations", 'i', POPT_ARG_INT | POPT_ARGFLAG_SHOW_DEFAULT,
+                    &bctx.iterations, 0,
+                    "How many times every search is repeated", NULL },
+        { "no-cleanup", 0, POPT_ARG_NONE, &no_cleanup, 0,
+                    "Do not delete the cache after the run", NULL },
+        POPT_TABLEEND
+    };
+
+    memset(&bctx, 0, sizeof(bctx));
+    bctx.num_users = 1000;
+    bctx.num_groups = 100;
+    bctx.group_size = 50;
+    bctx.depth = 1;
+    bctx.iterations = 1;
+
+    /* Set debug level to invalid value so we can deside if -d 0 was used. */
+    debug_level = SSSDBG_INVALID;
+
+    pc = poptGetContext(argv[0], argc, argv, long_options, 0);
+    while ((opt = poptGetNextOpt(pc)) != -1) {
+        switch (opt) {
+        default:
+            fprintf(stderr, "\nInvalid option %s: %s\n\n",
+                    poptBadOption(pc, 0), poptStrerror(opt));
+            poptPrintUsage(pc, stderr, 0);
+            poptFreeContext(pc);
+            return 1;
+        }
+    }
+    poptFreeContext(pc);
+
+    if (bctx.num_users < 1 || bctx.num_groups < 1 || bctx.group_size < 0
+            || bctx.depth < 1 || bctx.iterations < 1) {
+        fprintf(stderr, "The user and group counts, the depth and the "
+                "number of iterations must be positive\n");
+        return 1;
+    }
+
+    DEBUG_CLI_INIT(debug_level);
+
+    if (!ldb_modules_path_is_set()) {
+        fprintf(stderr, "Warning: LDB_MODULES_PATH is not set, "
+                "will use LDB plugins installed in system paths.\n");
+    }
+
+    tests_set_cwd();
+    test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    test_dom_suite_setup(TESTS_PATH);
+
+    bctx.tctx = create_dom_test_ctx(NULL, TESTS_PATH, TEST_CONF_DB,
+                                    TEST_DOM_NAME, TEST_ID_PROVIDER, NULL);
+    if (bctx.tctx == NULL) {
+        fprintf(stderr, "Unable to create the test domain\n");
+        return 1;
+    }
+
+    printf("# users=%d groups=%d group_size=%d depth=%d iterations=%d\n",
+           bctx.num_users, bctx.num_groups, bctx.group_size, bctx.depth,
+           bctx.iterations);
+
+    ret = bench_run(&bctx);
+
+    talloc_free(bctx.tctx);
+    if (!no_cleanup) {
+        test_dom_suite_cleanup(TESTS_PATH, TEST_CONF_DB, TEST_DOM_NAME);
+    }
+
+    return ret == EOK ? 0 : 1;
+}
@@ -5150,6 +5150,91 @@ START_TEST(test_sysdb_has_enumerated)
 }
 END_TEST
 
+START_TEST(test_sysdb_invalidate_cache)
+{
+    errno_t ret;
+    struct sysdb_test_ctx *test_ctx;
+    struct ldb_message *old_msg;
+    struct ldb_message *new_msg;
+    struct sss_domain_info *other_dom;
+    uint64_t generation;
+    time_t now;
+
+    /* Setup */
+    ret = setup_sysdb_tests(&test_ctx);
+    fail_if(ret != EOK, "Could not set up the test");
+
+    now = time(NULL);
+
+    old_msg = ldb_msg_new(test_ctx);
+    fail_if(old_msg == NULL, "ldb_msg_new failed");
+    ret = ldb_msg_add_fmt(old_msg, SYSDB_LAST_UPDATE, "%llu",
+                          (unsigned long long) now - 10);
+    fail_if(ret != LDB_SUCCESS, "ldb_msg_add_fmt failed");
+
+    new_msg = ldb_msg_new(test_ctx);
+    fail_if(new_msg == NULL, "ldb_msg_new failed");
+    ret = ldb_msg_add_fmt(new_msg, SYSDB_LAST_UPDATE, "%llu",
+                          (unsigned long long) now + 10);
+    fail_if(ret != LDB_SUCCESS, "ldb_msg_add_fmt failed");
+
+    ret = sysdb_get_cache_generation(test_ctx->domain,
+                                     SYSDB_CACHE_TYPE_USER, &generation);
+    fail_if(ret != EOK, "Error [%d][%s] reading the generation",
+                        ret, strerror(ret));
+    fail_unless(generation == 0, "No generation should have been started");
+
+    fail_if(sysdb_is_invalidated(test_ctx->domain, SYSDB_CACHE_TYPE_USER,
+                                 old_msg),
+            "Nothing should be invalidated yet");
+
+    ret = sysdb_invalidate_cache(test_ctx->domain, SYSDB_CACHE_TYPE_USER);
+    fail_if(ret != EOK, "Error [%d][%s] invalidating the cache",
+                        ret, strerror(ret));
+
+    ret = sysdb_get_cache_generation(test_ctx->domain,
+                                     SYSDB_CACHE_TYPE_USER, &generation);
+    fail_if(ret != EOK, "Error [%d][%s] reading the generation",
+                        ret, strerror(ret));
+    fail_unless(generation >= now, "A new generation should have started");
+
+    fail_unless(sysdb_is_invalidated(test_ctx->domain, SYSDB_CACHE_TYPE_USER,
+                                     old_msg),
+                "Users cached before should be invalidated");
+    fail_if(sysdb_is_invalidated(test_ctx->domain, SYSDB_CACHE_TYPE_USER,
+                                 new_msg),
+            "Users cached afterwards should be valid");
+    fail_if(sysdb_is_invalidated(test_ctx->domain, SYSDB_CACHE_TYPE_GROUP,
+                                 old_msg),
+            "Groups should not be invalidated");
+
+    /* Another process, e.g. sss_cache, invalidates the groups. The domain
+     * keeps the generations it has read until they are reset. */
+    other_dom = talloc_memdup(test_ctx, test_ctx->domain,
+                              sizeof(struct sss_domain_info));
+    fail_if(other_dom == NULL, "talloc_memdup failed");
+    other_dom->cache_gen = NULL;
+
+    ret = sysdb_invalidate_cache(other_dom, SYSDB_CACHE_TYPE_GROUP);
+    fail_if(ret != EOK, "Error [%d][%s] invalidating the cache",
+                        ret, strerror(ret));
+
+    fail_if(sysdb_is_invalidated(test_ctx->domain, SYSDB_CACHE_TYPE_GROUP,
+                                 old_msg),
+            "The generations should not be read again");
+
+    sysdb_reset_cache_generations(test_ctx->domain);
+    fail_unless(sysdb_is_invalidated(test_ctx->domain,
+                                     SYSDB_CACHE_TYPE_GROUP, old_msg),
+                "Groups cached before should be invalidated");
+    fail_unless(sysdb_is_invalidated(test_ctx->domain,
+                                     SYSDB_CACHE_TYPE_USER, old_msg),
+                "Users cached before should still be invalidated");
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 START_TEST(test_sysdb_original_dn_case_insensitive)
 {
     errno_t ret;
@@ -6528,6 +6613,7 @@ Suite *create_sysdb_suite(void)
 
     /* Test sysdb enumerated flag */
     tcase_add_test(tc_sysdb, test_sysdb_has_enumerated);
+    tcase_add_test(tc_sysdb, test_sysdb_invalidate_cache);
 
     /* Test originalDN searches */
     tcase_add_test(tc_sysdb, test_sysdb_original_dn_case_insensitive);
@@ -524,6 +524,64 @@ START_TEST(test_utf8_caseeq)
 }
 END_TEST
 
+START_TEST(test_utf8_ascii)
+{
+    const uint8_t munchen_utf8_upcase[] = { 'M', 0xC3, 0x9C, 'N', 'C', 'H', 'E', 'N', 0x0 };
+    const char *upcase = "AZaz09@[`{-User";
+    const char *lowcase = "azaz09@[`{-user";
+    uint8_t *lcase;
+    char *lcase_str;
+    size_t nlen;
+    errno_t ret;
+
+    TALLOC_CTX *test_ctx;
+    test_ctx = talloc_new(NULL);
+    fail_if(test_ctx == NULL);
+
+    fail_unless(sss_utf8_is_ascii((const uint8_t *) upcase, strlen(upcase)));
+    fail_if(sss_utf8_is_ascii(munchen_utf8_upcase,
+                              strlen((const char *) munchen_utf8_upcase)));
+
+    lcase = sss_utf8_tolower((const uint8_t *) upcase, strlen(upcase), &nlen);
+    fail_if(lcase == NULL);
+    fail_unless(nlen == strlen(lowcase));
+    fail_if(memcmp(lcase, lowcase, nlen));
+    sss_utf8_free(lcase);
+
+    lcase = sss_utf8_tolower((const uint8_t *) "", 0, &nlen);
+    fail_if(lcase == NULL);
+    fail_unless(nlen == 0);
+    sss_utf8_free(lcase);
+
+    lcase = sss_tc_utf8_tolower(test_ctx, (const uint8_t *) upcase,
+                                strlen(upcase), &nlen);
+    fail_if(lcase == NULL);
+    fail_unless(nlen == strlen(lowcase));
+    fail_if(memcmp(lcase, lowcase, nlen));
+
+    lcase_str = sss_tc_utf8_str_tolower(test_ctx, upcase);
+    fail_if(lcase_str == NULL);
+    fail_unless(strcmp(lcase_str, lowcase) == 0);
+
+    ret = sss_utf8_case_eq((const uint8_t *) upcase,
+                           (const uint8_t *) lowcase);
+    fail_unless(ret == EOK, "ASCII comparison failed\n");
+
+    ret = sss_utf8_case_eq((const uint8_t *) "user",
+                           (const uint8_t *) "users");
+    fail_unless(ret == ENOMATCH, "Prefix matched\n");
+
+    ret = sss_utf8_case_eq((const uint8_t *) "@", (const uint8_t *) "`");
+    fail_unless(ret == ENOMATCH, "Non-letters were case-folded\n");
+
+    ret = sss_utf8_case_eq((const uint8_t *) "M\xC3\x9C",
+                           (const uint8_t *) "X\xC3\x9C");
+    fail_unless(ret == ENOMATCH, "Negative test succeeded\n");
+
+    talloc_free(test_ctx);
+}
+END_TEST
+
 START_TEST(test_utf8_check)
 {
     const char *invalid = "ad\351la\357d";
@@ -1136,6 +1194,7 @@ Suite *util_suite(void)
     tcase_add_test (tc_utf8, test_utf8_talloc_lowercase);
     tcase_add_test (tc_utf8, test_utf8_talloc_str_lowercase);
     tcase_add_test (tc_utf8, test_utf8_caseeq);
+    tcase_add_test (tc_utf8, test_utf8_ascii);
     tcase_add_test (tc_utf8, test_utf8_check);
 
     tcase_set_timeout(tc_utf8, 60);
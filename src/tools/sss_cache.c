@@ -110,6 +110,8 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
                                struct sss_domain_info *dinfo,
                                enum sss_cache_entry entry_type,
                                const char *filter, const char *name);
+static bool invalidate_all_entries(struct sss_domain_info *dinfo,
+                                   enum sss_cache_entry entry_type);
 static errno_t update_all_filters(struct cache_tool_ctx *tctx,
                                   struct sss_domain_info *dinfo);
 
@@ -374,6 +376,13 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
     bool iret;
 
     if (!filter) return false;
+
+    if (name == NULL) {
+        /* all entries of this type, a new cache generation expires them
+         * with a single write and they do not have to be searched */
+        return invalidate_all_entries(dinfo, entry_type);
+    }
+
     switch (entry_type) {
     case TYPE_USER:
         type_string = "user";
@@ -413,7 +422,7 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
     if (ret != EOK) {
         if (ret == ENOENT) {
             DEBUG(SSSDBG_TRACE_FUNC, "'%s' %s: Not found in domain '%s'\n",
-                  type_string, name ? name : "", dinfo->name);
+                  type_string, name, dinfo->name);
         } else {
             DEBUG(SSSDBG_CRIT_FAILURE,
                   "Searching for %s in domain %s with filter %s failed\n",
@@ -445,6 +454,47 @@ static bool invalidate_entries(TALLOC_CTX *ctx,
     return iret;
 }
 
+static bool invalidate_all_entries(struct sss_domain_info *dinfo,
+                                   enum sss_cache_entry entry_type)
+{
+    enum sysdb_cache_type cache_type;
+    errno_t ret;
+
+    switch (entry_type) {
+    case TYPE_USER:
+        cache_type = SYSDB_CACHE_TYPE_USER;
+        break;
+    case TYPE_GROUP:
+        cache_type = SYSDB_CACHE_TYPE_GROUP;
+        break;
+    case TYPE_NETGROUP:
+        cache_type = SYSDB_CACHE_TYPE_NETGROUP;
+        break;
+    case TYPE_SERVICE:
+        cache_type = SYSDB_CACHE_TYPE_SERVICE;
+        break;
+    case TYPE_AUTOFSMAP:
+        cache_type = SYSDB_CACHE_TYPE_AUTOFSMAP;
+        break;
+    case TYPE_SSH_HOST:
+        cache_type = SYSDB_CACHE_TYPE_SSH_HOST;
+        break;
+    default:
+        return false;
+    }
+
+    ret = sysdb_invalidate_cache(dinfo, cache_type);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "Unable to invalidate the cache of domain %s [%d]: %s\n",
+              dinfo->name, ret, sss_strerror(ret));
+        ERROR("Couldn't invalidate the cache of domain %1$s\n", dinfo->name);
+        return false;
+    }
+
+    return true;
+}
+
 static errno_t invalidate_entry(TALLOC_CTX *ctx,
                                 struct sss_domain_info *domain,
                                 const char *name, int entry_type)
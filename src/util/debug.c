@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
 
 #ifdef WITH_JOURNALD
 #include <systemd/sd-journal.h>
@@ -206,6 +207,70 @@ journal_done:
 }
 #endif /* WiTH_JOURNALD */
 
+struct debug_timestamp_cache {
+    time_t sec;
+    char datetime[20];
+    int year;
+};
+
+/* localtime() and ctime() are only called once per second */
+static __thread struct debug_timestamp_cache debug_ts_cache = { -1, "", 0 };
+
+static void debug_get_timestamp(struct timeval *tv,
+                                const char **_datetime,
+                                int *_year)
+{
+    struct tm tm;
+    char buf[26];
+
+    gettimeofday(tv, NULL);
+
+    if (tv->tv_sec != debug_ts_cache.sec) {
+        localtime_r(&tv->tv_sec, &tm);
+        debug_ts_cache.year = tm.tm_year + 1900;
+        /* get date time without year */
+        memcpy(debug_ts_cache.datetime, ctime_r(&tv->tv_sec, buf), 19);
+        debug_ts_cache.datetime[19] = '\0';
+        debug_ts_cache.sec = tv->tv_sec;
+    }
+
+    *_datetime = debug_ts_cache.datetime;
+    *_year = debug_ts_cache.year;
+}
+
+static size_t debug_format_header(char *header, size_t size,
+                                  const char *function, int level)
+{
+    struct timeval tv;
+    const char *datetime;
+    int year;
+    int len;
+
+    if (debug_timestamps) {
+        debug_get_timestamp(&tv, &datetime, &year);
+        if (debug_microseconds) {
+            len = snprintf(header, size, "(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
+                           datetime, tv.tv_usec,
+                           year, debug_prg_name,
+                           function, level);
+        } else {
+            len = snprintf(header, size, "(%s %d) [%s] [%s] (%#.4x): ",
+                           datetime, year,
+                           debug_prg_name, function, level);
+        }
+    } else {
+        len = snprintf(header, size, "[%s] [%s] (%#.4x): ",
+                       debug_prg_name, function, level);
+    }
+
+    if (len < 0) {
+        header[0] = '\0';
+        return 0;
+    }
+
+    return (size_t) len >= size ? size - 1 : (size_t) len;
+}
+
 void sss_vdebug_fn(const char *file,
                    long line,
                    const char *function,
@@ -214,10 +279,8 @@ void sss_vdebug_fn(const char *file,
                    const char *format,
                    va_list ap)
 {
-    struct timeval tv;
-    struct tm *tm;
-    char datetime[20];
-    int year;
+    char header[256];
+    size_t header_len;
 
 #ifdef WITH_JOURNALD
     errno_t ret;
@@ -243,33 +306,26 @@ void sss_vdebug_fn(const char *file,
     }
 #endif
 
-    if (debug_timestamps) {
-        gettimeofday(&tv, NULL);
-        tm = localtime(&tv.tv_sec);
-        year = tm->tm_year + 1900;
-        /* get date time without year */
-        memcpy(datetime, ctime(&tv.tv_sec), 19);
-        datetime[19] = '\0';
-        if (debug_microseconds) {
-            debug_printf("(%s:%.6ld %d) [%s] [%s] (%#.4x): ",
-                         datetime, tv.tv_usec,
-                         year, debug_prg_name,
-                         function, level);
-        } else {
-            debug_printf("(%s %d) [%s] [%s] (%#.4x): ",
-                         datetime, year,
-                         debug_prg_name, function, level);
-        }
-    } else {
-        debug_printf("[%s] [%s] (%#.4x): ",
-                     debug_prg_name, function, level);
+    header_len = debug_format_header(header, sizeof(header), function, level);
+
+    /* Fatal failures are written immediately, the process may be about
+     * to terminate. */
+    if (!(level & SSSDBG_FATAL_FAILURE)
+            && debug_async_vlog(header, header_len, format, ap,
+                                flags & APPEND_LINE_FEED)) {
+        return;
     }
 
+    debug_async_sync_begin();
+
+    debug_printf("%s", header);
     debug_vprintf(format, ap);
     if (flags & APPEND_LINE_FEED) {
         debug_printf("\n");
     }
     debug_fflush();
+
+    debug_async_sync_end();
 }
 
 void sss_debug_fn(const char *file,
@@ -418,6 +474,9 @@ int rotate_debug_files(void)
 
     if (!debug_to_file) return EOK;
 
+    /* keep the writer thread away from the file while it is replaced */
+    debug_async_sync_begin();
+
     do {
         error = 0;
         ret = fclose(debug_file);
@@ -447,7 +506,11 @@ int rotate_debug_files(void)
 
     debug_file = NULL;
 
-    return open_debug_file();
+    ret = open_debug_file();
+
+    debug_async_sync_end();
+
+    return ret;
 }
 
 void talloc_log_fn(const char *message)
@@ -51,6 +51,19 @@ void sss_debug_fn(const char *file,
                   int level,
                   const char *format, ...) SSS_ATTRIBUTE_PRINTF(5, 6);
 int debug_convert_old_level(int old_level);
+
+/* Start a writer thread which writes the debug messages to the debug file,
+ * DEBUG() then only copies the message into a buffer. */
+errno_t debug_async_init(void);
+/* Write all buffered debug messages. */
+void debug_async_flush(void);
+bool debug_async_is_active(void);
+
+/* Used by sss_vdebug_fn(), see debug_async.c */
+bool debug_async_vlog(const char *header, size_t header_len,
+                      const char *format, va_list ap, bool append_lf);
+void debug_async_sync_begin(void);
+void debug_async_sync_end(void);
 errno_t set_debug_file_from_fd(const int fd);
 int get_fd_from_debug_file(void);
 
@@ -0,0 +1,450 @@
+/*
+    SSSD
+
+    Asynchronous debug logger
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The logging thread only formats the record into a slot of a bounded
+ * ring buffer, a writer thread drains the ring and writes the records to
+ * the debug file in batches.
+ *
+ * The ring is the bounded queue described by Dmitry Vyukov: every slot
+ * carries a sequence number which tells whether it is free for the
+ * producer at position pos (seq == pos) or ready for the consumer
+ * (seq == pos + 1). Producers claim positions with a compare-and-swap
+ * so no lock is taken when logging. There is only one consumer at a time,
+ * it is serialized by a mutex which also protects the debug file itself.
+ *
+ * Records that do not fit into a slot, records logged while the ring is
+ * full and fatal failures are written synchronously after the ring was
+ * drained so that the order of the messages is kept.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include "util/util.h"
+
+#ifdef HAVE_PTHREAD
+
+/* must be a power of two */
+#define DEBUG_RING_SLOTS 2048
+#define DEBUG_RING_RECORD_SIZE 496
+
+/* how long the writer lets records accumulate before it drains them */
+#define DEBUG_RING_BATCH_MS 5
+/* safety net in case a wake up was missed */
+#define DEBUG_RING_IDLE_MS 1000
+
+#define DEBUG_RING_BATCH_SIZE (64 * 1024)
+
+struct debug_ring_slot {
+    volatile unsigned long seq;
+    uint32_t len;
+    char data[DEBUG_RING_RECORD_SIZE];
+};
+
+struct debug_ring {
+    /* next position to be claimed by a producer */
+    volatile unsigned long head;
+    /* next position to be consumed, modified only under lock */
+    volatile unsigned long tail;
+
+    /* set by the writer before it goes to sleep */
+    volatile int sleeping;
+    int wake_fd[2];
+
+    pthread_mutex_t lock;
+    pthread_t writer;
+
+    char batch[DEBUG_RING_BATCH_SIZE];
+    struct debug_ring_slot slots[DEBUG_RING_SLOTS];
+};
+
+extern FILE *debug_file;
+
+static struct debug_ring *debug_ring = NULL;
+
+static errno_t debug_ring_pipe(int fds[2])
+{
+    int flags;
+    int i;
+
+    if (pipe(fds) != 0) {
+        return errno;
+    }
+
+    for (i = 0; i < 2; i++) {
+        flags = fcntl(fds[i], F_GETFL, 0);
+        (void) fcntl(fds[i], F_SETFL, flags | O_NONBLOCK);
+        flags = fcntl(fds[i], F_GETFD, 0);
+        (void) fcntl(fds[i], F_SETFD, flags | FD_CLOEXEC);
+    }
+
+    return EOK;
+}
+
+static struct debug_ring_slot *debug_ring_claim(struct debug_ring *ring,
+                                                unsigned long *_pos)
+{
+    struct debug_ring_slot *slot;
+    unsigned long pos;
+    long diff;
+
+    pos = ring->head;
+    for (;;) {
+        slot = &ring->slots[pos & (DEBUG_RING_SLOTS - 1)];
+        __sync_synchronize();
+        diff = (long)(slot->seq - pos);
+
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&ring->head, pos, pos + 1)) {
+                *_pos = pos;
+                return slot;
+            }
+            pos = ring->head;
+        } else if (diff < 0) {
+            /* the writer did not consume this slot yet, the ring is full */
+            return NULL;
+        } else {
+            /* another producer claimed this position */
+            pos = ring->head;
+        }
+    }
+}
+
+static void debug_ring_commit(struct debug_ring *ring,
+                              struct debug_ring_slot *slot,
+                              unsigned long pos)
+{
+    __sync_synchronize();
+    slot->seq = pos + 1;
+    __sync_synchronize();
+
+    if (ring->sleeping
+            && __sync_bool_compare_and_swap(&ring->sleeping, 1, 0)) {
+        /* nothing useful can be done if this fails, the writer will wake
+         * up on its own after DEBUG_RING_IDLE_MS */
+        (void) write(ring->wake_fd[1], "", 1);
+    }
+}
+
+static bool debug_ring_is_empty(struct debug_ring *ring)
+{
+    struct debug_ring_slot *slot;
+    unsigned long tail;
+
+    tail = ring->tail;
+    slot = &ring->slots[tail & (DEBUG_RING_SLOTS - 1)];
+    __sync_synchronize();
+
+    return slot->seq != tail + 1;
+}
+
+static void debug_ring_write(const char *data, size_t len)
+{
+    /* there is nowhere to report a failure */
+    (void) fwrite(data, 1, len, debug_file ? debug_file : stderr);
+}
+
+/* Must be called with the lock held. */
+static size_t debug_ring_drain(struct debug_ring *ring)
+{
+    struct debug_ring_slot *slot;
+    size_t batched = 0;
+    size_t count = 0;
+    unsigned long tail;
+
+    tail = ring->tail;
+    for (;;) {
+        slot = &ring->slots[tail & (DEBUG_RING_SLOTS - 1)];
+        __sync_synchronize();
+        if (slot->seq != tail + 1) {
+            /* empty, or a producer has not finished the record yet */
+            break;
+        }
+
+        if (batched + slot->len > DEBUG_RING_BATCH_SIZE) {
+            debug_ring_write(ring->batch, batched);
+            batched = 0;
+        }
+
+        memcpy(ring->batch + batched, slot->data, slot->len);
+        batched += slot->len;
+        count++;
+
+        __sync_synchronize();
+        slot->seq = tail + DEBUG_RING_SLOTS;
+        tail++;
+    }
+
+    ring->tail = tail;
+
+    if (batched > 0) {
+        debug_ring_write(ring->batch, batched);
+    }
+
+    if (count > 0) {
+        fflush(debug_file ? debug_file : stderr);
+    }
+
+    return count;
+}
+
+static void *debug_ring_writer(void *pvt)
+{
+    struct debug_ring *ring = pvt;
+    struct pollfd pfd;
+    char buf[64];
+    size_t count;
+
+    pfd.fd = ring->wake_fd[0];
+    pfd.events = POLLIN;
+
+    for (;;) {
+        pthread_mutex_lock(&ring->lock);
+        count = debug_ring_drain(ring);
+        pthread_mutex_unlock(&ring->lock);
+
+        if (count > 0) {
+            /* more records are likely on the way, write them together */
+            poll(NULL, 0, DEBUG_RING_BATCH_MS);
+            continue;
+        }
+
+        ring->sleeping = 1;
+        __sync_synchronize();
+        if (!debug_ring_is_empty(ring)) {
+            ring->sleeping = 0;
+            continue;
+        }
+
+        if (poll(&pfd, 1, DEBUG_RING_IDLE_MS) > 0) {
+            (void) read(ring->wake_fd[0], buf, sizeof(buf));
+        }
+        ring->sleeping = 0;
+    }
+
+    return NULL;
+}
+
+static void debug_async_atfork_child(void)
+{
+    /* The writer thread does not exist in the child. The records which are
+     * still in the ring are written by the parent, the child logs
+     * synchronously. */
+    debug_ring = NULL;
+}
+
+static void debug_async_atexit(void)
+{
+    debug_async_flush();
+}
+
+errno_t debug_async_init(void)
+{
+    struct debug_ring *ring;
+    unsigned long i;
+    errno_t ret;
+
+    if (debug_ring != NULL) {
+        return EOK;
+    }
+
+    ring = calloc(1, sizeof(struct debug_ring));
+    if (ring == NULL) {
+        return ENOMEM;
+    }
+
+    for (i = 0; i < DEBUG_RING_SLOTS; i++) {
+        ring->slots[i].seq = i;
+    }
+
+    ret = debug_ring_pipe(ring->wake_fd);
+    if (ret != EOK) {
+        free(ring);
+        return ret;
+    }
+
+    ret = pthread_mutex_init(&ring->lock, NULL);
+    if (ret != 0) {
+        goto fail;
+    }
+
+    ret = pthread_create(&ring->writer, NULL, debug_ring_writer, ring);
+    if (ret != 0) {
+        pthread_mutex_destroy(&ring->lock);
+        goto fail;
+    }
+
+    /* The ring is never released, the writer thread may use it until the
+     * process exits. */
+    pthread_atfork(NULL, NULL, debug_async_atfork_child);
+    atexit(debug_async_atexit);
+
+    __sync_synchronize();
+    debug_ring = ring;
+
+    return EOK;
+
+fail:
+    close(ring->wake_fd[0]);
+    close(ring->wake_fd[1]);
+    free(ring);
+    return ret;
+}
+
+bool debug_async_vlog(const char *header, size_t header_len,
+                      const char *format, va_list ap, bool append_lf)
+{
+    struct debug_ring *ring = debug_ring;
+    struct debug_ring_slot *slot;
+    va_list ap_copy;
+    unsigned long pos;
+    size_t avail;
+    int len;
+
+    if (ring == NULL) {
+        return false;
+    }
+
+    slot = debug_ring_claim(ring, &pos);
+    if (slot == NULL) {
+        return false;
+    }
+
+    if (header_len > DEBUG_RING_RECORD_SIZE) {
+        goto too_long;
+    }
+    memcpy(slot->data, header, header_len);
+
+    avail = DEBUG_RING_RECORD_SIZE - header_len;
+    va_copy(ap_copy, ap);
+    len = vsnprintf(slot->data + header_len, avail, format, ap_copy);
+    va_end(ap_copy);
+    /* one byte is needed for the line feed or the terminating zero */
+    if (len < 0 || (size_t) len + 1 > avail) {
+        goto too_long;
+    }
+
+    if (append_lf) {
+        slot->data[header_len + len] = '\n';
+        len++;
+    }
+
+    slot->len = header_len + len;
+    debug_ring_commit(ring, slot, pos);
+    return true;
+
+too_long:
+    /* the slot cannot be given back, commit an empty record instead */
+    slot->len = 0;
+    debug_ring_commit(ring, slot, pos);
+    return false;
+}
+
+void debug_async_sync_begin(void)
+{
+    struct debug_ring *ring = debug_ring;
+    unsigned long head;
+
+    if (ring == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+
+    /* All records claimed so far must be written before the synchronous
+     * one, including those another thread is still formatting. */
+    head = ring->head;
+    debug_ring_drain(ring);
+    while ((long)(head - ring->tail) > 0) {
+        sched_yield();
+        debug_ring_drain(ring);
+    }
+}
+
+void debug_async_sync_end(void)
+{
+    struct debug_ring *ring = debug_ring;
+
+    if (ring == NULL) {
+        return;
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+}
+
+void debug_async_flush(void)
+{
+    debug_async_sync_begin();
+    debug_async_sync_end();
+}
+
+bool debug_async_is_active(void)
+{
+    return debug_ring != NULL;
+}
+
+#else /* HAVE_PTHREAD */
+
+errno_t debug_async_init(void)
+{
+    return ENOTSUP;
+}
+
+bool debug_async_vlog(const char *header, size_t header_len,
+                      const char *format, va_list ap, bool append_lf)
+{
+    return false;
+}
+
+void debug_async_sync_begin(void)
+{
+    return;
+}
+
+void debug_async_sync_end(void)
+{
+    return;
+}
+
+void debug_async_flush(void)
+{
+    return;
+}
+
+bool debug_async_is_active(void)
+{
+    return false;
+}
+
+#endif /* HAVE_PTHREAD */
@@ -206,7 +206,8 @@ static int only_numbers(char *p)
     return *p;
 }
 
-static errno_t get_active_uid_linux(hash_table_t *table, uid_t search_uid)
+static errno_t get_active_uid_linux(hash_table_t *table, bool by_pid,
+                                   uid_t search_uid)
 {
     DIR *proc_dir = NULL;
     struct dirent *dirent;
@@ -233,15 +234,22 @@ static errno_t get_active_uid_linux(hash_table_t *table, uid_t search_uid)
             goto done;
         }
 
+        uid = (uid_t) -1;
         ret = get_uid_from_pid(pid, &uid);
         if (ret != EOK) {
             DEBUG(SSSDBG_CRIT_FAILURE, "get_uid_from_pid failed.\n");
             goto done;
         }
 
+        if (uid == (uid_t) -1) {
+            /* the process is gone already */
+            errno = 0;
+            continue;
+        }
+
         if (table != NULL) {
             key.type = HASH_KEY_ULONG;
-            key.ul = (unsigned long) uid;
+            key.ul = by_pid ? (unsigned long) pid : (unsigned long) uid;
             value.type = HASH_VALUE_ULONG;
             value.ul = (unsigned long) uid;
 
@@ -304,12 +312,51 @@ errno_t get_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table)
         return ENOMEM;
     }
 
-    return get_active_uid_linux(*table, 0);
+    return get_active_uid_linux(*table, false, 0);
+#else
+    return ENOSYS;
+#endif
+}
+
+errno_t get_pid_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table)
+{
+#ifdef __linux__
+    int ret;
+
+    ret = hash_create_ex(INITIAL_TABLE_SIZE, table, 0, 0, 0, 0,
+                         hash_talloc, hash_talloc_free, mem_ctx,
+                         NULL, NULL);
+    if (ret != HASH_SUCCESS) {
+        DEBUG(SSSDBG_CRIT_FAILURE,
+              "hash_create_ex failed [%s]\n", hash_error_string(ret));
+        return ENOMEM;
+    }
+
+    return get_active_uid_linux(*table, true, 0);
 #else
     return ENOSYS;
 #endif
 }
 
+errno_t get_process_uid(pid_t pid, uid_t *uid)
+{
+    uid_t result = (uid_t) -1;
+    errno_t ret;
+
+    ret = get_uid_from_pid(pid, &result);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    if (result == (uid_t) -1) {
+        /* the process is gone already */
+        return ENOENT;
+    }
+
+    *uid = result;
+    return EOK;
+}
+
 errno_t check_if_uid_is_active(uid_t uid, bool *result)
 {
     int ret;
@@ -330,7 +377,7 @@ errno_t check_if_uid_is_active(uid_t uid, bool *result)
     /* fall back to the old method */
 #endif
 
-    ret = get_active_uid_linux(NULL, uid);
+    ret = get_active_uid_linux(NULL, false, uid);
     if (ret != EOK && ret != ENOENT) {
         DEBUG(SSSDBG_CRIT_FAILURE, "get_uid_table failed.\n");
         return ret;
@@ -33,4 +33,9 @@
 errno_t get_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table);
 errno_t check_if_uid_is_active(uid_t uid, bool *result);
 
+/* Maps the ID of every process on the system to its real UID. */
+errno_t get_pid_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table);
+/* Returns ENOENT if the process does not exist anymore. */
+errno_t get_process_uid(pid_t pid, uid_t *uid);
+
 #endif /* __FIND_UID_H__ */
@@ -149,6 +149,18 @@ struct sss_mc_initgr_data {
                              * after gids */
 };
 
+struct sss_mc_svc_data {
+    rel_ptr_t name;         /* ptr to the "name/protocol" key string,
+                             * rel. to struct base addr */
+    uint32_t port;          /* port number in host byte order */
+    uint32_t aliases;       /* number of aliases in strs */
+    uint32_t strs_len;      /* length of strs */
+    char strs[0];           /* concatenation of all service strings, each
+                             * string is zero terminated ordered as follows:
+                             * name/protocol key, name, protocol,
+                             * alias1, alias2, ... */
+};
+
 #pragma pack()
 
 
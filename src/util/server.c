@@ -456,6 +456,7 @@ int server_setup(const char *name, int flags,
     bool dt;
     bool dl;
     bool dm;
+    bool da;
     struct tevent_signal *tes;
     struct logrotate_ctx *lctx;
     char *locale;
@@ -641,6 +642,24 @@ int server_setup(const char *name, int flags,
                                          "[%s]\n", ret, strerror(ret));
             return ret;
         }
+
+        ret = confdb_get_bool(ctx->confdb_ctx, conf_entry,
+                              CONFDB_SERVICE_DEBUG_ASYNC,
+                              false, &da);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_FATAL_FAILURE, "Error reading from confdb (%d) "
+                                         "[%s]\n", ret, strerror(ret));
+            return ret;
+        }
+
+        if (da) {
+            ret = debug_async_init();
+            if (ret != EOK) {
+                DEBUG(SSSDBG_OP_FAILURE, "Unable to start the debug writer "
+                      "thread, logging synchronously (%d) [%s]\n",
+                      ret, strerror(ret));
+            }
+        }
     }
 
     sss_log(SSS_LOG_INFO, "Starting up");
@@ -57,6 +57,10 @@ const char *sss_cmd2str(enum sss_cli_command cmd)
         return "SSS_NSS_ENDGRENT";
     case SSS_NSS_INITGR:
         return "SSS_NSS_INITGR";
+    case SSS_NSS_GETGRNAM_NOMEM:
+        return "SSS_NSS_GETGRNAM_NOMEM";
+    case SSS_NSS_GETGRGID_NOMEM:
+        return "SSS_NSS_GETGRGID_NOMEM";
 
 #if 0
     /* aliases */
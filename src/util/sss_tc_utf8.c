@@ -25,10 +25,20 @@
 char *
 sss_tc_utf8_str_tolower(TALLOC_CTX *mem_ctx, const char *s)
 {
+    size_t len;
     size_t nlen;
     uint8_t *ret;
 
-    ret = sss_tc_utf8_tolower(mem_ctx, (const uint8_t *) s, strlen(s), &nlen);
+    len = strlen(s);
+    if (sss_utf8_is_ascii((const uint8_t *) s, len)) {
+        ret = talloc_array(mem_ctx, uint8_t, len + 1);
+        if (!ret) return NULL;
+
+        sss_ascii_tolower(ret, (const uint8_t *) s, len + 1);
+        return (char *) ret;
+    }
+
+    ret = sss_tc_utf8_tolower(mem_ctx, (const uint8_t *) s, len, &nlen);
     if (!ret) return NULL;
 
     ret = talloc_realloc(mem_ctx, ret, uint8_t, nlen+1);
@@ -45,6 +55,15 @@ sss_tc_utf8_tolower(TALLOC_CTX *mem_ctx, const uint8_t *s, size_t len, size_t *_
     uint8_t *ret;
     size_t nlen;
 
+    if (sss_utf8_is_ascii(s, len)) {
+        ret = talloc_array(mem_ctx, uint8_t, len);
+        if (!ret) return NULL;
+
+        sss_ascii_tolower(ret, s, len);
+        *_nlen = len;
+        return ret;
+    }
+
     lower = sss_utf8_tolower(s, len, &nlen);
     if (!lower) return NULL;
 
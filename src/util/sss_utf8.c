@@ -22,6 +22,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
@@ -39,17 +40,58 @@ void sss_utf8_free(void *ptr)
 {
     return free(ptr);
 }
+
+static uint8_t *sss_utf8_alloc(size_t len)
+{
+    return malloc(len);
+}
 #elif defined(HAVE_GLIB2)
 void sss_utf8_free(void *ptr)
 {
     return g_free(ptr);
 }
+
+static uint8_t *sss_utf8_alloc(size_t len)
+{
+    return g_malloc(len);
+}
 #else
 #error No unicode library
 #endif
 
+/* Most names are plain ASCII. For them case folding is a simple mapping of
+ * A-Z to a-z, written without branches so that the compiler can vectorize
+ * the loops. Only strings with other characters go to the unicode library.
+ */
+static inline uint8_t sss_ascii_fold(uint8_t c)
+{
+    return c + (((uint8_t) (c - 'A') < 26) << 5);
+}
+
+bool sss_utf8_is_ascii(const uint8_t *s, size_t len)
+{
+    uint8_t acc = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        acc |= s[i];
+    }
+
+    return (acc & 0x80) == 0;
+}
+
+void sss_ascii_tolower(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        dst[i] = sss_ascii_fold(src[i]);
+    }
+}
+
 #ifdef HAVE_LIBUNISTRING
-uint8_t *sss_utf8_tolower(const uint8_t *s, size_t len, size_t *_nlen)
+static uint8_t *sss_utf8_tolower_full(const uint8_t *s, size_t len,
+                                      size_t *_nlen)
 {
     size_t llen;
     uint8_t *lower;
@@ -61,7 +103,8 @@ uint8_t *sss_utf8_tolower(const uint8_t *s, size_t len, size_t *_nlen)
     return lower;
 }
 #elif defined(HAVE_GLIB2)
-uint8_t *sss_utf8_tolower(const uint8_t *s, size_t len, size_t *_nlen)
+static uint8_t *sss_utf8_tolower_full(const uint8_t *s, size_t len,
+                                      size_t *_nlen)
 {
     gchar *glower;
     size_t nlen;
@@ -88,6 +131,24 @@ uint8_t *sss_utf8_tolower(const uint8_t *s, size_t len, size_t *_nlen)
 #error No unicode library
 #endif
 
+uint8_t *sss_utf8_tolower(const uint8_t *s, size_t len, size_t *_nlen)
+{
+    uint8_t *lower;
+
+    if (!sss_utf8_is_ascii(s, len)) {
+        return sss_utf8_tolower_full(s, len, _nlen);
+    }
+
+    /* neither malloc() nor g_malloc() is guaranteed to return memory for
+     * an empty string */
+    lower = sss_utf8_alloc(len > 0 ? len : 1);
+    if (!lower) return NULL;
+
+    sss_ascii_tolower(lower, s, len);
+    if (_nlen) *_nlen = len;
+    return lower;
+}
+
 #ifdef HAVE_LIBUNISTRING
 bool sss_utf8_check(const uint8_t *s, size_t n)
 {
@@ -112,7 +173,7 @@ bool sss_utf8_check(const uint8_t *s, size_t n)
  * May return other errno error codes on failure
  */
 #ifdef HAVE_LIBUNISTRING
-errno_t sss_utf8_case_eq(const uint8_t *s1, const uint8_t *s2)
+static errno_t sss_utf8_case_eq_full(const uint8_t *s1, const uint8_t *s2)
 {
 
     /* Do a case-insensitive comparison.
@@ -145,7 +206,7 @@ errno_t sss_utf8_case_eq(const uint8_t *s1, const uint8_t *s2)
 }
 
 #elif defined(HAVE_GLIB2)
-errno_t sss_utf8_case_eq(const uint8_t *s1, const uint8_t *s2)
+static errno_t sss_utf8_case_eq_full(const uint8_t *s1, const uint8_t *s2)
 {
     gchar *gs1;
     gchar *gs2;
@@ -183,6 +244,29 @@ errno_t sss_utf8_case_eq(const uint8_t *s1, const uint8_t *s2)
 #error No unicode library
 #endif
 
+errno_t sss_utf8_case_eq(const uint8_t *s1, const uint8_t *s2)
+{
+    size_t i;
+
+    /* Compare the ASCII characters in place. Once either string contains
+     * anything else the whole strings are compared by the unicode library,
+     * a different ASCII character before that is a mismatch in any case.
+     */
+    for (i = 0; ; i++) {
+        if ((s1[i] | s2[i]) & 0x80) {
+            return sss_utf8_case_eq_full(s1, s2);
+        }
+
+        if (sss_ascii_fold(s1[i]) != sss_ascii_fold(s2[i])) {
+            return ENOMATCH;
+        }
+
+        if (s1[i] == '\0') {
+            return EOK;
+        }
+    }
+}
+
 bool sss_string_equal(bool cs, const char *s1, const char *s2)
 {
     if (cs) {
@@ -39,6 +39,11 @@ uint8_t *sss_utf8_tolower(const uint8_t *s, size_t len, size_t *nlen);
 
 bool sss_utf8_check(const uint8_t *s, size_t n);
 
+bool sss_utf8_is_ascii(const uint8_t *s, size_t len);
+
+/* Lower-cases ASCII input only, dst must have room for len bytes */
+void sss_ascii_tolower(uint8_t *dst, const uint8_t *src, size_t len);
+
 errno_t sss_utf8_case_eq(const uint8_t *s1, const uint8_t *s2);
 
 
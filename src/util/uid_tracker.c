@@ -0,0 +1,582 @@
+/*
+    SSSD
+
+    Track the UIDs of running processes
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+ * The tracker keeps a table of all processes and their real UID and a table
+ * with the number of processes per UID. Both are filled by reading /proc
+ * once and are then kept up to date with the fork, exit and UID change
+ * events sent by the kernel. If events were lost, e.g. because the socket
+ * buffer overflowed, the tables are read from /proc again the next time
+ * they are needed.
+ */
+
+#include "config.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#ifdef HAVE_LINUX_CN_PROC_H
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#endif
+
+#include "util/util.h"
+#include "util/find_uid.h"
+#include "util/uid_tracker.h"
+
+#ifdef HAVE_LINUX_CN_PROC_H
+
+#define UID_TRACKER_RECV_BUF 8192
+#define UID_TRACKER_UIDS_SIZE 64
+
+struct uid_tracker {
+    int fd;
+    struct tevent_fd *fde;
+
+    /* parent of both tables, replaced on every resynchronization */
+    TALLOC_CTX *tables_ctx;
+    /* process ID -> real UID */
+    hash_table_t *pids;
+    /* real UID -> number of processes */
+    hash_table_t *uids;
+
+    /* the tables do not reflect the system, /proc must be read again */
+    bool resync;
+};
+
+static struct uid_tracker *uid_tracker = NULL;
+
+static int uid_tracker_destructor(struct uid_tracker *tracker)
+{
+    if (tracker->fd != -1) {
+        close(tracker->fd);
+    }
+
+    if (uid_tracker == tracker) {
+        uid_tracker = NULL;
+    }
+
+    return 0;
+}
+
+static errno_t uid_tracker_count(struct uid_tracker *tracker,
+                                 uid_t uid, int diff)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    key.type = HASH_KEY_ULONG;
+    key.ul = (unsigned long) uid;
+
+    hret = hash_lookup(tracker->uids, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        value.type = HASH_VALUE_ULONG;
+        value.ul = 0;
+    } else if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    if (diff < 0 && value.ul <= (unsigned long) -diff) {
+        hret = hash_delete(tracker->uids, &key);
+        return (hret == HASH_SUCCESS || hret == HASH_ERROR_KEY_NOT_FOUND)
+                    ? EOK : EIO;
+    }
+
+    value.ul += diff;
+    hret = hash_enter(tracker->uids, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return ENOMEM;
+    }
+
+    return EOK;
+}
+
+static errno_t uid_tracker_lookup(struct uid_tracker *tracker,
+                                  pid_t pid, uid_t *_uid)
+{
+    hash_key_t key;
+    hash_value_t value;
+    int hret;
+
+    key.type = HASH_KEY_ULONG;
+    key.ul = (unsigned long) pid;
+
+    hret = hash_lookup(tracker->pids, &key, &value);
+    if (hret == HASH_ERROR_KEY_NOT_FOUND) {
+        return ENOENT;
+    } else if (hret != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    *_uid = (uid_t) value.ul;
+    return EOK;
+}
+
+static errno_t uid_tracker_set(struct uid_tracker *tracker,
+                               pid_t pid, uid_t uid)
+{
+    hash_key_t key;
+    hash_value_t value;
+    uid_t old_uid;
+    errno_t ret;
+    int hret;
+
+    ret = uid_tracker_lookup(tracker, pid, &old_uid);
+    if (ret == EOK) {
+        if (old_uid == uid) {
+            return EOK;
+        }
+
+        ret = uid_tracker_count(tracker, old_uid, -1);
+        if (ret != EOK) {
+            return ret;
+        }
+    } else if (ret != ENOENT) {
+        return ret;
+    }
+
+    key.type = HASH_KEY_ULONG;
+    key.ul = (unsigned long) pid;
+    value.type = HASH_VALUE_ULONG;
+    value.ul = (unsigned long) uid;
+
+    hret = hash_enter(tracker->pids, &key, &value);
+    if (hret != HASH_SUCCESS) {
+        return ENOMEM;
+    }
+
+    return uid_tracker_count(tracker, uid, 1);
+}
+
+static errno_t uid_tracker_remove(struct uid_tracker *tracker, pid_t pid)
+{
+    hash_key_t key;
+    uid_t uid;
+    errno_t ret;
+
+    ret = uid_tracker_lookup(tracker, pid, &uid);
+    if (ret == ENOENT) {
+        return EOK;
+    } else if (ret != EOK) {
+        return ret;
+    }
+
+    key.type = HASH_KEY_ULONG;
+    key.ul = (unsigned long) pid;
+
+    if (hash_delete(tracker->pids, &key) != HASH_SUCCESS) {
+        return EIO;
+    }
+
+    return uid_tracker_count(tracker, uid, -1);
+}
+
+static errno_t uid_tracker_resync(struct uid_tracker *tracker)
+{
+    TALLOC_CTX *tables_ctx;
+    struct hash_iter_context_t *iter;
+    hash_entry_t *entry;
+    hash_table_t *pids;
+    hash_table_t *uids;
+    errno_t ret;
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Reading active processes from /proc\n");
+
+    tables_ctx = talloc_new(tracker);
+    if (tables_ctx == NULL) {
+        return ENOMEM;
+    }
+
+    ret = get_pid_uid_table(tables_ctx, &pids);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_OP_FAILURE, "get_pid_uid_table failed.\n");
+        goto done;
+    }
+
+    ret = sss_hash_create(tables_ctx, UID_TRACKER_UIDS_SIZE, &uids);
+    if (ret != EOK) {
+        goto done;
+    }
+
+    talloc_free(tracker->tables_ctx);
+    tracker->tables_ctx = tables_ctx;
+    tracker->pids = pids;
+    tracker->uids = uids;
+    tables_ctx = NULL;
+
+    iter = new_hash_iter_context(tracker->pids);
+    if (iter == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    while ((entry = iter->next(iter)) != NULL) {
+        ret = uid_tracker_count(tracker, (uid_t) entry->value.ul, 1);
+        if (ret != EOK) {
+            talloc_free(iter);
+            goto done;
+        }
+    }
+    talloc_free(iter);
+
+    tracker->resync = false;
+    ret = EOK;
+
+done:
+    talloc_free(tables_ctx);
+    return ret;
+}
+
+static errno_t uid_tracker_subscribe(int fd, enum proc_cn_mcast_op op)
+{
+    char buf[NLMSG_SPACE(sizeof(struct cn_msg)
+                         + sizeof(enum proc_cn_mcast_op))];
+    struct nlmsghdr *nlh;
+    struct cn_msg *cnmsg;
+    ssize_t len;
+
+    memset(buf, 0, sizeof(buf));
+
+    nlh = (struct nlmsghdr *) buf;
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg)
+                                  + sizeof(enum proc_cn_mcast_op));
+    nlh->nlmsg_type = NLMSG_DONE;
+    nlh->nlmsg_pid = getpid();
+
+    cnmsg = NLMSG_DATA(nlh);
+    cnmsg->id.idx = CN_IDX_PROC;
+    cnmsg->id.val = CN_VAL_PROC;
+    cnmsg->len = sizeof(enum proc_cn_mcast_op);
+    memcpy(cnmsg->data, &op, sizeof(enum proc_cn_mcast_op));
+
+    len = send(fd, nlh, nlh->nlmsg_len, 0);
+    if (len == -1) {
+        return errno;
+    }
+
+    return EOK;
+}
+
+/* Returns EPERM if the kernel refused to send the events. */
+static errno_t uid_tracker_process_event(struct uid_tracker *tracker,
+                                         struct proc_event *ev)
+{
+    uid_t uid;
+    errno_t ret;
+
+    switch (ev->what) {
+    case PROC_EVENT_NONE:
+        if (ev->event_data.ack.err != 0) {
+            return EPERM;
+        }
+        return EOK;
+
+    case PROC_EVENT_FORK:
+        if (ev->event_data.fork.child_pid != ev->event_data.fork.child_tgid) {
+            /* a new thread */
+            return EOK;
+        }
+
+        ret = uid_tracker_lookup(tracker, ev->event_data.fork.parent_tgid,
+                                 &uid);
+        if (ret == ENOENT) {
+            ret = get_process_uid(ev->event_data.fork.child_tgid, &uid);
+            if (ret == ENOENT) {
+                return EOK;
+            }
+        }
+        if (ret != EOK) {
+            return ret;
+        }
+
+        return uid_tracker_set(tracker, ev->event_data.fork.child_tgid, uid);
+
+    case PROC_EVENT_UID:
+        return uid_tracker_set(tracker, ev->event_data.id.process_tgid,
+                               ev->event_data.id.r.ruid);
+
+    case PROC_EVENT_EXIT:
+        if (ev->event_data.exit.process_pid
+                != ev->event_data.exit.process_tgid) {
+            /* only a thread exited */
+            return EOK;
+        }
+
+        return uid_tracker_remove(tracker, ev->event_data.exit.process_tgid);
+
+    default:
+        return EOK;
+    }
+}
+
+/* Processes all events which are queued on the socket. */
+static errno_t uid_tracker_read(struct uid_tracker *tracker)
+{
+    char buf[UID_TRACKER_RECV_BUF]
+            __attribute__ ((aligned(NLMSG_ALIGNTO)));
+    struct sockaddr_nl from;
+    socklen_t from_len;
+    struct nlmsghdr *nlh;
+    struct cn_msg *cnmsg;
+    struct proc_event *ev;
+    ssize_t len;
+    errno_t ret;
+
+    for (;;) {
+        from_len = sizeof(from);
+        len = recvfrom(tracker->fd, buf, sizeof(buf), 0,
+                       (struct sockaddr *) &from, &from_len);
+        if (len == -1) {
+            ret = errno;
+            if (ret == EINTR) {
+                continue;
+            } else if (ret == EAGAIN || ret == EWOULDBLOCK) {
+                return EOK;
+            } else if (ret == ENOBUFS) {
+                DEBUG(SSSDBG_MINOR_FAILURE,
+                      "Process events were lost, resynchronizing.\n");
+                tracker->resync = true;
+                continue;
+            }
+
+            DEBUG(SSSDBG_OP_FAILURE, "recvfrom failed [%d]: %s\n",
+                  ret, sss_strerror(ret));
+            tracker->resync = true;
+            return ret;
+        }
+
+        if (from.nl_pid != 0) {
+            /* not sent by the kernel */
+            continue;
+        }
+
+        for (nlh = (struct nlmsghdr *) buf;
+                NLMSG_OK(nlh, len);
+                nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_NOOP) {
+                continue;
+            }
+
+            if (nlh->nlmsg_type == NLMSG_ERROR
+                    || nlh->nlmsg_type == NLMSG_OVERRUN) {
+                tracker->resync = true;
+                break;
+            }
+
+            cnmsg = NLMSG_DATA(nlh);
+            if (cnmsg->id.idx != CN_IDX_PROC || cnmsg->id.val != CN_VAL_PROC
+                    || cnmsg->len < sizeof(struct proc_event)) {
+                continue;
+            }
+
+            ev = (struct proc_event *) cnmsg->data;
+            if (tracker->resync && ev->what != PROC_EVENT_NONE) {
+                /* the tables are read from /proc anyway, but the
+                 * acknowledgement of the subscription must not be missed */
+                continue;
+            }
+
+            ret = uid_tracker_process_event(tracker, ev);
+            if (ret == EPERM) {
+                return ret;
+            } else if (ret != EOK) {
+                DEBUG(SSSDBG_OP_FAILURE,
+                      "Unable to process event [%d]: %s\n",
+                      ret, sss_strerror(ret));
+                tracker->resync = true;
+            }
+        }
+    }
+}
+
+static void uid_tracker_fd_handler(struct tevent_context *ev,
+                                   struct tevent_fd *fde,
+                                   uint16_t flags,
+                                   void *pvt)
+{
+    struct uid_tracker *tracker = talloc_get_type(pvt, struct uid_tracker);
+    errno_t ret;
+
+    ret = uid_tracker_read(tracker);
+    if (ret == EPERM) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Not allowed to receive process events, "
+              "active users will be read from /proc.\n");
+        talloc_free(tracker);
+    }
+}
+
+/* Makes sure the tables are up to date, returns an error if the tracker
+ * cannot be used. */
+static errno_t uid_tracker_update(void)
+{
+    errno_t ret;
+
+    if (uid_tracker == NULL) {
+        return ENOTSUP;
+    }
+
+    ret = uid_tracker_read(uid_tracker);
+    if (ret == EPERM) {
+        DEBUG(SSSDBG_MINOR_FAILURE, "Not allowed to receive process events, "
+              "active users will be read from /proc.\n");
+        talloc_free(uid_tracker);
+        return ENOTSUP;
+    }
+
+    if (uid_tracker->resync) {
+        ret = uid_tracker_resync(uid_tracker);
+        if (ret != EOK) {
+            DEBUG(SSSDBG_OP_FAILURE, "Unable to read active processes "
+                  "[%d]: %s\n", ret, sss_strerror(ret));
+            return ret;
+        }
+    }
+
+    return EOK;
+}
+
+errno_t uid_tracker_start(TALLOC_CTX *mem_ctx, struct tevent_context *ev)
+{
+    struct uid_tracker *tracker;
+    struct sockaddr_nl addr;
+    errno_t ret;
+
+    if (uid_tracker != NULL) {
+        return EOK;
+    }
+
+    tracker = talloc_zero(mem_ctx, struct uid_tracker);
+    if (tracker == NULL) {
+        return ENOMEM;
+    }
+    tracker->resync = true;
+    talloc_set_destructor(tracker, uid_tracker_destructor);
+
+    tracker->fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                         NETLINK_CONNECTOR);
+    if (tracker->fd == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to open process events socket [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    addr.nl_pid = 0;
+
+    if (bind(tracker->fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        ret = errno;
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to bind process events socket [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    ret = uid_tracker_subscribe(tracker->fd, PROC_CN_MCAST_LISTEN);
+    if (ret != EOK) {
+        DEBUG(SSSDBG_MINOR_FAILURE,
+              "Unable to subscribe to process events [%d]: %s\n",
+              ret, sss_strerror(ret));
+        goto done;
+    }
+
+    tracker->fde = tevent_add_fd(ev, tracker, tracker->fd, TEVENT_FD_READ,
+                                 uid_tracker_fd_handler, tracker);
+    if (tracker->fde == NULL) {
+        ret = ENOMEM;
+        goto done;
+    }
+
+    DEBUG(SSSDBG_TRACE_FUNC, "Tracking active users with process events\n");
+
+    uid_tracker = tracker;
+    ret = EOK;
+
+done:
+    if (ret != EOK) {
+        talloc_free(tracker);
+    }
+
+    return ret;
+}
+
+errno_t uid_tracker_get_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table)
+{
+    struct hash_iter_context_t *iter;
+    hash_entry_t *entry;
+    hash_table_t *result;
+    hash_value_t value;
+    errno_t ret;
+    int hret;
+
+    ret = uid_tracker_update();
+    if (ret != EOK) {
+        return get_uid_table(mem_ctx, table);
+    }
+
+    ret = sss_hash_create(mem_ctx, hash_count(uid_tracker->uids), &result);
+    if (ret != EOK) {
+        return ret;
+    }
+
+    iter = new_hash_iter_context(uid_tracker->uids);
+    if (iter == NULL) {
+        talloc_free(result);
+        return ENOMEM;
+    }
+
+    /* same layout as the table returned by get_uid_table() */
+    value.type = HASH_VALUE_ULONG;
+    while ((entry = iter->next(iter)) != NULL) {
+        value.ul = entry->key.ul;
+        hret = hash_enter(result, &entry->key, &value);
+        if (hret != HASH_SUCCESS) {
+            talloc_free(iter);
+            talloc_free(result);
+            return ENOMEM;
+        }
+    }
+    talloc_free(iter);
+
+    *table = result;
+    return EOK;
+}
+
+#else /* HAVE_LINUX_CN_PROC_H */
+
+errno_t uid_tracker_start(TALLOC_CTX *mem_ctx, struct tevent_context *ev)
+{
+    return ENOTSUP;
+}
+
+errno_t uid_tracker_get_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table)
+{
+    return get_uid_table(mem_ctx, table);
+}
+
+#endif /* HAVE_LINUX_CN_PROC_H */
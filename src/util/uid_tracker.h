@@ -0,0 +1,43 @@
+/*
+    SSSD
+
+    Track the UIDs of running processes
+
+    Copyright (C) 2016 Red Hat
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __UID_TRACKER_H__
+#define __UID_TRACKER_H__
+
+#include <talloc.h>
+#include <tevent.h>
+#include <dhash.h>
+
+#include "util/util.h"
+
+/* Starts following process creation, exit and UID changes with the kernel
+ * process events connector so that the set of active UIDs is known without
+ * reading /proc for every process each time it is needed. There is one
+ * tracker per process, it is stopped when mem_ctx is freed.
+ *
+ * If the process events are not available an error is returned and the
+ * functions below read /proc instead. */
+errno_t uid_tracker_start(TALLOC_CTX *mem_ctx, struct tevent_context *ev);
+
+/* Same as get_uid_table() but answered by the tracker if it runs. */
+errno_t uid_tracker_get_uid_table(TALLOC_CTX *mem_ctx, hash_table_t **table);
+
+#endif /* __UID_TRACKER_H__ */